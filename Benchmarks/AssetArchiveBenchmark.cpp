@@ -0,0 +1,202 @@
+#include "Benchmark.h"
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Sigma;
+
+const char* kLooseDirectory = "AssetArchiveBenchmark.data";
+const char* kArchivePath = "AssetArchiveBenchmark.pak";
+const char* kCompressedPath = "AssetArchiveBenchmark.compressed.pak";
+
+// Writes back and drops the file from the page cache, so the next read comes from the disk
+static void DropFromCache(const char* path)
+{
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return;
+	fdatasync(file);
+	posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+	close(file);
+}
+
+// What loading assets did before the archive : open, size, read the whole file into a new vector
+static std::vector<uint8_t> ReadLooseFile(const char* path)
+{
+	std::vector<uint8_t> data;
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return data;
+	struct stat status;
+	fstat(file, &status);
+	data.resize((size_t)status.st_size);
+	size_t done = 0;
+	while (done < data.size())
+	{
+		ssize_t result = read(file, data.data() + done, data.size() - done);
+		if (result <= 0)
+			break;
+		done += (size_t)result;
+	}
+	close(file);
+	return data;
+}
+
+static double Milliseconds(const BenchmarkTimer& timer)
+{
+	return timer.GetSeconds() * 1000.0;
+}
+
+// Every asset copied into an upload sized buffer, from loose files then from the archive. Open to first byte is the time
+// until the first byte of the first asset can be read
+static void CompareLoading(const std::vector<std::string>& names, uint64_t totalSize, bool cold, uint32_t runs)
+{
+	std::vector<uint8_t> upload(1 << 20);
+	double looseFirstByte = 1e9, looseTotal = 1e9, archiveFirstByte = 1e9, archiveTotal = 1e9;
+	uint64_t sum = 0;
+	for (uint32_t run = 0; run < runs; run++)
+	{
+		if (cold)
+		{
+			for (const std::string& name : names)
+			{
+				DropFromCache(name.c_str());
+			}
+		}
+		BenchmarkTimer timer;
+		std::vector<uint8_t> first = ReadLooseFile(names[0].c_str());
+		sum += first[0];
+		looseFirstByte = std::min(looseFirstByte, Milliseconds(timer));
+		memcpy(upload.data(), first.data(), first.size());
+		for (size_t i = 1; i < names.size(); i++)
+		{
+			std::vector<uint8_t> data = ReadLooseFile(names[i].c_str());
+			memcpy(upload.data(), data.data(), data.size());
+		}
+		looseTotal = std::min(looseTotal, Milliseconds(timer));
+
+		if (cold)
+			DropFromCache(kArchivePath);
+		timer.Restart();
+		AssetArchive archive;
+		archive.Open(kArchivePath);
+		AssetSpan span = archive.GetSpan(*archive.Find(names[0].c_str()));
+		sum += span.m_data[0];
+		archiveFirstByte = std::min(archiveFirstByte, Milliseconds(timer));
+		memcpy(upload.data(), span.m_data, (size_t)span.m_size);
+		for (size_t i = 1; i < names.size(); i++)
+		{
+			span = archive.GetSpan(*archive.Find(names[i].c_str()));
+			memcpy(upload.data(), span.m_data, (size_t)span.m_size);
+		}
+		archiveTotal = std::min(archiveTotal, Milliseconds(timer));
+	}
+	Consume(sum + upload[0]);
+
+	const char* cache = cold ? "cold" : "warm";
+	char name[128];
+	snprintf(name, sizeof(name), "%s, loose files, open to first byte", cache);
+	PrintResult(name, looseFirstByte, "ms");
+	snprintf(name, sizeof(name), "%s, loose files, all assets", cache);
+	PrintResult(name, totalSize / (looseTotal / 1000.0) / (1024.0 * 1024.0), "MiB/s");
+	snprintf(name, sizeof(name), "%s, archive, open to first byte", cache);
+	PrintResult(name, archiveFirstByte, "ms");
+	snprintf(name, sizeof(name), "%s, archive, all assets", cache);
+	PrintResult(name, totalSize / (archiveTotal / 1000.0) / (1024.0 * 1024.0), "MiB/s");
+}
+
+// Shader-like text : the compression ratio, then how fast it compresses into the archive and decompresses out of it
+static void MeasureCompression(uint32_t size, uint32_t runs)
+{
+	static const char* words[] = { "float4 ", "return ", "texture", "sampler", "cbuffer ", "struct ", "\n\t", "SV_Position", "0.0f, ", "matrix " };
+	std::mt19937 random(5);
+	std::vector<uint8_t> text;
+	while (text.size() < size)
+	{
+		for (const char* c = words[random() % 10]; *c != 0; c++)
+		{
+			text.push_back((uint8_t)*c);
+		}
+	}
+	text.resize(size);
+
+	BenchmarkTimer timer;
+	AssetArchiveWriter writer;
+	writer.Add("text", text.data(), text.size(), true);
+	double compressSeconds = timer.GetSeconds();
+	writer.Write(kCompressedPath);
+
+	AssetArchive archive;
+	archive.Open(kCompressedPath);
+	const AssetArchiveEntry* entry = archive.Find("text");
+	std::vector<uint8_t> output(size);
+	JobSystem jobSystem;
+	double seconds[2] = { 1e9, 1e9 };
+	for (uint32_t run = 0; run < runs; run++)
+	{
+		for (uint32_t jobs = 0; jobs < 2; jobs++)
+		{
+			timer.Restart();
+			archive.Read(*entry, output.data(), jobs != 0 ? &jobSystem : nullptr);
+			seconds[jobs] = std::min(seconds[jobs], timer.GetSeconds());
+		}
+	}
+	Consume(output[size / 2]);
+	uint64_t storedSize = entry->m_storedSize;
+	archive.Close();
+	remove(kCompressedPath);
+
+	double mebibytes = size / (1024.0 * 1024.0);
+	PrintResult("Shader text, compressed size", 100.0 * storedSize / size, "%");
+	PrintResult("Shader text, compression", mebibytes / compressSeconds, "MiB/s");
+	PrintResult("Shader text, decompression, 1 thread", mebibytes / seconds[0], "MiB/s");
+	PrintResult("Shader text, decompression, jobs", mebibytes / seconds[1], "MiB/s");
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t numAssets = quick ? 50 : 1000;
+	uint32_t runs = quick ? 1 : 3;
+
+	// Random bytes the size of textures and buffers, 4 KiB to 516 KiB
+	mkdir(kLooseDirectory, 0755);
+	std::mt19937 random(3);
+	std::vector<std::string> names;
+	uint64_t totalSize = 0;
+	AssetArchiveWriter writer;
+	for (uint32_t i = 0; i < numAssets; i++)
+	{
+		std::vector<uint8_t> data(4096 + random() % (512 * 1024));
+		for (uint8_t& byte : data)
+		{
+			byte = (uint8_t)random();
+		}
+		names.push_back(std::string(kLooseDirectory) + "/Asset" + std::to_string(i) + ".bin");
+		FILE* file = fopen(names.back().c_str(), "wb");
+		fwrite(data.data(), 1, data.size(), file);
+		fclose(file);
+		writer.Add(names.back().c_str(), data.data(), data.size(), false);
+		totalSize += data.size();
+	}
+	writer.Write(kArchivePath);
+	printf("%u assets, %.1f MiB\n", numAssets, totalSize / (1024.0 * 1024.0));
+
+	CompareLoading(names, totalSize, false, runs);
+	CompareLoading(names, totalSize, true, runs);
+	MeasureCompression(quick ? (4 << 20) : (64 << 20), runs);
+
+	for (const std::string& name : names)
+	{
+		remove(name.c_str());
+	}
+	rmdir(kLooseDirectory);
+	remove(kArchivePath);
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include "Benchmark.h"
+#include "BcDecoder.h"
+#include "BcEncoder.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+// Smooth waves, flat shapes with sharp edges and some noise, closer to photos and painted textures than a gradient
+static std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> texels((size_t)width * height * 4);
+	std::mt19937 random(1);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			double u = x / (double)width;
+			double v = y / (double)height;
+			double color[3] = { 128 + 100 * std::sin(u * 9 + v * 3), 128 + 90 * std::cos(v * 7 - u * 2), 128 + 60 * std::sin((u + v) * 13) };
+			if (((x / 37) + (y / 53)) % 5 == 0)
+			{
+				color[0] = 230;
+				color[1] = 40;
+				color[2] = 30;
+			}
+			double noise = (double)(random() % 17) - 8.0;
+			uint8_t* texel = &texels[((size_t)y * width + x) * 4];
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				texel[c] = (uint8_t)std::min(std::max(color[c] + noise, 0.0), 255.0);
+			}
+			texel[3] = (uint8_t)(128 + 127 * std::sin(u * 5) * std::cos(v * 4));
+		}
+	}
+	return texels;
+}
+
+// Channels the format stores besides alpha, and whether it stores alpha
+static uint32_t GetColorChannelCount(BcFormat format)
+{
+	return format == BcFormat::BC4 ? 1 : format == BcFormat::BC5 ? 2 : 3;
+}
+
+static bool HasAlpha(BcFormat format)
+{
+	return format == BcFormat::BC3 || format == BcFormat::BC7;
+}
+
+static void DecodeBlock(BcFormat format, const uint8_t* block, uint8_t texels[16][4])
+{
+	switch (format)
+	{
+	case BcFormat::BC1:
+		BcDecoder::DecodeBc1(block, texels, false);
+		break;
+	case BcFormat::BC3:
+		BcDecoder::DecodeBc1(block + 8, texels, true);
+		BcDecoder::DecodeBc4(block, texels, 3);
+		break;
+	case BcFormat::BC4:
+		BcDecoder::DecodeBc4(block, texels, 0);
+		break;
+	case BcFormat::BC5:
+		BcDecoder::DecodeBc4(block, texels, 0);
+		BcDecoder::DecodeBc4(block + 8, texels, 1);
+		break;
+	case BcFormat::BC7:
+		BcDecoder::DecodeBc7(block, texels);
+		break;
+	}
+}
+
+static double GetPsnr(double squaredError, double count)
+{
+	return squaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * count / squaredError);
+}
+
+// Encode throughput in millions of source texels per second (best of a few runs), then the PSNR of the blocks decoded
+// back. BC1 skips the texels it makes transparent
+static void Measure(const char* formatName, BcFormat format, uint32_t quality, JobSystem* jobSystem, const std::vector<uint8_t>& image, uint32_t width, uint32_t height, uint32_t runs)
+{
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	uint64_t rowPitch = blocksX * GetBcBlockSize(format);
+	std::vector<uint8_t> blocks(rowPitch * blocksY);
+
+	double best = 1e9;
+	for (uint32_t run = 0; run < runs; run++)
+	{
+		BenchmarkTimer timer;
+		EncodeBc(format, image.data(), width * 4, width, height, blocks.data(), rowPitch, quality, jobSystem);
+		best = std::min(best, timer.GetSeconds());
+	}
+
+	double colorError = 0.0;
+	double alphaError = 0.0;
+	double count = 0.0;
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			uint8_t texels[16][4] = {};
+			DecodeBlock(format, &blocks[blockY * rowPitch + blockX * GetBcBlockSize(format)], texels);
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = blockX * 4 + i % 4;
+				uint32_t y = blockY * 4 + i / 4;
+				const uint8_t* source = &image[((size_t)y * width + x) * 4];
+				if (x >= width || y >= height || (format == BcFormat::BC1 && source[3] < 128))
+					continue;
+				for (uint32_t c = 0; c < GetColorChannelCount(format); c++)
+				{
+					colorError += ((double)source[c] - texels[i][c]) * ((double)source[c] - texels[i][c]);
+				}
+				alphaError += ((double)source[3] - texels[i][3]) * ((double)source[3] - texels[i][3]);
+				count++;
+			}
+		}
+	}
+
+	char name[128];
+	snprintf(name, sizeof(name), "%s, quality %u, %s", formatName, quality, jobSystem != nullptr ? "jobs" : "1 thread");
+	PrintResult(name, width * (double)height / best / 1e6, "MPixels/s");
+	if (jobSystem == nullptr)
+	{
+		snprintf(name, sizeof(name), "%s, quality %u, PSNR", formatName, quality);
+		PrintResult(name, GetPsnr(colorError, count * GetColorChannelCount(format)), "dB");
+		if (HasAlpha(format))
+		{
+			snprintf(name, sizeof(name), "%s, quality %u, alpha PSNR", formatName, quality);
+			PrintResult(name, GetPsnr(alphaError, count), "dB");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t width = quick ? 128 : 1024;
+	uint32_t height = quick ? 128 : 1024;
+	uint32_t runs = quick ? 1 : 3;
+	std::vector<uint8_t> image = MakeImage(width, height);
+	JobSystem jobSystem;
+	printf("%ux%u image, %u job system threads\n", width, height, jobSystem.GetThreadCount());
+
+	const char* formatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+	const BcFormat formats[] = { BcFormat::BC1, BcFormat::BC3, BcFormat::BC4, BcFormat::BC5, BcFormat::BC7 };
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		// BC4 and BC5 have no quality setting
+		uint32_t maxQuality = formats[i] == BcFormat::BC4 || formats[i] == BcFormat::BC5 ? 0 : kMaxBcQuality;
+		for (uint32_t quality = 0; quality <= maxQuality; quality += quality < 2 ? 1 : 2)
+		{
+			Measure(formatNames[i], formats[i], quality, nullptr, image, width, height, runs);
+		}
+		Measure(formatNames[i], formats[i], std::min(maxQuality, 1u), &jobSystem, image, width, height, runs);
+	}
+	return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace Sigma
+{
+	// With --quick, benchmarks run a reduced workload : ctest runs them that way so they keep building and working
+	inline bool IsQuickRun(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--quick") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	class BenchmarkTimer
+	{
+	public:
+		BenchmarkTimer() : m_start(std::chrono::steady_clock::now()) {}
+
+		void Restart() { m_start = std::chrono::steady_clock::now(); }
+		double GetSeconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count(); }
+
+	private:
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	// Results go through a volatile, so the work producing them is not optimized away
+	inline void Consume(uint64_t value)
+	{
+		static volatile uint64_t sink;
+		sink = sink + value;
+	}
+
+	inline void PrintResult(const char* name, double value, const char* unit)
+	{
+		printf("%-56s %14.2f %s\n", name, value, unit);
+	}
+}
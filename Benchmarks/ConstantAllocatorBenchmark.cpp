@@ -0,0 +1,86 @@
+#include "Benchmark.h"
+#include "MockDevice.h"
+#include "ConstantAllocator.h"
+#include "JobSystem.h"
+
+using namespace Sigma;
+
+const uint32_t kFramesInFlight = 3;
+const UINT64 kFrameSize = 32 * 1024 * 1024;
+
+template<uint32_t Size>
+struct Constants
+{
+	float m_values[Size / sizeof(float)];
+};
+
+// Frames of draws writing their constants, on one thread or spread over the job system threads
+template<uint32_t Size>
+static void WriteFrames(ConstantAllocator& allocator, JobSystem* jobSystem, uint32_t numFrames, uint32_t drawsPerFrame)
+{
+	Constants<Size> constants = {};
+	std::atomic<uint64_t> failed(0);
+	std::atomic<uint64_t> addresses(0);
+
+	BenchmarkTimer timer;
+	for (uint32_t frame = 0; frame < numFrames; frame++)
+	{
+		allocator.BeginFrame(frame % kFramesInFlight);
+		auto draw = [&](uint32_t i)
+		{
+			constants.m_values[0] = (float)i;
+			D3D12_GPU_VIRTUAL_ADDRESS address = allocator.Write(constants);
+			if (address == 0)
+				failed.fetch_add(1, std::memory_order_relaxed);
+			addresses.fetch_add(address, std::memory_order_relaxed);
+		};
+
+		if (jobSystem != nullptr)
+		{
+			jobSystem->ParallelFor(drawsPerFrame, 256, draw);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < drawsPerFrame; i++)
+			{
+				draw(i);
+			}
+		}
+	}
+	double seconds = timer.GetSeconds();
+	Consume(addresses);
+
+	uint64_t writes = (uint64_t)numFrames * drawsPerFrame - failed;
+	char name[128];
+	snprintf(name, sizeof(name), "%u B constants, %u draws/frame, %s", Size, drawsPerFrame, jobSystem != nullptr ? "jobs" : "1 thread");
+	PrintResult(name, writes / seconds / 1e6, "M allocations/s");
+	snprintf(name, sizeof(name), "%u B constants, %u draws/frame, %s, written", Size, drawsPerFrame, jobSystem != nullptr ? "jobs" : "1 thread");
+	PrintResult(name, writes * Size / seconds / (1024.0 * 1024.0 * 1024.0), "GiB/s");
+	if (failed > 0)
+	{
+		snprintf(name, sizeof(name), "%u B constants, %u draws/frame, out of memory", Size, drawsPerFrame);
+		PrintResult(name, 100.0 * failed / ((uint64_t)numFrames * drawsPerFrame), "%");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t numFrames = quick ? 3 : 300;
+
+	ComPtr<ID3D12Device> device;
+	device.Attach(CreateMockDevice());
+	ConstantAllocator allocator(device, kFramesInFlight, kFrameSize);
+	JobSystem jobSystem;
+
+	printf("%u frames of %llu MiB on a mock device, %u job system threads\n", numFrames, (unsigned long long)(kFrameSize >> 20), jobSystem.GetThreadCount());
+
+	WriteFrames<64>(allocator, nullptr, numFrames, 10000);
+	WriteFrames<256>(allocator, nullptr, numFrames, 10000);
+	WriteFrames<1024>(allocator, nullptr, numFrames, 10000);
+	WriteFrames<256>(allocator, &jobSystem, numFrames, 100000);
+
+	// Every allocation takes 256 bytes : past 128K draws the frame is out of constant memory and the writes fail
+	WriteFrames<64>(allocator, nullptr, numFrames, 160000);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include "Benchmark.h"
+#include "CpuProfiler.h"
+#include <thread>
+#include <vector>
+
+using namespace Sigma;
+
+// What a scope cost before it used the timestamp counter : both ends on the steady clock
+class SteadyClockScope
+{
+public:
+	explicit SteadyClockScope(const char* name) :
+		m_name(name),
+		m_begin(CpuProfiler::Now())
+	{
+	}
+
+	~SteadyClockScope()
+	{
+		CpuProfiler::Record(m_name, m_begin, CpuProfiler::Now());
+	}
+
+private:
+	const char* m_name;
+	uint64_t m_begin;
+};
+
+template<typename Scope>
+static double MeasureScopes(uint32_t count)
+{
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Scope scope("Empty");
+	}
+	return timer.GetSeconds() * 1e9 / count;
+}
+
+template<typename Clock>
+static double MeasureClock(uint32_t count, Clock clock)
+{
+	uint64_t sum = 0;
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		sum += clock();
+	}
+	double seconds = timer.GetSeconds();
+	Consume(sum);
+	return seconds * 1e9 / count;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t count = quick ? 100000 : 20000000;
+
+	PrintResult("CpuProfiler::Now", MeasureClock(count, []() { return CpuProfiler::Now(); }), "ns");
+	PrintResult("CpuProfiler::GetTicks", MeasureClock(count, []() { return CpuProfiler::GetTicks(); }), "ns");
+	PrintResult("Empty scope, steady clock", MeasureScopes<SteadyClockScope>(count), "ns");
+	PrintResult("Empty scope, CpuProfileScope", MeasureScopes<CpuProfileScope>(count), "ns");
+
+	// Several threads recording at once only share the registry on their first scope
+	uint32_t numThreads = 4;
+	std::vector<std::thread> threads;
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back([count, numThreads]() { MeasureScopes<CpuProfileScope>(count / numThreads); });
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	PrintResult("Empty scopes, CpuProfileScope, 4 threads", count / timer.GetSeconds() / 1e6, "M/s");
+
+	// Conversion to nanoseconds, and how far it drifts from the steady clock
+	uint64_t ticks = CpuProfiler::GetTicks();
+	uint64_t now = CpuProfiler::Now();
+	PrintResult("Tick conversion, difference with the steady clock", ((double)CpuProfiler::TicksToNanoseconds(ticks) - (double)now) / 1000.0, "us");
+	PrintResult("CpuProfiler::TicksToNanoseconds", MeasureClock(count, [ticks]() { return CpuProfiler::TicksToNanoseconds(ticks); }), "ns");
+	return 0;
+}
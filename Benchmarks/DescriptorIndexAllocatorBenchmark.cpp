@@ -0,0 +1,102 @@
+#include "Benchmark.h"
+#include "DescriptorIndexAllocator.h"
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint32_t kCapacity = 1 << 20;
+const uint32_t kRangeCapacity = 1 << 18;
+const uint64_t kFramesInFlight = 2;
+
+// Fills the single descriptor part, frees all of it and fills it again from the free list
+static void FillAndFree(uint32_t rounds)
+{
+	DescriptorIndexAllocator allocator(kCapacity, kRangeCapacity);
+	std::vector<uint32_t> indices;
+	indices.reserve(kCapacity);
+	uint64_t operations = 0;
+
+	BenchmarkTimer timer;
+	for (uint32_t round = 0; round < rounds; round++)
+	{
+		for (uint32_t index = allocator.Allocate(); index != kInvalidDescriptorIndex; index = allocator.Allocate())
+		{
+			indices.push_back(index);
+		}
+		for (uint32_t index : indices)
+		{
+			allocator.Free(index);
+		}
+		operations += 2 * indices.size();
+		indices.clear();
+		allocator.Submit(round + 1);
+		allocator.Retire(round + 1);
+	}
+	PrintResult("1M heap, fill and free singles", operations / timer.GetSeconds() / 1e6, "M operations/s");
+}
+
+// Frames freeing and allocating random descriptors of a heap kept mostly full, like streaming views
+static void Churn(uint32_t numFrames, uint32_t perFrame, bool ranges)
+{
+	DescriptorIndexAllocator allocator(kCapacity, kRangeCapacity);
+	std::mt19937 random(3);
+
+	struct Allocation
+	{
+		uint32_t m_first;
+		uint32_t m_count;
+	};
+	std::vector<Allocation> live;
+	uint32_t target = ranges ? kRangeCapacity * 3 / 4 : (kCapacity - kRangeCapacity) * 3 / 4;
+	for (uint32_t used = 0; used < target;)
+	{
+		uint32_t count = ranges ? 1 + random() % 64 : 1;
+		uint32_t first = ranges ? allocator.AllocateRange(count) : allocator.Allocate();
+		live.push_back({ first, count });
+		used += count;
+	}
+
+	uint64_t operations = 0;
+	uint64_t failures = 0;
+	BenchmarkTimer timer;
+	for (uint32_t frame = 1; frame <= numFrames; frame++)
+	{
+		for (uint32_t i = 0; i < perFrame && !live.empty(); i++)
+		{
+			size_t victim = random() % live.size();
+			allocator.FreeRange(live[victim].m_first, live[victim].m_count);
+			live[victim] = live.back();
+			live.pop_back();
+
+			uint32_t count = ranges ? 1 + random() % 64 : 1;
+			uint32_t first = ranges ? allocator.AllocateRange(count) : allocator.Allocate();
+			if (first == kInvalidDescriptorIndex)
+				failures++;
+			else
+				live.push_back({ first, count });
+			operations += 2;
+		}
+		allocator.Submit(frame);
+		if (frame > kFramesInFlight)
+			allocator.Retire(frame - kFramesInFlight);
+	}
+	double seconds = timer.GetSeconds();
+
+	const char* kind = ranges ? "ranges of 1-64" : "singles";
+	char name[128];
+	snprintf(name, sizeof(name), "1M heap 75%% full, churn of %s", kind);
+	PrintResult(name, operations / seconds / 1e6, "M operations/s");
+	snprintf(name, sizeof(name), "1M heap 75%% full, churn of %s, failed", kind);
+	PrintResult(name, 100.0 * failures / (operations / 2), "%");
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+
+	FillAndFree(quick ? 1 : 20);
+	Churn(quick ? 10 : 2000, 1000, false);
+	Churn(quick ? 10 : 2000, 1000, true);
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include "Benchmark.h"
+#include "FrameGraph.h"
+#include <random>
+
+using namespace Sigma;
+
+const uint64_t kPlacementAlignment = 65536;
+
+/*
+Synthetic frame: every pass reads the outputs of the last few passes and writes a new render target, a few targets
+stay alive much longer (history, shadow maps), and some passes write debug targets nothing reads.
+*/
+static void BuildGraph(FrameGraph& graph, uint32_t numPasses, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	graph.Reset();
+	static int backBuffer;
+	FrameGraphResource target = graph.Import("Back buffer", &backBuffer);
+
+	std::vector<FrameGraphResource> outputs;
+	std::vector<FrameGraphResource> longLived;
+	for (uint32_t i = 0; i < numPasses; i++)
+	{
+		uint32_t pass = graph.AddPass("Pass", nullptr);
+		for (uint32_t input = 1; input <= 3 && input <= outputs.size(); input++)
+		{
+			if (random() % 2 == 0)
+				graph.Read(pass, outputs[outputs.size() - input], 0);
+		}
+		if (!longLived.empty() && random() % 8 == 0)
+			graph.Read(pass, longLived[random() % longLived.size()], 0);
+
+		// Render targets from 64 KiB to 32 MiB, most of them small
+		TransientResourceDesc desc = {};
+		desc.m_width = 1 + random() % 4096;
+		desc.m_height = 1 + random() % 4096;
+		desc.m_size = kPlacementAlignment << (random() % 6 == 0 ? random() % 10 : random() % 4);
+		desc.m_alignment = kPlacementAlignment;
+		FrameGraphResource output = graph.CreateTransient("Target", desc);
+		graph.Write(pass, output, 0);
+
+		if (random() % 16 == 0)
+			graph.Write(pass, graph.CreateTransient("Debug", desc), 0);
+		if (random() % 64 == 0)
+			longLived.push_back(output);
+		outputs.push_back(output);
+	}
+
+	uint32_t present = graph.AddPass("Present", nullptr);
+	graph.Read(present, outputs.back(), 0);
+	for (FrameGraphResource resource : longLived)
+	{
+		graph.Read(present, resource, 0);
+	}
+	graph.Write(present, target, 0);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t sizes[] = { 16, 1000, 4000, 16000 };
+
+	for (uint32_t numPasses : sizes)
+	{
+		if (quick && numPasses > 1000)
+			break;
+
+		FrameGraph graph;
+		BuildGraph(graph, numPasses, numPasses);
+
+		// Compile is called every frame, on a graph built the same way
+		uint32_t repeats = quick ? 3 : (numPasses <= 1000 ? 200 : 20);
+		BenchmarkTimer timer;
+		for (uint32_t i = 0; i < repeats; i++)
+		{
+			graph.Compile();
+		}
+		double compileMs = timer.GetSeconds() * 1000.0 / repeats;
+
+		timer.Restart();
+		for (uint32_t i = 0; i < repeats; i++)
+		{
+			BuildGraph(graph, numPasses, numPasses);
+		}
+		double buildMs = timer.GetSeconds() * 1000.0 / repeats;
+		graph.Compile();
+
+		char name[128];
+		snprintf(name, sizeof(name), "%u passes, build", numPasses);
+		PrintResult(name, buildMs, "ms");
+		snprintf(name, sizeof(name), "%u passes, compile", numPasses);
+		PrintResult(name, compileMs, "ms");
+		snprintf(name, sizeof(name), "%u passes, culled passes", numPasses);
+		PrintResult(name, graph.GetCulledPassCount(), "");
+		snprintf(name, sizeof(name), "%u passes, transient resources without aliasing", numPasses);
+		PrintResult(name, graph.GetTransientSize() / (1024.0 * 1024.0), "MiB");
+		snprintf(name, sizeof(name), "%u passes, transient heap", numPasses);
+		PrintResult(name, graph.GetHeapSize() / (1024.0 * 1024.0), "MiB");
+		snprintf(name, sizeof(name), "%u passes, memory saved by aliasing", numPasses);
+		PrintResult(name, 100.0 * (1.0 - (double)graph.GetHeapSize() / graph.GetTransientSize()), "%");
+	}
+	return 0;
+}
@@ -0,0 +1,276 @@
+#include "Benchmark.h"
+#include "HandlePool.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace Sigma;
+
+// Stands in for ID3D12Resource : a heap object with an atomic reference count
+struct FakeResource
+{
+	std::atomic<uint32_t> m_refCount{ 1 };
+	uint64_t m_gpuAddress = 0;
+
+	void AddRef() { m_refCount.fetch_add(1, std::memory_order_relaxed); }
+	void Release()
+	{
+		if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+};
+
+// Same size as D3D12_RESOURCE_DESC and GpuAllocation
+struct FakeDesc
+{
+	uint32_t m_dimension;
+	uint64_t m_alignment;
+	uint64_t m_width;
+	uint32_t m_height;
+	uint16_t m_depthOrArraySize;
+	uint16_t m_mipLevels;
+	uint32_t m_format;
+	uint32_t m_sampleCount;
+	uint32_t m_sampleQuality;
+	uint32_t m_layout;
+	uint32_t m_flags;
+};
+
+struct FakeAllocation
+{
+	uint64_t m_offset;
+	uint64_t m_size;
+	uint32_t m_heapIndex;
+	uint32_t m_block;
+	uint32_t m_residencyHandle;
+};
+
+// ResourceRegistry's layout without the device : one array per field kept packed by a HandlePool, a single reference
+// held on each resource, raw pointers returned by lookups
+class PackedRegistry
+{
+public:
+	Handle Create(uint32_t i)
+	{
+		Handle handle = m_handles.Allocate();
+		m_resources.push_back(new FakeResource());
+		m_descs.push_back(FakeDesc{ 1, 65536, i, 1, 1, 1, 2, 1, 0, 1, 0 });
+		m_allocations.push_back(FakeAllocation{ i * 65536ull, 65536, 0, i, i & 7 });
+		m_residencyHandles.push_back(i & 7);
+		m_srvIndices.push_back(i);
+		return handle;
+	}
+
+	void Destroy(Handle handle)
+	{
+		uint32_t denseIndex = m_handles.Free(handle);
+		if (denseIndex == kInvalidDenseIndex)
+			return;
+
+		m_resources[denseIndex]->Release();
+		m_resources[denseIndex] = m_resources.back();
+		m_descs[denseIndex] = m_descs.back();
+		m_allocations[denseIndex] = m_allocations.back();
+		m_residencyHandles[denseIndex] = m_residencyHandles.back();
+		m_srvIndices[denseIndex] = m_srvIndices.back();
+
+		m_resources.pop_back();
+		m_descs.pop_back();
+		m_allocations.pop_back();
+		m_residencyHandles.pop_back();
+		m_srvIndices.pop_back();
+	}
+
+	FakeResource* GetResource(Handle handle) const
+	{
+		uint32_t denseIndex = m_handles.GetDenseIndex(handle);
+		return denseIndex != kInvalidDenseIndex ? m_resources[denseIndex] : nullptr;
+	}
+	const FakeAllocation& GetAllocation(Handle handle) const { return m_allocations[m_handles.GetDenseIndex(handle)]; }
+	const std::vector<uint32_t>& GetResidencyHandles() const { return m_residencyHandles; }
+
+private:
+	HandlePool m_handles;
+	std::vector<FakeResource*> m_resources;
+	std::vector<FakeDesc> m_descs;
+	std::vector<FakeAllocation> m_allocations;
+	std::vector<uint32_t> m_residencyHandles;
+	std::vector<uint32_t> m_srvIndices;
+};
+
+// What the registry replaced : metadata in a node per resource, keyed by the resource pointer, and lookups taking a
+// reference like copying a ComPtr does
+class MapRegistry
+{
+public:
+	struct Entry
+	{
+		FakeResource* m_resource;
+		FakeDesc m_desc;
+		FakeAllocation m_allocation;
+		uint32_t m_srvIndex;
+	};
+
+	FakeResource* Create(uint32_t i)
+	{
+		FakeResource* resource = new FakeResource();
+		Entry entry = { resource, FakeDesc{ 1, 65536, i, 1, 1, 1, 2, 1, 0, 1, 0 }, FakeAllocation{ i * 65536ull, 65536, 0, i, i & 7 }, i };
+		m_entries.emplace(resource, entry);
+		return resource;
+	}
+
+	void Destroy(FakeResource* resource)
+	{
+		auto it = m_entries.find(resource);
+		if (it == m_entries.end())
+			return;
+		it->second.m_resource->Release();
+		m_entries.erase(it);
+	}
+
+	const std::unordered_map<FakeResource*, Entry>& GetEntries() const { return m_entries; }
+
+private:
+	std::unordered_map<FakeResource*, Entry> m_entries;
+};
+
+static void PrintNanoseconds(uint32_t count, const char* registry, const char* operation, double seconds, uint64_t operations)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "%u resources, %s, %s", count, registry, operation);
+	PrintResult(name, seconds * 1e9 / operations, "ns");
+}
+
+// Creates count resources, looks them up and destroys them in random order, repeats enough times to fill a few million
+// operations. Lookups read the resource and its allocation, as recording a barrier or a draw does
+static void Compare(uint32_t count, uint32_t totalOperations)
+{
+	uint32_t rounds = std::max(totalOperations / count, 1u);
+	uint64_t operations = (uint64_t)count * rounds;
+	std::mt19937 random(count);
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), random);
+
+	{
+		PackedRegistry registry;
+		std::vector<Handle> handles(count);
+		std::vector<Handle> stale(count);
+		double create = 0.0, lookup = 0.0, staleLookup = 0.0, iterate = 0.0, destroy = 0.0;
+		uint64_t sum = 0;
+		for (uint32_t round = 0; round < rounds; round++)
+		{
+			BenchmarkTimer timer;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				handles[i] = registry.Create(i);
+			}
+			create += timer.GetSeconds();
+
+			timer.Restart();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Handle handle = handles[order[i]];
+				sum += (uint64_t)(uintptr_t)registry.GetResource(handle) + registry.GetAllocation(handle).m_offset;
+			}
+			lookup += timer.GetSeconds();
+
+			// Handles from the previous round, their slots are in use again
+			if (round > 0)
+			{
+				timer.Restart();
+				for (uint32_t i = 0; i < count; i++)
+				{
+					sum += registry.GetResource(stale[order[i]]) == nullptr;
+				}
+				staleLookup += timer.GetSeconds();
+			}
+
+			// One field over every resource, like MarkUsed
+			timer.Restart();
+			for (uint32_t residencyHandle : registry.GetResidencyHandles())
+			{
+				sum += residencyHandle;
+			}
+			iterate += timer.GetSeconds();
+
+			timer.Restart();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				registry.Destroy(handles[order[i]]);
+			}
+			destroy += timer.GetSeconds();
+			std::swap(handles, stale);
+		}
+		Consume(sum);
+
+		PrintNanoseconds(count, "handles", "create", create, operations);
+		PrintNanoseconds(count, "handles", "lookup", lookup, operations);
+		if (rounds > 1)
+			PrintNanoseconds(count, "handles", "stale lookup", staleLookup, operations - count);
+		PrintNanoseconds(count, "handles", "iterate", iterate, operations);
+		PrintNanoseconds(count, "handles", "destroy", destroy, operations);
+	}
+
+	{
+		MapRegistry registry;
+		std::vector<FakeResource*> keys(count);
+		double create = 0.0, lookup = 0.0, iterate = 0.0, destroy = 0.0;
+		uint64_t sum = 0;
+		for (uint32_t round = 0; round < rounds; round++)
+		{
+			BenchmarkTimer timer;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				keys[i] = registry.Create(i);
+			}
+			create += timer.GetSeconds();
+
+			timer.Restart();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const MapRegistry::Entry& entry = registry.GetEntries().find(keys[order[i]])->second;
+				entry.m_resource->AddRef();
+				sum += (uint64_t)(uintptr_t)entry.m_resource + entry.m_allocation.m_offset;
+				entry.m_resource->Release();
+			}
+			lookup += timer.GetSeconds();
+
+			timer.Restart();
+			for (const auto& entry : registry.GetEntries())
+			{
+				sum += entry.second.m_allocation.m_residencyHandle;
+			}
+			iterate += timer.GetSeconds();
+
+			timer.Restart();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				registry.Destroy(keys[order[i]]);
+			}
+			destroy += timer.GetSeconds();
+		}
+		Consume(sum);
+
+		PrintNanoseconds(count, "map", "create", create, operations);
+		PrintNanoseconds(count, "map", "lookup", lookup, operations);
+		PrintNanoseconds(count, "map", "iterate", iterate, operations);
+		PrintNanoseconds(count, "map", "destroy", destroy, operations);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t totalOperations = quick ? 100000 : 4000000;
+
+	Compare(1024, totalOperations);
+	Compare(16384, totalOperations);
+	Compare(262144, totalOperations);
+	return 0;
+}
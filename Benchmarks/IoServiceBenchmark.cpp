@@ -0,0 +1,225 @@
+#include "Benchmark.h"
+#include "IoService.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Sigma;
+
+const char* kDirectory = "IoServiceBenchmark.data";
+const uint64_t kMiB = 1024 * 1024;
+
+struct FileSet
+{
+	std::vector<std::string> m_paths;
+	std::vector<uint64_t> m_sizes;
+	uint64_t m_totalSize = 0;
+};
+
+// Writes back and drops the file from the page cache, so the next read comes from the disk
+static void DropFromCache(const char* path)
+{
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return;
+	fdatasync(file);
+	posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+	close(file);
+}
+
+static void DropFromCache(const FileSet& files)
+{
+	for (const std::string& path : files.m_paths)
+	{
+		DropFromCache(path.c_str());
+	}
+}
+
+// One file at a time : open, read all of it, close
+static double ReadBlocking(const FileSet& files, std::vector<std::vector<uint8_t>>& outputs)
+{
+	BenchmarkTimer timer;
+	for (size_t i = 0; i < files.m_paths.size(); i++)
+	{
+		int file = open(files.m_paths[i].c_str(), O_RDONLY);
+		if (file < 0)
+			continue;
+		size_t done = 0;
+		while (done < outputs[i].size())
+		{
+			ssize_t result = read(file, outputs[i].data() + done, outputs[i].size() - done);
+			if (result <= 0)
+				break;
+			done += (size_t)result;
+		}
+		close(file);
+	}
+	return timer.GetSeconds();
+}
+
+// Every file queued at once, the service keeps up to queueDepth chunks in flight
+static double ReadWithService(const FileSet& files, std::vector<std::vector<uint8_t>>& outputs, uint32_t queueDepth, IoStats& stats)
+{
+	BenchmarkTimer timer;
+	IoService io(queueDepth, 64 * kMiB);
+	IoBatch batch;
+	for (size_t i = 0; i < files.m_paths.size(); i++)
+	{
+		uint32_t file = io.OpenFile(files.m_paths[i].c_str());
+		io.Read(file, 0, io.GetFileSize(file), outputs[i].data(), IoPriority::High, &batch);
+	}
+	io.Wait(batch);
+	double seconds = timer.GetSeconds();
+	stats = io.GetStats();
+	if (batch.m_failed != 0)
+		printf("%u reads failed\n", batch.m_failed.load());
+	return seconds;
+}
+
+// Blocking reads against the service at increasing queue depths, best of a few runs. Latencies are per request, from
+// Read to completion, so with everything queued at once they mostly measure the wait in the queue
+static void CompareQueueDepths(const FileSet& files, bool cold, uint32_t runs)
+{
+	std::vector<std::vector<uint8_t>> outputs(files.m_paths.size());
+	for (size_t i = 0; i < outputs.size(); i++)
+	{
+		outputs[i].resize((size_t)files.m_sizes[i]);
+	}
+	double mebibytes = files.m_totalSize / (double)kMiB;
+	const char* cache = cold ? "cold" : "warm";
+	char name[128];
+
+	double best = 1e9;
+	for (uint32_t run = 0; run < runs; run++)
+	{
+		if (cold)
+			DropFromCache(files);
+		best = std::min(best, ReadBlocking(files, outputs));
+	}
+	snprintf(name, sizeof(name), "%s, blocking reads", cache);
+	PrintResult(name, mebibytes / best, "MiB/s");
+
+	const uint32_t queueDepths[] = { 1, 4, 16, 32 };
+	for (uint32_t queueDepth : queueDepths)
+	{
+		best = 1e9;
+		IoStats bestStats = {};
+		for (uint32_t run = 0; run < runs; run++)
+		{
+			if (cold)
+				DropFromCache(files);
+			IoStats stats;
+			double seconds = ReadWithService(files, outputs, queueDepth, stats);
+			if (seconds < best)
+			{
+				best = seconds;
+				bestStats = stats;
+			}
+		}
+		snprintf(name, sizeof(name), "%s, IoService, queue depth %u", cache, queueDepth);
+		PrintResult(name, mebibytes / best, "MiB/s");
+		snprintf(name, sizeof(name), "%s, IoService, queue depth %u, p50 latency", cache, queueDepth);
+		PrintResult(name, bestStats.m_p50LatencyMs, "ms");
+		snprintf(name, sizeof(name), "%s, IoService, queue depth %u, p99 latency", cache, queueDepth);
+		PrintResult(name, bestStats.m_p99LatencyMs, "ms");
+	}
+	Consume(outputs[0][0]);
+}
+
+// Small reads, one every few milliseconds, while the rest of the set streams in cold at low priority : how long a read
+// the frame is waiting for takes at low priority, queued behind the stream, and at critical priority, ahead of it. Each
+// read is of a file of its own, so none comes from the page cache
+static void MeasurePriorityLatency(const FileSet& files, uint32_t numProbes, uint32_t intervalMs)
+{
+	size_t numStreamed = files.m_paths.size() - numProbes;
+	// Sized and touched up front, page faults while queueing the stream would let it finish before the reads are made
+	std::vector<std::vector<uint8_t>> outputs(numStreamed);
+	for (size_t i = 0; i < numStreamed; i++)
+	{
+		outputs[i].resize((size_t)files.m_sizes[i]);
+	}
+	std::vector<uint8_t> probes((size_t)numProbes * 64 * 1024);
+	const IoPriority priorities[] = { IoPriority::Low, IoPriority::Critical };
+	for (IoPriority priority : priorities)
+	{
+		IoService io(16, 64 * kMiB);
+		std::vector<uint32_t> handles;
+		for (const std::string& path : files.m_paths)
+		{
+			handles.push_back(io.OpenFile(path.c_str()));
+		}
+		DropFromCache(files);
+
+		IoBatch stream;
+		for (size_t i = 0; i < numStreamed; i++)
+		{
+			io.Read(handles[i], 0, files.m_sizes[i], outputs[i].data(), IoPriority::Low, &stream);
+		}
+		// Timers start when the read is made and stop in its callback
+		std::vector<BenchmarkTimer> timers(numProbes);
+		std::vector<double> latencies(numProbes);
+		IoBatch batch;
+		for (uint32_t i = 0; i < numProbes; i++)
+		{
+			timers[i].Restart();
+			io.Read(handles[numStreamed + i], 0, 64 * 1024, &probes[(size_t)i * 64 * 1024], priority, &batch, [&, i](IoService::RequestId, IoStatus)
+			{
+				latencies[i] = timers[i].GetSeconds() * 1000.0;
+			});
+			usleep(intervalMs * 1000);
+		}
+		io.Wait(batch);
+		io.Wait(stream);
+		std::sort(latencies.begin(), latencies.end());
+
+		const char* priorityName = priority == IoPriority::Low ? "low" : "critical";
+		char name[128];
+		snprintf(name, sizeof(name), "64 KiB reads at %s priority during a stream, p50", priorityName);
+		PrintResult(name, latencies[latencies.size() / 2], "ms");
+		snprintf(name, sizeof(name), "64 KiB reads at %s priority during a stream, max", priorityName);
+		PrintResult(name, latencies.back(), "ms");
+	}
+	Consume(probes[0]);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t numFiles = quick ? 50 : 2000;
+	uint32_t runs = quick ? 1 : 2;
+
+	// Random bytes the size of streamed textures and meshes, 64 KiB to 1 MiB
+	mkdir(kDirectory, 0755);
+	std::mt19937 random(1);
+	std::vector<uint8_t> data(kMiB);
+	for (uint8_t& byte : data)
+	{
+		byte = (uint8_t)random();
+	}
+	FileSet files;
+	for (uint32_t i = 0; i < numFiles; i++)
+	{
+		files.m_paths.push_back(std::string(kDirectory) + "/File" + std::to_string(i) + ".bin");
+		files.m_sizes.push_back(64 * 1024 + random() % (kMiB - 64 * 1024 + 1));
+		files.m_totalSize += files.m_sizes.back();
+		FILE* file = fopen(files.m_paths.back().c_str(), "wb");
+		fwrite(data.data(), 1, (size_t)files.m_sizes.back(), file);
+		fclose(file);
+	}
+	printf("%u files, %.1f MiB\n", numFiles, files.m_totalSize / (double)kMiB);
+
+	CompareQueueDepths(files, true, runs);
+	CompareQueueDepths(files, false, runs);
+	MeasurePriorityLatency(files, quick ? 5 : 20, quick ? 1 : 10);
+
+	for (const std::string& path : files.m_paths)
+	{
+		remove(path.c_str());
+	}
+	rmdir(kDirectory);
+	return 0;
+}
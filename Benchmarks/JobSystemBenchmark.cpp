@@ -0,0 +1,90 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <vector>
+
+using namespace Sigma;
+
+// Work of a job, roughly iterations nanoseconds
+static uint64_t Work(uint32_t iterations)
+{
+	uint64_t value = iterations;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		value = value * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	return value;
+}
+
+static double GetPercentile(std::vector<double>& samples, double percentile)
+{
+	size_t index = std::min(samples.size() - 1, (size_t)(percentile * samples.size()));
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
+
+// Fan-out of numJobs jobs from the calling thread, fan-in with Wait
+static void FanOutFanIn(JobSystem& jobSystem, uint32_t numJobs, uint32_t iterations, uint32_t rounds)
+{
+	std::atomic<uint64_t> sum(0);
+	BenchmarkTimer timer;
+	for (uint32_t round = 0; round < rounds; round++)
+	{
+		JobCounter counter;
+		for (uint32_t i = 0; i < numJobs; i++)
+		{
+			jobSystem.Run([&sum, iterations]() { sum.fetch_add(Work(iterations), std::memory_order_relaxed); }, &counter);
+		}
+		jobSystem.Wait(counter);
+	}
+	double seconds = timer.GetSeconds();
+	Consume(sum);
+
+	char name[128];
+	snprintf(name, sizeof(name), "%u jobs of %u iterations, jobs", numJobs, iterations);
+	PrintResult(name, (double)numJobs * rounds / seconds / 1e6, "M/s");
+	snprintf(name, sizeof(name), "%u jobs of %u iterations, fan-out/fan-in", numJobs, iterations);
+	PrintResult(name, seconds * 1e6 / rounds, "us");
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	JobSystem jobSystem;
+	printf("%u threads\n", jobSystem.GetThreadCount());
+
+	for (uint32_t numJobs : { 1, 16, 256, 4096 })
+	{
+		uint32_t rounds = (quick ? 20000 : 2000000) / numJobs;
+		FanOutFanIn(jobSystem, numJobs, 0, std::max(rounds, 1u));
+		FanOutFanIn(jobSystem, numJobs, 1000, std::max(rounds / 20, 1u));
+	}
+
+	// Latency of single jobs : Run + Wait when the caller helps, and Run until a worker starts the job when it does not
+	uint32_t numSamples = quick ? 100 : 20000;
+	std::vector<double> roundTrips;
+	std::vector<double> startDelays;
+	for (uint32_t i = 0; i < numSamples; i++)
+	{
+		BenchmarkTimer timer;
+		JobCounter counter;
+		jobSystem.Run([]() {}, &counter);
+		jobSystem.Wait(counter);
+		roundTrips.push_back(timer.GetSeconds() * 1e6);
+
+		std::atomic<double> startDelay(0.0);
+		timer.Restart();
+		JobCounter workerCounter;
+		jobSystem.Run([&timer, &startDelay]() { startDelay = timer.GetSeconds() * 1e6; }, &workerCounter);
+		while (workerCounter.m_value.load(std::memory_order_acquire) > 0)
+		{
+			std::this_thread::yield();
+		}
+		startDelays.push_back(startDelay);
+	}
+	PrintResult("Run + Wait, p50", GetPercentile(roundTrips, 0.5), "us");
+	PrintResult("Run + Wait, p99", GetPercentile(roundTrips, 0.99), "us");
+	PrintResult("Run to start on a worker, p50", GetPercentile(startDelays, 0.5), "us");
+	PrintResult("Run to start on a worker, p99", GetPercentile(startDelays, 0.99), "us");
+	return 0;
+}
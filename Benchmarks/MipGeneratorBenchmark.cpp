@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+#include "MipGenerator.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+// Full chains generated and written into a footprint, in millions of source pixels per second
+static void Measure(const char* formatName, MipFormat format, MipFilter filter, JobSystem* jobSystem, uint32_t size, uint32_t runs)
+{
+	uint32_t texelSize = MipGenerator::GetTexelSize(format);
+	std::vector<uint8_t> source((size_t)size * size * texelSize);
+	std::mt19937 random(size);
+	for (size_t i = 0; i < source.size(); i += 2)
+	{
+		// Halves stay finite, between -8 and 8
+		uint16_t value = format == MipFormat::RGBA16F ? (uint16_t)(((random() % 2) << 15) | ((1 + random() % 17) << 10) | (random() & 0x3ff)) : (uint16_t)random();
+		memcpy(&source[i], &value, sizeof(value));
+	}
+
+	MipGenerator generator(jobSystem);
+	uint32_t numLevels = MipGenerator::GetFullChainLevelCount(size, size);
+	std::vector<uint8_t> footprint((size_t)size * size * texelSize * 2);
+	double best = 1e9;
+	for (uint32_t run = 0; run < runs; run++)
+	{
+		BenchmarkTimer timer;
+		generator.Generate(format, filter, source.data(), (uint64_t)size * texelSize, size, size, numLevels);
+		uint64_t offset = 0;
+		for (uint32_t level = 0; level < numLevels; level++)
+		{
+			uint64_t rowSize = (uint64_t)generator.GetWidth(level) * texelSize;
+			uint64_t rowPitch = (rowSize + 255) & ~255ull;
+			TextureRows rows = { &footprint[offset], rowPitch, rowPitch * generator.GetHeight(level), rowSize, generator.GetHeight(level), 1 };
+			generator.Write(level, rows);
+			offset += (rowPitch * generator.GetHeight(level) + 511) & ~511ull;
+		}
+		best = std::min(best, timer.GetSeconds());
+	}
+	Consume(footprint[footprint.size() / 2]);
+
+	char name[128];
+	snprintf(name, sizeof(name), "%ux%u %s, %s, %s", size, size, formatName, filter == MipFilter::Kaiser ? "Kaiser" : "box", jobSystem != nullptr ? "jobs" : "1 thread");
+	PrintResult(name, size * (double)size / best / 1e6, "MPixels/s");
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t size = quick ? 256 : 2048;
+	uint32_t runs = quick ? 1 : 5;
+	JobSystem jobSystem;
+	printf("%u job system threads\n", jobSystem.GetThreadCount());
+
+	const char* formatNames[] = { "RGBA8", "RGBA8 sRGB", "RGBA16F", "R8" };
+	const MipFormat formats[] = { MipFormat::RGBA8, MipFormat::RGBA8Srgb, MipFormat::RGBA16F, MipFormat::R8 };
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+		{
+			Measure(formatNames[i], formats[i], filter, nullptr, size, runs);
+			Measure(formatNames[i], formats[i], filter, &jobSystem, size, runs);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,262 @@
+#include "MockDevice.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	const UINT64 kMockGpuAddressBase = 0x100000000ull;
+
+	static UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Size of a 4x4 block for block compressed formats, of a texel otherwise
+	static UINT GetElementSize(DXGI_FORMAT format, bool& blockCompressed)
+	{
+		blockCompressed = false;
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return 8;
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+			blockCompressed = true;
+			return 8;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			blockCompressed = true;
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	template<typename Interface>
+	class MockObject : public Interface
+	{
+	public:
+		ULONG AddRef() override
+		{
+			return ++m_references;
+		}
+
+		ULONG Release() override
+		{
+			ULONG references = --m_references;
+			if (references == 0)
+				delete this;
+			return references;
+		}
+
+	private:
+		std::atomic<ULONG> m_references{ 1 };
+	};
+
+	class MockHeap : public MockObject<ID3D12Heap>
+	{
+	public:
+		MockHeap(const D3D12_HEAP_DESC& desc, D3D12_GPU_VIRTUAL_ADDRESS gpuAddress) :
+			m_desc(desc),
+			m_memory(static_cast<UINT8*>(calloc((size_t)desc.SizeInBytes, 1))),
+			m_gpuAddress(gpuAddress)
+		{
+		}
+
+		~MockHeap()
+		{
+			free(m_memory);
+		}
+
+		D3D12_HEAP_DESC GetDesc() override { return m_desc; }
+
+		UINT8* GetMemory() const { return m_memory; }
+		D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const { return m_gpuAddress; }
+
+	private:
+		D3D12_HEAP_DESC m_desc;
+		UINT8* m_memory;
+		D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+	};
+
+	// Placed resources keep their heap alive, committed ones own an implicit heap
+	class MockResource : public MockObject<ID3D12Resource>
+	{
+	public:
+		MockResource(MockHeap* heap, UINT64 offset, const D3D12_RESOURCE_DESC& desc) :
+			m_heap(heap),
+			m_offset(offset),
+			m_desc(desc)
+		{
+		}
+
+		HRESULT Map(UINT, const D3D12_RANGE*, void** data) override
+		{
+			if (data != nullptr)
+				*data = m_heap->GetMemory() + m_offset;
+			return S_OK;
+		}
+
+		void Unmap(UINT, const D3D12_RANGE*) override
+		{
+		}
+
+		D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() override
+		{
+			return m_desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? m_heap->GetGpuAddress() + m_offset : 0;
+		}
+
+		D3D12_RESOURCE_DESC GetDesc() override { return m_desc; }
+
+	private:
+		ComPtr<MockHeap> m_heap;
+		UINT64 m_offset;
+		D3D12_RESOURCE_DESC m_desc;
+	};
+
+	class MockDevice : public MockObject<ID3D12Device>
+	{
+	public:
+		HRESULT CreateHeap(const D3D12_HEAP_DESC* desc, REFIID, void** heap) override
+		{
+			*heap = static_cast<ID3D12Heap*>(NewHeap(*desc));
+			return *heap != nullptr ? S_OK : E_OUTOFMEMORY;
+		}
+
+		HRESULT CreatePlacedResource(ID3D12Heap* heap, UINT64 heapOffset, const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES,
+			const D3D12_CLEAR_VALUE*, REFIID, void** resource) override
+		{
+			D3D12_RESOURCE_ALLOCATION_INFO info = GetResourceAllocationInfo(0, 1, desc);
+			if (heapOffset % info.Alignment != 0 || heapOffset + info.SizeInBytes > heap->GetDesc().SizeInBytes)
+			{
+				*resource = nullptr;
+				return E_INVALIDARG;
+			}
+
+			*resource = static_cast<ID3D12Resource*>(new MockResource(static_cast<MockHeap*>(heap), heapOffset, *desc));
+			return S_OK;
+		}
+
+		HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES* heapProperties, D3D12_HEAP_FLAGS heapFlags, const D3D12_RESOURCE_DESC* desc,
+			D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID, void** resource) override
+		{
+			D3D12_HEAP_DESC heapDesc = {};
+			heapDesc.SizeInBytes = GetResourceAllocationInfo(0, 1, desc).SizeInBytes;
+			heapDesc.Properties = *heapProperties;
+			heapDesc.Flags = heapFlags;
+			ComPtr<MockHeap> heap;
+			heap.Attach(NewHeap(heapDesc));
+			if (heap == nullptr)
+			{
+				*resource = nullptr;
+				return E_OUTOFMEMORY;
+			}
+
+			*resource = static_cast<ID3D12Resource*>(new MockResource(heap.Get(), 0, *desc));
+			return S_OK;
+		}
+
+		D3D12_RESOURCE_ALLOCATION_INFO GetResourceAllocationInfo(UINT, UINT numResourceDescs, const D3D12_RESOURCE_DESC* resourceDescs) override
+		{
+			D3D12_RESOURCE_ALLOCATION_INFO info = { 0, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT };
+			for (UINT i = 0; i < numResourceDescs; i++)
+			{
+				const D3D12_RESOURCE_DESC& desc = resourceDescs[i];
+				UINT64 size = desc.Width;
+				if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+				{
+					UINT numSubresources = desc.MipLevels * (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize);
+					GetCopyableFootprints(&desc, 0, numSubresources, 0, nullptr, nullptr, nullptr, &size);
+				}
+				info.SizeInBytes = AlignUp(info.SizeInBytes, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) + AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+			}
+			return info;
+		}
+
+		void GetCopyableFootprints(const D3D12_RESOURCE_DESC* resourceDesc, UINT firstSubresource, UINT numSubresources, UINT64 baseOffset,
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes) override
+		{
+			const D3D12_RESOURCE_DESC& desc = *resourceDesc;
+			bool blockCompressed;
+			UINT elementSize = GetElementSize(desc.Format, blockCompressed);
+			UINT mipLevels = std::max<UINT>(desc.MipLevels, 1);
+
+			UINT64 offset = baseOffset;
+			UINT64 end = baseOffset;
+			for (UINT i = 0; i < numSubresources; i++)
+			{
+				UINT subresource = firstSubresource + i;
+				UINT mip = subresource % mipLevels;
+				UINT width = std::max<UINT>((UINT)(desc.Width >> mip), 1);
+				UINT height = std::max<UINT>(desc.Height >> mip, 1);
+				UINT depth = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? std::max<UINT>(desc.DepthOrArraySize >> mip, 1) : 1;
+
+				UINT rows = height;
+				UINT64 rowSize = (UINT64)width * elementSize;
+				if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+				{
+					rows = 1;
+					rowSize = desc.Width;
+				}
+				else if (blockCompressed)
+				{
+					rows = (height + 3) / 4;
+					rowSize = (UINT64)((width + 3) / 4) * elementSize;
+				}
+
+				offset = AlignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+				UINT rowPitch = (UINT)AlignUp(rowSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+				if (layouts != nullptr)
+				{
+					layouts[i].Offset = offset;
+					layouts[i].Footprint.Format = desc.Format;
+					layouts[i].Footprint.Width = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? (UINT)desc.Width : (blockCompressed ? (UINT)AlignUp(width, 4) : width);
+					layouts[i].Footprint.Height = blockCompressed ? (UINT)AlignUp(height, 4) : height;
+					layouts[i].Footprint.Depth = depth;
+					layouts[i].Footprint.RowPitch = rowPitch;
+				}
+				if (numRows != nullptr)
+					numRows[i] = rows;
+				if (rowSizesInBytes != nullptr)
+					rowSizesInBytes[i] = rowSize;
+
+				// The last row of the last slice is not padded
+				end = offset + (UINT64)rowPitch * (rows * depth - 1) + rowSize;
+				offset += (UINT64)rowPitch * rows * depth;
+			}
+			if (totalBytes != nullptr)
+				*totalBytes = end - baseOffset;
+		}
+
+	private:
+		// Made up GPU addresses are handed out in increasing order and never reused
+		MockHeap* NewHeap(const D3D12_HEAP_DESC& desc)
+		{
+			MockHeap* heap = new MockHeap(desc, m_nextGpuAddress);
+			if (heap->GetMemory() == nullptr && desc.SizeInBytes != 0)
+			{
+				heap->Release();
+				return nullptr;
+			}
+			m_nextGpuAddress += AlignUp(desc.SizeInBytes, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+			return heap;
+		}
+
+		D3D12_GPU_VIRTUAL_ADDRESS m_nextGpuAddress = kMockGpuAddressBase;
+	};
+
+	ID3D12Device* CreateMockDevice()
+	{
+		return new MockDevice();
+	}
+}
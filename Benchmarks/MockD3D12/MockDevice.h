@@ -0,0 +1,16 @@
+#pragma once
+
+#include <d3d12.h>
+
+namespace Sigma
+{
+	/*
+	Device that backs every heap and committed resource with CPU memory, so allocators built on D3D12 can run headless.
+	Resources can all be mapped, GPU virtual addresses are made up but stay consistent with the offsets within heaps.
+	Sizes and alignments follow the D3D12 rules : 64 KiB resource placement, 256 bytes row pitch, 512 bytes subresource
+	placement. Only for single threaded use.
+
+	Returned with a reference count of 1, to be attached to a ComPtr.
+	*/
+	ID3D12Device* CreateMockDevice();
+}
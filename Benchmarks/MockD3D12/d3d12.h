@@ -0,0 +1,203 @@
+#pragma once
+
+#include <windows.h>
+
+/*
+The part of the D3D12 API used by the sources that are built headless, implemented by the mock device of MockDevice.h.
+Interfaces keep the COM shape (virtual calls, reference counts), so code going through them costs about what it would
+with a driver that does nothing.
+*/
+
+// Every mock object implements the interfaces it is asked for, the IID is only passed along
+struct MockIid
+{
+};
+typedef const MockIid& REFIID;
+#define IID_PPV_ARGS(ppType) MockIid(), reinterpret_cast<void**>(ppType)
+
+typedef UINT64 D3D12_GPU_VIRTUAL_ADDRESS;
+
+const UINT64 D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT = 65536;
+const UINT64 D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT = 256;
+const UINT64 D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT = 512;
+const UINT64 D3D12_TEXTURE_DATA_PITCH_ALIGNMENT = 256;
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_FORMAT_R32_FLOAT = 41,
+	DXGI_FORMAT_BC1_UNORM = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+	DXGI_FORMAT_BC3_UNORM = 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+	DXGI_FORMAT_BC4_UNORM = 80,
+	DXGI_FORMAT_BC5_UNORM = 83,
+	DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_BC7_UNORM = 98,
+	DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+enum D3D12_RESOURCE_DIMENSION
+{
+	D3D12_RESOURCE_DIMENSION_UNKNOWN = 0,
+	D3D12_RESOURCE_DIMENSION_BUFFER = 1,
+	D3D12_RESOURCE_DIMENSION_TEXTURE1D = 2,
+	D3D12_RESOURCE_DIMENSION_TEXTURE2D = 3,
+	D3D12_RESOURCE_DIMENSION_TEXTURE3D = 4,
+};
+
+enum D3D12_TEXTURE_LAYOUT
+{
+	D3D12_TEXTURE_LAYOUT_UNKNOWN = 0,
+	D3D12_TEXTURE_LAYOUT_ROW_MAJOR = 1,
+};
+
+enum D3D12_RESOURCE_FLAGS
+{
+	D3D12_RESOURCE_FLAG_NONE = 0,
+	D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET = 0x1,
+	D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL = 0x2,
+	D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS = 0x4,
+};
+
+enum D3D12_RESOURCE_STATES
+{
+	D3D12_RESOURCE_STATE_COMMON = 0,
+	D3D12_RESOURCE_STATE_COPY_DEST = 0x400,
+	D3D12_RESOURCE_STATE_COPY_SOURCE = 0x800,
+	D3D12_RESOURCE_STATE_GENERIC_READ = 0xac3,
+};
+
+enum D3D12_HEAP_TYPE
+{
+	D3D12_HEAP_TYPE_DEFAULT = 1,
+	D3D12_HEAP_TYPE_UPLOAD = 2,
+	D3D12_HEAP_TYPE_READBACK = 3,
+};
+
+enum D3D12_CPU_PAGE_PROPERTY
+{
+	D3D12_CPU_PAGE_PROPERTY_UNKNOWN = 0,
+};
+
+enum D3D12_MEMORY_POOL
+{
+	D3D12_MEMORY_POOL_UNKNOWN = 0,
+};
+
+enum D3D12_HEAP_FLAGS
+{
+	D3D12_HEAP_FLAG_NONE = 0,
+	D3D12_HEAP_FLAG_DENY_BUFFERS = 0x4,
+	D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES = 0x40,
+	D3D12_HEAP_FLAG_DENY_NON_RT_DS_TEXTURES = 0x80,
+	D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS = 0xc0,
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	UINT Count;
+	UINT Quality;
+};
+
+struct D3D12_RESOURCE_DESC
+{
+	D3D12_RESOURCE_DIMENSION Dimension;
+	UINT64 Alignment;
+	UINT64 Width;
+	UINT Height;
+	UINT16 DepthOrArraySize;
+	UINT16 MipLevels;
+	DXGI_FORMAT Format;
+	DXGI_SAMPLE_DESC SampleDesc;
+	D3D12_TEXTURE_LAYOUT Layout;
+	D3D12_RESOURCE_FLAGS Flags;
+};
+
+struct D3D12_HEAP_PROPERTIES
+{
+	D3D12_HEAP_TYPE Type;
+	D3D12_CPU_PAGE_PROPERTY CPUPageProperty;
+	D3D12_MEMORY_POOL MemoryPoolPreference;
+	UINT CreationNodeMask;
+	UINT VisibleNodeMask;
+};
+
+struct D3D12_HEAP_DESC
+{
+	UINT64 SizeInBytes;
+	D3D12_HEAP_PROPERTIES Properties;
+	UINT64 Alignment;
+	D3D12_HEAP_FLAGS Flags;
+};
+
+struct D3D12_RANGE
+{
+	SIZE_T Begin;
+	SIZE_T End;
+};
+
+struct D3D12_RESOURCE_ALLOCATION_INFO
+{
+	UINT64 SizeInBytes;
+	UINT64 Alignment;
+};
+
+struct D3D12_SUBRESOURCE_FOOTPRINT
+{
+	DXGI_FORMAT Format;
+	UINT Width;
+	UINT Height;
+	UINT Depth;
+	UINT RowPitch;
+};
+
+struct D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+{
+	UINT64 Offset;
+	D3D12_SUBRESOURCE_FOOTPRINT Footprint;
+};
+
+struct D3D12_CLEAR_VALUE
+{
+	DXGI_FORMAT Format;
+	float Color[4];
+};
+
+struct IUnknown
+{
+	virtual ULONG AddRef() = 0;
+	virtual ULONG Release() = 0;
+
+protected:
+	virtual ~IUnknown() {}
+};
+
+struct ID3D12Heap : public IUnknown
+{
+	virtual D3D12_HEAP_DESC GetDesc() = 0;
+};
+
+struct ID3D12Resource : public IUnknown
+{
+	virtual HRESULT Map(UINT subresource, const D3D12_RANGE* readRange, void** data) = 0;
+	virtual void Unmap(UINT subresource, const D3D12_RANGE* writtenRange) = 0;
+	virtual D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() = 0;
+	virtual D3D12_RESOURCE_DESC GetDesc() = 0;
+};
+
+struct ID3D12Device : public IUnknown
+{
+	virtual HRESULT CreateHeap(const D3D12_HEAP_DESC* desc, REFIID iid, void** heap) = 0;
+	virtual HRESULT CreatePlacedResource(ID3D12Heap* heap, UINT64 heapOffset, const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES initialState,
+		const D3D12_CLEAR_VALUE* optimizedClearValue, REFIID iid, void** resource) = 0;
+	virtual HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES* heapProperties, D3D12_HEAP_FLAGS heapFlags, const D3D12_RESOURCE_DESC* desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue, REFIID iid, void** resource) = 0;
+	virtual D3D12_RESOURCE_ALLOCATION_INFO GetResourceAllocationInfo(UINT visibleMask, UINT numResourceDescs, const D3D12_RESOURCE_DESC* resourceDescs) = 0;
+	virtual void GetCopyableFootprints(const D3D12_RESOURCE_DESC* resourceDesc, UINT firstSubresource, UINT numSubresources, UINT64 baseOffset,
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes) = 0;
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+// Included by stdafx.h, nothing from it is used by the headless builds
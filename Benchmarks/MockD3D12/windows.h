@@ -0,0 +1,26 @@
+#pragma once
+
+// Only the Win32 types the headless builds go through
+#include <cstddef>
+#include <cstdint>
+
+typedef int BOOL;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef unsigned int UINT;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int32_t HRESULT;
+typedef size_t SIZE_T;
+typedef const char* LPCSTR;
+typedef void* HANDLE;
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+namespace Microsoft
+{
+	namespace WRL
+	{
+		// The subset of the WRL smart pointer used by the sources, same reference counting rules
+		template<typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() : m_ptr(nullptr) {}
+			ComPtr(std::nullptr_t) : m_ptr(nullptr) {}
+			ComPtr(T* ptr) : m_ptr(ptr) { InternalAddRef(); }
+			ComPtr(const ComPtr& other) : m_ptr(other.m_ptr) { InternalAddRef(); }
+			template<typename U>
+			ComPtr(const ComPtr<U>& other) : m_ptr(other.Get()) { InternalAddRef(); }
+			ComPtr(ComPtr&& other) : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+			~ComPtr() { Reset(); }
+
+			ComPtr& operator=(ComPtr other)
+			{
+				std::swap(m_ptr, other.m_ptr);
+				return *this;
+			}
+
+			T* Get() const { return m_ptr; }
+			T* operator->() const { return m_ptr; }
+			explicit operator bool() const { return m_ptr != nullptr; }
+			bool operator==(std::nullptr_t) const { return m_ptr == nullptr; }
+			bool operator!=(std::nullptr_t) const { return m_ptr != nullptr; }
+
+			// As with WRL, taking the address releases the current pointer first
+			T** operator&() { return ReleaseAndGetAddressOf(); }
+			T* const* GetAddressOf() const { return &m_ptr; }
+			T** GetAddressOf() { return &m_ptr; }
+			T** ReleaseAndGetAddressOf()
+			{
+				Reset();
+				return &m_ptr;
+			}
+
+			void Attach(T* ptr)
+			{
+				Reset();
+				m_ptr = ptr;
+			}
+
+			T* Detach()
+			{
+				T* ptr = m_ptr;
+				m_ptr = nullptr;
+				return ptr;
+			}
+
+			unsigned long Reset()
+			{
+				unsigned long count = 0;
+				if (m_ptr != nullptr)
+				{
+					count = m_ptr->Release();
+					m_ptr = nullptr;
+				}
+				return count;
+			}
+
+		private:
+			void InternalAddRef()
+			{
+				if (m_ptr != nullptr)
+					m_ptr->AddRef();
+			}
+
+			T* m_ptr;
+		};
+	}
+}
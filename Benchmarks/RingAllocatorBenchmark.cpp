@@ -0,0 +1,92 @@
+#include "Benchmark.h"
+#include "RingAllocator.h"
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint64_t kFramesInFlight = 2;
+
+struct RingResult
+{
+	double m_allocationsPerSecond;
+	uint64_t m_failed;
+	uint64_t m_wraps;
+};
+
+// Frames of allocations with the given sizes, the oldest frame is retired before a new one starts
+static RingResult RunFrames(uint64_t ringSize, const std::vector<uint64_t>& sizes, uint64_t alignment, uint32_t numFrames)
+{
+	RingAllocator ring(ringSize);
+	RingResult result = {};
+	uint64_t allocations = 0;
+	uint64_t lastOffset = 0;
+	BenchmarkTimer timer;
+	for (uint32_t frame = 0; frame < numFrames; frame++)
+	{
+		if (frame >= kFramesInFlight)
+			ring.Retire(frame - kFramesInFlight + 1);
+
+		for (uint64_t size : sizes)
+		{
+			uint64_t offset = ring.Allocate(size, alignment);
+			if (offset == kInvalidOffset)
+			{
+				result.m_failed++;
+				continue;
+			}
+			result.m_wraps += offset < lastOffset;
+			lastOffset = offset;
+			allocations++;
+		}
+		ring.Submit(frame + 1);
+	}
+	result.m_allocationsPerSecond = allocations / timer.GetSeconds();
+	Consume(lastOffset);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t numFrames = quick ? 100 : 20000;
+
+	// Per draw constants : 1000 draws of 256 bytes per frame
+	std::vector<uint64_t> constants(1000, 256);
+	// Uploads : 200 of 256 bytes to 64 KiB per frame
+	std::vector<uint64_t> uploads(200);
+	std::mt19937 random(1);
+	for (uint64_t& size : uploads)
+	{
+		size = 256 + random() % (64 * 1024 - 256);
+	}
+	uint64_t uploadFrameSize = 0;
+	for (uint64_t size : uploads)
+	{
+		uploadFrameSize += AlignUp(size, 512);
+	}
+
+	printf("%u frames, %llu in flight\n", numFrames, (unsigned long long)kFramesInFlight);
+
+	RingResult result = RunFrames(64 * 1024 * 1024, constants, 256, numFrames);
+	PrintResult("256 B constants, 64 MiB ring", result.m_allocationsPerSecond / 1e6, "M allocations/s");
+
+	result = RunFrames(64 * 1024 * 1024, uploads, 512, numFrames);
+	PrintResult("256 B - 64 KiB uploads, 64 MiB ring", result.m_allocationsPerSecond / 1e6, "M allocations/s");
+
+	// Rings close to the size of the frames in flight wrap every few frames, and fail once smaller
+	for (double scale : { 3.0, 2.0, 1.5 })
+	{
+		uint64_t ringSize = (uint64_t)(uploadFrameSize * scale);
+		result = RunFrames(ringSize, uploads, 512, numFrames);
+
+		char name[128];
+		snprintf(name, sizeof(name), "Uploads, ring of %.1f frames, allocations", scale);
+		PrintResult(name, result.m_allocationsPerSecond / 1e6, "M/s");
+		snprintf(name, sizeof(name), "Uploads, ring of %.1f frames, wraps per frame", scale);
+		PrintResult(name, (double)result.m_wraps / numFrames, "");
+		snprintf(name, sizeof(name), "Uploads, ring of %.1f frames, failed allocations", scale);
+		PrintResult(name, 100.0 * result.m_failed / ((uint64_t)numFrames * uploads.size()), "%");
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+#include "TextureCopy.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace Sigma;
+
+const uint64_t kRowPitchAlignment = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+
+static uint32_t SwapRedBlue(uint32_t texel)
+{
+	return (texel & 0xff00ff00) | ((texel >> 16) & 0xff) | ((texel & 0xff) << 16);
+}
+
+// Best of a few runs, in GB of texels copied per second
+template<typename Copy>
+static double Measure(uint64_t bytes, uint32_t runs, Copy copy)
+{
+	copy();
+	double best = 1e9;
+	for (uint32_t i = 0; i < runs; i++)
+	{
+		BenchmarkTimer timer;
+		copy();
+		best = std::min(best, timer.GetSeconds());
+	}
+	return bytes / best / 1e9;
+}
+
+// An RGBA8 image with tightly packed rows copied into a footprint with its row pitch padded to 256 bytes. Linux has no
+// write-combined memory, the destination is ordinary cached memory
+static void Compare(uint32_t width, uint32_t height, uint32_t runs)
+{
+	uint64_t rowSize = width * sizeof(uint32_t);
+	uint64_t rowPitch = (rowSize + kRowPitchAlignment - 1) & ~(kRowPitchAlignment - 1);
+	std::vector<uint8_t> source(rowSize * height);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		source[i] = (uint8_t)(i * 7);
+	}
+	uint8_t* destination = (uint8_t*)aligned_alloc(4096, rowPitch * height);
+	std::fill(destination, destination + rowPitch * height, 0);
+	TextureRows rows = { destination, rowPitch, rowPitch * height, rowSize, height, 1 };
+	uint64_t bytes = rowSize * height;
+
+	// The loop UploadQueue had before : memcpy row by row
+	double rowMemcpy = Measure(bytes, runs, [&]()
+	{
+		uint8_t* dst = destination;
+		const uint8_t* src = source.data();
+		for (uint32_t row = 0; row < height; row++)
+		{
+			memcpy(dst, src, rowSize);
+			dst += rowPitch;
+			src += rowSize;
+		}
+	});
+	double copy = Measure(bytes, runs, [&]() { CopyTextureRows(rows, source.data(), rowSize, rowSize * height, TexelConversion::None); });
+
+	double scalarSwap = Measure(bytes, runs, [&]()
+	{
+		uint8_t* dst = destination;
+		const uint8_t* src = source.data();
+		for (uint32_t row = 0; row < height; row++)
+		{
+			for (uint64_t i = 0; i < rowSize; i += sizeof(uint32_t))
+			{
+				uint32_t texel;
+				memcpy(&texel, src + i, sizeof(texel));
+				texel = SwapRedBlue(texel);
+				memcpy(dst + i, &texel, sizeof(texel));
+			}
+			dst += rowPitch;
+			src += rowSize;
+		}
+	});
+	double swap = Measure(bytes, runs, [&]() { CopyTextureRows(rows, source.data(), rowSize, rowSize * height, TexelConversion::SwapRedBlue); });
+	Consume(destination[rowPitch * (height - 1)]);
+	free(destination);
+
+	char name[128];
+	snprintf(name, sizeof(name), "%ux%u, row memcpy", width, height);
+	PrintResult(name, rowMemcpy, "GB/s");
+	snprintf(name, sizeof(name), "%ux%u, CopyTextureRows", width, height);
+	PrintResult(name, copy, "GB/s");
+	snprintf(name, sizeof(name), "%ux%u, red/blue swap, scalar loop", width, height);
+	PrintResult(name, scalarSwap, "GB/s");
+	snprintf(name, sizeof(name), "%ux%u, red/blue swap, CopyTextureRows", width, height);
+	PrintResult(name, swap, "GB/s");
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t runs = quick ? 1 : 10;
+
+	// Pitch padded by 96 bytes per row, larger than the caches
+	Compare(4000, quick ? 256 : 4096, runs);
+	// Fits in L2, pitch already aligned
+	Compare(256, 256, runs * 10);
+	// Small mip with most of each row pitch being padding
+	Compare(17, quick ? 64 : 4096, runs * 10);
+	return 0;
+}
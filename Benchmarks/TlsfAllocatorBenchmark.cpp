@@ -0,0 +1,179 @@
+#include "Benchmark.h"
+#include "TlsfAllocator.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+// Free ranges by offset, the first one large enough once aligned is taken and freed ranges merge with their neighbours
+class FirstFitAllocator
+{
+public:
+	FirstFitAllocator(uint64_t size, uint64_t granularity) :
+		m_granularity(granularity)
+	{
+		m_freeRanges[0] = size;
+	}
+
+	uint64_t Allocate(uint64_t size, uint64_t alignment)
+	{
+		size = AlignUp(size, m_granularity);
+		for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+		{
+			uint64_t offset = AlignUp(it->first, alignment);
+			uint64_t end = it->first + it->second;
+			if (offset + size > end)
+				continue;
+
+			uint64_t begin = it->first;
+			m_freeRanges.erase(it);
+			if (begin < offset)
+				m_freeRanges[begin] = offset - begin;
+			if (offset + size < end)
+				m_freeRanges[offset + size] = end - offset - size;
+			return offset;
+		}
+		return kInvalidOffset;
+	}
+
+	void Free(uint64_t offset, uint64_t size)
+	{
+		size = AlignUp(size, m_granularity);
+		auto next = m_freeRanges.lower_bound(offset);
+		if (next != m_freeRanges.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = m_freeRanges.erase(next);
+		}
+		if (next != m_freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+		m_freeRanges[offset] = size;
+	}
+
+	size_t GetFreeRangeCount() const { return m_freeRanges.size(); }
+
+private:
+	uint64_t m_granularity;
+	std::map<uint64_t, uint64_t> m_freeRanges;
+};
+
+struct RunResult
+{
+	double m_operationsPerSecond;
+	double m_failedPercent;
+	double m_freeBlocks; // Average over the run
+};
+
+// Allocations of 1 to maxUnits granules, some with a larger alignment, and frees of random live ones, keeping the heap
+// about 75% full. The same seed gives both allocators the same sequence as long as they fail the same allocations
+template<typename Allocate, typename Free, typename CountFreeBlocks>
+static RunResult Run(uint64_t heapSize, uint64_t granularity, uint64_t maxUnits, uint32_t count, Allocate allocate, Free free, CountFreeBlocks countFreeBlocks)
+{
+	struct Live
+	{
+		uint64_t m_offset;
+		uint64_t m_size;
+		uint32_t m_block;
+	};
+	std::vector<Live> live;
+	std::mt19937 random(7);
+	uint64_t usedSize = 0;
+	uint32_t allocations = 0;
+	uint32_t failures = 0;
+	double freeBlocks = 0.0;
+	uint32_t samples = 0;
+
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool fill = random() % 100 < (usedSize < heapSize * 3 / 4 ? 75u : 25u);
+		if (fill || live.empty())
+		{
+			Live allocation = { 0, granularity * (1 + random() % maxUnits), kInvalidTlsfBlock };
+			uint64_t alignment = granularity << (random() % 4 == 0 ? 2 : 0);
+			allocation.m_offset = allocate(allocation.m_size, alignment, allocation.m_block);
+			allocations++;
+			if (allocation.m_offset == kInvalidOffset)
+			{
+				failures++;
+				continue;
+			}
+			live.push_back(allocation);
+			usedSize += allocation.m_size;
+		}
+		else
+		{
+			size_t victim = random() % live.size();
+			free(live[victim].m_offset, live[victim].m_size, live[victim].m_block);
+			usedSize -= live[victim].m_size;
+			live[victim] = live.back();
+			live.pop_back();
+		}
+
+		if (i % 1024 == 0)
+		{
+			freeBlocks += (double)countFreeBlocks();
+			samples++;
+		}
+	}
+
+	RunResult result;
+	result.m_operationsPerSecond = count / timer.GetSeconds();
+	result.m_failedPercent = 100.0 * failures / allocations;
+	result.m_freeBlocks = freeBlocks / samples;
+	return result;
+}
+
+static void Compare(const char* name, uint64_t heapSize, uint64_t granularity, uint64_t maxUnits, uint32_t count)
+{
+	TlsfAllocator tlsf(heapSize, granularity);
+	RunResult tlsfResult = Run(heapSize, granularity, maxUnits, count,
+		[&tlsf](uint64_t size, uint64_t alignment, uint32_t& block)
+		{
+			TlsfAllocation allocation = tlsf.Allocate(size, alignment);
+			block = allocation.m_block;
+			return allocation.m_offset;
+		},
+		[&tlsf](uint64_t, uint64_t, uint32_t block) { tlsf.Free(block); },
+		[&tlsf]() { return tlsf.GetStats().m_freeBlockCount; });
+
+	FirstFitAllocator firstFit(heapSize, granularity);
+	RunResult firstFitResult = Run(heapSize, granularity, maxUnits, count,
+		[&firstFit](uint64_t size, uint64_t alignment, uint32_t&) { return firstFit.Allocate(size, alignment); },
+		[&firstFit](uint64_t offset, uint64_t size, uint32_t) { firstFit.Free(offset, size); },
+		[&firstFit]() { return firstFit.GetFreeRangeCount(); });
+
+	const char* names[] = { "TLSF", "first fit" };
+	const RunResult* results[] = { &tlsfResult, &firstFitResult };
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		char line[128];
+		snprintf(line, sizeof(line), "%s, %s", name, names[i]);
+		PrintResult(line, results[i]->m_operationsPerSecond / 1e6, "M operations/s");
+		snprintf(line, sizeof(line), "%s, %s, failed", name, names[i]);
+		PrintResult(line, results[i]->m_failedPercent, "%");
+		snprintf(line, sizeof(line), "%s, %s, free blocks", name, names[i]);
+		PrintResult(line, results[i]->m_freeBlocks, "");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t count = quick ? 20000 : 2000000;
+
+	// Placed resources in 256 MiB heaps, 64 KiB to 4 MiB
+	Compare("256 MiB, 64 KiB - 4 MiB", 256ull << 20, 65536, 64, count);
+	// Many small buffers sub-allocated from a large one, 256 B to 16 KiB. First fit scans thousands of free ranges
+	Compare("256 MiB, 256 B - 16 KiB", 256ull << 20, 256, 64, count / 4);
+	return 0;
+}
@@ -0,0 +1,190 @@
+#include "Benchmark.h"
+#include "MockDevice.h"
+#include "Allocator.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const UINT64 kUploadHeapSize = 256 * 1024 * 1024;
+const uint32_t kFramesInFlight = 2;
+
+// The path UploadAllocator replaced : one placed buffer per upload, the heap is reset once all of them are released
+class PlacedUploadAllocator
+{
+public:
+	PlacedUploadAllocator(ComPtr<ID3D12Device> device, ComPtr<ID3D12Heap> heap) :
+		m_device(device),
+		m_heap(heap),
+		m_offset(0),
+		m_size(heap->GetDesc().SizeInBytes)
+	{
+	}
+
+	ID3D12Resource* Allocate(const D3D12_RESOURCE_DESC* desc)
+	{
+		D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, desc);
+		UINT64 alignedOffset = AlignUp(m_offset, info.Alignment);
+		if (alignedOffset + info.SizeInBytes > m_size)
+			return nullptr;
+
+		ID3D12Resource* resource = nullptr;
+		m_device->CreatePlacedResource(m_heap.Get(), alignedOffset, desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&resource));
+		m_offset = alignedOffset + info.SizeInBytes;
+		return resource;
+	}
+
+	void Reset() { m_offset = 0; }
+	UINT64 GetUsedSize() const { return m_offset; }
+
+private:
+	ComPtr<ID3D12Device> m_device;
+	ComPtr<ID3D12Heap> m_heap;
+	UINT64 m_offset;
+	UINT64 m_size;
+};
+
+static ComPtr<ID3D12Heap> CreateUploadHeap(ID3D12Device* device)
+{
+	D3D12_HEAP_DESC desc = {};
+	desc.SizeInBytes = kUploadHeapSize;
+	desc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	ComPtr<ID3D12Heap> heap;
+	device->CreateHeap(&desc, IID_PPV_ARGS(&heap));
+	return heap;
+}
+
+static D3D12_RESOURCE_DESC GetBufferDesc(UINT64 size)
+{
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	desc.Width = size;
+	desc.Height = 1;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	return desc;
+}
+
+// Frames of uploads : mostly constant buffer sized, some up to 64 KiB
+static std::vector<UINT64> GetUploadSizes(uint32_t uploadsPerFrame)
+{
+	std::mt19937 random(1);
+	std::vector<UINT64> sizes(uploadsPerFrame);
+	for (UINT64& size : sizes)
+	{
+		size = random() % 4 != 0 ? 256 : 256 + random() % (64 * 1024 - 256);
+	}
+	return sizes;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	uint32_t numFrames = quick ? 20 : 2000;
+	uint32_t uploadsPerFrame = 1000;
+	std::vector<UINT64> sizes = GetUploadSizes(uploadsPerFrame);
+
+	ComPtr<ID3D12Device> device;
+	device.Attach(CreateMockDevice());
+
+	printf("%u frames of %u uploads on a mock device, a lower bound for the placed path with a real driver\n", numFrames, uploadsPerFrame);
+
+	// Placed resources : allocation info, creation, map and unmap for every upload, released when the frame retires
+	{
+		PlacedUploadAllocator allocator(device, CreateUploadHeap(device.Get()));
+		std::vector<ID3D12Resource*> frameResources[kFramesInFlight];
+		uint64_t failed = 0;
+		UINT64 maxUsed = 0;
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < numFrames; frame++)
+		{
+			// All frames in flight share the linear heap, so it can only be reset when none of them is
+			std::vector<ID3D12Resource*>& resources = frameResources[frame % kFramesInFlight];
+			if (frame % kFramesInFlight == 0)
+			{
+				for (std::vector<ID3D12Resource*>& retired : frameResources)
+				{
+					for (ID3D12Resource* resource : retired)
+					{
+						resource->Release();
+					}
+					retired.clear();
+				}
+				allocator.Reset();
+			}
+
+			for (UINT64 size : sizes)
+			{
+				D3D12_RESOURCE_DESC desc = GetBufferDesc(size);
+				ID3D12Resource* resource = allocator.Allocate(&desc);
+				if (resource == nullptr)
+				{
+					failed++;
+					continue;
+				}
+
+				void* data = nullptr;
+				D3D12_RANGE readRange{ 0, 0 };
+				resource->Map(0, &readRange, &data);
+				resource->Unmap(0, nullptr);
+				Consume((uint64_t)data);
+				resources.push_back(resource);
+			}
+			maxUsed = std::max(maxUsed, allocator.GetUsedSize());
+		}
+		double seconds = timer.GetSeconds();
+		for (std::vector<ID3D12Resource*>& retired : frameResources)
+		{
+			for (ID3D12Resource* resource : retired)
+			{
+				resource->Release();
+			}
+		}
+
+		PrintResult("Placed resources, allocations", (numFrames * uploadsPerFrame - failed) / seconds / 1e6, "M/s");
+		PrintResult("Placed resources, failed allocations (heap full)", (double)failed, "");
+		PrintResult("Placed resources, heap used by the frames in flight", maxUsed / (1024.0 * 1024.0), "MiB");
+	}
+
+	// UploadAllocator : a ring over one persistently mapped buffer, regions retire when their fence is reached
+	{
+		UploadAllocator allocator(device, CreateUploadHeap(device.Get()));
+		uint64_t failed = 0;
+		uint64_t allocations = 0;
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < numFrames; frame++)
+		{
+			if (frame >= kFramesInFlight)
+				allocator.Retire(frame - kFramesInFlight + 1);
+
+			for (UINT64 size : sizes)
+			{
+				UploadAllocation allocation = size == 256 ? allocator.AllocateConstants(size) : allocator.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+				if (allocation.m_resource == nullptr)
+				{
+					failed++;
+					continue;
+				}
+				Consume((uint64_t)allocation.m_cpuAddress + allocation.m_gpuAddress);
+				allocations++;
+			}
+			allocator.Submit(frame + 1);
+		}
+		double seconds = timer.GetSeconds();
+
+		UINT64 frameBytes = 0;
+		for (UINT64 size : sizes)
+		{
+			frameBytes += AlignUp(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		}
+		PrintResult("UploadAllocator, allocations", allocations / seconds / 1e6, "M/s");
+		PrintResult("UploadAllocator, failed allocations (ring full)", (double)failed, "");
+		PrintResult("UploadAllocator, heap used by the frames in flight", kFramesInFlight * frameBytes / (1024.0 * 1024.0), "MiB");
+	}
+	return 0;
+}
@@ -0,0 +1,14 @@
+struct VS_Out
+{
+	float4 pos : SV_Position;
+	float2 texCoord : TEXCOORD;
+};
+
+// Single triangle covering the whole screen, no vertex buffer needed
+VS_Out main(uint vertexId : SV_VertexID)
+{
+	VS_Out o;
+	o.texCoord = float2((vertexId << 1) & 2, vertexId & 2);
+	o.pos = float4(o.texCoord * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	return o;
+}
\ No newline at end of file
@@ -1,45 +1,104 @@
 #pragma once
 #include "stdafx.h"
+#include "RingAllocator.h"
 
 
 using Microsoft::WRL::ComPtr;
 
-class LinearHeapAllocator
+// A slice of a bigger upload buffer
+struct UploadAllocation
+{
+	ID3D12Resource* m_resource;
+	UINT64 m_offset;
+	void* m_cpuAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+};
+
+// Carves a single persistently mapped buffer spanning a whole upload heap into suballocations.
+// Memory is handed out by a fence-tracked ring, so new uploads can be written while older ones are still being read by the GPU
+class UploadAllocator
 {
 public:
-	LinearHeapAllocator(ComPtr<ID3D12Device> device, ComPtr<ID3D12Heap> heap):m_device(device), m_heap(heap), m_offset(0)
+	UploadAllocator(ComPtr<ID3D12Device> device, ComPtr<ID3D12Heap> heap):m_device(device), m_heap(heap), m_ring(heap->GetDesc().SizeInBytes)
 	{
-		auto desc = m_heap->GetDesc();
-		m_size = desc.SizeInBytes;
+		D3D12_RESOURCE_DESC bufDesc;
+		bufDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		bufDesc.Height = 1;
+		bufDesc.DepthOrArraySize = 1;
+		bufDesc.MipLevels = 1;
+		bufDesc.SampleDesc.Count = 1;
+		bufDesc.SampleDesc.Quality = 0;
+		bufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		bufDesc.Width = m_ring.GetSize();
+		bufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufDesc.Format = DXGI_FORMAT_UNKNOWN;
+		bufDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		m_device->CreatePlacedResource(m_heap.Get(), 0, &bufDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_buffer));
+
+		// Upload heaps can stay mapped for their whole lifetime, and we never read from them
+		D3D12_RANGE readRange{ 0, 0 };
+		m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_cpuAddress));
+		m_gpuAddress = m_buffer->GetGPUVirtualAddress();
 	}
 
-	ID3D12Resource* Allocate(const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES states, const D3D12_CLEAR_VALUE* pOptimizedClearValue)
+	~UploadAllocator()
 	{
-		D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, desc);
+		m_buffer->Unmap(0, nullptr);
+	}
 
-		auto alignedOffset = (m_offset + info.Alignment - 1) & ~(info.Alignment - 1);
+	// Returns an allocation with a null resource if the ring is full
+	UploadAllocation Allocate(UINT64 size, UINT64 alignment)
+	{
+		UploadAllocation allocation = {};
 
-		if(alignedOffset + info.SizeInBytes < m_size)
-		{
-			ID3D12Resource* resource;
-			m_device->CreatePlacedResource(m_heap.Get(), alignedOffset, desc, states, pOptimizedClearValue, IID_PPV_ARGS(&resource));
-			m_offset = alignedOffset + info.SizeInBytes;
-			return resource;
-		}
-		else
+		UINT64 offset = m_ring.Allocate(size, alignment);
+		if (offset == Sigma::kInvalidOffset)
+			return allocation;
+
+		allocation.m_resource = m_buffer.Get();
+		allocation.m_offset = offset;
+		allocation.m_cpuAddress = m_cpuAddress + offset;
+		allocation.m_gpuAddress = m_gpuAddress + offset;
+		return allocation;
+	}
+
+	UploadAllocation AllocateConstants(UINT64 size)
+	{
+		return Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	}
+
+	// Allocates room for the given subresources, footprints offsets are relative to the start of the upload buffer.
+	// numRows and rowSizesInBytes are optional, as with GetCopyableFootprints
+	UploadAllocation AllocateTexture(const D3D12_RESOURCE_DESC* desc, UINT firstSubresource, UINT numSubresources, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprints, UINT* numRows = nullptr, UINT64* rowSizesInBytes = nullptr)
+	{
+		UINT64 size = 0;
+		m_device->GetCopyableFootprints(desc, firstSubresource, numSubresources, 0, nullptr, nullptr, nullptr, &size);
+
+		UploadAllocation allocation = Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		if (allocation.m_resource != nullptr)
 		{
-			return nullptr;
+			m_device->GetCopyableFootprints(desc, firstSubresource, numSubresources, allocation.m_offset, footprints, numRows, rowSizesInBytes, nullptr);
 		}
+		return allocation;
 	}
 
-	void Reset()
+	// Everything allocated since the last Submit will be reclaimed once the fence reaches fenceValue
+	void Submit(UINT64 fenceValue)
 	{
-		m_offset = 0;
+		m_ring.Submit(fenceValue);
+	}
+
+	void Retire(UINT64 completedFenceValue)
+	{
+		m_ring.Retire(completedFenceValue);
 	}
 
 private:
 	ComPtr<ID3D12Device> m_device;
 	ComPtr<ID3D12Heap> m_heap;
-	UINT64 m_offset;
-	UINT64 m_size;
-};
\ No newline at end of file
+	ComPtr<ID3D12Resource> m_buffer;
+	UINT8* m_cpuAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+	Sigma::RingAllocator m_ring;
+};
@@ -0,0 +1,353 @@
+#include "AssetArchive.h"
+#include "Align.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Sigma
+{
+	// The handles are closed right away, the view keeps the file open until unmapped
+	static const uint8_t* MapFile(const char* path, uint64_t& size)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		LARGE_INTEGER fileSize;
+		void* data = nullptr;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		{
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+			{
+				data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+			size = (uint64_t)fileSize.QuadPart;
+		}
+		CloseHandle(file);
+		return static_cast<const uint8_t*>(data);
+#else
+		int file = open(path, O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			return nullptr;
+
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			size = (uint64_t)status.st_size;
+		}
+		close(file);
+		return data != MAP_FAILED ? static_cast<const uint8_t*>(data) : nullptr;
+#endif
+	}
+
+	static void UnmapFile(const uint8_t* data, uint64_t size)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<uint8_t*>(data), (size_t)size);
+#endif
+	}
+
+	// Faults read ahead around them, which suits assets but would make opening read megabytes of them
+	static void SetReadAhead(const uint8_t* data, uint64_t size, bool enabled)
+	{
+#ifndef _WIN32
+		madvise(const_cast<uint8_t*>(data), (size_t)size, enabled ? MADV_NORMAL : MADV_RANDOM);
+#endif
+	}
+
+	static void Prefetch(const uint8_t* data, uint64_t size)
+	{
+#ifdef _WIN32
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<uint8_t*>(data);
+		range.NumberOfBytes = (SIZE_T)size;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+		madvise(const_cast<uint8_t*>(data), (size_t)size, MADV_WILLNEED);
+#endif
+	}
+
+	uint64_t HashAssetName(const char* name)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (; *name != 0; name++)
+		{
+			hash ^= (uint8_t)*name;
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	AssetArchive::AssetArchive() :
+		m_data(nullptr),
+		m_size(0),
+		m_entries(nullptr),
+		m_entryCount(0)
+	{
+	}
+
+	AssetArchive::~AssetArchive()
+	{
+		Close();
+	}
+
+	bool AssetArchive::Open(const char* path)
+	{
+		Close();
+
+		uint64_t size = 0;
+		const uint8_t* data = MapFile(path, size);
+		if (data == nullptr)
+			return false;
+
+		// Opening reads the header and the table of contents, nothing else
+		SetReadAhead(data, size, false);
+		AssetArchiveHeader header;
+		bool valid = size >= sizeof(header);
+		if (valid)
+		{
+			memcpy(&header, data, sizeof(header));
+			valid = header.m_magic == kAssetArchiveMagic && header.m_version == kAssetArchiveVersion && header.m_blockSize == kAssetArchiveBlockSize &&
+				header.m_tocOffset % alignof(AssetArchiveEntry) == 0 && header.m_tocOffset <= size &&
+				header.m_entryCount <= (size - header.m_tocOffset) / sizeof(AssetArchiveEntry);
+		}
+		if (valid)
+			Prefetch(data, header.m_tocOffset + (uint64_t)header.m_entryCount * sizeof(AssetArchiveEntry));
+
+		// Everything Find and Read rely on is checked once here
+		const AssetArchiveEntry* entries = valid ? reinterpret_cast<const AssetArchiveEntry*>(data + header.m_tocOffset) : nullptr;
+		for (uint32_t i = 0; valid && i < header.m_entryCount; i++)
+		{
+			const AssetArchiveEntry& entry = entries[i];
+			valid = entry.m_offset <= size && entry.m_storedSize <= size - entry.m_offset && (i == 0 || entries[i - 1].m_nameHash < entry.m_nameHash);
+			if (entry.m_numBlocks == 0)
+				valid = valid && entry.m_storedSize == entry.m_size;
+			else
+				valid = valid && entry.m_numBlocks == (entry.m_size + kAssetArchiveBlockSize - 1) / kAssetArchiveBlockSize && entry.m_storedSize >= entry.m_numBlocks * sizeof(uint32_t);
+		}
+
+		if (!valid)
+		{
+			UnmapFile(data, size);
+			return false;
+		}
+
+		SetReadAhead(data, size, true);
+		m_data = data;
+		m_size = size;
+		m_entries = entries;
+		m_entryCount = header.m_entryCount;
+		return true;
+	}
+
+	void AssetArchive::Close()
+	{
+		if (m_data != nullptr)
+			UnmapFile(m_data, m_size);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_entries = nullptr;
+		m_entryCount = 0;
+	}
+
+	const AssetArchiveEntry* AssetArchive::Find(const char* name) const
+	{
+		return Find(HashAssetName(name));
+	}
+
+	const AssetArchiveEntry* AssetArchive::Find(uint64_t nameHash) const
+	{
+		const AssetArchiveEntry* end = m_entries + m_entryCount;
+		const AssetArchiveEntry* entry = std::lower_bound(m_entries, end, nameHash, [](const AssetArchiveEntry& entry, uint64_t hash)
+		{
+			return entry.m_nameHash < hash;
+		});
+		return entry != end && entry->m_nameHash == nameHash ? entry : nullptr;
+	}
+
+	AssetSpan AssetArchive::GetSpan(const AssetArchiveEntry& entry) const
+	{
+		AssetSpan span = {};
+		if (entry.m_numBlocks == 0)
+		{
+			span.m_data = m_data + entry.m_offset;
+			span.m_size = entry.m_size;
+		}
+		return span;
+	}
+
+	bool AssetArchive::Read(const AssetArchiveEntry& entry, void* destination, JobSystem* jobSystem) const
+	{
+		const uint8_t* stored = m_data + entry.m_offset;
+		if (entry.m_size == 0)
+			return true;
+		if (entry.m_numBlocks == 0)
+		{
+			memcpy(destination, stored, (size_t)entry.m_size);
+			return true;
+		}
+
+		// Block offsets are known before decompressing anything, so blocks are independent
+		std::vector<uint32_t> blockSizes(entry.m_numBlocks);
+		std::vector<uint64_t> blockOffsets(entry.m_numBlocks);
+		memcpy(blockSizes.data(), stored, entry.m_numBlocks * sizeof(uint32_t));
+		uint64_t offset = entry.m_numBlocks * sizeof(uint32_t);
+		for (uint32_t i = 0; i < entry.m_numBlocks; i++)
+		{
+			blockOffsets[i] = offset;
+			offset += blockSizes[i] & ~kStoredBlock;
+		}
+		if (offset > entry.m_storedSize)
+			return false;
+
+		std::atomic<bool> valid(true);
+		auto decompress = [&](uint32_t i)
+		{
+			uint8_t* output = static_cast<uint8_t*>(destination) + (uint64_t)i * kAssetArchiveBlockSize;
+			uint32_t size = (uint32_t)std::min<uint64_t>(entry.m_size - (uint64_t)i * kAssetArchiveBlockSize, kAssetArchiveBlockSize);
+			uint32_t storedSize = blockSizes[i] & ~kStoredBlock;
+			if ((blockSizes[i] & kStoredBlock) != 0)
+			{
+				if (storedSize == size)
+					memcpy(output, stored + blockOffsets[i], size);
+				else
+					valid = false;
+			}
+			else if (!DecompressBlock(stored + blockOffsets[i], storedSize, output, size))
+			{
+				valid = false;
+			}
+		};
+
+		if (jobSystem != nullptr && entry.m_numBlocks > 1)
+		{
+			jobSystem->ParallelFor(entry.m_numBlocks, 1, decompress);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < entry.m_numBlocks; i++)
+				decompress(i);
+		}
+		return valid;
+	}
+
+	bool AssetArchiveWriter::Add(const char* name, const void* data, uint64_t size, bool compress)
+	{
+		uint64_t nameHash = HashAssetName(name);
+		for (const Asset& asset : m_assets)
+		{
+			if (asset.m_entry.m_nameHash == nameHash)
+				return false;
+		}
+
+		Asset asset;
+		asset.m_entry.m_nameHash = nameHash;
+		asset.m_entry.m_offset = 0;
+		asset.m_entry.m_size = size;
+		asset.m_entry.m_numBlocks = 0;
+		asset.m_entry.m_padding = 0;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		if (compress && size > 0)
+		{
+			uint32_t numBlocks = (uint32_t)((size + kAssetArchiveBlockSize - 1) / kAssetArchiveBlockSize);
+			asset.m_stored.resize(numBlocks * sizeof(uint32_t));
+			std::vector<uint8_t> block(GetCompressBound(kAssetArchiveBlockSize));
+			for (uint32_t i = 0; i < numBlocks; i++)
+			{
+				const uint8_t* source = bytes + (uint64_t)i * kAssetArchiveBlockSize;
+				uint32_t blockSize = (uint32_t)std::min<uint64_t>(size - (uint64_t)i * kAssetArchiveBlockSize, kAssetArchiveBlockSize);
+
+				// Blocks only stay compressed if that saves space
+				uint32_t compressedSize = CompressBlock(source, blockSize, block.data(), blockSize - 1);
+				uint32_t storedSize = compressedSize != 0 ? compressedSize : blockSize | kStoredBlock;
+				memcpy(asset.m_stored.data() + i * sizeof(uint32_t), &storedSize, sizeof(storedSize));
+				if (compressedSize != 0)
+					asset.m_stored.insert(asset.m_stored.end(), block.data(), block.data() + compressedSize);
+				else
+					asset.m_stored.insert(asset.m_stored.end(), source, source + blockSize);
+			}
+
+			if (asset.m_stored.size() < size)
+				asset.m_entry.m_numBlocks = numBlocks;
+		}
+
+		if (asset.m_entry.m_numBlocks == 0)
+			asset.m_stored.assign(bytes, bytes + size);
+
+		asset.m_entry.m_storedSize = asset.m_stored.size();
+		m_assets.push_back(std::move(asset));
+		return true;
+	}
+
+	bool AssetArchiveWriter::Write(const char* path) const
+	{
+		// The table of contents follows the header, so opening only touches the start of the file. Assets keep the order
+		// they were added in, so assets loaded together are read together
+		std::vector<AssetArchiveEntry> entries;
+		uint64_t tocOffset = AlignUp(sizeof(AssetArchiveHeader), alignof(AssetArchiveEntry));
+		uint64_t offset = AlignUp(tocOffset + m_assets.size() * sizeof(AssetArchiveEntry), kAssetArchiveAlignment);
+		for (const Asset& asset : m_assets)
+		{
+			entries.push_back(asset.m_entry);
+			entries.back().m_offset = offset;
+			offset = AlignUp(offset + asset.m_stored.size(), kAssetArchiveAlignment);
+		}
+
+		AssetArchiveHeader header;
+		header.m_magic = kAssetArchiveMagic;
+		header.m_version = kAssetArchiveVersion;
+		header.m_entryCount = (uint32_t)entries.size();
+		header.m_blockSize = kAssetArchiveBlockSize;
+		header.m_tocOffset = tocOffset;
+
+		std::sort(entries.begin(), entries.end(), [](const AssetArchiveEntry& a, const AssetArchiveEntry& b)
+		{
+			return a.m_nameHash < b.m_nameHash;
+		});
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		const char padding[kAssetArchiveAlignment] = {};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding, tocOffset - sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetArchiveEntry));
+		uint64_t position = tocOffset + entries.size() * sizeof(AssetArchiveEntry);
+		for (const Asset& asset : m_assets)
+		{
+			uint64_t start = AlignUp(position, kAssetArchiveAlignment);
+			file.write(padding, start - position);
+			file.write(reinterpret_cast<const char*>(asset.m_stored.data()), asset.m_stored.size());
+			position = start + asset.m_stored.size();
+		}
+		return (bool)file;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Sigma
+{
+	class JobSystem;
+
+	const uint32_t kAssetArchiveMagic = 0x4b504753; // "SGPK"
+	const uint32_t kAssetArchiveVersion = 1;
+	const uint32_t kAssetArchiveAlignment = 64; // Of entries, from the start of the file
+	const uint32_t kAssetArchiveBlockSize = 64 * 1024; // Compressed entries are split in blocks of this size
+	const uint32_t kStoredBlock = 0x80000000; // Set in the block size of blocks that did not compress
+
+	struct AssetArchiveHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		uint32_t m_entryCount;
+		uint32_t m_blockSize;
+		uint64_t m_tocOffset;
+	};
+
+	struct AssetArchiveEntry
+	{
+		uint64_t m_nameHash;
+		uint64_t m_offset;
+		uint64_t m_size; // Once decompressed
+		uint64_t m_storedSize;
+		uint32_t m_numBlocks; // 0 for uncompressed entries
+		uint32_t m_padding;
+	};
+
+	// Points into a mapped archive
+	struct AssetSpan
+	{
+		const uint8_t* m_data;
+		uint64_t m_size;
+	};
+
+	// 64 bits FNV-1a of the name, which is case sensitive
+	uint64_t HashAssetName(const char* name);
+
+	/*
+	Read only archive of assets, memory mapped whole. Opening only maps the file and checks the table of contents, pages
+	are read by the OS when first touched, and every asset is shared with the file cache instead of copied.
+
+	File : header, table of contents sorted by name hash, then the assets aligned to kAssetArchiveAlignment.
+	Uncompressed entries are handed out as spans into the mapping, which can be given directly to D3D or copied into
+	upload memory. Compressed entries start with the size of each block (LZ4 block format, kStoredBlock when stored as
+	is), and are decompressed by Read, block by block in jobs when a job system is given.
+	*/
+	class AssetArchive
+	{
+	public:
+		AssetArchive();
+		~AssetArchive();
+
+		// Returns false if the file can not be mapped or is not a valid archive
+		bool Open(const char* path);
+		void Close();
+
+		// nullptr if the archive has no asset with this name
+		const AssetArchiveEntry* Find(const char* name) const;
+		const AssetArchiveEntry* Find(uint64_t nameHash) const;
+
+		// Valid until Close, empty for compressed entries
+		AssetSpan GetSpan(const AssetArchiveEntry& entry) const;
+		// Writes the m_size bytes of the entry, false if compressed data is corrupt
+		bool Read(const AssetArchiveEntry& entry, void* destination, JobSystem* jobSystem = nullptr) const;
+
+		uint32_t GetEntryCount() const { return m_entryCount; }
+		bool IsOpen() const { return m_data != nullptr; }
+
+	private:
+		const uint8_t* m_data;
+		uint64_t m_size;
+		const AssetArchiveEntry* m_entries;
+		uint32_t m_entryCount;
+	};
+
+	// Builds archives offline or in development builds, assets are kept in memory until Write
+	class AssetArchiveWriter
+	{
+	public:
+		// Returns false if an asset with the same name hash was already added
+		bool Add(const char* name, const void* data, uint64_t size, bool compress);
+		bool Write(const char* path) const;
+
+	private:
+		struct Asset
+		{
+			AssetArchiveEntry m_entry;
+			std::vector<uint8_t> m_stored;
+		};
+
+		std::vector<Asset> m_assets;
+	};
+}
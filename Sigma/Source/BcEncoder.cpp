@@ -0,0 +1,528 @@
+#include "BcEncoder.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include "JobSystem.h"
+
+namespace Sigma
+{
+	const uint32_t kBlockRowsPerJob = 8;
+	const uint32_t kPowerIterations = 8;
+	const int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// 4x4 texels, one array per channel so 4 texels fit in a register
+	struct Block
+	{
+		float m_channels[4][16];
+	};
+
+	static void LoadBlock(const uint8_t* source, uint64_t rowPitch, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			const uint8_t* row = source + std::min(blockY * 4 + y, height - 1) * rowPitch;
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				const uint8_t* texel = row + std::min(blockX * 4 + x, width - 1) * 4;
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					block.m_channels[c][y * 4 + x] = texel[c];
+				}
+			}
+		}
+	}
+
+	// Closest palette entry of each texel and its squared error
+	static void FindIndices(const Block& block, uint32_t channels, const float (*palette)[4], uint32_t paletteSize, uint32_t* indices, float* errors)
+	{
+		for (uint32_t group = 0; group < 16; group += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (uint32_t i = 0; i < paletteSize; i++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (uint32_t c = 0; c < channels; c++)
+				{
+					__m128 difference = _mm_sub_ps(_mm_loadu_ps(block.m_channels[c] + group), _mm_set1_ps(palette[i][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)), _mm_andnot_si128(closer, bestIndex));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + group), bestIndex);
+			_mm_storeu_ps(errors + group, best);
+		}
+	}
+
+	// Mean and principal axis of the texels in mask (all if null), and the range of their projections on it
+	static void FitAxis(const Block& block, uint32_t channels, const bool* mask, float* mean, float* axis, float& minProjection, float& maxProjection)
+	{
+		uint32_t count = 0;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			mean[c] = 0.0f;
+		}
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				mean[c] += block.m_channels[c][i];
+			}
+			count++;
+		}
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			mean[c] /= std::max(count, 1u);
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+			for (uint32_t a = 0; a < channels; a++)
+			{
+				for (uint32_t b = a; b < channels; b++)
+				{
+					covariance[a][b] += (block.m_channels[a][i] - mean[a]) * (block.m_channels[b][i] - mean[b]);
+				}
+			}
+		}
+
+		// Power iteration, from the row of the channel that varies most
+		uint32_t start = 0;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			for (uint32_t b = 0; b < c; b++)
+			{
+				covariance[c][b] = covariance[b][c];
+			}
+			if (covariance[c][c] > covariance[start][start])
+				start = c;
+		}
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			axis[c] = covariance[start][c];
+		}
+		for (uint32_t iteration = 0; iteration < kPowerIterations; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (uint32_t a = 0; a < channels; a++)
+			{
+				for (uint32_t b = 0; b < channels; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+
+			// Flat block, every texel is the mean
+			if (length < 1e-12f)
+			{
+				for (uint32_t c = 0; c < channels; c++)
+				{
+					axis[c] = 0.0f;
+				}
+				break;
+			}
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				axis[c] = next[c] / sqrtf(length);
+			}
+		}
+
+		minProjection = FLT_MAX;
+		maxProjection = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+			float projection = 0.0f;
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				projection += (block.m_channels[c][i] - mean[c]) * axis[c];
+			}
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+	}
+
+	// Least squares endpoints for the weights of the first endpoint at each texel, false if they are all the same
+	static bool FitEndpoints(const Block& block, uint32_t channels, const float* weights, const bool* mask, float* first, float* second)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+			float a = weights[i];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				ax[c] += a * block.m_channels[c][i];
+				bx[c] += b * block.m_channels[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			first[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			second[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	static uint16_t QuantizeRgb565(const float* color)
+	{
+		int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+		int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * (63.0f / 255.0f) + 0.5f);
+		int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+		return (uint16_t)(r << 11 | g << 5 | b);
+	}
+
+	static void ExpandRgb565(uint16_t color, float* expanded)
+	{
+		uint32_t r = color >> 11;
+		uint32_t g = (color >> 5) & 63;
+		uint32_t b = color & 31;
+		expanded[0] = (float)(r << 3 | r >> 2);
+		expanded[1] = (float)(g << 2 | g >> 4);
+		expanded[2] = (float)(b << 3 | b >> 2);
+	}
+
+	// BC2 and BC3 always decode their color block with 4 colors, BC1 only if color0 > color1
+	static void EncodeBc1Block(const Block& block, uint32_t quality, bool allowTransparent, bool alwaysFourColors, uint8_t* out)
+	{
+		bool opaque[16];
+		bool anyTransparent = false;
+		bool anyOpaque = false;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			opaque[i] = !allowTransparent || block.m_channels[3][i] >= 128.0f;
+			anyTransparent |= !opaque[i];
+			anyOpaque |= opaque[i];
+		}
+
+		// Equal colors select the 3 color mode, where index 3 is transparent
+		uint16_t bestColors[2] = { 0, 0 };
+		uint32_t bestIndices[16];
+		std::fill(bestIndices, bestIndices + 16, 3u);
+
+		if (anyOpaque)
+		{
+			float mean[4], axis[4], minProjection, maxProjection;
+			FitAxis(block, 3, opaque, mean, axis, minProjection, maxProjection);
+			float endpoints[2][4];
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				endpoints[0][c] = mean[c] + axis[c] * maxProjection;
+				endpoints[1][c] = mean[c] + axis[c] * minProjection;
+			}
+
+			float bestError = FLT_MAX;
+			for (uint32_t pass = 0; pass <= quality; pass++)
+			{
+				uint16_t colors[2] = { QuantizeRgb565(endpoints[0]), QuantizeRgb565(endpoints[1]) };
+				if (!alwaysFourColors && (anyTransparent ? colors[0] > colors[1] : colors[0] < colors[1]))
+					std::swap(colors[0], colors[1]);
+				bool fourColors = alwaysFourColors || colors[0] > colors[1];
+
+				float palette[4][4];
+				ExpandRgb565(colors[0], palette[0]);
+				ExpandRgb565(colors[1], palette[1]);
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					palette[2][c] = fourColors ? (2.0f * palette[0][c] + palette[1][c]) / 3.0f : (palette[0][c] + palette[1][c]) * 0.5f;
+					palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+				}
+
+				uint32_t indices[16];
+				float errors[16];
+				FindIndices(block, 3, palette, fourColors ? 4 : 3, indices, errors);
+				float error = 0.0f;
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					if (opaque[i])
+						error += errors[i];
+					else
+						indices[i] = 3;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestColors[0] = colors[0];
+					bestColors[1] = colors[1];
+					std::copy(indices, indices + 16, bestIndices);
+				}
+				if (pass == quality || error == 0.0f)
+					break;
+
+				const float fourColorWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+				const float threeColorWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+				float weights[16];
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					weights[i] = fourColors ? fourColorWeights[indices[i]] : threeColorWeights[indices[i]];
+				}
+				if (!FitEndpoints(block, 3, weights, opaque, endpoints[0], endpoints[1]))
+					break;
+			}
+		}
+
+		uint32_t indexBits = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			indexBits |= bestIndices[i] << (2 * i);
+		}
+		memcpy(out, &bestColors[0], sizeof(uint16_t));
+		memcpy(out + 2, &bestColors[1], sizeof(uint16_t));
+		memcpy(out + 4, &indexBits, sizeof(indexBits));
+	}
+
+	// 8 value mode with the max as first endpoint : the palette is linear from max to min, the closest index is a rounding
+	static void EncodeBc4Block(const Block& block, uint32_t channel, uint8_t* out)
+	{
+		const float* values = block.m_channels[channel];
+		float maxValue = *std::max_element(values, values + 16);
+		float minValue = *std::min_element(values, values + 16);
+		out[0] = (uint8_t)maxValue;
+		out[1] = (uint8_t)minValue;
+
+		uint64_t indexBits = 0;
+		if (maxValue > minValue)
+		{
+			const __m128 scale = _mm_set1_ps(7.0f / (maxValue - minValue));
+			const __m128 half = _mm_set1_ps(0.5f);
+			int32_t steps[16];
+			for (uint32_t group = 0; group < 16; group += 4)
+			{
+				__m128 distance = _mm_sub_ps(_mm_set1_ps(maxValue), _mm_loadu_ps(values + group));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(steps + group), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(distance, scale), half)));
+			}
+
+			// Indices 0 and 1 are the endpoints, 2 to 7 the values in between
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint64_t index = steps[i] == 0 ? 0 : steps[i] == 7 ? 1 : steps[i] + 1;
+				indexBits |= index << (3 * i);
+			}
+		}
+		memcpy(out + 2, &indexBits, 6);
+	}
+
+	struct BitWriter
+	{
+		uint8_t* m_out;
+		uint32_t m_position;
+
+		void Write(uint32_t value, uint32_t numBits)
+		{
+			for (uint32_t bit = 0; bit < numBits; bit++, m_position++)
+			{
+				if ((value >> bit) & 1)
+					m_out[m_position >> 3] |= (uint8_t)(1 << (m_position & 7));
+			}
+		}
+	};
+
+	static void QuantizeBc7Endpoint(const float* endpoint, uint32_t pbit, int* quantized, int* expanded)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			quantized[c] = std::min(std::max((int)((std::min(std::max(endpoint[c], 0.0f), 255.0f) - pbit) * 0.5f + 0.5f), 0), 127);
+			expanded[c] = quantized[c] << 1 | (int)pbit;
+		}
+	}
+
+	static float EvaluateBc7(const Block& block, const int* first, const int* second, uint32_t* indices)
+	{
+		float palette[16][4];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				palette[i][c] = (float)(((64 - kBc7Weights[i]) * first[c] + kBc7Weights[i] * second[c] + 32) >> 6);
+			}
+		}
+
+		float errors[16];
+		FindIndices(block, 4, palette, 16, indices, errors);
+		float error = 0.0f;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			error += errors[i];
+		}
+		return error;
+	}
+
+	static void EncodeBc7Block(const Block& block, uint32_t quality, uint8_t* out)
+	{
+		float mean[4], axis[4], minProjection, maxProjection;
+		FitAxis(block, 4, nullptr, mean, axis, minProjection, maxProjection);
+		float endpoints[2][4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = mean[c] + axis[c] * minProjection;
+			endpoints[1][c] = mean[c] + axis[c] * maxProjection;
+		}
+
+		float bestError = FLT_MAX;
+		int bestQuantized[2][4] = {};
+		uint32_t bestPbits[2] = { 0, 0 };
+		uint32_t bestIndices[16] = {};
+		for (uint32_t pass = 0; pass <= quality; pass++)
+		{
+			// Every p-bit combination, or for each endpoint the p-bit closest to it
+			uint32_t pbitCombinations[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+			uint32_t numCombinations = 4;
+			if (quality < 2)
+			{
+				for (uint32_t e = 0; e < 2; e++)
+				{
+					float errors[2] = {};
+					for (uint32_t pbit = 0; pbit < 2; pbit++)
+					{
+						int quantized[4], expanded[4];
+						QuantizeBc7Endpoint(endpoints[e], pbit, quantized, expanded);
+						for (uint32_t c = 0; c < 4; c++)
+						{
+							errors[pbit] += (expanded[c] - endpoints[e][c]) * (expanded[c] - endpoints[e][c]);
+						}
+					}
+					pbitCombinations[0][e] = errors[1] < errors[0] ? 1 : 0;
+				}
+				numCombinations = 1;
+			}
+
+			for (uint32_t combination = 0; combination < numCombinations; combination++)
+			{
+				int quantized[2][4], expanded[2][4];
+				uint32_t indices[16];
+				QuantizeBc7Endpoint(endpoints[0], pbitCombinations[combination][0], quantized[0], expanded[0]);
+				QuantizeBc7Endpoint(endpoints[1], pbitCombinations[combination][1], quantized[1], expanded[1]);
+				float error = EvaluateBc7(block, expanded[0], expanded[1], indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(bestQuantized, quantized, sizeof(quantized));
+					bestPbits[0] = pbitCombinations[combination][0];
+					bestPbits[1] = pbitCombinations[combination][1];
+					std::copy(indices, indices + 16, bestIndices);
+				}
+			}
+			if (pass == quality || bestError == 0.0f)
+				break;
+
+			float weights[16];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				weights[i] = 1.0f - kBc7Weights[bestIndices[i]] / 64.0f;
+			}
+			if (!FitEndpoints(block, 4, weights, nullptr, endpoints[0], endpoints[1]))
+				break;
+		}
+
+		// The most significant bit of the first index is implicit 0
+		if (bestIndices[0] >= 8)
+		{
+			std::swap(bestQuantized[0], bestQuantized[1]);
+			std::swap(bestPbits[0], bestPbits[1]);
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				bestIndices[i] = 15 - bestIndices[i];
+			}
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.Write(1 << 6, 7);
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			writer.Write(bestQuantized[0][c], 7);
+			writer.Write(bestQuantized[1][c], 7);
+		}
+		writer.Write(bestPbits[0], 1);
+		writer.Write(bestPbits[1], 1);
+		writer.Write(bestIndices[0], 3);
+		for (uint32_t i = 1; i < 16; i++)
+		{
+			writer.Write(bestIndices[i], 4);
+		}
+	}
+
+	uint32_t GetBcBlockSize(BcFormat format)
+	{
+		return format == BcFormat::BC1 || format == BcFormat::BC4 ? 8 : 16;
+	}
+
+	void EncodeBc(BcFormat format, const uint8_t* source, uint64_t sourceRowPitch, uint32_t width, uint32_t height, uint8_t* destination, uint64_t destinationRowPitch, uint32_t quality, JobSystem* jobSystem)
+	{
+		uint32_t blocksX = (width + 3) / 4;
+		uint32_t blocksY = (height + 3) / 4;
+		uint32_t blockSize = GetBcBlockSize(format);
+		quality = std::min(quality, kMaxBcQuality);
+
+		auto encodeRows = [&](uint32_t firstRow, uint32_t endRow)
+		{
+			Block block;
+			for (uint32_t blockY = firstRow; blockY < endRow; blockY++)
+			{
+				uint8_t* out = destination + blockY * destinationRowPitch;
+				for (uint32_t blockX = 0; blockX < blocksX; blockX++, out += blockSize)
+				{
+					LoadBlock(source, sourceRowPitch, width, height, blockX, blockY, block);
+					switch (format)
+					{
+					case BcFormat::BC1:
+						EncodeBc1Block(block, quality, true, false, out);
+						break;
+					case BcFormat::BC3:
+						EncodeBc4Block(block, 3, out);
+						EncodeBc1Block(block, quality, false, true, out + 8);
+						break;
+					case BcFormat::BC4:
+						EncodeBc4Block(block, 0, out);
+						break;
+					case BcFormat::BC5:
+						EncodeBc4Block(block, 0, out);
+						EncodeBc4Block(block, 1, out + 8);
+						break;
+					case BcFormat::BC7:
+						EncodeBc7Block(block, quality, out);
+						break;
+					}
+				}
+			}
+		};
+
+		if (jobSystem == nullptr || blocksY <= kBlockRowsPerJob)
+		{
+			encodeRows(0, blocksY);
+			return;
+		}
+
+		uint32_t numJobs = (blocksY + kBlockRowsPerJob - 1) / kBlockRowsPerJob;
+		jobSystem->ParallelFor(numJobs, 1, [&](uint32_t job)
+		{
+			encodeRows(job * kBlockRowsPerJob, std::min((job + 1) * kBlockRowsPerJob, blocksY));
+		});
+	}
+}
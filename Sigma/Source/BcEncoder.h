@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Sigma
+{
+	class JobSystem;
+
+	enum class BcFormat
+	{
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7,
+	};
+
+	const uint32_t kMaxBcQuality = 4;
+
+	/*
+	Block compression encoder, from RGBA8 images.
+
+	BC1 and the color part of BC3 fit their endpoints on the principal axis of the block colors, BC4 (the alpha part of
+	BC3, both channels of BC5) uses the min and max of the block and computes indices directly. BC7 only uses mode 6
+	(single subset, RGBA endpoints with p-bits, 4 bit indices), which covers smooth color and alpha blocks well but not
+	sharp edges between two colors. Quality is the number of least squares refinement passes of the endpoints (BC1, BC3
+	and BC7), from quality 2 BC7 also tries every p-bit combination.
+
+	BC1 blocks with texels under alpha 128 use the 3 color mode, those texels become transparent. BC4 reads the red
+	channel, BC5 red and green. Texels are processed with SSE2, block rows are split in jobs when a job system is given.
+	*/
+	uint32_t GetBcBlockSize(BcFormat format);
+	// The destination has one row of blocks every destinationRowPitch bytes, partial blocks at the edges are clamped
+	void EncodeBc(BcFormat format, const uint8_t* source, uint64_t sourceRowPitch, uint32_t width, uint32_t height, uint8_t* destination, uint64_t destinationRowPitch, uint32_t quality, JobSystem* jobSystem);
+}
@@ -0,0 +1,184 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Sigma
+{
+	const uint32_t kMinMatch = 4;
+	const uint32_t kLastLiterals = 5; // The block always ends with literals
+	const uint32_t kMatchStartLimit = 12; // No match starts in the last bytes
+	const uint32_t kMaxOffset = 65535;
+	const uint32_t kHashBits = 12;
+	const uint32_t kNoPosition = 0xffffffff;
+
+	static inline uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// Lengths over 15 continue in bytes of 255, ended by a smaller one
+	static bool WriteLength(uint8_t*& out, const uint8_t* end, uint32_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			if (out == end)
+				return false;
+			*out++ = 255;
+		}
+		if (out == end)
+			return false;
+		*out++ = (uint8_t)length;
+		return true;
+	}
+
+	static bool ReadLength(const uint8_t*& in, const uint8_t* end, uint32_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in == end)
+				return false;
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	static bool WriteSequence(uint8_t*& out, const uint8_t* end, const uint8_t* literals, uint32_t numLiterals, uint32_t offset, uint32_t matchLength)
+	{
+		if (out == end)
+			return false;
+
+		uint8_t* token = out++;
+		*token = (uint8_t)((numLiterals < 15 ? numLiterals : 15) << 4);
+		if (numLiterals >= 15 && !WriteLength(out, end, numLiterals - 15))
+			return false;
+		if ((uint32_t)(end - out) < numLiterals)
+			return false;
+		if (numLiterals != 0)
+			memcpy(out, literals, numLiterals);
+		out += numLiterals;
+
+		// The last sequence has no match
+		if (matchLength == 0)
+			return true;
+
+		if (end - out < 2)
+			return false;
+		*out++ = (uint8_t)offset;
+		*out++ = (uint8_t)(offset >> 8);
+		matchLength -= kMinMatch;
+		*token |= (uint8_t)(matchLength < 15 ? matchLength : 15);
+		return matchLength < 15 || WriteLength(out, end, matchLength - 15);
+	}
+
+	uint32_t GetCompressBound(uint32_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	uint32_t CompressBlock(const void* source, uint32_t size, void* destination, uint32_t capacity)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(source);
+		uint8_t* out = static_cast<uint8_t*>(destination);
+		const uint8_t* end = out + capacity;
+
+		uint32_t table[1 << kHashBits];
+		std::fill(table, table + (1 << kHashBits), kNoPosition);
+
+		uint32_t anchor = 0;
+		uint32_t position = 0;
+		uint32_t matchLimit = size > kLastLiterals ? size - kLastLiterals : 0;
+		uint32_t startLimit = size > kMatchStartLimit ? size - kMatchStartLimit : 0;
+		while (position < startLimit)
+		{
+			uint32_t sequence = Read32(src + position);
+			uint32_t hash = Hash(sequence);
+			uint32_t candidate = table[hash];
+			table[hash] = position;
+
+			if (candidate == kNoPosition || position - candidate > kMaxOffset || Read32(src + candidate) != sequence)
+			{
+				// Skips faster through data that does not compress
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			uint32_t length = kMinMatch;
+			while (position + length < matchLimit && src[candidate + length] == src[position + length])
+				length++;
+
+			if (!WriteSequence(out, end, src + anchor, position - anchor, position - candidate, length))
+				return 0;
+
+			position += length;
+			anchor = position;
+			if (position >= 2 && position - 2 < startLimit)
+				table[Hash(Read32(src + position - 2))] = position - 2;
+		}
+
+		if (!WriteSequence(out, end, src + anchor, size - anchor, 0, 0))
+			return 0;
+		return (uint32_t)(out - static_cast<uint8_t*>(destination));
+	}
+
+	bool DecompressBlock(const void* source, uint32_t compressedSize, void* destination, uint32_t size)
+	{
+		const uint8_t* in = static_cast<const uint8_t*>(source);
+		const uint8_t* inEnd = in + compressedSize;
+		uint8_t* out = static_cast<uint8_t*>(destination);
+		uint8_t* outStart = out;
+		uint8_t* outEnd = out + size;
+
+		while (in < inEnd)
+		{
+			uint8_t token = *in++;
+			uint32_t numLiterals = token >> 4;
+			if (numLiterals == 15 && !ReadLength(in, inEnd, numLiterals))
+				return false;
+			if ((uint32_t)(inEnd - in) < numLiterals || (uint32_t)(outEnd - out) < numLiterals)
+				return false;
+			memcpy(out, in, numLiterals);
+			in += numLiterals;
+			out += numLiterals;
+
+			if (in == inEnd)
+				break;
+
+			if (inEnd - in < 2)
+				return false;
+			uint32_t offset = in[0] | (in[1] << 8);
+			in += 2;
+			if (offset == 0 || offset > (uint32_t)(out - outStart))
+				return false;
+
+			uint32_t matchLength = token & 15;
+			if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+				return false;
+			matchLength += kMinMatch;
+			if ((uint32_t)(outEnd - out) < matchLength)
+				return false;
+
+			// Overlapping matches repeat the last bytes, they are copied forward one at a time
+			const uint8_t* match = out - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(out, match, matchLength);
+				out += matchLength;
+			}
+			else
+			{
+				for (uint32_t i = 0; i < matchLength; i++)
+					*out++ = *match++;
+			}
+		}
+		return out == outEnd;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Sigma
+{
+	/*
+	LZ4 block format codec (sequences of literals and matches within 64 KiB, no frame), so archives can be inspected
+	with standard tools. The compressor is the greedy single probe variant : fast, with ratios a bit under reference LZ4.
+	The decompressor checks every length against both buffers, corrupt input fails instead of overrunning.
+	*/
+	// Worst case size of incompressible data
+	uint32_t GetCompressBound(uint32_t size);
+	// Returns the compressed size, 0 if it does not fit in capacity
+	uint32_t CompressBlock(const void* source, uint32_t size, void* destination, uint32_t capacity);
+	// Fails unless the block decodes to exactly size bytes
+	bool DecompressBlock(const void* source, uint32_t compressedSize, void* destination, uint32_t size);
+}
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#include "CommandListPool.h"
+
+namespace Sigma
+{
+	CommandListPool::CommandListPool(ComPtr<ID3D12Device> device, D3D12_COMMAND_LIST_TYPE type, uint32_t numThreads, uint32_t numFrames, const ResourceStateRegistry& registry) :
+		m_device(device),
+		m_type(type),
+		m_numThreads(numThreads),
+		m_registry(registry),
+		m_slots(numThreads * numFrames)
+	{
+		for (Slot& slot : m_slots)
+		{
+			slot.m_usedCount = 0;
+		}
+	}
+
+	void CommandListPool::BeginFrame(uint32_t frameIndex)
+	{
+		for (uint32_t i = 0; i < m_numThreads; i++)
+		{
+			m_slots[frameIndex * m_numThreads + i].m_usedCount = 0;
+		}
+	}
+
+	PooledCommandList* CommandListPool::Acquire(uint32_t frameIndex, uint32_t threadIndex)
+	{
+		Slot& slot = m_slots[frameIndex * m_numThreads + threadIndex];
+
+		if (slot.m_usedCount < slot.m_commandLists.size())
+		{
+			PooledCommandList* commandList = slot.m_commandLists[slot.m_usedCount++].get();
+			commandList->m_allocator->Reset();
+			commandList->m_commandList->Reset(commandList->m_allocator.Get(), nullptr);
+			commandList->m_stateTracker->Reset();
+			return commandList;
+		}
+
+		// Command lists are created open
+		std::unique_ptr<PooledCommandList> commandList = std::make_unique<PooledCommandList>();
+		m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&commandList->m_allocator));
+		m_device->CreateCommandList(0, m_type, commandList->m_allocator.Get(), nullptr, IID_PPV_ARGS(&commandList->m_commandList));
+		commandList->m_stateTracker = std::make_unique<ResourceStateTracker>(m_registry);
+
+		slot.m_commandLists.push_back(std::move(commandList));
+		slot.m_usedCount++;
+		return slot.m_commandLists.back().get();
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "stdafx.h"
+#include <memory>
+#include <vector>
+#include "ResourceStateTracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	// Command list with its own allocator, so any number of them can be recorded at the same time
+	struct PooledCommandList
+	{
+		ComPtr<ID3D12CommandAllocator> m_allocator;
+		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		std::unique_ptr<ResourceStateTracker> m_stateTracker;
+	};
+
+	/*
+	Command lists per thread and per frame in flight.
+	A thread only ever acquires lists from its own slot, so acquiring does not need any synchronization.
+	Lists of a frame are recycled by BeginFrame, once the GPU is done with that frame.
+	*/
+	class CommandListPool
+	{
+	public:
+		CommandListPool(ComPtr<ID3D12Device> device, D3D12_COMMAND_LIST_TYPE type, uint32_t numThreads, uint32_t numFrames, const ResourceStateRegistry& registry);
+
+		void BeginFrame(uint32_t frameIndex);
+
+		// Returns a list ready for recording
+		PooledCommandList* Acquire(uint32_t frameIndex, uint32_t threadIndex);
+
+	private:
+		struct Slot
+		{
+			std::vector<std::unique_ptr<PooledCommandList>> m_commandLists;
+			size_t m_usedCount;
+		};
+
+		ComPtr<ID3D12Device> m_device;
+		D3D12_COMMAND_LIST_TYPE m_type;
+		uint32_t m_numThreads;
+		const ResourceStateRegistry& m_registry;
+		std::vector<Slot> m_slots;
+	};
+}
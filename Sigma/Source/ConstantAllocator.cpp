@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "ConstantAllocator.h"
+
+namespace Sigma
+{
+	ConstantAllocator::ConstantAllocator(ComPtr<ID3D12Device> device, uint32_t numFrames, UINT64 frameSize) :
+		m_frameSize(AlignUp(frameSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)),
+		m_frameIndex(0)
+	{
+		D3D12_RESOURCE_DESC bufDesc;
+		bufDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		bufDesc.Height = 1;
+		bufDesc.DepthOrArraySize = 1;
+		bufDesc.MipLevels = 1;
+		bufDesc.SampleDesc.Count = 1;
+		bufDesc.SampleDesc.Quality = 0;
+		bufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		bufDesc.Width = m_frameSize * numFrames;
+		bufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufDesc.Format = DXGI_FORMAT_UNKNOWN;
+		bufDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		D3D12_HEAP_PROPERTIES heapProps;
+		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapProps.CreationNodeMask = 0;
+		heapProps.VisibleNodeMask = 0;
+
+		device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_buffer));
+
+		D3D12_RANGE readRange{ 0, 0 };
+		m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_cpuAddress));
+		m_gpuAddress = m_buffer->GetGPUVirtualAddress();
+
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			m_frames.push_back(std::make_unique<LinearAllocator>(m_frameSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+		}
+	}
+
+	ConstantAllocator::~ConstantAllocator()
+	{
+		m_buffer->Unmap(0, nullptr);
+	}
+
+	void ConstantAllocator::BeginFrame(uint32_t frameIndex)
+	{
+		m_frameIndex = frameIndex;
+		m_frames[m_frameIndex]->Reset();
+	}
+
+	UploadAllocation ConstantAllocator::Allocate(UINT64 size)
+	{
+		UploadAllocation allocation = {};
+
+		UINT64 offset = m_frames[m_frameIndex]->Allocate(size);
+		if (offset == kInvalidOffset)
+			return allocation;
+
+		offset += m_frameIndex * m_frameSize;
+		allocation.m_resource = m_buffer.Get();
+		allocation.m_offset = offset;
+		allocation.m_cpuAddress = m_cpuAddress + offset;
+		allocation.m_gpuAddress = m_gpuAddress + offset;
+		return allocation;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "stdafx.h"
+#include <memory>
+#include <vector>
+#include "Allocator.h"
+#include "LinearAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	/*
+	Per-frame constant data, bound by GPU virtual address (root CBV) : no descriptor and no Map/Unmap per draw.
+	A single upload buffer stays mapped for the whole run, split in one linear allocator per frame in flight.
+	A frame part is reset by BeginFrame, once the GPU is done with the previous frame that used it.
+	Allocate can be called from any thread recording the current frame.
+	*/
+	class ConstantAllocator
+	{
+	public:
+		ConstantAllocator(ComPtr<ID3D12Device> device, uint32_t numFrames, UINT64 frameSize);
+		~ConstantAllocator();
+
+		void BeginFrame(uint32_t frameIndex);
+
+		// Returns an allocation with a null resource if the frame ran out of constant memory
+		UploadAllocation Allocate(UINT64 size);
+
+		// Returns 0 if the frame ran out of constant memory, the draw using it must be skipped
+		template<typename T>
+		D3D12_GPU_VIRTUAL_ADDRESS Write(const T& constants)
+		{
+			UploadAllocation allocation = Allocate(sizeof(T));
+			if (allocation.m_resource == nullptr)
+				return 0;
+
+			// Write combined memory, never read it back
+			memcpy(allocation.m_cpuAddress, &constants, sizeof(T));
+			return allocation.m_gpuAddress;
+		}
+
+	private:
+		ComPtr<ID3D12Resource> m_buffer;
+		UINT8* m_cpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+		UINT64 m_frameSize;
+		uint32_t m_frameIndex;
+		std::vector<std::unique_ptr<LinearAllocator>> m_frames;
+	};
+}
@@ -0,0 +1,151 @@
+#include "CookedTexture.h"
+#include "Align.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Sigma
+{
+	static bool IsBlockCompressed(TextureFormat format)
+	{
+		return format != TextureFormat::RGBA8;
+	}
+
+	static BcFormat GetBcFormat(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1: return BcFormat::BC1;
+		case TextureFormat::BC3: return BcFormat::BC3;
+		case TextureFormat::BC4: return BcFormat::BC4;
+		case TextureFormat::BC5: return BcFormat::BC5;
+		default: return BcFormat::BC7;
+		}
+	}
+
+	static uint64_t GetDataOffset(uint32_t mipLevels)
+	{
+		return AlignUp(sizeof(CookedTextureHeader) + sizeof(CookedSubresource) * (uint64_t)mipLevels, kTexturePlacementAlignment);
+	}
+
+	CookSettings::CookSettings() :
+		m_format(TextureFormat::BC7),
+		m_srgb(true),
+		m_generateMips(true),
+		m_mipFilter(MipFilter::Kaiser),
+		m_quality(1)
+	{
+	}
+
+	uint64_t ComputeFootprints(TextureFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, CookedSubresource* subresources)
+	{
+		uint64_t offset = 0;
+		for (uint32_t level = 0; level < mipLevels; level++)
+		{
+			CookedSubresource& subresource = subresources[level];
+			subresource.m_width = std::max(width >> level, 1u);
+			subresource.m_height = std::max(height >> level, 1u);
+			if (IsBlockCompressed(format))
+			{
+				subresource.m_rowSize = ((subresource.m_width + 3) / 4) * GetBcBlockSize(GetBcFormat(format));
+				subresource.m_numRows = (subresource.m_height + 3) / 4;
+			}
+			else
+			{
+				subresource.m_rowSize = subresource.m_width * 4;
+				subresource.m_numRows = subresource.m_height;
+			}
+			subresource.m_rowPitch = (uint32_t)AlignUp(subresource.m_rowSize, kTexturePitchAlignment);
+			subresource.m_padding = 0;
+
+			offset = AlignUp(offset, kTexturePlacementAlignment);
+			subresource.m_offset = offset;
+			// Like GetCopyableFootprints, the last row is not padded
+			offset += (uint64_t)subresource.m_rowPitch * (subresource.m_numRows - 1) + subresource.m_rowSize;
+		}
+		return offset;
+	}
+
+	void CookTexture(const void* texels, uint64_t rowPitch, uint32_t width, uint32_t height, const CookSettings& settings, JobSystem* jobSystem, std::vector<uint8_t>& cooked)
+	{
+		uint32_t mipLevels = settings.m_generateMips ? MipGenerator::GetFullChainLevelCount(width, height) : 1;
+		std::vector<CookedSubresource> subresources(mipLevels);
+		uint64_t dataSize = ComputeFootprints(settings.m_format, width, height, mipLevels, subresources.data());
+		uint64_t dataOffset = GetDataOffset(mipLevels);
+
+		cooked.assign(dataOffset + dataSize, 0);
+		CookedTextureHeader header;
+		header.m_magic = kCookedTextureMagic;
+		header.m_version = kCookedTextureVersion;
+		header.m_format = settings.m_format;
+		header.m_srgb = settings.m_srgb ? 1 : 0;
+		header.m_width = width;
+		header.m_height = height;
+		header.m_mipLevels = mipLevels;
+		header.m_padding = 0;
+		header.m_dataOffset = dataOffset;
+		header.m_dataSize = dataSize;
+		memcpy(cooked.data(), &header, sizeof(header));
+		memcpy(cooked.data() + sizeof(header), subresources.data(), sizeof(CookedSubresource) * mipLevels);
+		uint8_t* data = cooked.data() + dataOffset;
+
+		MipGenerator mipGenerator(jobSystem);
+		mipGenerator.Generate(settings.m_srgb ? MipFormat::RGBA8Srgb : MipFormat::RGBA8, settings.m_mipFilter, texels, rowPitch, width, height, mipLevels);
+
+		// Uncompressed levels are written in place, compressed ones go through an RGBA8 level first
+		std::vector<uint8_t> level;
+		for (uint32_t i = 0; i < mipLevels; i++)
+		{
+			const CookedSubresource& subresource = subresources[i];
+			TextureRows rows;
+			rows.m_rowSize = (uint64_t)subresource.m_width * 4;
+			rows.m_numRows = subresource.m_height;
+			rows.m_numSlices = 1;
+			if (IsBlockCompressed(settings.m_format))
+			{
+				level.resize(rows.m_rowSize * rows.m_numRows);
+				rows.m_data = level.data();
+				rows.m_rowPitch = rows.m_rowSize;
+			}
+			else
+			{
+				rows.m_data = data + subresource.m_offset;
+				rows.m_rowPitch = subresource.m_rowPitch;
+			}
+			rows.m_slicePitch = rows.m_rowPitch * rows.m_numRows;
+			mipGenerator.Write(i, rows);
+
+			if (IsBlockCompressed(settings.m_format))
+				EncodeBc(GetBcFormat(settings.m_format), level.data(), rows.m_rowPitch, subresource.m_width, subresource.m_height, data + subresource.m_offset, subresource.m_rowPitch, settings.m_quality, jobSystem);
+		}
+	}
+
+	bool ReadCookedTexture(const void* data, uint64_t size, CookedTexture& texture)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+		if (size < sizeof(CookedTextureHeader))
+			return false;
+
+		const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(bytes);
+		if (header->m_magic != kCookedTextureMagic || header->m_version != kCookedTextureVersion)
+			return false;
+		if (header->m_format > TextureFormat::BC7 || header->m_mipLevels == 0 || header->m_mipLevels > 32)
+			return false;
+		if (header->m_dataOffset < GetDataOffset(header->m_mipLevels) || header->m_dataOffset > size || header->m_dataSize > size - header->m_dataOffset)
+			return false;
+
+		texture.m_header = header;
+		texture.m_subresources = reinterpret_cast<const CookedSubresource*>(bytes + sizeof(CookedTextureHeader));
+		texture.m_data = bytes + header->m_dataOffset;
+
+		// The layout must be the one this version computes, the upload relies on it
+		for (uint32_t level = 0; level < header->m_mipLevels; level++)
+		{
+			const CookedSubresource& subresource = texture.m_subresources[level];
+			if (subresource.m_numRows == 0 || subresource.m_rowSize > subresource.m_rowPitch)
+				return false;
+			if (subresource.m_offset + (uint64_t)subresource.m_rowPitch * (subresource.m_numRows - 1) + subresource.m_rowSize > header->m_dataSize)
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "BcEncoder.h"
+#include "MipGenerator.h"
+
+namespace Sigma
+{
+	class JobSystem;
+
+	const uint32_t kCookedTextureMagic = 0x58544753; // "SGTX"
+	const uint32_t kCookedTextureVersion = 1;
+
+	// Same values as D3D12_TEXTURE_DATA_PITCH_ALIGNMENT and D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+	const uint32_t kTexturePitchAlignment = 256;
+	const uint32_t kTexturePlacementAlignment = 512;
+
+	enum class TextureFormat : uint32_t
+	{
+		RGBA8,
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7,
+	};
+
+	// Placement of a subresource in the data, like the footprints of GetCopyableFootprints with a base offset of 0
+	struct CookedSubresource
+	{
+		uint64_t m_offset;
+		uint32_t m_rowPitch;
+		uint32_t m_rowSize;
+		uint32_t m_numRows; // Of blocks for BC formats
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_padding;
+	};
+
+	// Followed by the subresources, then by the data at the first multiple of kTexturePlacementAlignment
+	struct CookedTextureHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		TextureFormat m_format;
+		uint32_t m_srgb;
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_mipLevels;
+		uint32_t m_padding;
+		uint64_t m_dataOffset;
+		uint64_t m_dataSize;
+	};
+
+	// Points into cooked data, nothing is copied
+	struct CookedTexture
+	{
+		const CookedTextureHeader* m_header;
+		const CookedSubresource* m_subresources;
+		const uint8_t* m_data;
+	};
+
+	struct CookSettings
+	{
+		TextureFormat m_format;
+		bool m_srgb; // Mips are filtered in linear space, the BC encoders work on the stored values
+		bool m_generateMips;
+		MipFilter m_mipFilter;
+		uint32_t m_quality; // Up to kMaxBcQuality
+
+		CookSettings();
+	};
+
+	/*
+	Cooked textures are stored mip complete, in the layout GetCopyableFootprints gives on D3D12 (rows aligned to 256
+	bytes, subresources to 512), so they are uploaded with a single copy when the device agrees with that layout.
+	The same code cooks offline and at load time, from RGBA8 texels. BC4 and BC5 read the red and green channels.
+	*/
+	// Returns the size of the data
+	uint64_t ComputeFootprints(TextureFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, CookedSubresource* subresources);
+	void CookTexture(const void* texels, uint64_t rowPitch, uint32_t width, uint32_t height, const CookSettings& settings, JobSystem* jobSystem, std::vector<uint8_t>& cooked);
+	// Returns false if the data is not a complete cooked texture of this version
+	bool ReadCookedTexture(const void* data, uint64_t size, CookedTexture& texture);
+}
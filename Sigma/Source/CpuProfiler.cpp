@@ -0,0 +1,228 @@
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Sigma
+{
+	// Fields are relaxed atomics so a trace can be written while they are overwritten, they compile to plain stores
+	struct CpuProfileEvent
+	{
+		std::atomic<const char*> m_name;
+		std::atomic<uint64_t> m_begin;
+		std::atomic<uint64_t> m_end;
+	};
+
+	struct CpuProfileThread
+	{
+		uint32_t m_threadId;
+		std::string m_name; // Protected by the registry mutex
+		std::atomic<uint64_t> m_head; // Events written so far
+		CpuProfileEvent m_events[CpuProfiler::kEventsPerThread];
+	};
+
+	struct CpuProfileRegistry
+	{
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<CpuProfileThread>> m_threads; // Never released, a thread that exited keeps its events
+
+		std::atomic<uint64_t> m_frameHead{ 0 };
+		std::atomic<uint64_t> m_frameStarts[CpuProfiler::kMaxFrames];
+	};
+
+	// Events that may be overwritten while a trace is being written, from the oldest ones
+	const uint64_t kOverwriteMargin = 256;
+
+	// Timestamps are relative to the program start, they fit in a double with sub microsecond precision
+	static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	// Long enough for the clock read latencies to be negligible
+	const std::chrono::milliseconds kTickCalibrationTime(10);
+	const uint32_t kTickCalibrationSamples = 16;
+
+	static CpuProfileRegistry& GetRegistry()
+	{
+		static CpuProfileRegistry registry;
+		return registry;
+	}
+
+	static thread_local CpuProfileThread* t_thread = nullptr;
+
+	static CpuProfileThread& GetThread()
+	{
+		if (t_thread == nullptr)
+		{
+			CpuProfileRegistry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.m_mutex);
+			std::unique_ptr<CpuProfileThread> thread = std::make_unique<CpuProfileThread>();
+			thread->m_threadId = (uint32_t)registry.m_threads.size();
+			thread->m_name = "Thread " + std::to_string(thread->m_threadId);
+			thread->m_head.store(0, std::memory_order_relaxed);
+			t_thread = thread.get();
+			registry.m_threads.push_back(std::move(thread));
+		}
+		return *t_thread;
+	}
+
+	static void WriteJsonString(std::ofstream& file, const char* string)
+	{
+		file << '"';
+		for (const char* c = string; *c != 0; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				file << '\\';
+			file << *c;
+		}
+		file << '"';
+	}
+
+	uint64_t CpuProfiler::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+	}
+
+	// The clock read between two tick reads, the closest pair of a few : a thread preempted between the reads would skew
+	// the tick rate
+	static void SampleClock(std::chrono::steady_clock::time_point& time, uint64_t& ticks)
+	{
+		uint64_t closest = UINT64_MAX;
+		for (uint32_t i = 0; i < kTickCalibrationSamples; i++)
+		{
+			uint64_t before = CpuProfiler::GetTicks();
+			std::chrono::steady_clock::time_point sample = std::chrono::steady_clock::now();
+			uint64_t after = CpuProfiler::GetTicks();
+			if (after - before < closest)
+			{
+				closest = after - before;
+				time = sample;
+				ticks = before + (after - before) / 2;
+			}
+		}
+	}
+
+	uint64_t CpuProfiler::TicksToNanoseconds(uint64_t ticks)
+	{
+		struct TickCalibration
+		{
+			uint64_t m_ticks;
+			double m_nanoseconds; // Since s_epoch, at m_ticks
+			double m_nanosecondsPerTick;
+		};
+
+		// Both ends measured here, so nothing depends on the order statics were initialized in
+		static const TickCalibration calibration = []()
+		{
+			std::chrono::steady_clock::time_point beginTime, endTime;
+			uint64_t beginTicks = 0, endTicks = 0;
+			SampleClock(beginTime, beginTicks);
+			while (std::chrono::steady_clock::now() - beginTime < kTickCalibrationTime)
+			{
+			}
+			SampleClock(endTime, endTicks);
+
+			TickCalibration result;
+			result.m_ticks = beginTicks;
+			result.m_nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(beginTime - s_epoch).count();
+			result.m_nanosecondsPerTick = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - beginTime).count() / (endTicks - beginTicks);
+			return result;
+		}();
+
+		// Ticks from before the calibration are negative
+		double nanoseconds = calibration.m_nanoseconds + (double)(int64_t)(ticks - calibration.m_ticks) * calibration.m_nanosecondsPerTick;
+		return nanoseconds > 0.0 ? (uint64_t)nanoseconds : 0;
+	}
+
+	void CpuProfiler::Record(const char* name, uint64_t begin, uint64_t end)
+	{
+		CpuProfileThread& thread = GetThread();
+		uint64_t head = thread.m_head.load(std::memory_order_relaxed);
+		CpuProfileEvent& event = thread.m_events[head % kEventsPerThread];
+		event.m_name.store(name, std::memory_order_relaxed);
+		event.m_begin.store(begin, std::memory_order_relaxed);
+		event.m_end.store(end, std::memory_order_relaxed);
+		thread.m_head.store(head + 1, std::memory_order_release);
+	}
+
+	void CpuProfiler::BeginFrame()
+	{
+		CpuProfileRegistry& registry = GetRegistry();
+		uint64_t head = registry.m_frameHead.load(std::memory_order_relaxed);
+		registry.m_frameStarts[head % kMaxFrames].store(GetTicks(), std::memory_order_relaxed);
+		registry.m_frameHead.store(head + 1, std::memory_order_release);
+	}
+
+	void CpuProfiler::SetThreadName(const char* name)
+	{
+		CpuProfileThread& thread = GetThread();
+		std::lock_guard<std::mutex> lock(GetRegistry().m_mutex);
+		thread.m_name = name;
+	}
+
+	bool CpuProfiler::WriteChromeTrace(const char* path, uint32_t numFrames)
+	{
+		CpuProfileRegistry& registry = GetRegistry();
+
+		// Scopes ending before the start of the first frame asked for are left out
+		uint64_t frameHead = registry.m_frameHead.load(std::memory_order_acquire);
+		uint64_t firstFrame = frameHead - std::min<uint64_t>(frameHead, std::min<uint64_t>(numFrames, kMaxFrames));
+		uint64_t startTime = firstFrame < frameHead ? registry.m_frameStarts[firstFrame % kMaxFrames].load(std::memory_order_relaxed) : 0;
+
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file.setf(std::ios::fixed);
+		file.precision(3);
+
+		std::lock_guard<std::mutex> lock(registry.m_mutex);
+		bool first = true;
+		for (const std::unique_ptr<CpuProfileThread>& thread : registry.m_threads)
+		{
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->m_threadId << ",\"args\":{\"name\":";
+			WriteJsonString(file, thread->m_name.c_str());
+			file << "}}";
+			first = false;
+
+			uint64_t head = thread->m_head.load(std::memory_order_acquire);
+			uint64_t begin = head - std::min<uint64_t>(head, kEventsPerThread);
+			for (uint64_t i = begin; i < head; i++)
+			{
+				const CpuProfileEvent& event = thread->m_events[i % kEventsPerThread];
+				const char* name = event.m_name.load(std::memory_order_relaxed);
+				uint64_t eventBegin = event.m_begin.load(std::memory_order_relaxed);
+				uint64_t eventEnd = event.m_end.load(std::memory_order_relaxed);
+
+				// The thread kept recording, this slot may have been overwritten while it was read
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint64_t currentHead = thread->m_head.load(std::memory_order_relaxed);
+				if (i + kEventsPerThread <= currentHead + kOverwriteMargin)
+					continue;
+
+				if (eventEnd < startTime)
+					continue;
+
+				uint64_t beginNs = TicksToNanoseconds(eventBegin);
+				uint64_t endNs = TicksToNanoseconds(eventEnd);
+				file << ",\n{\"name\":";
+				WriteJsonString(file, name);
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->m_threadId << ",\"ts\":" << beginNs / 1000.0 << ",\"dur\":" << (endNs - beginNs) / 1000.0 << "}";
+			}
+		}
+
+		for (uint64_t frame = firstFrame; frame < frameHead; frame++)
+		{
+			file << (first ? "" : ",\n") << "{\"name\":\"Frame " << frame << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+				<< TicksToNanoseconds(registry.m_frameStarts[frame % kMaxFrames].load(std::memory_order_relaxed)) / 1000.0 << "}";
+			first = false;
+		}
+
+		file << "\n]}\n";
+		return (bool)file;
+	}
+}
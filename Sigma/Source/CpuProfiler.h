@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define SIGMA_CPU_PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIGMA_CPU_PROFILER_RDTSC
+#endif
+
+namespace Sigma
+{
+	/*
+	Records CPU scopes of every thread, to look at a few frames in chrome://tracing (or Perfetto) without a PIX capture.
+
+	Each thread writes its scopes to its own ring buffer, registered on its first scope. Recording is lock-free, a scope
+	costs two clock reads and a few stores. The buffers keep the last kEventsPerThread scopes of each thread, older ones
+	are overwritten. Writing a trace can run while other threads record, it skips the scopes that may be overwritten
+	while it copies them.
+
+	Scopes are timed in ticks of the timestamp counter on x86 (invariant on any recent CPU, read without a system call),
+	converted to nanoseconds when a trace is written. The tick rate is measured once against the steady clock.
+
+	Names must outlive the profiler, string literals are expected.
+	*/
+	class CpuProfiler
+	{
+	public:
+		static const uint32_t kEventsPerThread = 16384;
+		static const uint32_t kMaxFrames = 256;
+
+		// Nanoseconds, from a steady clock
+		static uint64_t Now();
+
+		// Timestamp counter, or Now where there is none
+		static uint64_t GetTicks()
+		{
+#ifdef SIGMA_CPU_PROFILER_RDTSC
+			return __rdtsc();
+#else
+			return Now();
+#endif
+		}
+
+		// Nanoseconds on the Now clock. The first call measures the tick rate, it takes 10 ms
+		static uint64_t TicksToNanoseconds(uint64_t ticks);
+
+		// begin and end are in ticks
+		static void Record(const char* name, uint64_t begin, uint64_t end);
+		// Marks the start of a frame, from a single thread
+		static void BeginFrame();
+		// Shown in the trace, copied
+		static void SetThreadName(const char* name);
+
+		// Writes the scopes of the last numFrames frames (all of them if no frame was marked) as Chrome trace_event JSON,
+		// returns false if the file could not be written
+		static bool WriteChromeTrace(const char* path, uint32_t numFrames);
+	};
+
+	class CpuProfileScope
+	{
+	public:
+		explicit CpuProfileScope(const char* name) :
+			m_name(name),
+			m_begin(CpuProfiler::GetTicks())
+		{
+		}
+
+		~CpuProfileScope()
+		{
+			CpuProfiler::Record(m_name, m_begin, CpuProfiler::GetTicks());
+		}
+
+	private:
+		const char* m_name;
+		uint64_t m_begin;
+	};
+}
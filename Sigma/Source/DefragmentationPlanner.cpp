@@ -0,0 +1,105 @@
+#include "DefragmentationPlanner.h"
+#include <algorithm>
+
+namespace Sigma
+{
+	DefragmentationSettings::DefragmentationSettings() :
+		m_maxSourceUsage(0.5),
+		m_minSourceFragmentation(0.5)
+	{
+	}
+
+	DefragmentationPlanner::DefragmentationPlanner(const DefragmentationSettings& settings) :
+		m_settings(settings)
+	{
+	}
+
+	uint64_t DefragmentationPlanner::Plan(const std::vector<TlsfAllocator*>& blocks, const std::vector<MovableAllocation>& allocations, uint64_t maxBytes, std::vector<DefragmentationMove>& moves)
+	{
+		moves.clear();
+
+		// Fullest blocks first, they are the destinations
+		m_blockOrder.clear();
+		std::vector<uint64_t> usedSizes(blocks.size(), 0);
+		for (uint32_t i = 0; i < blocks.size(); i++)
+		{
+			if (blocks[i] == nullptr)
+				continue;
+
+			usedSizes[i] = blocks[i]->GetStats().m_usedSize;
+			m_blockOrder.push_back(i);
+		}
+		std::stable_sort(m_blockOrder.begin(), m_blockOrder.end(), [&](uint32_t a, uint32_t b) { return usedSizes[a] > usedSizes[b]; });
+
+		m_blockRanks.assign(blocks.size(), 0);
+		for (uint32_t rank = 0; rank < m_blockOrder.size(); rank++)
+		{
+			m_blockRanks[m_blockOrder[rank]] = rank;
+		}
+
+		uint64_t movedBytes = 0;
+		for (uint32_t sourceRank = (uint32_t)m_blockOrder.size(); sourceRank-- > 0;)
+		{
+			uint32_t source = m_blockOrder[sourceRank];
+			if (!IsSource(blocks[source]->GetStats()))
+				continue;
+
+			// From the end of the block, so in place compaction moves the last allocations to the first holes
+			m_sourceAllocations.clear();
+			for (const MovableAllocation& allocation : allocations)
+			{
+				if (allocation.m_block == source)
+					m_sourceAllocations.push_back(&allocation);
+			}
+			std::sort(m_sourceAllocations.begin(), m_sourceAllocations.end(), [](const MovableAllocation* a, const MovableAllocation* b)
+			{
+				return a->m_allocation.m_offset > b->m_allocation.m_offset;
+			});
+
+			for (const MovableAllocation* allocation : m_sourceAllocations)
+			{
+				// An allocation larger than the budget still moves, alone
+				uint64_t size = allocation->m_allocation.m_size;
+				if (movedBytes > 0 && movedBytes + size > maxBytes)
+					return movedBytes;
+
+				DefragmentationMove move = { allocation->m_id, source, { kInvalidOffset, 0, kInvalidTlsfBlock } };
+				for (uint32_t rank = 0; rank < sourceRank; rank++)
+				{
+					move.m_destination = blocks[m_blockOrder[rank]]->Allocate(size, allocation->m_alignment);
+					if (move.m_destination.m_offset != kInvalidOffset)
+					{
+						move.m_destinationBlock = m_blockOrder[rank];
+						break;
+					}
+				}
+
+				if (move.m_destination.m_offset == kInvalidOffset)
+				{
+					move.m_destination = blocks[source]->Allocate(size, allocation->m_alignment);
+					if (move.m_destination.m_offset != kInvalidOffset && move.m_destination.m_offset > allocation->m_allocation.m_offset)
+					{
+						blocks[source]->Free(move.m_destination.m_block);
+						move.m_destination.m_offset = kInvalidOffset;
+					}
+				}
+
+				if (move.m_destination.m_offset == kInvalidOffset)
+					continue;
+
+				moves.push_back(move);
+				movedBytes += size;
+			}
+		}
+		return movedBytes;
+	}
+
+	bool DefragmentationPlanner::IsSource(const TlsfStats& stats) const
+	{
+		if (stats.m_allocationCount == 0 || stats.m_size == 0)
+			return false;
+
+		double usage = (double)stats.m_usedSize / stats.m_size;
+		return usage <= m_settings.m_maxSourceUsage || (stats.m_freeBlockCount > 1 && stats.GetFragmentation() >= m_settings.m_minSourceFragmentation);
+	}
+}
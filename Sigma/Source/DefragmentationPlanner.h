@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TlsfAllocator.h"
+
+namespace Sigma
+{
+	// A live allocation that may be moved
+	struct MovableAllocation
+	{
+		uint32_t m_id;		// Returned in the moves
+		uint32_t m_block;	// Index in the blocks given to Plan
+		TlsfAllocation m_allocation;
+		uint64_t m_alignment;
+	};
+
+	struct DefragmentationMove
+	{
+		uint32_t m_id;
+		uint32_t m_destinationBlock;
+		TlsfAllocation m_destination;
+	};
+
+	struct DefragmentationSettings
+	{
+		// A block is emptied when it is used below this ratio, or compacted when its free space is more fragmented than this
+		double m_maxSourceUsage;
+		double m_minSourceFragmentation;
+
+		DefragmentationSettings();
+	};
+
+	/*
+	Plans moves of allocations out of fragmented blocks, only deals with TLSF blocks so it does not depend on any graphics API.
+
+	The emptiest blocks are emptied first, into the fuller ones, so they can be released. An allocation that does not fit in
+	a fuller block moves to a lower offset of its own block when there is one, which compacts it. Destinations are allocated
+	right away, the sources are left allocated : the caller frees them once the data has been copied.
+	Moves are planned up to a byte budget, so the copies can be spread over several frames.
+	*/
+	class DefragmentationPlanner
+	{
+	public:
+		explicit DefragmentationPlanner(const DefragmentationSettings& settings = DefragmentationSettings());
+
+		// blocks can have null entries, returns the number of bytes moved
+		uint64_t Plan(const std::vector<TlsfAllocator*>& blocks, const std::vector<MovableAllocation>& allocations, uint64_t maxBytes, std::vector<DefragmentationMove>& moves);
+
+	private:
+		bool IsSource(const TlsfStats& stats) const;
+
+		DefragmentationSettings m_settings;
+		std::vector<uint32_t> m_blockOrder;
+		std::vector<uint32_t> m_blockRanks;
+		std::vector<const MovableAllocation*> m_sourceAllocations;
+	};
+}
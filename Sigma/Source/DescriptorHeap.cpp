@@ -0,0 +1,70 @@
+#include "stdafx.h"
+#include "DescriptorHeap.h"
+
+namespace Sigma
+{
+	DescriptorHeap::DescriptorHeap(ComPtr<ID3D12Device> device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t capacity, uint32_t rangeCapacity, bool shaderVisible) :
+		m_allocator(capacity, rangeCapacity)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.Type = type;
+		heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		heapDesc.NodeMask = 0;
+		heapDesc.NumDescriptors = capacity;
+		device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_heap));
+
+		m_descriptorSize = device->GetDescriptorHandleIncrementSize(type);
+		m_cpuStart = m_heap->GetCPUDescriptorHandleForHeapStart();
+		m_gpuStart = shaderVisible ? m_heap->GetGPUDescriptorHandleForHeapStart() : D3D12_GPU_DESCRIPTOR_HANDLE{ 0 };
+	}
+
+	uint32_t DescriptorHeap::Allocate()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_allocator.Allocate();
+	}
+
+	uint32_t DescriptorHeap::AllocateRange(uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_allocator.AllocateRange(count);
+	}
+
+	void DescriptorHeap::Free(uint32_t index)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_allocator.Free(index);
+	}
+
+	void DescriptorHeap::FreeRange(uint32_t first, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_allocator.FreeRange(first, count);
+	}
+
+	void DescriptorHeap::Submit(uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_allocator.Submit(fenceValue);
+	}
+
+	void DescriptorHeap::Retire(uint64_t completedFenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_allocator.Retire(completedFenceValue);
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::GetCPUHandle(uint32_t index) const
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE handle;
+		handle.ptr = m_cpuStart.ptr + (SIZE_T)index * m_descriptorSize;
+		return handle;
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GetGPUHandle(uint32_t index) const
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE handle;
+		handle.ptr = m_gpuStart.ptr + (UINT64)index * m_descriptorSize;
+		return handle;
+	}
+}
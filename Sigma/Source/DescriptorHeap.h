@@ -0,0 +1,43 @@
+#pragma once
+
+#include "stdafx.h"
+#include <mutex>
+#include "DescriptorIndexAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	/*
+	Descriptor heap handing out stable indices, for bindless access from shaders (Texture2DTable[index]).
+	Single descriptors and table ranges are allocated from the same heap, so one SetDescriptorHeaps covers everything.
+	Freed descriptors are recycled once the frame fence proves the GPU is done with them, see DescriptorIndexAllocator.
+	*/
+	class DescriptorHeap
+	{
+	public:
+		DescriptorHeap(ComPtr<ID3D12Device> device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t capacity, uint32_t rangeCapacity, bool shaderVisible);
+
+		uint32_t Allocate();
+		uint32_t AllocateRange(uint32_t count);
+		void Free(uint32_t index);
+		void FreeRange(uint32_t first, uint32_t count);
+
+		void Submit(uint64_t fenceValue);
+		void Retire(uint64_t completedFenceValue);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(uint32_t index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(uint32_t index) const;
+		ID3D12DescriptorHeap* GetHeap() const { return m_heap.Get(); }
+
+	private:
+		ComPtr<ID3D12DescriptorHeap> m_heap;
+		D3D12_CPU_DESCRIPTOR_HANDLE m_cpuStart;
+		D3D12_GPU_DESCRIPTOR_HANDLE m_gpuStart;
+		uint32_t m_descriptorSize;
+
+		// Descriptors can be created from any thread
+		std::mutex m_mutex;
+		DescriptorIndexAllocator m_allocator;
+	};
+}
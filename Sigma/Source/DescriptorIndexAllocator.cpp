@@ -0,0 +1,135 @@
+#include "DescriptorIndexAllocator.h"
+#include <iterator>
+
+namespace Sigma
+{
+	DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t capacity, uint32_t rangeCapacity) :
+		m_capacity(capacity),
+		m_singleCapacity(capacity - rangeCapacity),
+		m_nextIndex(0),
+		m_allocatedCount(0)
+	{
+		if (rangeCapacity > 0)
+			AddFreeRange(m_singleCapacity, rangeCapacity);
+	}
+
+	uint32_t DescriptorIndexAllocator::Allocate()
+	{
+		uint32_t index = kInvalidDescriptorIndex;
+		if (!m_freeIndices.empty())
+		{
+			index = m_freeIndices.back();
+			m_freeIndices.pop_back();
+		}
+		else if (m_nextIndex < m_singleCapacity)
+		{
+			index = m_nextIndex++;
+		}
+		else
+		{
+			return kInvalidDescriptorIndex;
+		}
+
+		m_allocatedCount++;
+		return index;
+	}
+
+	uint32_t DescriptorIndexAllocator::AllocateRange(uint32_t count)
+	{
+		if (count == 0)
+			return kInvalidDescriptorIndex;
+
+		// Smallest free range that fits, the lowest one among those of the same size
+		auto bySize = m_freeRangesBySize.lower_bound(std::make_pair(count, 0u));
+		if (bySize == m_freeRangesBySize.end())
+			return kInvalidDescriptorIndex;
+
+		uint32_t first = bySize->second;
+		uint32_t remaining = bySize->first - count;
+		RemoveFreeRange(m_freeRanges.find(first));
+		if (remaining > 0)
+			AddFreeRange(first + count, remaining);
+
+		m_allocatedCount += count;
+		return first;
+	}
+
+	void DescriptorIndexAllocator::Free(uint32_t index)
+	{
+		FreeRange(index, 1);
+	}
+
+	void DescriptorIndexAllocator::FreeRange(uint32_t first, uint32_t count)
+	{
+		if (first == kInvalidDescriptorIndex || count == 0)
+			return;
+
+		PendingFree pending = { first, count, 0 };
+		m_openFrees.push_back(pending);
+	}
+
+	void DescriptorIndexAllocator::Submit(uint64_t fenceValue)
+	{
+		for (PendingFree& pending : m_openFrees)
+		{
+			pending.m_fenceValue = fenceValue;
+			m_pendingFrees.push_back(pending);
+		}
+		m_openFrees.clear();
+	}
+
+	void DescriptorIndexAllocator::Retire(uint64_t completedFenceValue)
+	{
+		while (!m_pendingFrees.empty() && m_pendingFrees.front().m_fenceValue <= completedFenceValue)
+		{
+			const PendingFree& pending = m_pendingFrees.front();
+			ReleaseRange(pending.m_first, pending.m_count);
+			m_pendingFrees.pop_front();
+		}
+	}
+
+	void DescriptorIndexAllocator::ReleaseRange(uint32_t first, uint32_t count)
+	{
+		m_allocatedCount -= count;
+
+		// Indices of the single descriptor part go back one by one
+		for (; count > 0 && first < m_singleCapacity; first++, count--)
+		{
+			m_freeIndices.push_back(first);
+		}
+		if (count == 0)
+			return;
+
+		// Merge with the free ranges right before and after
+		auto next = m_freeRanges.lower_bound(first);
+		if (next != m_freeRanges.end() && first + count == next->first)
+		{
+			count += next->second;
+			auto merged = next++;
+			RemoveFreeRange(merged);
+		}
+		if (next != m_freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == first)
+			{
+				first = previous->first;
+				count += previous->second;
+				RemoveFreeRange(previous);
+			}
+		}
+		AddFreeRange(first, count);
+	}
+
+	void DescriptorIndexAllocator::AddFreeRange(uint32_t first, uint32_t count)
+	{
+		m_freeRanges[first] = count;
+		m_freeRangesBySize.insert(std::make_pair(count, first));
+	}
+
+	void DescriptorIndexAllocator::RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator range)
+	{
+		m_freeRangesBySize.erase(std::make_pair(range->second, range->first));
+		m_freeRanges.erase(range);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Sigma
+{
+	const uint32_t kInvalidDescriptorIndex = 0xffffffff;
+
+	/*
+	Hands out indices in a descriptor heap, only deals with indices so it does not depend on any graphics API.
+
+	The heap is split in two parts :
+	|  single descriptors (bump pointer + free list, O(1))  |  contiguous ranges for tables (best fit, coalesced)   |
+	0                                                        capacity - rangeCapacity                                 capacity
+
+	Freed indices are not reusable right away, the GPU may still read them : frees since the last Submit are tagged
+	with its fence value, and Retire makes them available again once that fence has been reached.
+	*/
+	class DescriptorIndexAllocator
+	{
+	public:
+		DescriptorIndexAllocator(uint32_t capacity, uint32_t rangeCapacity);
+
+		// Both return kInvalidDescriptorIndex if the heap is full
+		uint32_t Allocate();
+		uint32_t AllocateRange(uint32_t count);
+
+		void Free(uint32_t index);
+		void FreeRange(uint32_t first, uint32_t count);
+
+		// Frees since the last Submit become available once the fence reaches fenceValue
+		void Submit(uint64_t fenceValue);
+		void Retire(uint64_t completedFenceValue);
+
+		uint32_t GetCapacity() const { return m_capacity; }
+		uint32_t GetAllocatedCount() const { return m_allocatedCount; }
+
+	private:
+		struct PendingFree
+		{
+			uint32_t m_first;
+			uint32_t m_count;
+			uint64_t m_fenceValue;
+		};
+
+		void ReleaseRange(uint32_t first, uint32_t count);
+		void AddFreeRange(uint32_t first, uint32_t count);
+		void RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator range);
+
+		uint32_t m_capacity;
+		uint32_t m_singleCapacity;
+		uint32_t m_nextIndex;
+		uint32_t m_allocatedCount;
+		std::vector<uint32_t> m_freeIndices;
+		std::map<uint32_t, uint32_t> m_freeRanges; // first index -> count
+		std::set<std::pair<uint32_t, uint32_t>> m_freeRangesBySize; // count, first index
+
+		std::vector<PendingFree> m_openFrees;
+		std::deque<PendingFree> m_pendingFrees;
+	};
+}
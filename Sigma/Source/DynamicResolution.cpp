@@ -0,0 +1,60 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Sigma
+{
+	const double kCostRiseRate = 0.5;
+	const double kCostFallRate = 0.1;
+
+	DynamicResolutionSettings::DynamicResolutionSettings() :
+		m_targetFrameTimeMs(1000.0 / 60.0),
+		m_headroom(0.9),
+		m_minScale(0.5f),
+		m_maxScale(1.0f),
+		m_maxScaleIncrease(0.02f),
+		m_hysteresis(0.01f)
+	{
+	}
+
+	DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) :
+		m_settings(settings)
+	{
+		Reset();
+	}
+
+	void DynamicResolution::Reset()
+	{
+		m_scale = m_settings.m_maxScale;
+		m_cost = 0.0;
+	}
+
+	float DynamicResolution::Update(double gpuFrameTimeMs, float renderScale)
+	{
+		if (gpuFrameTimeMs <= 0.0 || renderScale <= 0.0f)
+			return m_scale;
+
+		double cost = gpuFrameTimeMs / ((double)renderScale * renderScale);
+		if (m_cost == 0.0)
+			m_cost = cost;
+		else
+			m_cost += (cost - m_cost) * (cost > m_cost ? kCostRiseRate : kCostFallRate);
+
+		double budget = m_settings.m_targetFrameTimeMs * m_settings.m_headroom;
+		float scale = (float)std::sqrt(budget / m_cost);
+		scale = std::min(scale, m_scale + m_settings.m_maxScaleIncrease);
+		scale = std::max(m_settings.m_minScale, std::min(scale, m_settings.m_maxScale));
+
+		// Always move to a limit, otherwise the hysteresis could keep the scale just short of it
+		bool atLimit = scale == m_settings.m_minScale || scale == m_settings.m_maxScale;
+		if (std::abs(scale - m_scale) >= m_settings.m_hysteresis || (atLimit && scale != m_scale))
+			m_scale = scale;
+
+		return m_scale;
+	}
+
+	double DynamicResolution::GetPredictedFrameTimeMs() const
+	{
+		return m_cost * m_scale * m_scale;
+	}
+}
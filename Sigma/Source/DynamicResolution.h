@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Sigma
+{
+	struct DynamicResolutionSettings
+	{
+		double m_targetFrameTimeMs;	// GPU budget of a frame
+		double m_headroom;			// Fraction of the budget aimed for, leaves room for frame to frame variations
+		float m_minScale;
+		float m_maxScale;
+		float m_maxScaleIncrease;	// Per frame, the scale drops right away but recovers slowly
+		float m_hysteresis;			// Scale changes smaller than this are ignored, so the resolution does not flicker
+
+		DynamicResolutionSettings();
+	};
+
+	/*
+	Picks the render scale (fraction of the swap chain size, per axis) that keeps the GPU frame time under budget.
+
+	GPU time is modeled as proportional to the rendered area : time = cost * scale^2. The cost is estimated from the
+	measured GPU times, rising fast when a frame is slower than predicted and falling slowly, so a spike lowers the
+	resolution immediately and a quiet frame does not raise it back right away. The scale for the next frame is the
+	one that fits the estimated cost in the budget.
+
+	Only depends on the measured times, so recorded traces can be replayed to tune it.
+	*/
+	class DynamicResolution
+	{
+	public:
+		explicit DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+
+		// gpuFrameTimeMs was measured for a frame rendered at renderScale, returns the scale for the next frame.
+		// With frames in flight, renderScale is usually not the current scale
+		float Update(double gpuFrameTimeMs, float renderScale);
+		void Reset();
+
+		float GetScale() const { return m_scale; }
+		// GPU time expected at the current scale
+		double GetPredictedFrameTimeMs() const;
+		const DynamicResolutionSettings& GetSettings() const { return m_settings; }
+
+	private:
+		DynamicResolutionSettings m_settings;
+		float m_scale;
+		double m_cost; // Estimated GPU time at scale 1, 0 until the first measurement
+	};
+}
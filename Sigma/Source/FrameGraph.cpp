@@ -0,0 +1,244 @@
+#include "FrameGraph.h"
+#include "RingAllocator.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+
+namespace Sigma
+{
+	const uint32_t kInvalidPass = 0xffffffff;
+
+	FrameGraphResource FrameGraph::CreateTransient(const char* name, const TransientResourceDesc& desc)
+	{
+		FrameGraphResourceNode node = {};
+		node.m_name = name;
+		node.m_imported = false;
+		node.m_desc = desc;
+		node.m_physical = nullptr;
+		m_resources.push_back(node);
+		return (FrameGraphResource)m_resources.size() - 1;
+	}
+
+	FrameGraphResource FrameGraph::Import(const char* name, void* physical)
+	{
+		FrameGraphResourceNode node = {};
+		node.m_name = name;
+		node.m_imported = true;
+		node.m_physical = physical;
+		m_resources.push_back(node);
+		return (FrameGraphResource)m_resources.size() - 1;
+	}
+
+	uint32_t FrameGraph::AddPass(const char* name, std::function<void(void*)> execute, bool hasSideEffects)
+	{
+		FrameGraphPass pass;
+		pass.m_name = name;
+		pass.m_execute = execute;
+		pass.m_hasSideEffects = hasSideEffects;
+		pass.m_culled = false;
+		m_passes.push_back(pass);
+		return (uint32_t)m_passes.size() - 1;
+	}
+
+	void FrameGraph::Read(uint32_t pass, FrameGraphResource resource, uint32_t state)
+	{
+		FrameGraphAccess access = { resource, state, false };
+		m_passes[pass].m_accesses.push_back(access);
+	}
+
+	void FrameGraph::Write(uint32_t pass, FrameGraphResource resource, uint32_t state)
+	{
+		FrameGraphAccess access = { resource, state, true };
+		m_passes[pass].m_accesses.push_back(access);
+	}
+
+	void FrameGraph::Compile()
+	{
+		// Walk passes backward, a pass is needed if it writes something read by a later needed pass, or an imported resource
+		std::vector<bool> needed(m_resources.size(), false);
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			needed[i] = m_resources[i].m_imported;
+		}
+
+		m_culledPassCount = 0;
+		for (size_t i = m_passes.size(); i-- > 0;)
+		{
+			FrameGraphPass& pass = m_passes[i];
+			pass.m_firstUses.clear();
+
+			bool live = pass.m_hasSideEffects;
+			for (const FrameGraphAccess& access : pass.m_accesses)
+			{
+				live |= access.m_write && needed[access.m_resource];
+			}
+
+			pass.m_culled = !live;
+			if (!live)
+			{
+				++m_culledPassCount;
+				continue;
+			}
+
+			for (const FrameGraphAccess& access : pass.m_accesses)
+			{
+				if (!access.m_write)
+					needed[access.m_resource] = true;
+			}
+		}
+
+		ComputeLifetimes();
+		PlaceTransients();
+	}
+
+	void FrameGraph::ComputeLifetimes()
+	{
+		for (FrameGraphResourceNode& resource : m_resources)
+		{
+			resource.m_firstPass = kInvalidPass;
+			resource.m_lastPass = kInvalidPass;
+			resource.m_heapOffset = kInvalidOffset;
+			resource.m_aliased = false;
+		}
+
+		for (uint32_t i = 0; i < m_passes.size(); i++)
+		{
+			FrameGraphPass& pass = m_passes[i];
+			if (pass.m_culled)
+				continue;
+
+			for (const FrameGraphAccess& access : pass.m_accesses)
+			{
+				FrameGraphResourceNode& resource = m_resources[access.m_resource];
+				if (resource.m_imported)
+					continue;
+
+				if (resource.m_firstPass == kInvalidPass)
+				{
+					resource.m_firstPass = i;
+					pass.m_firstUses.push_back(access.m_resource);
+				}
+				resource.m_lastPass = i;
+			}
+		}
+	}
+
+	void FrameGraph::PlaceTransients()
+	{
+		std::vector<FrameGraphResource> transients;
+		for (FrameGraphResource i = 0; i < m_resources.size(); i++)
+		{
+			if (!m_resources[i].m_imported && m_resources[i].m_firstPass != kInvalidPass)
+				transients.push_back(i);
+		}
+
+		// Placed in pass order, and biggest first among resources first used by the same pass, they are the hardest to fit
+		std::sort(transients.begin(), transients.end(), [this](FrameGraphResource a, FrameGraphResource b)
+		{
+			if (m_resources[a].m_firstPass != m_resources[b].m_firstPass)
+				return m_resources[a].m_firstPass < m_resources[b].m_firstPass;
+			return m_resources[a].m_desc.m_size > m_resources[b].m_desc.m_size;
+		});
+		std::vector<FrameGraphResource> expiring = transients;
+		std::sort(expiring.begin(), expiring.end(), [this](FrameGraphResource a, FrameGraphResource b)
+		{
+			return m_resources[a].m_lastPass < m_resources[b].m_lastPass;
+		});
+
+		// Free memory between the resources alive at the pass being swept, by offset (to merge gaps) and by size (to find
+		// the smallest one that fits). The last gap is unbounded
+		std::map<uint64_t, uint64_t> gaps;
+		std::set<std::pair<uint64_t, uint64_t>> gapsBySize;
+		gaps[0] = kInvalidOffset;
+		gapsBySize.insert(std::make_pair(kInvalidOffset, 0));
+		size_t nextExpiring = 0;
+
+		m_heapSize = 0;
+		m_transientSize = 0;
+		for (FrameGraphResource index : transients)
+		{
+			FrameGraphResourceNode& resource = m_resources[index];
+
+			// Memory of the resources no longer used by the time this one is first used can be reused
+			for (; nextExpiring < expiring.size() && m_resources[expiring[nextExpiring]].m_lastPass < resource.m_firstPass; nextExpiring++)
+			{
+				const FrameGraphResourceNode& expired = m_resources[expiring[nextExpiring]];
+				uint64_t begin = expired.m_heapOffset;
+				uint64_t end = begin + expired.m_desc.m_size;
+
+				auto next = gaps.lower_bound(begin);
+				if (next != gaps.begin() && std::prev(next)->second == begin)
+				{
+					auto previous = std::prev(next);
+					begin = previous->first;
+					gapsBySize.erase(std::make_pair(previous->second - previous->first, previous->first));
+					gaps.erase(previous);
+				}
+				if (next != gaps.end() && next->first == end)
+				{
+					end = next->second;
+					gapsBySize.erase(std::make_pair(next->second - next->first, next->first));
+					gaps.erase(next);
+				}
+				gaps[begin] = end;
+				gapsBySize.insert(std::make_pair(end - begin, begin));
+			}
+
+			// Smallest gap that still fits once aligned, the unbounded one always does
+			auto gap = gapsBySize.lower_bound(std::make_pair(resource.m_desc.m_size, (uint64_t)0));
+			uint64_t offset = AlignUp(gap->second, resource.m_desc.m_alignment);
+			while (offset - gap->second > gap->first - resource.m_desc.m_size)
+			{
+				++gap;
+				offset = AlignUp(gap->second, resource.m_desc.m_alignment);
+			}
+
+			uint64_t gapBegin = gap->second;
+			uint64_t gapEnd = gapBegin + gap->first;
+			uint64_t resourceEnd = offset + resource.m_desc.m_size;
+			gapsBySize.erase(gap);
+			gaps.erase(gapBegin);
+			if (gapBegin < offset)
+			{
+				gaps[gapBegin] = offset;
+				gapsBySize.insert(std::make_pair(offset - gapBegin, gapBegin));
+			}
+			if (resourceEnd < gapEnd)
+			{
+				gaps[resourceEnd] = gapEnd;
+				gapsBySize.insert(std::make_pair(gapEnd - resourceEnd, resourceEnd));
+			}
+
+			resource.m_heapOffset = offset;
+			m_heapSize = std::max(m_heapSize, resourceEnd);
+			m_transientSize += resource.m_desc.m_size;
+		}
+
+		// Resources sharing memory with another one need an aliasing barrier on first use,
+		// including the first one of the frame since the previous frame ended with another resource active.
+		// By offset, a resource overlaps an earlier one if one of them ends after it starts, and a later one if the next starts before it ends
+		std::sort(transients.begin(), transients.end(), [this](FrameGraphResource a, FrameGraphResource b)
+		{
+			return m_resources[a].m_heapOffset < m_resources[b].m_heapOffset;
+		});
+		uint64_t end = 0;
+		for (size_t i = 0; i < transients.size(); i++)
+		{
+			FrameGraphResourceNode& resource = m_resources[transients[i]];
+			uint64_t resourceEnd = resource.m_heapOffset + resource.m_desc.m_size;
+			resource.m_aliased = (i > 0 && end > resource.m_heapOffset) ||
+				(i + 1 < transients.size() && m_resources[transients[i + 1]].m_heapOffset < resourceEnd);
+			end = std::max(end, resourceEnd);
+		}
+	}
+
+	void FrameGraph::Reset()
+	{
+		m_passes.clear();
+		m_resources.clear();
+		m_heapSize = 0;
+		m_transientSize = 0;
+		m_culledPassCount = 0;
+	}
+}
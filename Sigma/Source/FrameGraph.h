@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Sigma
+{
+	typedef uint32_t FrameGraphResource;
+	const FrameGraphResource kInvalidFrameGraphResource = 0xffffffff;
+
+	// Everything needed to create and place a transient resource, size and alignment are filled by the caller
+	// (GetResourceAllocationInfo), the rest is opaque to the graph and only used to tell resources apart
+	struct TransientResourceDesc
+	{
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_format;
+		uint32_t m_flags;
+		uint64_t m_size;
+		uint64_t m_alignment;
+	};
+
+	struct FrameGraphAccess
+	{
+		FrameGraphResource m_resource;
+		uint32_t m_state;
+		bool m_write;
+	};
+
+	struct FrameGraphPass
+	{
+		std::string m_name;
+		std::vector<FrameGraphAccess> m_accesses;
+		// Receives the command list the pass records into, passes may be recorded in parallel
+		std::function<void(void*)> m_execute;
+		bool m_hasSideEffects;
+
+		// Compiled
+		bool m_culled;
+		std::vector<FrameGraphResource> m_firstUses;
+	};
+
+	struct FrameGraphResourceNode
+	{
+		std::string m_name;
+		bool m_imported;
+		TransientResourceDesc m_desc;
+		void* m_physical;
+
+		// Compiled, transient resources only
+		uint32_t m_firstPass;
+		uint32_t m_lastPass;
+		uint64_t m_heapOffset;
+		bool m_aliased;
+	};
+
+	/*
+	Passes declare the resources they read and write, in execution order. Compile then :
+	- culls passes whose results are never used (writing an imported resource or having side effects keeps a pass alive)
+	- computes transient resources lifetimes, as the first and last live pass using them
+	- places transient resources in a single heap, resources whose lifetimes do not overlap can share memory
+
+	Compile does not touch any graphics API : the caller creates transient resources at the computed heap offsets,
+	sets them with SetPhysicalResource, then records the live passes (possibly in parallel) and submits them in pass order.
+	*/
+	class FrameGraph
+	{
+	public:
+		FrameGraphResource CreateTransient(const char* name, const TransientResourceDesc& desc);
+		FrameGraphResource Import(const char* name, void* physical);
+
+		uint32_t AddPass(const char* name, std::function<void(void*)> execute, bool hasSideEffects = false);
+		void Read(uint32_t pass, FrameGraphResource resource, uint32_t state);
+		void Write(uint32_t pass, FrameGraphResource resource, uint32_t state);
+
+		void Compile();
+		void Reset();
+
+		const std::vector<FrameGraphPass>& GetPasses() const { return m_passes; }
+		const std::vector<FrameGraphResourceNode>& GetResources() const { return m_resources; }
+
+		void* GetPhysicalResource(FrameGraphResource resource) const { return m_resources[resource].m_physical; }
+		void SetPhysicalResource(FrameGraphResource resource, void* physical) { m_resources[resource].m_physical = physical; }
+
+		// Statistics of the last Compile
+		uint64_t GetHeapSize() const { return m_heapSize; }
+		uint64_t GetTransientSize() const { return m_transientSize; }
+		uint32_t GetCulledPassCount() const { return m_culledPassCount; }
+
+	private:
+		void ComputeLifetimes();
+		void PlaceTransients();
+
+		std::vector<FrameGraphPass> m_passes;
+		std::vector<FrameGraphResourceNode> m_resources;
+
+		uint64_t m_heapSize = 0;
+		uint64_t m_transientSize = 0;
+		uint32_t m_culledPassCount = 0;
+	};
+}
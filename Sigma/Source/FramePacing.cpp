@@ -0,0 +1,156 @@
+#include "FramePacing.h"
+#include <algorithm>
+#include <fstream>
+
+namespace Sigma
+{
+	const double FramePacingStats::kHitchRatio = 2.0;
+
+	static double ToMs(uint64_t begin, uint64_t end)
+	{
+		return end > begin ? (end - begin) / 1000000.0 : 0.0;
+	}
+
+	// Nearest rank, on sorted values. In integer thousandths, 99.9 / 100 * 1000 rounds up to rank 1000 in floating point
+	static double Percentile(const std::vector<double>& sorted, uint64_t perMille)
+	{
+		size_t rank = (size_t)((perMille * sorted.size() + 999) / 1000);
+		rank = std::max<size_t>(1, std::min(rank, sorted.size()));
+		return sorted[rank - 1];
+	}
+
+	FramePacingStats::FramePacingStats(uint32_t capacity) :
+		m_capacity(std::max(1u, capacity)),
+		m_head(0)
+	{
+		m_samples.reserve(m_capacity);
+	}
+
+	void FramePacingStats::Add(const FramePacingSample& sample)
+	{
+		if (m_samples.size() < m_capacity)
+		{
+			m_samples.push_back(sample);
+		}
+		else
+		{
+			m_samples[m_head] = sample;
+			m_head = (m_head + 1) % m_capacity;
+		}
+	}
+
+	void FramePacingStats::Clear()
+	{
+		m_samples.clear();
+		m_head = 0;
+	}
+
+	FramePacingSummary FramePacingStats::ComputeSummary() const
+	{
+		FramePacingSummary summary = {};
+		uint32_t count = GetSampleCount();
+		if (count == 0)
+			return summary;
+
+		summary.m_frameCount = count;
+
+		std::vector<double> frameTimes;
+		frameTimes.reserve(count);
+		for (uint32_t i = 1; i < count; i++)
+		{
+			frameTimes.push_back(ToMs(GetSample(i - 1).m_cpuStart, GetSample(i).m_cpuStart));
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const FramePacingSample& sample = GetSample(i);
+			summary.m_waitableWaitMs += ToMs(sample.m_cpuStart, sample.m_waitableWake);
+			summary.m_fenceWaitMs += ToMs(sample.m_waitableWake, sample.m_fenceWaitEnd);
+			summary.m_latencyMs += ToMs(sample.m_cpuStart, sample.m_gpuComplete);
+			summary.m_queuedFrames += sample.m_queuedFrames;
+		}
+		summary.m_waitableWaitMs /= count;
+		summary.m_fenceWaitMs /= count;
+		summary.m_latencyMs /= count;
+		summary.m_queuedFrames /= count;
+
+		if (frameTimes.empty())
+			return summary;
+
+		std::vector<double> sorted = frameTimes;
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (double frameTime : sorted)
+		{
+			total += frameTime;
+		}
+		summary.m_averageMs = total / sorted.size();
+		summary.m_p50Ms = Percentile(sorted, 500);
+		summary.m_p99Ms = Percentile(sorted, 990);
+		summary.m_p999Ms = Percentile(sorted, 999);
+		summary.m_maxMs = sorted.back();
+
+		for (double frameTime : frameTimes)
+		{
+			if (frameTime > summary.m_p50Ms * kHitchRatio)
+				summary.m_hitchCount++;
+		}
+		return summary;
+	}
+
+	bool FramePacingStats::WriteCsv(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		// Times relative to the CPU start of the frame
+		file << "frame,frame_ms,waitable_ms,fence_wait_ms,submit_ms,present_ms,gpu_complete_ms,queued_frames\n";
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (uint32_t i = 0; i < GetSampleCount(); i++)
+		{
+			const FramePacingSample& sample = GetSample(i);
+			double frameTime = i > 0 ? ToMs(GetSample(i - 1).m_cpuStart, sample.m_cpuStart) : 0.0;
+			file << sample.m_frameIndex << "," << frameTime << "," << ToMs(sample.m_cpuStart, sample.m_waitableWake) << ","
+				<< ToMs(sample.m_cpuStart, sample.m_fenceWaitEnd) << "," << ToMs(sample.m_cpuStart, sample.m_submit) << ","
+				<< ToMs(sample.m_cpuStart, sample.m_present) << "," << ToMs(sample.m_cpuStart, sample.m_gpuComplete) << ","
+				<< sample.m_queuedFrames << "\n";
+		}
+		return (bool)file;
+	}
+
+	bool FramePacingStats::WriteJson(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		FramePacingSummary summary = ComputeSummary();
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		file << "{\n\"summary\":{\"frames\":" << summary.m_frameCount << ",\"average_ms\":" << summary.m_averageMs
+			<< ",\"p50_ms\":" << summary.m_p50Ms << ",\"p99_ms\":" << summary.m_p99Ms << ",\"p99_9_ms\":" << summary.m_p999Ms
+			<< ",\"max_ms\":" << summary.m_maxMs << ",\"hitches\":" << summary.m_hitchCount
+			<< ",\"waitable_wait_ms\":" << summary.m_waitableWaitMs << ",\"fence_wait_ms\":" << summary.m_fenceWaitMs
+			<< ",\"latency_ms\":" << summary.m_latencyMs << ",\"queued_frames\":" << summary.m_queuedFrames << "},\n\"frames\":[";
+
+		// Raw timelines, in microseconds
+		for (uint32_t i = 0; i < GetSampleCount(); i++)
+		{
+			const FramePacingSample& sample = GetSample(i);
+			file << (i > 0 ? ",\n" : "\n") << "{\"frame\":" << sample.m_frameIndex << ",\"cpu_start\":" << sample.m_cpuStart / 1000.0
+				<< ",\"waitable_wake\":" << sample.m_waitableWake / 1000.0 << ",\"fence_wait_end\":" << sample.m_fenceWaitEnd / 1000.0
+				<< ",\"submit\":" << sample.m_submit / 1000.0 << ",\"present\":" << sample.m_present / 1000.0
+				<< ",\"gpu_complete\":" << sample.m_gpuComplete / 1000.0 << ",\"queued_frames\":" << sample.m_queuedFrames << "}";
+		}
+		file << "\n]}\n";
+		return (bool)file;
+	}
+
+	const FramePacingSample& FramePacingStats::GetSample(uint32_t index) const
+	{
+		return m_samples[(m_head + index) % m_samples.size()];
+	}
+}
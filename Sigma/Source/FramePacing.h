@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Sigma
+{
+	// Timeline of a frame, in nanoseconds on the CpuProfiler::Now clock
+	struct FramePacingSample
+	{
+		uint64_t m_frameIndex;
+		uint64_t m_cpuStart;
+		uint64_t m_waitableWake;	// The swap chain waitable object was signaled
+		uint64_t m_fenceWaitEnd;	// The command allocator of the frame was free
+		uint64_t m_submit;
+		uint64_t m_present;			// Present returned
+		uint64_t m_gpuComplete;		// The GPU finished the frame
+		uint32_t m_queuedFrames;	// Submitted frames the GPU had not completed when the frame started
+	};
+
+	struct FramePacingSummary
+	{
+		uint32_t m_frameCount;
+		// Frame time, between the CPU starts of consecutive frames
+		double m_averageMs;
+		double m_p50Ms;
+		double m_p99Ms;
+		double m_p999Ms;
+		double m_maxMs;
+		uint32_t m_hitchCount;
+		// Averages of the waits and of the latency from the CPU start to the GPU completion
+		double m_waitableWaitMs;
+		double m_fenceWaitMs;
+		double m_latencyMs;
+		double m_queuedFrames;
+	};
+
+	/*
+	Keeps the timelines of the last frames and computes frame pacing statistics over them.
+	A frame is a hitch when it takes more than kHitchRatio times the median frame time.
+	Does not depend on any graphics API, samples are filled by the game once the GPU has completed them.
+	*/
+	class FramePacingStats
+	{
+	public:
+		static const double kHitchRatio;
+
+		explicit FramePacingStats(uint32_t capacity);
+
+		// Samples are expected in frame order, the oldest is dropped once the capacity is reached
+		void Add(const FramePacingSample& sample);
+		void Clear();
+
+		FramePacingSummary ComputeSummary() const;
+		uint32_t GetSampleCount() const { return (uint32_t)m_samples.size(); }
+
+		// Both return false if the file could not be written
+		bool WriteCsv(const char* path) const;
+		bool WriteJson(const char* path) const;
+
+	private:
+		// Oldest first
+		const FramePacingSample& GetSample(uint32_t index) const;
+
+		uint32_t m_capacity;
+		uint32_t m_head;
+		std::vector<FramePacingSample> m_samples;
+	};
+}
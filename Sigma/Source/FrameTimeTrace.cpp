@@ -0,0 +1,62 @@
+#include "FrameTimeTrace.h"
+#include <algorithm>
+#include <fstream>
+
+namespace Sigma
+{
+	FrameTimeTrace::FrameTimeTrace() :
+		m_recording(false)
+	{
+	}
+
+	void FrameTimeTrace::Start()
+	{
+		m_samples.clear();
+		m_recording = true;
+	}
+
+	bool FrameTimeTrace::Stop(const char* path)
+	{
+		m_recording = false;
+
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		file << "frame,frame_ms,resize_ms,gpu_ms,buffer_width,buffer_height,render_width,render_height\n";
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (const FrameTimeSample& sample : m_samples)
+		{
+			file << sample.m_frameIndex << "," << sample.m_frameTimeMs << "," << sample.m_resizeTimeMs << "," << sample.m_gpuTimeMs << ","
+				<< sample.m_bufferWidth << "," << sample.m_bufferHeight << "," << sample.m_renderWidth << "," << sample.m_renderHeight << "\n";
+		}
+		return (bool)file;
+	}
+
+	void FrameTimeTrace::Add(const FrameTimeSample& sample)
+	{
+		if (m_recording)
+			m_samples.push_back(sample);
+	}
+
+	double FrameTimeTrace::GetMaxFrameTimeMs() const
+	{
+		double maxFrameTime = 0.0;
+		for (const FrameTimeSample& sample : m_samples)
+		{
+			maxFrameTime = std::max(maxFrameTime, sample.m_frameTimeMs);
+		}
+		return maxFrameTime;
+	}
+
+	double FrameTimeTrace::GetTotalResizeTimeMs() const
+	{
+		double total = 0.0;
+		for (const FrameTimeSample& sample : m_samples)
+		{
+			total += sample.m_resizeTimeMs;
+		}
+		return total;
+	}
+}
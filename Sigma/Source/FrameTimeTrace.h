@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Sigma
+{
+	struct FrameTimeSample
+	{
+		uint64_t m_frameIndex;
+		double m_frameTimeMs;	// Since the start of the previous frame
+		double m_resizeTimeMs;	// Spent resizing the swap chain, GPU drain included
+		double m_gpuTimeMs;		// Of the last frame the GPU completed, not of this one
+		uint32_t m_bufferWidth;
+		uint32_t m_bufferHeight;
+		uint32_t m_renderWidth;
+		uint32_t m_renderHeight;
+	};
+
+	// Records frame times between Start and Stop, to measure stalls (like swap chain resizes) outside of a PIX capture
+	class FrameTimeTrace
+	{
+	public:
+		FrameTimeTrace();
+
+		void Start();
+		// Writes the recorded frames as CSV, returns false if the file could not be written
+		bool Stop(const char* path);
+		bool IsRecording() const { return m_recording; }
+
+		void Add(const FrameTimeSample& sample);
+
+		double GetMaxFrameTimeMs() const;
+		double GetTotalResizeTimeMs() const;
+
+	private:
+		std::vector<FrameTimeSample> m_samples;
+		bool m_recording;
+	};
+}
@@ -1,102 +1,239 @@
 #include "stdafx.h"
 #include "Game.h"
 #include "Defines.h"
+#include "Profile.h"
+#include <windowsx.h>
 
 namespace Sigma {
 	
-	ID3D12Resource* CreateTexture2D(ID3D12Device* device, int width, int height)
+	DXGI_FORMAT GetDxgiFormat(TextureFormat format, bool srgb)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case TextureFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+		case TextureFormat::BC4: return DXGI_FORMAT_BC4_UNORM;
+		case TextureFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+		case TextureFormat::BC7: return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		default: return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	ResourceHandle CreateTexture2D(ResourceRegistry& registry, GpuHeapAllocator& allocator, int width, int height, int mipLevels, DXGI_FORMAT format)
 	{
 		D3D12_RESOURCE_DESC desc;
 		desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 		desc.Width = width;
 		desc.Height = height;
 		desc.DepthOrArraySize = 1;
-		desc.MipLevels = 1;
+		desc.MipLevels = mipLevels;
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		desc.Format = format;
 		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-		D3D12_HEAP_PROPERTIES texHeapProps;
-		texHeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-		texHeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		texHeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		texHeapProps.CreationNodeMask = 0;
-		texHeapProps.VisibleNodeMask = 0;
-
-		ID3D12Resource* resource;
-		device->CreateCommittedResource(
-			&texHeapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&desc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&resource));
-		return resource;
-	}
-
-
-	ID3D12Resource* CreateUploadBuffer(ID3D12Device* device, ID3D12Resource* resource, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprint)
-	{
-		D3D12_HEAP_PROPERTIES heapProps;
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.CreationNodeMask = 0;
-		heapProps.VisibleNodeMask = 0;
-
-		UINT64 uploadBufferSize = 0;
-		UINT numRows = 0;
-		UINT64 rowSizeInBytes = 0;
-		device->GetCopyableFootprints(&resource->GetDesc(), 0, 1, 0, footprint, &numRows, &rowSizeInBytes, &uploadBufferSize);
-
-		D3D12_RESOURCE_DESC bufDesc;
-		bufDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-		bufDesc.Height = 1;
-		bufDesc.DepthOrArraySize = 1;
-		bufDesc.MipLevels = 1;
-		bufDesc.SampleDesc.Count = 1;
-		bufDesc.SampleDesc.Quality = 0;
-		bufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		bufDesc.Width = uploadBufferSize;
-		bufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		bufDesc.Format = DXGI_FORMAT_UNKNOWN;
-		bufDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ID3D12Resource* uploadBuffer;
-		device->CreateCommittedResource(
-			&heapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&bufDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&uploadBuffer));	
-		return uploadBuffer;
-	}
-
-	const uint32_t kNumSRV = 128;
-
-	void FillBuffer(ID3D12Resource* buffer, ID3D12Resource* resource, unsigned pitchInBytes, char* data)
-	{
-		auto desc = resource->GetDesc();
-		char* cpuData;
-		buffer->Map(0, nullptr, (void**)&cpuData);
-		for (unsigned i = 0; i < desc.Height; i++)
-		{
-			memcpy(cpuData, data, desc.Width * 4);
-			cpuData += pitchInBytes;
-			data += desc.Width;
-		}
-		buffer->Unmap(0, nullptr);
+		// Promoted to COPY_DEST by the copy queue uploading it
+		return registry.Create(allocator, desc, D3D12_RESOURCE_STATE_COMMON, nullptr);
+	}
+
+
+	const uint32_t kNumDescriptors = 1 << 16;
+	const uint32_t kNumRangeDescriptors = 4096; // Part of the heap reserved for descriptor tables
+	const UINT64 kTransientHeapSize = 128 * 1024 * 1024; // 128 MiB
+	const UINT64 kBufferHeapBlockSize = 16 * 1024 * 1024; // 16 MiB
+	const UINT64 kTextureHeapBlockSize = 64 * 1024 * 1024; // 64 MiB
+	const UINT64 kDefragmentationBytesPerFrame = 4 * 1024 * 1024; // 4 MiB
+	const std::chrono::milliseconds kResizeDebounce(200);
+	const int kRenderTargetGranularity = 128; // Internal targets are allocated by steps, so small resizes keep them
+	const uint32_t kNumTransientRenderTargets = 256;
+	const UINT64 kFrameConstantsSize = 32 * 1024 * 1024; // 32 MiB per frame in flight, 128K draws
+	const uint32_t kMaxGpuScopes = 256; // Per frame
+	const uint32_t kGpuTimingHistory = 120;
+	const uint32_t kCpuTraceFrames = 60;
+	const uint32_t kFramePacingFrames = 1000;
+	const std::chrono::milliseconds kOverlayRefresh(500);
+	const UINT kSetOverlayTitleMessage = WM_APP + 1; // Posted by the render thread, m_overlayTitle is the new title
+	const DWORD kPendingWindowEventsRetryMs = 1;
+	const uint32_t kBenchmarkWarmupFrames = 60;
+	const uint32_t kBenchmarkMeasuredFrames = 600;
+	const char* kAssetArchivePath = "Assets.pak";
+	const char* kShaderAssets[] = { "VertexShader.cso", "PixelShader.cso", "FullscreenVS.cso", "UpscalePS.cso" };
+	const char* kTextureAsset = "Default.sgtx";
+	const uint32_t kIoQueueDepth = 8;
+	const uint64_t kMaxIoInFlightBytes = 64 * 1024 * 1024;
+
+	// Matches PerDrawConstants in PixelShader.hlsl
+	struct PerDrawConstants
+	{
+		uint32_t TextureIndex;
+	};
+
+	// Matches UpscaleConstants in UpscalePS.hlsl
+	struct UpscaleConstants
+	{
+		float UVScale[2];
+		float UVMin[2];
+		float UVClamp[2];
+		uint32_t TextureIndex;
+	};
+
+	// Missing, or older than one of the shaders it packs
+	bool IsAssetArchiveOutdated()
+	{
+		WIN32_FILE_ATTRIBUTE_DATA archive;
+		if (!GetFileAttributesEx(kAssetArchivePath, GetFileExInfoStandard, &archive))
+			return true;
+
+		for (const char* shader : kShaderAssets)
+		{
+			WIN32_FILE_ATTRIBUTE_DATA attributes;
+			if (GetFileAttributesEx(shader, GetFileExInfoStandard, &attributes) && CompareFileTime(&attributes.ftLastWriteTime, &archive.ftLastWriteTime) > 0)
+				return true;
+		}
+		return false;
+	}
+
+	void CookDefaultTexture(JobSystem* jobSystem, std::vector<uint8_t>& cooked)
+	{
+		std::vector<int> texels(128 * 128);
+		for (int& texel : texels)
+		{
+			texel = rand() << 8 | rand();
+		}
+
+		CookSettings settings;
+		settings.m_format = TextureFormat::BC7;
+		settings.m_srgb = true;
+		CookTexture(texels.data(), 128 * sizeof(int), 128, 128, settings, jobSystem, cooked);
+	}
+
+	// Stands in for the offline packing step in development builds. Assets are stored uncompressed, to be used in place.
+	// The loose shaders are read asynchronously while the texture is cooked
+	bool BuildAssetArchive(JobSystem* jobSystem, IoService* ioService)
+	{
+		const uint32_t numShaders = _countof(kShaderAssets);
+		uint32_t files[numShaders];
+		std::vector<char> bytecode[numShaders];
+		IoBatch batch;
+		for (uint32_t i = 0; i < numShaders; i++)
+		{
+			files[i] = ioService->OpenFile(kShaderAssets[i]);
+			if (files[i] == kInvalidIoFile)
+				continue;
+			bytecode[i].resize((size_t)ioService->GetFileSize(files[i]));
+			ioService->Read(files[i], 0, bytecode[i].size(), bytecode[i].data(), IoPriority::High, &batch);
+		}
+
+		std::vector<uint8_t> cooked;
+		CookDefaultTexture(jobSystem, cooked);
+
+		ioService->Wait(batch);
+		for (uint32_t file : files)
+		{
+			if (file != kInvalidIoFile)
+				ioService->CloseFile(file);
+		}
+
+		IoStats stats = ioService->GetStats();
+		char message[256];
+		sprintf_s(message, "Read %llu loose files, %.1f MB/s, latency p50 %.2f ms p99 %.2f ms\n",
+			stats.m_completedRequests, stats.m_throughputMBs, stats.m_p50LatencyMs, stats.m_p99LatencyMs);
+		OutputDebugString(message);
+
+		AssetArchiveWriter writer;
+		for (uint32_t i = 0; i < numShaders; i++)
+		{
+			if (files[i] == kInvalidIoFile || bytecode[i].empty() || !writer.Add(kShaderAssets[i], bytecode[i].data(), bytecode[i].size(), false))
+				return false;
+		}
+		return batch.m_failed == 0 && writer.Add(kTextureAsset, cooked.data(), cooked.size(), false) && writer.Write(kAssetArchivePath);
+	}
+
+	AssetSpan FindAsset(const AssetArchive& archive, const char* name)
+	{
+		const AssetArchiveEntry* entry = archive.Find(name);
+		AssetSpan span = entry != nullptr ? archive.GetSpan(*entry) : AssetSpan();
+		if (span.m_data == nullptr)
+		{
+			char message[256];
+			sprintf_s(message, "Asset %s missing from %s\n", name, kAssetArchivePath);
+			OutputDebugString(message);
+		}
+		return span;
+	}
+
+	D3D12_SHADER_BYTECODE GetShaderBytecode(const AssetArchive& archive, const char* name)
+	{
+		AssetSpan span = FindAsset(archive, name);
+		D3D12_SHADER_BYTECODE bytecode;
+		bytecode.pShaderBytecode = span.m_data;
+		bytecode.BytecodeLength = (SIZE_T)span.m_size;
+		return bytecode;
+	}
+
+	void SetViewportAndScissor(ID3D12GraphicsCommandList* commandList, int width, int height)
+	{
+		D3D12_VIEWPORT viewport;
+		viewport.Height = (float)height;
+		viewport.Width = (float)width;
+		viewport.TopLeftX = 0;
+		viewport.TopLeftY = 0;
+		viewport.MinDepth = 0;
+		viewport.MaxDepth = 1.0f;
+
+		D3D12_RECT scissorRect;
+		scissorRect.top = 0;
+		scissorRect.bottom = height;
+		scissorRect.left = 0;
+		scissorRect.right = width;
+
+		commandList->RSSetViewports(1, &viewport);
+		commandList->RSSetScissorRects(1, &scissorRect);
+	}
+
+	// Records all transitions with a single ResourceBarrier call
+	void RecordBarriers(ID3D12GraphicsCommandList* commandList, const std::vector<StateTransition>& transitions)
+	{
+		if (transitions.empty())
+			return;
+
+		std::vector<D3D12_RESOURCE_BARRIER> barriers(transitions.size());
+		for (size_t i = 0; i < transitions.size(); i++)
+		{
+			barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barriers[i].Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+			barriers[i].Transition.pResource = static_cast<ID3D12Resource*>(transitions[i].m_resource);
+			barriers[i].Transition.Subresource = transitions[i].m_subresource;
+			barriers[i].Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(transitions[i].m_stateBefore);
+			barriers[i].Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(transitions[i].m_stateAfter);
+		}
+		commandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	}
+
+	void FlushBarriers(ID3D12GraphicsCommandList* commandList, ResourceStateTracker* stateTracker)
+	{
+		stateTracker->FlushBarriers([commandList](const std::vector<StateTransition>& barriers)
+		{
+			RecordBarriers(commandList, barriers);
+		});
 	}
 
 	Game::Game(std::string title, int width, int height, HINSTANCE hInstance) : 
 		m_title(title), 
 		m_windowWidth(width), 
 		m_windowHeight(height),
-		m_hInstance(hInstance)
+		m_hInstance(hInstance),
+		m_inSizeMove(false),
+		m_renderScale(1.0f),
+		m_dynamicResolutionEnabled(true),
+		m_gpuFrameTimeMs(0.0),
+		m_framePacing(kFramePacingFrames),
+		m_numFrames(2),
+		m_numBuffers(2),
+		m_vsync(true),
+		m_latencyBenchmark(kBenchmarkWarmupFrames, kBenchmarkMeasuredFrames)
 	{
 		SetupWindow();
 		SetupD3D();
@@ -154,42 +291,311 @@ namespace Sigma {
 	int Game::Run()
 	{
 		MSG msg;
-		
-		bool running = true;
 
-		// Main message loop:
+		CpuProfiler::SetThreadName("Window");
+		m_renderThread = CreateThread(nullptr, 0, Game::StaticGameLoop, this, 0, nullptr);
+
+		// Main message loop, it only forwards window events to the render thread
+		// Messages keep being pumped until the render thread exits : DXGI sends messages to the window from Present,
+		// ResizeBuffers or SetFullscreenState, blocking here could deadlock them
+		// Events that did not fit in the queue are retried until the render thread makes room for them
+		bool running = true;
 		while (running)
 		{
+			DWORD timeout = FlushWindowEvents() ? INFINITE : kPendingWindowEventsRetryMs;
+			DWORD result = MsgWaitForMultipleObjects(1, &m_renderThread, FALSE, timeout, QS_ALLINPUT);
+			if (result == WAIT_OBJECT_0)
+			{
+				running = false;
+				break;
+			}
 
 			while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) > 0)
 			{
 				TranslateMessage(&msg);
 				DispatchMessage(&msg);
-				if (msg.message == WM_QUIT)
-					running = false;
 			}
-			
-			if (m_windowWidth != m_bufferWidth || m_windowHeight != m_bufferHeight)
+		}
+
+		CloseHandle(m_renderThread);
+		m_renderThread = nullptr;
+
+		if (m_hWindow)
+			DestroyWindow(m_hWindow);
+
+		return 0;
+	}
+
+	DWORD WINAPI Game::StaticGameLoop(LPVOID startParam)
+	{
+		Game* game = reinterpret_cast<Game*>(startParam);
+		return game->RenderLoop();
+	}
+
+	DWORD Game::RenderLoop()
+	{
+		CpuProfiler::SetThreadName("Render");
+		m_jobSystem->RegisterThread();
+		memset(m_frameStates, 0, sizeof(m_frameStates));
+		std::chrono::steady_clock::time_point previousFrameStart = std::chrono::steady_clock::now();
+
+		while (ProcessWindowEvents())
+		{
+			CpuProfiler::BeginFrame();
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+			m_framePacingSample = {};
+			m_framePacingSample.m_frameIndex = m_frameCounter;
+			m_framePacingSample.m_cpuStart = CpuProfiler::Now();
+			m_framePacingSample.m_queuedFrames = (uint32_t)(m_lastSubmittedFrameFenceValue - m_endOfFrameFence->GetCompletedValue());
+
+			// Resize events are coalesced : only the latest size is kept, and the swap chain is resized at most once per frame.
+			// While an edge is being dragged, the current buffers are stretched until the size settles.
+			// A minimized window reports a 0x0 client area, keep the current buffers until it is restored
+			bool sizeChanged = (m_windowWidth != m_bufferWidth || m_windowHeight != m_bufferHeight) && m_windowWidth > 0 && m_windowHeight > 0;
+			bool sizeSettled = !m_inSizeMove || frameStart - m_lastResizeEventTime > kResizeDebounce;
+			if (sizeChanged && sizeSettled)
 			{
 				ResizeSwapChainBuffers();
 			}
-			
-			GameLoop();
+			std::chrono::steady_clock::time_point resizeEnd = std::chrono::steady_clock::now();
+
+			// The next frame is simulated while this one is recorded and submitted
+			const FrameState& state = m_frameStates[m_frameCounter % 2];
+			FrameState& nextState = m_frameStates[(m_frameCounter + 1) % 2];
+
+			JobCounter simulation;
+			m_jobSystem->Run([this, &state, &nextState]() { Simulate(state, nextState); }, &simulation);
+
+			GameLoop(state);
+
+			m_jobSystem->Wait(simulation);
+			m_inputEvents.clear();
+
+			FrameTimeSample sample;
+			sample.m_frameIndex = m_frameCounter;
+			sample.m_frameTimeMs = std::chrono::duration<double, std::milli>(frameStart - previousFrameStart).count();
+			sample.m_resizeTimeMs = std::chrono::duration<double, std::milli>(resizeEnd - frameStart).count();
+			sample.m_gpuTimeMs = m_gpuFrameTimeMs;
+			sample.m_bufferWidth = m_bufferWidth;
+			sample.m_bufferHeight = m_bufferHeight;
+			sample.m_renderWidth = m_renderWidth;
+			sample.m_renderHeight = m_renderHeight;
+			m_frameTimeTrace.Add(sample);
+			previousFrameStart = frameStart;
+
+			if (m_latencyBenchmark.AdvanceFrame(m_framePacing))
+			{
+				if (m_latencyBenchmark.IsRunning())
+				{
+					SetLatencyMode(m_latencyBenchmark.GetMode());
+				}
+				else
+				{
+					SetLatencyMode(m_modeBeforeBenchmark);
+					if (m_latencyBenchmark.WriteCsv("LatencyBenchmark.csv"))
+						OutputDebugString("Latency benchmark written to LatencyBenchmark.csv\n");
+				}
+			}
+
+			if (frameStart - m_lastOverlayUpdate > kOverlayRefresh)
+			{
+				UpdateOverlay();
+				m_lastOverlayUpdate = frameStart;
+			}
 		}
 
+		// Leave fullscreen before the swap chain is released
+		m_swapChain->SetFullscreenState(FALSE, nullptr);
+		return 0;
+	}
+
+	// Drains the window events, handling the ones that concern the swap chain and keeping input ones for the simulation
+	// Returns false once the window asked to quit
+	bool Game::ProcessWindowEvents()
+	{
+		WindowEvent event;
+		while (m_windowEvents.Pop(event))
+		{
+			switch (event.m_type)
+			{
+			case WindowEventType::Resize:
+				m_windowWidth = event.m_x;
+				m_windowHeight = event.m_y;
+				m_lastResizeEventTime = std::chrono::steady_clock::now();
+				break;
+			case WindowEventType::SizeMoveBegin:
+				m_inSizeMove = true;
+				break;
+			case WindowEventType::SizeMoveEnd:
+				m_inSizeMove = false;
+				break;
+			case WindowEventType::ToggleFrameTimeTrace:
+				if (m_frameTimeTrace.IsRecording())
+				{
+					m_frameTimeTrace.Stop("FrameTimeTrace.csv");
+					char summary[256];
+					sprintf_s(summary, "Frame time trace written to FrameTimeTrace.csv : max frame %.2f ms, %.2f ms spent resizing\n",
+						m_frameTimeTrace.GetMaxFrameTimeMs(), m_frameTimeTrace.GetTotalResizeTimeMs());
+					OutputDebugString(summary);
+				}
+				else
+				{
+					m_frameTimeTrace.Start();
+				}
+				break;
+			case WindowEventType::WriteCpuTrace:
+				if (CpuProfiler::WriteChromeTrace("CpuTrace.json", kCpuTraceFrames))
+					OutputDebugString("CPU trace of the last frames written to CpuTrace.json\n");
+				break;
+			case WindowEventType::WriteFramePacing:
+				if (m_framePacing.WriteCsv("FramePacing.csv") && m_framePacing.WriteJson("FramePacing.json"))
+					OutputDebugString("Frame pacing of the last frames written to FramePacing.csv and FramePacing.json\n");
+				break;
+			case WindowEventType::CycleFramesInFlight:
+			{
+				LatencyMode mode = { m_numFrames % kMaxFrames + 1, m_vsync };
+				SetLatencyMode(mode);
+				break;
+			}
+			case WindowEventType::ToggleVSync:
+			{
+				LatencyMode mode = { m_numFrames, !m_vsync };
+				SetLatencyMode(mode);
+				break;
+			}
+			case WindowEventType::RunLatencyBenchmark:
+			{
+				if (m_latencyBenchmark.IsRunning())
+					break;
+
+				std::vector<LatencyMode> modes;
+				for (uint32_t numFrames = 1; numFrames <= kMaxFrames; numFrames++)
+				{
+					modes.push_back({ numFrames, true });
+					modes.push_back({ numFrames, false });
+				}
+				m_modeBeforeBenchmark = { m_numFrames, m_vsync };
+				m_latencyBenchmark.Start(modes);
+				SetLatencyMode(m_latencyBenchmark.GetMode());
+				break;
+			}
+			case WindowEventType::PrintGpuTimings:
+				OutputDebugString(m_gpuProfiler->GetTimingTree().ToString().c_str());
+				break;
+			case WindowEventType::ToggleDynamicResolution:
+				m_dynamicResolutionEnabled = !m_dynamicResolutionEnabled;
+				m_dynamicResolution.Reset();
+				m_renderScale = m_dynamicResolution.GetScale();
+				break;
+			case WindowEventType::ToggleFullscreen:
+			{
+				BOOL fullscreenState = false;
+				m_swapChain->GetFullscreenState(&fullscreenState, nullptr);
+				m_swapChain->SetFullscreenState(!fullscreenState, nullptr);
+				break;
+			}
+			case WindowEventType::Quit:
+				return false;
+			default:
+				m_inputEvents.push_back(event);
+				break;
+			}
+		}
+		return true;
+	}
+
+	void Game::Simulate(const FrameState& previous, FrameState& next)
+	{
+		CpuProfileScope profileScope("Simulate");
+		next = previous;
+		next.m_frameIndex = previous.m_frameIndex + 1;
+
+		for (const WindowEvent& event : m_inputEvents)
+		{
+			switch (event.m_type)
+			{
+			case WindowEventType::KeyDown:
+				next.m_keysDown[event.m_x & 0xff] = true;
+				break;
+			case WindowEventType::KeyUp:
+				next.m_keysDown[event.m_x & 0xff] = false;
+				break;
+			case WindowEventType::MouseMove:
+				next.m_mouseX = event.m_x;
+				next.m_mouseY = event.m_y;
+				break;
+			case WindowEventType::MouseButtonDown:
+				next.m_mouseButtonsDown[event.m_x] = true;
+				break;
+			case WindowEventType::MouseButtonUp:
+				next.m_mouseButtonsDown[event.m_x] = false;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	// Window thread only, never blocks : the render thread can be waiting on the window thread (DXGI resizing or
+	// switching to fullscreen sends it messages), and the queue is only full while the render thread is stalled.
+	// Events that do not fit are kept in order until there is room, mouse moves and resizes only keep the latest one
+	void Game::PushWindowEvent(WindowEventType type, int x, int y)
+	{
+		WindowEvent event = { type, x, y };
+		if (FlushWindowEvents() && m_windowEvents.Push(event))
+			return;
+
+		bool coalesced = (type == WindowEventType::MouseMove || type == WindowEventType::Resize) &&
+			!m_pendingWindowEvents.empty() && m_pendingWindowEvents.back().m_type == type;
+		if (coalesced)
+			m_pendingWindowEvents.back() = event;
+		else
+			m_pendingWindowEvents.push_back(event);
+	}
+
+	// Returns true once no event is waiting for room in the queue
+	bool Game::FlushWindowEvents()
+	{
+		size_t count = 0;
+		while (count < m_pendingWindowEvents.size() && m_windowEvents.Push(m_pendingWindowEvents[count]))
+		{
+			count++;
+		}
+		m_pendingWindowEvents.erase(m_pendingWindowEvents.begin(), m_pendingWindowEvents.begin() + count);
+		return m_pendingWindowEvents.empty();
+	}
 
-		return (int)msg.wParam;
+	// Frame pacing and resolution in the window title, there is no text rendering yet
+	void Game::UpdateOverlay()
+	{
+		FramePacingSummary summary = m_framePacing.ComputeSummary();
+		const ResidencyStats& residency = m_residencyManager->GetStats();
+		char title[320];
+		sprintf_s(title, "%s - %.2f ms (p99 %.2f, p99.9 %.2f), %u hitches, %.1f ms latency, %.1f queued - %u frames in flight%s%s - %dx%d (%d%%) - %llu/%llu MiB resident",
+			m_title.c_str(), summary.m_p50Ms, summary.m_p99Ms, summary.m_p999Ms, summary.m_hitchCount, summary.m_latencyMs, summary.m_queuedFrames,
+			m_numFrames, m_vsync ? "" : ", no vsync", m_latencyBenchmark.IsRunning() ? ", benchmarking" : "",
+			m_renderWidth, m_renderHeight, (int)(m_renderScale * 100.0f + 0.5f),
+			residency.m_residentSize >> 20, residency.m_budget >> 20);
+
+		// SetWindowText would wait on the window thread, which may itself be waiting on DXGI called from this thread
+		{
+			std::lock_guard<std::mutex> lock(m_overlayTitleMutex);
+			m_overlayTitle = title;
+		}
+		PostMessage(m_hWindow, kSetOverlayTitleMessage, 0, 0);
 	}
 
 	Frame Game::GetNewFrame()
 	{
-		PIXScopedEvent(PIX_COLOR_INDEX(1), "New frame");
+		ProfileScopedEvent(PIX_COLOR_INDEX(1), "New frame");
 		
 		{
-			PIXScopedEvent(PIX_COLOR_INDEX(2), "Waiting for free back buffer");
+			ProfileScopedEvent(PIX_COLOR_INDEX(2), "Waiting for free back buffer");
 			// Make sure we have a free back buffer
 			WaitForSingleObject(m_swapChainWait, INFINITE);
 		}
+		m_framePacingSample.m_waitableWake = CpuProfiler::Now();
 
 		Frame frame;
 		frame.m_commandAllocator = m_commandAllocators[m_currentFrame];
@@ -197,99 +603,211 @@ namespace Sigma {
 		frame.m_fenceValue = ++m_lastSubmittedFrameFenceValue;
 		frame.m_renderTarget = m_renderTargets[m_currentBuffer];
 		frame.m_renderTargetsHandle = m_renderTargetsHandles[m_currentBuffer];
+		frame.m_stateTracker = m_stateTrackers[m_currentFrame].get();
 
 		// Make sure GPU is done with our previous usage of this command allocator before resetting it
-		// This assumes that command allocators are used in order, and their command lists are executed when the
-		// GPU reach the end of the frame fence
-		if (frame.m_fenceValue >= kNumFrames && m_endOfFrameFence->GetCompletedValue() < frame.m_fenceValue - kNumFrames)
+		// Its command lists were executed before the end of frame fence was signaled with the value kept for the slot
+		UINT64 previousFenceValue = m_frameSlotFenceValues[m_currentFrame];
+		if (m_endOfFrameFence->GetCompletedValue() < previousFenceValue)
 		{
-			PIXScopedEvent(PIX_COLOR_INDEX(2), "Waiting for CL exec");
-			m_endOfFrameFence->SetEventOnCompletion(frame.m_fenceValue - kNumFrames, m_fenceEvent);
+			ProfileScopedEvent(PIX_COLOR_INDEX(2), "Waiting for CL exec");
+			m_endOfFrameFence->SetEventOnCompletion(previousFenceValue, m_fenceEvent);
 			WaitForSingleObject(m_fenceEvent, INFINITE);
 			PIXNotifyWakeFromFenceSignal(m_fenceEvent);
 		}
+		m_framePacingSample.m_fenceWaitEnd = CpuProfiler::Now();
+
+		RetireFrameSlot(m_currentFrame);
+		m_frameSlotFenceValues[m_currentFrame] = frame.m_fenceValue;
 
 		frame.m_commandAllocator->Reset();
 		frame.m_commandList->Reset(frame.m_commandAllocator.Get(), nullptr);
+		frame.m_stateTracker->Reset();
+		m_commandListPool->BeginFrame(m_currentFrame);
+
+		// Reclaim upload memory of copies the GPU is done with
+		m_uploadQueue->Retire();
+		m_descriptorHeap->Retire(m_endOfFrameFence->GetCompletedValue());
+		m_resourceRegistry->Retire(m_endOfFrameFence->GetCompletedValue());
+		m_transientRtvHeap->Retire(m_endOfFrameFence->GetCompletedValue());
+		m_constantAllocator->BeginFrame(m_currentFrame);
 
 		return frame;
 	}
 
 
-	void Game::GameLoop()
+	// The previous frame that used this slot is complete, its GPU time drives the render scale of the next frame
+	void Game::RetireFrameSlot(uint32_t slot)
 	{
-		PIXBeginEvent(m_commandQueue.Get(), PIX_COLOR_INDEX(0), "Frame %d", m_frameCounter);
-		Frame frame = GetNewFrame();
-		PIXBeginEvent(frame.m_commandList.Get(), PIX_COLOR_INDEX(0), "CMDList %d", frame.m_commandList.Get());
-	
-		{
-			D3D12_RESOURCE_TRANSITION_BARRIER transition = {};
-			transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-			transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			transition.pResource = frame.m_renderTarget.Get();
-			transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		m_gpuProfiler->BeginFrame(slot);
+		if (m_frameSlotFenceValues[slot] == 0)
+			return;
 
-			D3D12_RESOURCE_BARRIER barrier = {};
-			barrier.Transition = transition;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		FramePacingSample& completed = m_pendingFramePacing[slot];
+		completed.m_gpuComplete = CpuProfiler::Now() - (uint64_t)(m_gpuProfiler->GetFrameEndAgeMs() * 1000000.0);
+		m_framePacing.Add(completed);
 
-			frame.m_commandList->ResourceBarrier(1, &barrier);
-		}
+		m_gpuFrameTimeMs = m_gpuProfiler->GetFrameTimeMs();
+		if (m_dynamicResolutionEnabled)
+			m_renderScale = m_dynamicResolution.Update(m_gpuFrameTimeMs, m_frameRenderScales[slot]);
 
-		frame.m_commandList->OMSetRenderTargets(1, &frame.m_renderTargetsHandle, FALSE, nullptr);
+		m_frameSlotFenceValues[slot] = 0;
+	}
 
-		const float clearColor[4] = { 1.0f, 1.0f, 0.f, 1.0f };
-		frame.m_commandList->ClearRenderTargetView(frame.m_renderTargetsHandle, clearColor, 0, nullptr);
-		
-		D3D12_VIEWPORT viewport;
-		viewport.Height = (float)m_bufferHeight;
-		viewport.Width = (float)m_bufferWidth;
-		viewport.TopLeftX = 0;
-		viewport.TopLeftY = 0;
-		viewport.MinDepth = 0;
-		viewport.MaxDepth = 1.0f;
+	void Game::GameLoop(const FrameState& state)
+	{
+		CpuProfileScope profileScope("Game loop");
+		PIXBeginEvent(m_commandQueue.Get(), PIX_COLOR_INDEX(0), "Frame %d", state.m_frameIndex);
+		Frame frame = GetNewFrame();
+		PIXBeginEvent(frame.m_commandList.Get(), PIX_COLOR_INDEX(0), "CMDList %d", frame.m_commandList.Get());
 
-		D3D12_RECT scissorRect;
-		scissorRect.top = 0;
-		scissorRect.bottom = m_bufferHeight;
-		scissorRect.left = 0;
-		scissorRect.right = m_bufferWidth;
+		// Resources moved by the defragmenter are switched before the frame graph imports them
+		m_defragmenter->Update(m_endOfFrameFence->GetCompletedValue(), frame.m_fenceValue);
 
-		frame.m_commandList->RSSetViewports(1, &viewport);
-		frame.m_commandList->RSSetScissorRects(1, &scissorRect);
+		m_frameGraph.Reset();
+		FrameGraphResource backBuffer = m_frameGraph.Import("Back buffer", frame.m_renderTarget.Get());
+		FrameGraphResource vertexBuffer = m_frameGraph.Import("Vertex buffer", m_resourceRegistry->GetResource(m_vertexBuffer));
+		FrameGraphResource texture = m_frameGraph.Import("Texture", m_resourceRegistry->GetResource(m_texture));
 
-		frame.m_commandList->SetPipelineState(m_pipelineState.Get());
-		frame.m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-		ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeap.Get() };
-		frame.m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-		frame.m_commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
-		frame.m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		frame.m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-		frame.m_commandList->DrawInstanced(3, 1, 0, 0);
+		// The scene is rendered in the top left corner of an internal target, only reallocated when the render size crosses a granularity step
+		m_renderWidth = (std::max)(1, (int)(m_bufferWidth * m_renderScale));
+		m_renderHeight = (std::max)(1, (int)(m_bufferHeight * m_renderScale));
+		m_frameRenderScales[m_currentFrame] = m_renderScale;
+		UINT targetWidth = (UINT)AlignUp(m_renderWidth, kRenderTargetGranularity);
+		UINT targetHeight = (UINT)AlignUp(m_renderHeight, kRenderTargetGranularity);
+		FrameGraphResource sceneColor = CreateTransientTexture("Scene color", targetWidth, targetHeight, DXGI_FORMAT_R8G8B8A8_UNORM, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
 
+		uint32_t trianglePass = m_frameGraph.AddPass("Triangle", [this, sceneColor](void* context)
+		{
+			ID3D12GraphicsCommandList* commandList = static_cast<ID3D12GraphicsCommandList*>(context);
+
+			D3D12_CPU_DESCRIPTOR_HANDLE renderTarget = m_transientRtvHeap->GetCPUHandle(GetTransientTexture(sceneColor)->m_rtvIndex);
+			commandList->OMSetRenderTargets(1, &renderTarget, FALSE, nullptr);
+
+			const float clearColor[4] = { 1.0f, 1.0f, 0.f, 1.0f };
+			commandList->ClearRenderTargetView(renderTarget, clearColor, 0, nullptr);
+
+			SetViewportAndScissor(commandList, m_renderWidth, m_renderHeight);
+
+			// Nothing is drawn until the pipeline is compiled
+			ID3D12PipelineState* pipelineState = m_pipelineCache->Get(m_pipelineKey);
+			if (pipelineState == nullptr)
+				return;
+
+			commandList->SetPipelineState(pipelineState);
+			commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+			ID3D12DescriptorHeap* ppHeaps[] = { m_descriptorHeap->GetHeap() };
+			commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+			commandList->SetGraphicsRootDescriptorTable(0, m_descriptorHeap->GetGPUHandle(0));
+
+			// Nothing is drawn either once the frame is out of constant memory
+			PerDrawConstants constants;
+			constants.TextureIndex = m_resourceRegistry->GetSrvIndex(m_texture);
+			D3D12_GPU_VIRTUAL_ADDRESS constantsAddress = m_constantAllocator->Write(constants);
+			if (constantsAddress == 0)
+				return;
+			commandList->SetGraphicsRootConstantBufferView(1, constantsAddress);
+
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+			commandList->DrawInstanced(3, 1, 0, 0);
+		});
+		m_frameGraph.Read(trianglePass, vertexBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		m_frameGraph.Read(trianglePass, texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		m_frameGraph.Write(trianglePass, sceneColor, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		uint32_t upscalePass = m_frameGraph.AddPass("Upscale", [this, &frame, sceneColor, targetWidth, targetHeight](void* context)
 		{
-			D3D12_RESOURCE_TRANSITION_BARRIER transition = {};
-			transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-			transition.pResource = frame.m_renderTarget.Get();
-			transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			ID3D12GraphicsCommandList* commandList = static_cast<ID3D12GraphicsCommandList*>(context);
+
+			commandList->OMSetRenderTargets(1, &frame.m_renderTargetsHandle, FALSE, nullptr);
+			SetViewportAndScissor(commandList, m_bufferWidth, m_bufferHeight);
+
+			UpscaleConstants constants;
+			constants.UVScale[0] = (float)m_renderWidth / targetWidth;
+			constants.UVScale[1] = (float)m_renderHeight / targetHeight;
+			constants.UVMin[0] = 0.5f / targetWidth;
+			constants.UVMin[1] = 0.5f / targetHeight;
+			constants.UVClamp[0] = (m_renderWidth - 0.5f) / targetWidth;
+			constants.UVClamp[1] = (m_renderHeight - 0.5f) / targetHeight;
+			constants.TextureIndex = GetTransientTexture(sceneColor)->m_srvIndex;
+
+			// The back buffer is cleared instead until the pipeline is compiled, or if the frame is out of constant memory
+			ID3D12PipelineState* pipelineState = m_pipelineCache->Get(m_upscalePipelineKey);
+			D3D12_GPU_VIRTUAL_ADDRESS constantsAddress = pipelineState != nullptr ? m_constantAllocator->Write(constants) : 0;
+			if (constantsAddress == 0)
+			{
+				const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				commandList->ClearRenderTargetView(frame.m_renderTargetsHandle, clearColor, 0, nullptr);
+				return;
+			}
 
-			D3D12_RESOURCE_BARRIER barrier = {};
-			barrier.Transition = transition;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			commandList->SetPipelineState(pipelineState);
+			commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+			ID3D12DescriptorHeap* ppHeaps[] = { m_descriptorHeap->GetHeap() };
+			commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+			commandList->SetGraphicsRootDescriptorTable(0, m_descriptorHeap->GetGPUHandle(0));
+			commandList->SetGraphicsRootConstantBufferView(1, constantsAddress);
 
-			frame.m_commandList->ResourceBarrier(1, &barrier);
-		}
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			commandList->DrawInstanced(3, 1, 0, 0);
+		});
+		m_frameGraph.Read(upscalePass, sceneColor, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_frameGraph.Write(upscalePass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		ExecuteFrameGraph(frame);
+
+		frame.m_stateTracker->Transition(frame.m_renderTarget.Get(), D3D12_RESOURCE_STATE_PRESENT);
+		m_defragmenter->TransitionSources(frame.m_stateTracker);
+		FlushBarriers(frame.m_commandList.Get(), frame.m_stateTracker);
+
+		// The frame begin timestamp is written by SubmitFrame, ahead of the pass command lists
+		m_gpuProfiler->EndFrame(frame.m_commandList.Get());
 
 		PIXEndEvent(frame.m_commandList.Get());
 		frame.m_commandList->Close();
-		ID3D12CommandList* commandLists[] = { frame.m_commandList.Get() };
-		m_commandQueue->ExecuteCommandLists(1, commandLists);
+
+		// Everything the frame uses has to be resident once it is submitted
+		m_residencyManager->MarkUsed(m_heapResidency, frame.m_fenceValue);
+		m_resourceRegistry->MarkUsed(m_residencyManager.get(), frame.m_fenceValue);
+		m_residencyManager->Update(m_endOfFrameFence->GetCompletedValue());
+
+		// Uploads queued during the frame are submitted now, the frame only waits for them GPU side
+		m_uploadQueue->WaitOnGPU(m_commandQueue.Get(), m_uploadQueue->Flush());
+
+		{
+			CpuProfileScope submitScope("Submit");
+			SubmitFrame(frame);
+		}
+		m_framePacingSample.m_submit = CpuProfiler::Now();
 
 		m_commandQueue->Signal(m_endOfFrameFence.Get(), frame.m_fenceValue); 
-		m_swapChain->Present(1, 0);
+		// The copies of the defragmenter run between this frame and the next one
+		UINT64 defragmentationTicket = m_defragmenter->Submit(m_endOfFrameFence.Get(), frame.m_fenceValue);
+		m_descriptorHeap->Submit(frame.m_fenceValue);
+		m_resourceRegistry->Submit(frame.m_fenceValue);
+		m_transientRtvHeap->Submit(frame.m_fenceValue);
+		{
+			CpuProfileScope presentScope("Present");
+			if (m_vsync)
+			{
+				m_swapChain->Present(1, 0);
+			}
+			else
+			{
+				// Tearing is not allowed in exclusive fullscreen, where presenting without vsync is immediate anyway
+				BOOL fullscreen = FALSE;
+				m_swapChain->GetFullscreenState(&fullscreen, nullptr);
+				m_swapChain->Present(0, m_tearingSupported && !fullscreen ? DXGI_PRESENT_ALLOW_TEARING : 0);
+			}
+		}
+		m_framePacingSample.m_present = CpuProfiler::Now();
+		m_pendingFramePacing[m_currentFrame] = m_framePacingSample;
+
+		// Only the next frame waits for the copies, queued after Present so this frame is not presented behind them
+		m_defragmenter->WaitOnGPU(m_commandQueue.Get(), defragmentationTicket);
 		
-		m_currentFrame = (m_currentFrame + 1) % kNumFrames;
+		m_currentFrame = (m_currentFrame + 1) % m_numFrames;
 		m_currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
 		m_frameCounter++;
 		PIXEndEvent(m_commandQueue.Get());
@@ -315,6 +833,13 @@ namespace Sigma {
 		ComPtr<IDXGIFactory3> factory;
 		CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory));
 
+		// Presenting without vsync in a window needs tearing support
+		BOOL allowTearing = FALSE;
+		ComPtr<IDXGIFactory5> factory5;
+		if (SUCCEEDED(factory.As(&factory5)))
+			factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing));
+		m_tearingSupported = allowTearing == TRUE;
+
 		// Enumerate all adapters
 		unsigned i = 0;
 		ComPtr<IDXGIAdapter1> adapter;
@@ -349,14 +874,25 @@ namespace Sigma {
 		if (selectedAdapter == nullptr)
 			return;
 
-		// Fetch memory information
-		{
-			DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo;
-			selectedAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo);
-			std::cout << memoryInfo.Budget << std::endl;
-		}
 		// Create logical device
 		D3D12CreateDevice(selectedAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_device));
+		m_residencyManager = std::make_unique<ResidencyManager>(m_device, selectedAdapter);
+
+		// Cached pipelines are only valid for the adapter and driver that compiled them
+		{
+			DXGI_ADAPTER_DESC1 adapterDesc;
+			selectedAdapter->GetDesc1(&adapterDesc);
+			LARGE_INTEGER driverVersion = {};
+			selectedAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+			PipelineHasher hasher;
+			hasher.AddValue(adapterDesc.VendorId);
+			hasher.AddValue(adapterDesc.DeviceId);
+			hasher.AddValue(adapterDesc.SubSysId);
+			hasher.AddValue(adapterDesc.Revision);
+			hasher.AddValue(driverVersion.QuadPart);
+			m_pipelineCache = std::make_unique<PipelineStateCache>(m_device, "PipelineCache.bin", hasher.Get());
+		}
 
 		// Create command queue
 		D3D12_COMMAND_QUEUE_DESC commandQueueDesc = {};
@@ -369,11 +905,9 @@ namespace Sigma {
 		copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 		copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
 		m_device->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(&m_copyQueue));
-		m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_copyCommandAllocator));
-		m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_copyCommandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_copyCommandList));
 
 
-		// Create swap chain, aiming for minimum latency with a waitable object and two frame buffer
+		// Create swap chain, aiming for minimum latency with a waitable object, and as many buffers as frames in flight
 		m_bufferWidth = m_windowWidth;
 		m_bufferHeight = m_windowHeight;
 		DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
@@ -381,21 +915,22 @@ namespace Sigma {
 		swapChainDesc.Height = m_bufferHeight;
 		swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		swapChainDesc.BufferCount = kNumBuffers;
+		swapChainDesc.BufferCount = m_numBuffers;
 		swapChainDesc.Stereo = false;
 		swapChainDesc.SampleDesc.Count = 1;
 		swapChainDesc.SampleDesc.Quality = 0;
-		swapChainDesc.Scaling = DXGI_SCALING_NONE;
+		// Stretched while a resize is pending, see RenderLoop
+		swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
 		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 		swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-		swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+		swapChainDesc.Flags = GetSwapChainFlags();
 
 		ComPtr<IDXGISwapChain1> swapChain1;
 		factory->CreateSwapChainForHwnd(m_commandQueue.Get(), m_hWindow, &swapChainDesc, nullptr, nullptr, swapChain1.GetAddressOf());
 
 		swapChain1.As(&m_swapChain);
 
-		m_swapChain->SetMaximumFrameLatency(kNumFrames);
+		m_swapChain->SetMaximumFrameLatency(m_numFrames);
 		m_swapChainWait = m_swapChain->GetFrameLatencyWaitableObject();
 
 		// Create render target views for the swap chain buffers
@@ -403,13 +938,13 @@ namespace Sigma {
 		rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 		rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 		rtvHeapDesc.NodeMask = 0;
-		rtvHeapDesc.NumDescriptors = kNumBuffers;
+		rtvHeapDesc.NumDescriptors = kMaxBuffers;
 		m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap));
 
 		unsigned rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
 
-		for (int i = 0; i < kNumBuffers; i++)
+		for (uint32_t i = 0; i < m_numBuffers; i++)
 		{
 			m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i]));
 			m_device->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHandle);
@@ -420,16 +955,24 @@ namespace Sigma {
 		// Create a command allocator for each frame (and a command list - we could create more than one)
 		// Command Allocator needs to be alive as long as the GPU is using it,
 		// so if we want two frames, we need one command allocator for the in-flight frame
-		// and one for the one we are building now
-		for (int i = 0; i < kNumFrames; i++)
+		// and one for the one we are building now. Slots are created up to the maximum number of frames in flight
+		for (int i = 0; i < kMaxFrames; i++)
 		{
 			// Create command allocator
 			m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[i]));
 
 			m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[i].Get(), nullptr, IID_PPV_ARGS(&m_commandLists[i]));
 			m_commandLists[i]->Close();
+
+			m_stateTrackers[i] = std::make_unique<ResourceStateTracker>(m_resourceStates);
+			m_frameSlotFenceValues[i] = 0;
 		}
 
+		// Frame graph passes are recorded by the job system threads, each one into its own command lists.
+		// The window thread creating it and the render thread each have their own index
+		m_jobSystem = std::make_unique<JobSystem>(0, 2);
+		m_commandListPool = std::make_unique<CommandListPool>(m_device, D3D12_COMMAND_LIST_TYPE_DIRECT, m_jobSystem->GetThreadCount(), kMaxFrames, m_resourceStates);
+
 		// Fence inserted at the end of the frame (before Present)
 		m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_endOfFrameFence));
 		m_lastSubmittedFrameFenceValue = 0;
@@ -440,24 +983,34 @@ namespace Sigma {
 		m_haltFenceValue = 0;
 		m_haltFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
-		m_currentFrame = m_swapChain->GetCurrentBackBufferIndex();
+		m_currentFrame = 0;
 		m_frameCounter = 0;
 
+		for (uint32_t i = 0; i < m_numBuffers; i++)
+		{
+			m_resourceStates.Register(m_renderTargets[i].Get(), 1, D3D12_RESOURCE_STATE_PRESENT);
+		}
+
 
 
 		// CREATE RESOURCES
-		/*
+		// Heap shared by the frame graph transient render targets
 		D3D12_HEAP_DESC heapDesc = {};
 		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-		heapDesc.SizeInBytes = 128 * 1024 * 1024; // 128 Mb
+		heapDesc.SizeInBytes = kTransientHeapSize;
 		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
 		heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
 		heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 		heapDesc.Properties.VisibleNodeMask = 0;
 		heapDesc.Properties.CreationNodeMask = 0;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
 		
 		m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heap));
-		*/
+		m_heapResidency = m_residencyManager->Register(m_heap.Get());
+
+		m_bufferAllocator = std::make_unique<GpuHeapAllocator>(m_device, m_residencyManager.get(), D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, kBufferHeapBlockSize);
+		m_textureAllocator = std::make_unique<GpuHeapAllocator>(m_device, m_residencyManager.get(), D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, kTextureHeapBlockSize);
+		m_defragmenter = std::make_unique<GpuDefragmenter>(m_device, m_copyQueue, m_residencyManager.get(), m_resourceStates, kDefragmentationBytesPerFrame);
 
 		D3D12_HEAP_DESC uploadHeapDesc = {};
 		uploadHeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
@@ -467,18 +1020,26 @@ namespace Sigma {
 		uploadHeapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 		uploadHeapDesc.Properties.VisibleNodeMask = 0;
 		uploadHeapDesc.Properties.CreationNodeMask = 0;
+		uploadHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
 
 		m_device->CreateHeap(&uploadHeapDesc, IID_PPV_ARGS(&m_uploadHeap));
-		m_uploadAllocator = std::make_unique<LinearHeapAllocator>(m_device, m_uploadHeap);
+		m_uploadQueue = std::make_unique<UploadQueue>(m_device, m_copyQueue, m_uploadHeap);
+		m_constantAllocator = std::make_unique<ConstantAllocator>(m_device, kMaxFrames, kFrameConstantsSize);
+		m_gpuProfiler = std::make_unique<GpuProfiler>(m_device, m_commandQueue, kMaxFrames, kMaxGpuScopes, kGpuTimingHistory);
+
 
+		m_descriptorHeap = std::make_unique<DescriptorHeap>(m_device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kNumDescriptors, kNumRangeDescriptors, true);
+		m_transientRtvHeap = std::make_unique<DescriptorHeap>(m_device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, kNumTransientRenderTargets, 0, false);
+		m_resourceRegistry = std::make_unique<ResourceRegistry>(m_device, m_resourceStates, *m_descriptorHeap);
 
+		// Bindless table covering the whole heap, most of it is not initialized so descriptors are volatile
 		D3D12_DESCRIPTOR_RANGE1 descRange = {};
 		descRange.BaseShaderRegister = 0;
 		descRange.RegisterSpace = 0;
-		descRange.NumDescriptors = kNumSRV;
+		descRange.NumDescriptors = UINT_MAX;
 		descRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 		descRange.OffsetInDescriptorsFromTableStart = 0;
-		descRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+		descRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
 
 		D3D12_ROOT_PARAMETER1 param = {};
 		param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
@@ -486,19 +1047,13 @@ namespace Sigma {
 		param.DescriptorTable.NumDescriptorRanges = 1;
 		param.DescriptorTable.pDescriptorRanges = &descRange;
 
-		D3D12_DESCRIPTOR_RANGE1 descRange1 = {};
-		descRange1.BaseShaderRegister = 0;
-		descRange1.RegisterSpace = 0;
-		descRange1.NumDescriptors = 1;
-		descRange1.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-		descRange1.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-		descRange1.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
-
+		// Per draw constants, bound by GPU address
 		D3D12_ROOT_PARAMETER1 param1 = {};
-		param1.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		param1.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 		param1.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		param1.DescriptorTable.NumDescriptorRanges = 1;
-		param1.DescriptorTable.pDescriptorRanges = &descRange1;
+		param1.Descriptor.ShaderRegister = 0;
+		param1.Descriptor.RegisterSpace = 0;
+		param1.Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
 
 		D3D12_STATIC_SAMPLER_DESC staticSampler = {};
 		staticSampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
@@ -525,6 +1080,14 @@ namespace Sigma {
 			char* buffer = (char*)errorBlob->GetBufferPointer();
 		}
 		m_device->CreateRootSignature(0, outputBlob->GetBufferPointer(), outputBlob->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
+		m_pipelineCache->AddRootSignature(m_rootSignature.Get(), outputBlob.Get());
+
+		// Assets are used in place in the mapping, which stays open for the lifetime of the game. Other files go through the I/O service
+		m_ioService = std::make_unique<IoService>(kIoQueueDepth, kMaxIoInFlightBytes);
+		if (IsAssetArchiveOutdated() && !BuildAssetArchive(m_jobSystem.get(), m_ioService.get()))
+			OutputDebugString("Asset archive could not be built from the loose files\n");
+		if (!m_assetArchive.Open(kAssetArchivePath))
+			OutputDebugString("Asset archive could not be opened\n");
 
 		D3D12_INPUT_ELEMENT_DESC inputDescPos = {};
 		inputDescPos.SemanticName = "POSITION";
@@ -546,25 +1109,11 @@ namespace Sigma {
 
 		D3D12_INPUT_ELEMENT_DESC inputs[] = { inputDescPos, inputDescUV };
 
-		HANDLE hFile = CreateFile("PixelShader.cso", GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-		LARGE_INTEGER  size;
-		GetFileSizeEx(hFile, &size);
-		std::vector<char> pixelShaderBuffer(size.QuadPart);
-		DWORD byteReadPS;
-		ReadFile(hFile, pixelShaderBuffer.data(), (DWORD)size.QuadPart, &byteReadPS, nullptr);
-
-		hFile = CreateFile("VertexShader.cso", GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-		GetFileSizeEx(hFile, &size);
-		std::vector<char> vertexShaderBuffer(size.QuadPart);
-		DWORD byteReadVS;
-		ReadFile(hFile, vertexShaderBuffer.data(), (DWORD)size.QuadPart, &byteReadVS, nullptr);
 
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
 		desc.pRootSignature = m_rootSignature.Get();
-		desc.VS.pShaderBytecode = vertexShaderBuffer.data();
-		desc.VS.BytecodeLength = vertexShaderBuffer.size();
-		desc.PS.pShaderBytecode = pixelShaderBuffer.data();
-		desc.PS.BytecodeLength = pixelShaderBuffer.size();
+		desc.VS = GetShaderBytecode(m_assetArchive, "VertexShader.cso");
+		desc.PS = GetShaderBytecode(m_assetArchive, "PixelShader.cso");
 		desc.NumRenderTargets = 1;
 		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 		desc.DSVFormat = DXGI_FORMAT_UNKNOWN;
@@ -579,7 +1128,16 @@ namespace Sigma {
 		desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED | D3D12_COLOR_WRITE_ENABLE_GREEN | D3D12_COLOR_WRITE_ENABLE_BLUE;
 
-		m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_pipelineState));
+		// Compiled in the background, or loaded from the cache of a previous run
+		m_pipelineKey = m_pipelineCache->RequestGraphicsPipeline(desc);
+
+		// Fullscreen triangle generated from SV_VertexID, no input layout
+		desc.VS = GetShaderBytecode(m_assetArchive, "FullscreenVS.cso");
+		desc.PS = GetShaderBytecode(m_assetArchive, "UpscalePS.cso");
+		desc.InputLayout.NumElements = 0;
+		desc.InputLayout.pInputElementDescs = nullptr;
+		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		m_upscalePipelineKey = m_pipelineCache->RequestGraphicsPipeline(desc);
 				
 		// Create the vertex buffer.
 		{
@@ -607,298 +1165,393 @@ namespace Sigma {
 			resDesc.Format = DXGI_FORMAT_UNKNOWN;
 			resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-
-			ComPtr<ID3D12Resource> uploadBuffer;
-
-			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
-			UINT64 uploadBufferSize;
-			UINT numRows;
-			UINT64 rowSizeInBytes;
-
-			m_device->GetCopyableFootprints(&resDesc, 0, 1, 0, &footprint, &numRows, &rowSizeInBytes, &uploadBufferSize);
-
-			D3D12_RESOURCE_DESC copyBufDesc;
-			copyBufDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-			copyBufDesc.Height = 1;
-			copyBufDesc.DepthOrArraySize = 1;
-			copyBufDesc.MipLevels = 1;
-			copyBufDesc.SampleDesc.Count = 1;
-			copyBufDesc.SampleDesc.Quality = 0;
-			copyBufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-			copyBufDesc.Width = uploadBufferSize;
-			copyBufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-			copyBufDesc.Format = DXGI_FORMAT_UNKNOWN;
-			copyBufDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-			uploadBuffer.Attach(m_uploadAllocator->Allocate(&copyBufDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr));
-
-			
-			D3D12_HEAP_PROPERTIES heapProps;
-			heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-			heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			heapProps.CreationNodeMask = 0;
-			heapProps.VisibleNodeMask = 0;
-
-			m_device->CreateCommittedResource(
-				&heapProps,
-				D3D12_HEAP_FLAG_NONE,
-				&resDesc,
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				nullptr,
-				IID_PPV_ARGS(&m_vertexBuffer));
+			m_vertexBuffer = m_resourceRegistry->Create(*m_bufferAllocator, resDesc, D3D12_RESOURCE_STATE_COMMON, nullptr);
 
 			// Copy the triangle data to the vertex buffer.
-			UINT8* pVertexDataBegin;
-			D3D12_RANGE readRange{ 0, 0 };
-			uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin));
-			memcpy(pVertexDataBegin, triangleVertices, sizeof(triangleVertices));
-			uploadBuffer->Unmap(0, nullptr);
-
-
-			m_copyCommandList->CopyBufferRegion(m_vertexBuffer.Get(), 0, uploadBuffer.Get(), 0, uploadBufferSize);
-			m_copyCommandList->Close();
-			ID3D12CommandList* commandLists[] = { m_copyCommandList.Get() };
-			m_copyQueue->ExecuteCommandLists(1, commandLists);
-
-			WaitForGPUCopy();
-
-			m_uploadAllocator->Reset();
-			m_copyCommandAllocator->Reset();
-			m_copyCommandList->Reset(m_copyCommandAllocator.Get(), nullptr);
-
-			{
-				// This could be done at the beginning of the next "real" frame instead of here
-				m_commandLists[0]->Reset(m_commandAllocators[0].Get(), nullptr);
-				D3D12_RESOURCE_BARRIER barrier = {};
-				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-				barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-				barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
-				barrier.Transition.pResource = m_vertexBuffer.Get();
-				barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-				m_commandLists[0]->ResourceBarrier(1, &barrier);
-				m_commandLists[0]->Close();
-				ID3D12CommandList* commandLists[] = { m_commandLists[0].Get() };
-				m_commandQueue->ExecuteCommandLists(1, commandLists);
-			}
-
+			m_uploadQueue->UploadBuffer(m_resourceRegistry->GetResource(m_vertexBuffer), 0, triangleVertices, vertexBufferSize);
 
 			// Initialize the vertex buffer view.
-			m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+			m_vertexBufferView.BufferLocation = m_resourceRegistry->GetResource(m_vertexBuffer)->GetGPUVirtualAddress();
 			m_vertexBufferView.StrideInBytes = sizeof(float) * 5;
 			m_vertexBufferView.SizeInBytes = vertexBufferSize;
 		}
 
 		// Create Texture
 		{
-			D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-			srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-			srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-			srvHeapDesc.NodeMask = 0;
-			srvHeapDesc.NumDescriptors = kNumSRV + 1;
-			m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap));
+			// Cooked when the archive was built, copied from the mapping straight into upload memory
+			AssetSpan asset = FindAsset(m_assetArchive, kTextureAsset);
+			std::vector<uint8_t> cooked;
+			CookedTexture texture;
+			if (!ReadCookedTexture(asset.m_data, asset.m_size, texture))
+			{
+				// Without archive, cooked again at load time
+				CookDefaultTexture(m_jobSystem.get(), cooked);
+				ReadCookedTexture(cooked.data(), cooked.size(), texture);
+			}
+			const CookedTextureHeader& header = *texture.m_header;
+			m_texture = CreateTexture2D(*m_resourceRegistry, *m_textureAllocator, header.m_width, header.m_height, header.m_mipLevels, GetDxgiFormat(header.m_format, header.m_srgb != 0));
+			m_uploadQueue->UploadTexture(m_resourceRegistry->GetResource(m_texture), texture);
 
-			m_textureRes.Attach(CreateTexture2D(m_device.Get(), 128, 128));
+			CreateTextureView();
+		}
 
-			ComPtr<ID3D12Resource> uploadBuffer;
+		// Submit all uploads at once, the direct queue waits for them GPU side
+		UINT64 uploadTicket = m_uploadQueue->Flush();
+		m_uploadQueue->WaitOnGPU(m_commandQueue.Get(), uploadTicket);
 
-			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
-			UINT64 uploadBufferSize;
-			UINT numRows;
-			UINT64 rowSizeInBytes;
-				
-			m_device->GetCopyableFootprints(&m_textureRes->GetDesc(), 0, 1, 0, &footprint, &numRows, &rowSizeInBytes, &uploadBufferSize);
-
-			D3D12_RESOURCE_DESC bufDesc;
-			bufDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-			bufDesc.Height = 1;
-			bufDesc.DepthOrArraySize = 1;
-			bufDesc.MipLevels = 1;
-			bufDesc.SampleDesc.Count = 1;
-			bufDesc.SampleDesc.Quality = 0;
-			bufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-			bufDesc.Width = uploadBufferSize;
-			bufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-			bufDesc.Format = DXGI_FORMAT_UNKNOWN;
-			bufDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-				
-			uploadBuffer.Attach(m_uploadAllocator->Allocate(&bufDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr));
+		// Frames in flight keep using the previous resources and views, they are released once they complete
+		m_defragmenter->Register(m_bufferAllocator.get(), m_resourceRegistry->GetResource(m_vertexBuffer), m_resourceRegistry->GetAllocation(m_vertexBuffer), [this](ID3D12Resource* resource, const GpuAllocation& allocation)
+		{
+			m_resourceRegistry->Replace(m_vertexBuffer, resource, allocation);
+			m_vertexBufferView.BufferLocation = resource->GetGPUVirtualAddress();
+		});
+		m_defragmenter->Register(m_textureAllocator.get(), m_resourceRegistry->GetResource(m_texture), m_resourceRegistry->GetAllocation(m_texture), [this](ID3D12Resource* resource, const GpuAllocation& allocation)
+		{
+			m_resourceRegistry->Replace(m_texture, resource, allocation);
+			CreateTextureView();
+		});
+	}
+
+	void Game::CreateTextureView()
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Format = m_resourceRegistry->GetDesc(m_texture).Format;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MipLevels = -1;
+
+		// The previous descriptor is only recycled once the frames reading it are done
+		m_resourceRegistry->CreateShaderResourceView(m_texture, &srvDesc);
+	}
+
+	void Game::CleanD3D()
+	{
+		WaitForGPU();
+		WaitForGPUCopy();
+
+		m_pipelineCache->Save();
+	}
 
-			std::vector<int> pixels;
-			for (int i = 0; i < 128; i++)
+	void Game::ResizeSwapChainBuffers()
+	{
+		CpuProfileScope profileScope("Resize swap chain");
+		// To resize the swap chain buffers, we need to stop submitting commands to their
+		// associated command allocators and wait for the GPU to finish everything (including Present call)
+		WaitForGPU();
+		
+		for (int i = 0; i < kMaxFrames; i++)
+		{
+			DXSafeCall(m_commandAllocators[i]->Reset());
+		}
+
+		for (int i = 0; i < kMaxBuffers; i++)
+		{
+			if (m_renderTargets[i] != nullptr)
 			{
-				for (int j = 0; j < 128; j++)
-				{
-					pixels.push_back(rand() << 8 | rand());
-				}
+				m_resourceStates.Unregister(m_renderTargets[i].Get());
+				m_renderTargets[i].Reset();
 			}
+		}
 
-			FillBuffer(uploadBuffer.Get(), m_textureRes.Get(), footprint.Footprint.RowPitch, (char*)pixels.data());
-
-			D3D12_TEXTURE_COPY_LOCATION Dst = {};
-			Dst.pResource = m_textureRes.Get();
-			Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-			Dst.SubresourceIndex = 0;
+		// Also called to change the buffer count, keep the current size while minimized
+		if (m_windowWidth > 0 && m_windowHeight > 0)
+		{
+			m_bufferWidth = m_windowWidth;
+			m_bufferHeight = m_windowHeight;
+		}
 
-			D3D12_TEXTURE_COPY_LOCATION Src = {};
-			Src.pResource = uploadBuffer.Get();
-			Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-			Src.PlacedFootprint = footprint;
+		DXSafeCall(m_swapChain->ResizeBuffers(m_numBuffers, m_bufferWidth, m_bufferHeight, DXGI_FORMAT_UNKNOWN, GetSwapChainFlags()));
 
-			m_copyCommandList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
-			m_copyCommandList->Close();
-			ID3D12CommandList* commandLists[] = { m_copyCommandList.Get() };
-			m_copyQueue->ExecuteCommandLists(1, commandLists);
+		unsigned rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
 
-			WaitForGPUCopy();
+		for (uint32_t i = 0; i < m_numBuffers; i++)
+		{
+			m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i]));
+			m_device->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHandle);
+			m_renderTargetsHandles[i] = rtvHandle;
+			rtvHandle.ptr += rtvDescriptorSize;
 
-			m_uploadAllocator->Reset();
-			m_copyCommandAllocator->Reset();
-			m_copyCommandList->Reset(m_copyCommandAllocator.Get(), nullptr);
+			m_resourceStates.Register(m_renderTargets[i].Get(), 1, D3D12_RESOURCE_STATE_PRESENT);
+		}
 
-			{
 
-				m_commandLists[0]->Reset(m_commandAllocators[0].Get(), nullptr);
-				// This could be done at the beginning of the next "real" frame instead of here
-				D3D12_RESOURCE_BARRIER barrier = {};
-				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-				barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-				barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
-				barrier.Transition.pResource = m_textureRes.Get();
-				barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-				m_commandLists[0]->ResourceBarrier(1, &barrier);
-				m_commandLists[0]->Close();
-				ID3D12CommandList* commandLists[] = { m_commandLists[0].Get() };
-				m_commandQueue->ExecuteCommandLists(1, commandLists);
-			}
+		m_currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
+	}
 
-			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-			srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			srvDesc.Texture2D.MipLevels = -1;
+	void Game::SetLatencyMode(const LatencyMode& mode)
+	{
+		CpuProfileScope profileScope("Set latency mode");
+		m_vsync = mode.m_vsync;
+		uint32_t numFrames = (std::max)(1u, (std::min)(mode.m_framesInFlight, (uint32_t)kMaxFrames));
+		if (numFrames == m_numFrames)
+			return;
 
-			m_device->CreateShaderResourceView(m_textureRes.Get(), &srvDesc, m_srvHeap->GetCPUDescriptorHandleForHeapStart());
+		// Every frame in flight is retired, oldest first, so the frame slots can be renumbered
+		WaitForGPU();
+		for (uint32_t i = 0; i < m_numFrames; i++)
+		{
+			RetireFrameSlot((m_currentFrame + i) % m_numFrames);
+		}
+		m_currentFrame = 0;
 
-			// Null Descriptors
-			for (uint32_t i = 1; i < kNumSRV; i++)
-			{
-				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-				srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				srvDesc.Texture2D.MipLevels = -1;
+		// Flip model swap chains need at least two buffers
+		m_numFrames = numFrames;
+		m_numBuffers = (std::max)(2u, numFrames);
+		m_swapChain->SetMaximumFrameLatency(m_numFrames);
+		ResizeSwapChainBuffers();
+	}
 
-				D3D12_CPU_DESCRIPTOR_HANDLE nullSrvHandle;
-				nullSrvHandle.ptr = m_srvHeap->GetCPUDescriptorHandleForHeapStart().ptr + i * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	UINT Game::GetSwapChainFlags() const
+	{
+		// The flags have to be the same when the buffers are resized
+		return DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT | (m_tearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+	}
 
-				m_device->CreateShaderResourceView(nullptr, &srvDesc, nullSrvHandle);
-			}
+	FrameGraphResource Game::CreateTransientTexture(const char* name, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags)
+	{
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Alignment = 0;
+		desc.Width = width;
+		desc.Height = height;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		desc.Flags = flags;
+
+		D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+
+		TransientResourceDesc transientDesc;
+		transientDesc.m_width = width;
+		transientDesc.m_height = height;
+		transientDesc.m_format = format;
+		transientDesc.m_flags = flags;
+		transientDesc.m_size = info.SizeInBytes;
+		transientDesc.m_alignment = info.Alignment;
+		return m_frameGraph.CreateTransient(name, transientDesc);
+	}
 
-			// Create constant buffer
+	const TransientTexture* Game::GetTransientTexture(FrameGraphResource resource) const
+	{
+		void* physical = m_frameGraph.GetPhysicalResource(resource);
+		for (const TransientTexture& transient : m_transientTextures)
+		{
+			if (transient.m_resource.Get() == physical)
+				return &transient;
+		}
+		return nullptr;
+	}
 
-			struct DrawConstantBuffer
-			{
-				int TextureIndex;
-			};
+	// Compiles the frame graph, places its transient resources in m_heap and records its live passes
+	void Game::ExecuteFrameGraph(Frame& frame)
+	{
+		ProfileScopedEvent(PIX_COLOR_INDEX(4), "Frame graph");
+		m_frameGraph.Compile();
 
-			{
-				D3D12_RESOURCE_DESC resDesc;
-				resDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-				resDesc.Height = 1;
-				resDesc.DepthOrArraySize = 1;
-				resDesc.MipLevels = 1;
-				resDesc.SampleDesc.Count = 1;
-				resDesc.SampleDesc.Quality = 0;
-				resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-				resDesc.Width = (sizeof(DrawConstantBuffer) + 255) & ~255; // align to 256 bytes
-				resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-				resDesc.Format = DXGI_FORMAT_UNKNOWN;
-				resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		if (m_frameGraph.GetHeapSize() > kTransientHeapSize)
+		{
+			OutputDebugString("Frame graph transient resources do not fit in the transient heap\n");
+			return;
+		}
 
-				D3D12_HEAP_PROPERTIES heapProps;
-				heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-				heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-				heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-				heapProps.CreationNodeMask = 0;
-				heapProps.VisibleNodeMask = 0;
+		// Placed resources are kept from frame to frame as long as the same desc lands at the same offset
+		const std::vector<FrameGraphResourceNode>& resources = m_frameGraph.GetResources();
+		for (FrameGraphResource i = 0; i < resources.size(); i++)
+		{
+			const FrameGraphResourceNode& node = resources[i];
+			if (node.m_imported || node.m_heapOffset == kInvalidOffset)
+				continue;
 
-				m_device->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&resDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&m_ConstantBuffer));
+			TransientTexture* transient = nullptr;
+			for (TransientTexture& candidate : m_transientTextures)
+			{
+				if (candidate.m_heapOffset == node.m_heapOffset && memcmp(&candidate.m_desc, &node.m_desc, sizeof(TransientResourceDesc)) == 0)
+				{
+					transient = &candidate;
+					break;
+				}
+			}
 
+			if (transient == nullptr)
+			{
+				D3D12_RESOURCE_DESC desc = {};
+				desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+				desc.Alignment = node.m_desc.m_alignment;
+				desc.Width = node.m_desc.m_width;
+				desc.Height = node.m_desc.m_height;
+				desc.DepthOrArraySize = 1;
+				desc.MipLevels = 1;
+				desc.Format = static_cast<DXGI_FORMAT>(node.m_desc.m_format);
+				desc.SampleDesc.Count = 1;
+				desc.SampleDesc.Quality = 0;
+				desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+				desc.Flags = static_cast<D3D12_RESOURCE_FLAGS>(node.m_desc.m_flags);
+
+				TransientTexture newTransient;
+				newTransient.m_desc = node.m_desc;
+				newTransient.m_heapOffset = node.m_heapOffset;
+				m_device->CreatePlacedResource(m_heap.Get(), node.m_heapOffset, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&newTransient.m_resource));
+				m_resourceStates.Register(newTransient.m_resource.Get(), 1, D3D12_RESOURCE_STATE_COMMON);
+
+				newTransient.m_rtvIndex = kInvalidDescriptorIndex;
+				if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+					newTransient.m_rtvIndex = m_transientRtvHeap->Allocate();
+				newTransient.m_srvIndex = m_descriptorHeap->Allocate();
+
+				bool rtvMissing = (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) && newTransient.m_rtvIndex == kInvalidDescriptorIndex;
+				if (rtvMissing || newTransient.m_srvIndex == kInvalidDescriptorIndex)
+				{
+					// Not used by the GPU yet, freed indices only come back once the current frame is done anyway
+					OutputDebugString("Out of descriptors for frame graph transient resources\n");
+					m_resourceStates.Unregister(newTransient.m_resource.Get());
+					m_transientRtvHeap->Free(newTransient.m_rtvIndex);
+					m_descriptorHeap->Free(newTransient.m_srvIndex);
+					return;
+				}
 
-				DrawConstantBuffer ConstantBuffer;
-				ConstantBuffer.TextureIndex = 0;
+				if (newTransient.m_rtvIndex != kInvalidDescriptorIndex)
+					m_device->CreateRenderTargetView(newTransient.m_resource.Get(), nullptr, m_transientRtvHeap->GetCPUHandle(newTransient.m_rtvIndex));
+				m_device->CreateShaderResourceView(newTransient.m_resource.Get(), nullptr, m_descriptorHeap->GetCPUHandle(newTransient.m_srvIndex));
 
-				UINT8* pConstantDataBegin;
-				D3D12_RANGE readRange{ 0, 0 };
-				m_ConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pConstantDataBegin));
-				memcpy(pConstantDataBegin, &ConstantBuffer, sizeof(DrawConstantBuffer));
-				m_ConstantBuffer->Unmap(0, nullptr);
+				m_transientTextures.push_back(newTransient);
+				transient = &m_transientTextures.back();
+			}
 
-				D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-				cbvDesc.BufferLocation = m_ConstantBuffer->GetGPUVirtualAddress();
-				cbvDesc.SizeInBytes = (sizeof(DrawConstantBuffer) + 255) & ~255; // align to 256 bytes
+			transient->m_lastUsedFrame = m_frameCounter;
+			m_frameGraph.SetPhysicalResource(i, transient->m_resource.Get());
+		}
 
-				D3D12_CPU_DESCRIPTOR_HANDLE cbvHandle;
-				cbvHandle.ptr = m_srvHeap->GetCPUDescriptorHandleForHeapStart().ptr + kNumSRV * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-				m_device->CreateConstantBufferView(&cbvDesc, cbvHandle);
+		// Release placed resources the GPU can no longer be using
+		for (size_t i = 0; i < m_transientTextures.size();)
+		{
+			if (m_transientTextures[i].m_lastUsedFrame + m_numFrames < m_frameCounter)
+			{
+				m_resourceStates.Unregister(m_transientTextures[i].m_resource.Get());
+				m_transientRtvHeap->Free(m_transientTextures[i].m_rtvIndex);
+				m_descriptorHeap->Free(m_transientTextures[i].m_srvIndex);
+				m_transientTextures[i] = m_transientTextures.back();
+				m_transientTextures.pop_back();
+			}
+			else
+			{
+				i++;
 			}
 		}
 
-		WaitForGPU();
-	}
+		// Every live pass records into its own command list, on whichever thread picks up its job.
+		// Lists are submitted in pass order, their state trackers resolve against each other at submit
+		std::vector<uint32_t> livePasses;
+		const std::vector<FrameGraphPass>& passes = m_frameGraph.GetPasses();
+		for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+		{
+			if (!passes[passIndex].m_culled)
+				livePasses.push_back(passIndex);
+		}
 
-	void Game::CleanD3D()
-	{
-		WaitForGPU();
-		WaitForGPUCopy();
+		frame.m_passCommandLists.resize(livePasses.size());
+		JobCounter counter;
+		for (size_t i = 0; i < livePasses.size(); i++)
+		{
+			m_jobSystem->Run([this, &frame, &livePasses, i]()
+			{
+				PooledCommandList* commandList = m_commandListPool->Acquire(m_currentFrame, JobSystem::GetThreadIndex());
+				RecordPass(commandList->m_commandList.Get(), commandList->m_stateTracker.get(), livePasses[i]);
+				commandList->m_commandList->Close();
+				frame.m_passCommandLists[i] = commandList;
+			}, &counter);
+		}
+		m_jobSystem->Wait(counter);
 	}
 
-	void Game::ResizeSwapChainBuffers()
+	void Game::RecordPass(ID3D12GraphicsCommandList* commandList, ResourceStateTracker* stateTracker, uint32_t passIndex)
 	{
-		// To resize the swap chain buffers, we need to stop submitting commands to their
-		// associated command allocators and wait for the GPU to finish everything (including Present call)
-		WaitForGPU();
-		
-		for (int i = 0; i < kNumFrames; i++)
+		const std::vector<FrameGraphResourceNode>& resources = m_frameGraph.GetResources();
+		const FrameGraphPass& pass = m_frameGraph.GetPasses()[passIndex];
+
+		CpuProfileScope profileScope("Record pass");
+		PIXBeginEvent(commandList, PIX_COLOR_INDEX(5), pass.m_name.c_str());
+		uint32_t gpuScope = m_gpuProfiler->BeginScope(commandList, pass.m_name.c_str());
+
+		// Transient resources sharing memory have to be activated before their first use
+		std::vector<D3D12_RESOURCE_BARRIER> aliasingBarriers;
+		for (FrameGraphResource resource : pass.m_firstUses)
 		{
-			DXSafeCall(m_commandAllocators[i]->Reset());
+			if (resources[resource].m_aliased)
+			{
+				D3D12_RESOURCE_BARRIER barrier = {};
+				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+				barrier.Aliasing.pResourceBefore = nullptr;
+				barrier.Aliasing.pResourceAfter = static_cast<ID3D12Resource*>(resources[resource].m_physical);
+				aliasingBarriers.push_back(barrier);
+			}
+		}
+		if (!aliasingBarriers.empty())
+		{
+			FlushBarriers(commandList, stateTracker);
+			commandList->ResourceBarrier((UINT)aliasingBarriers.size(), aliasingBarriers.data());
 		}
 
-		for (int i = 0; i < kNumBuffers; i++)
+		for (const FrameGraphAccess& access : pass.m_accesses)
 		{
-			if (m_renderTargets[i] != nullptr)
+			stateTracker->Transition(resources[access.m_resource].m_physical, access.m_state);
+		}
+		FlushBarriers(commandList, stateTracker);
+
+		// Aliased memory content is undefined, render targets must be discarded (or cleared) before use
+		for (const FrameGraphAccess& access : pass.m_accesses)
+		{
+			const FrameGraphResourceNode& node = resources[access.m_resource];
+			if (node.m_aliased && node.m_firstPass == passIndex &&
+				(access.m_state == D3D12_RESOURCE_STATE_RENDER_TARGET || access.m_state == D3D12_RESOURCE_STATE_DEPTH_WRITE))
 			{
-				m_renderTargets[i].Reset();
+				commandList->DiscardResource(static_cast<ID3D12Resource*>(node.m_physical), nullptr);
 			}
 		}
 
-		m_bufferWidth = m_windowWidth;
-		m_bufferHeight = m_windowHeight;
+		pass.m_execute(commandList);
 
-		DXSafeCall(m_swapChain->ResizeBuffers(kNumBuffers, m_bufferWidth, m_bufferHeight, DXGI_FORMAT_UNKNOWN, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT));
+		m_gpuProfiler->EndScope(commandList, gpuScope);
+		PIXEndEvent(commandList);
+	}
 
-		unsigned rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
+	// Executes the pass command lists then the frame one, each preceded by the transitions it needs from the state
+	// the previous lists left resources in. Everything goes in a single ExecuteCommandLists
+	void Game::SubmitFrame(Frame& frame)
+	{
+		std::vector<ID3D12CommandList*> commandLists;
+		std::vector<StateTransition> transitions;
 
-		for (int i = 0; i < kNumBuffers; i++)
+		PooledCommandList* timestampCommandList = m_commandListPool->Acquire(m_currentFrame, JobSystem::GetThreadIndex());
+		m_gpuProfiler->WriteFrameBegin(timestampCommandList->m_commandList.Get());
+		timestampCommandList->m_commandList->Close();
+		commandLists.push_back(timestampCommandList->m_commandList.Get());
+
+		auto addCommandList = [&](ID3D12GraphicsCommandList* commandList, ResourceStateTracker* stateTracker)
 		{
-			m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i]));
-			m_device->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHandle);
-			m_renderTargetsHandles[i] = rtvHandle;
-			rtvHandle.ptr += rtvDescriptorSize;
-		}
+			transitions.clear();
+			stateTracker->ResolvePendingTransitions(m_resourceStates, transitions);
 
+			if (!transitions.empty())
+			{
+				PooledCommandList* barrierCommandList = m_commandListPool->Acquire(m_currentFrame, JobSystem::GetThreadIndex());
+				RecordBarriers(barrierCommandList->m_commandList.Get(), transitions);
+				barrierCommandList->m_commandList->Close();
+				commandLists.push_back(barrierCommandList->m_commandList.Get());
+			}
+			commandLists.push_back(commandList);
+		};
 
-		m_currentBuffer = m_swapChain->GetCurrentBackBufferIndex();
+		for (PooledCommandList* passCommandList : frame.m_passCommandLists)
+		{
+			addCommandList(passCommandList->m_commandList.Get(), passCommandList->m_stateTracker.get());
+		}
+		addCommandList(frame.m_commandList.Get(), frame.m_stateTracker);
+
+		m_commandQueue->ExecuteCommandLists((UINT)commandLists.size(), commandLists.data());
 	}
 
 	// Blocking call - Waits for the GPU to complete all of its work submitted until now
@@ -937,45 +1590,93 @@ namespace Sigma {
 			hdc = BeginPaint(hWnd, &ps);
 			EndPaint(hWnd, &ps);
 			break;
+		case WM_CLOSE:
+			// The window is destroyed by Run once the render thread is done with it
+			PushWindowEvent(WindowEventType::Quit, 0, 0);
+			break;
+		case kSetOverlayTitleMessage:
+		{
+			std::lock_guard<std::mutex> lock(m_overlayTitleMutex);
+			SetWindowText(hWnd, m_overlayTitle.c_str());
+			break;
+		}
 		case WM_DESTROY:
 			m_hWindow = nullptr;
 			PostQuitMessage(0);
 			break;
 		case WM_SIZE:
-		{
-			int nWidth = LOWORD(lParam);
-			int nHeight = HIWORD(lParam);
-			m_windowWidth = nWidth;
-			m_windowHeight = nHeight;
+			PushWindowEvent(WindowEventType::Resize, LOWORD(lParam), HIWORD(lParam));
+			break;
+		case WM_ENTERSIZEMOVE:
+			PushWindowEvent(WindowEventType::SizeMoveBegin, 0, 0);
+			break;
+		case WM_EXITSIZEMOVE:
+			PushWindowEvent(WindowEventType::SizeMoveEnd, 0, 0);
 			break;
-		}
 		case WM_MOUSEMOVE:
-		{
+			PushWindowEvent(WindowEventType::MouseMove, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 			break;
-		}
 		case WM_LBUTTONDOWN:
+			PushWindowEvent(WindowEventType::MouseButtonDown, 0, 0);
 			break;
 		case WM_LBUTTONUP:
+			PushWindowEvent(WindowEventType::MouseButtonUp, 0, 0);
 			break;
 		case WM_RBUTTONDOWN:
+			PushWindowEvent(WindowEventType::MouseButtonDown, 1, 0);
 			break;
 		case WM_RBUTTONUP:
+			PushWindowEvent(WindowEventType::MouseButtonUp, 1, 0);
 			break;
 		case WM_MBUTTONDOWN:
+			PushWindowEvent(WindowEventType::MouseButtonDown, 2, 0);
 			break;
 		case WM_MBUTTONUP:
+			PushWindowEvent(WindowEventType::MouseButtonUp, 2, 0);
 			break;
 		case WM_KEYDOWN:
+			PushWindowEvent(WindowEventType::KeyDown, static_cast<UINT8>(wParam), 0);
 			break;
 		case WM_KEYUP:
 		{
 			UINT8 keyCode = static_cast<UINT8>(wParam);
 			if (keyCode == VK_SPACE)
 			{
-				BOOL fullscreenState = false;
-				m_swapChain->GetFullscreenState(&fullscreenState, nullptr);
-				m_swapChain->SetFullscreenState(!fullscreenState, nullptr);
+				PushWindowEvent(WindowEventType::ToggleFullscreen, 0, 0);
+			}
+			else if (keyCode == VK_F2)
+			{
+				PushWindowEvent(WindowEventType::ToggleFrameTimeTrace, 0, 0);
+			}
+			else if (keyCode == VK_F3)
+			{
+				PushWindowEvent(WindowEventType::ToggleDynamicResolution, 0, 0);
+			}
+			else if (keyCode == VK_F4)
+			{
+				PushWindowEvent(WindowEventType::PrintGpuTimings, 0, 0);
+			}
+			else if (keyCode == VK_F5)
+			{
+				PushWindowEvent(WindowEventType::WriteCpuTrace, 0, 0);
+			}
+			else if (keyCode == VK_F6)
+			{
+				PushWindowEvent(WindowEventType::WriteFramePacing, 0, 0);
+			}
+			else if (keyCode == VK_F7)
+			{
+				PushWindowEvent(WindowEventType::CycleFramesInFlight, 0, 0);
+			}
+			else if (keyCode == VK_F8)
+			{
+				PushWindowEvent(WindowEventType::ToggleVSync, 0, 0);
+			}
+			else if (keyCode == VK_F9)
+			{
+				PushWindowEvent(WindowEventType::RunLatencyBenchmark, 0, 0);
 			}
+			PushWindowEvent(WindowEventType::KeyUp, keyCode, 0);
 			break;
 		}
 		default:
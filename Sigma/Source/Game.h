@@ -1,24 +1,102 @@
 #pragma once
 
 #include "stdafx.h"
+#include <chrono>
+#include <mutex>
 #include <vector>
-#include "Allocator.h"
+#include "UploadQueue.h"
+#include "ResourceStateTracker.h"
+#include "FrameGraph.h"
+#include "JobSystem.h"
+#include "CommandListPool.h"
+#include "SpscQueue.h"
+#include "PipelineStateCache.h"
+#include "DescriptorHeap.h"
+#include "ConstantAllocator.h"
+#include "FrameTimeTrace.h"
+#include "DynamicResolution.h"
+#include "GpuProfiler.h"
+#include "FramePacing.h"
+#include "LatencyBenchmark.h"
+#include "ResidencyManager.h"
+#include "GpuHeapAllocator.h"
+#include "GpuDefragmenter.h"
+#include "ResourceRegistry.h"
+#include "CookedTexture.h"
+#include "AssetArchive.h"
+#include "IoService.h"
 
 using Microsoft::WRL::ComPtr;
 
-const short kNumFrames = 2;
-const short kNumBuffers = 2;
+// Capacities, the number of frames in flight and of swap chain buffers are chosen at runtime
+const short kMaxFrames = 3;
+const short kMaxBuffers = 3;
 namespace Sigma
 {
 	struct Frame
 	{
 		ComPtr<ID3D12CommandAllocator> m_commandAllocator;
 		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		ResourceStateTracker* m_stateTracker;
+		// Pass command lists, executed in order before m_commandList
+		std::vector<PooledCommandList*> m_passCommandLists;
 		ComPtr<ID3D12Resource> m_renderTarget;
 		D3D12_CPU_DESCRIPTOR_HANDLE m_renderTargetsHandle;
 		UINT64 m_fenceValue;
 	};
 
+	enum class WindowEventType
+	{
+		Resize,
+		SizeMoveBegin,
+		SizeMoveEnd,
+		ToggleFullscreen,
+		ToggleFrameTimeTrace,
+		ToggleDynamicResolution,
+		PrintGpuTimings,
+		WriteCpuTrace,
+		WriteFramePacing,
+		CycleFramesInFlight,
+		ToggleVSync,
+		RunLatencyBenchmark,
+		KeyDown,
+		KeyUp,
+		MouseMove,
+		MouseButtonDown,
+		MouseButtonUp,
+		Quit
+	};
+
+	// Sent by the window thread to the render thread
+	// Resize : m_x, m_y is the client size, keys : m_x is the virtual key code, mouse : m_x, m_y is the position, buttons : m_x is the button
+	struct WindowEvent
+	{
+		WindowEventType m_type;
+		int m_x;
+		int m_y;
+	};
+
+	// Everything the render of a frame needs from the simulation, double buffered so the simulation of
+	// frame N+1 runs while frame N is recorded and submitted
+	struct FrameState
+	{
+		UINT64 m_frameIndex;
+		int m_mouseX;
+		int m_mouseY;
+		bool m_mouseButtonsDown[3];
+		bool m_keysDown[256];
+	};
+
+	struct TransientTexture
+	{
+		TransientResourceDesc m_desc;
+		UINT64 m_heapOffset;
+		ComPtr<ID3D12Resource> m_resource;
+		uint32_t m_rtvIndex;
+		uint32_t m_srvIndex;
+		UINT64 m_lastUsedFrame;
+	};
+
 	class Game
 	{
 	public:
@@ -34,17 +112,20 @@ namespace Sigma
 		HWND m_hWindow;
 
 		ComPtr<IDXGISwapChain3> m_swapChain;
-		ComPtr<ID3D12GraphicsCommandList> m_commandLists[kNumFrames];
+		ComPtr<ID3D12GraphicsCommandList> m_commandLists[kMaxFrames];
 		ComPtr<ID3D12CommandQueue> m_commandQueue;
 		ComPtr<ID3D12CommandQueue> m_copyQueue;
-		ComPtr<ID3D12CommandAllocator> m_copyCommandAllocator;
-		ComPtr<ID3D12GraphicsCommandList> m_copyCommandList;
-		ComPtr<ID3D12CommandAllocator> m_commandAllocators[kNumFrames];
+		ComPtr<ID3D12CommandAllocator> m_commandAllocators[kMaxFrames];
+		std::unique_ptr<ResourceStateTracker> m_stateTrackers[kMaxFrames];
+		// Fence value of the last frame submitted from each frame slot, 0 once it has been retired
+		UINT64 m_frameSlotFenceValues[kMaxFrames];
+		ResourceStateRegistry m_resourceStates;
 		ComPtr<ID3D12Device1> m_device;
 		ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-		ComPtr<ID3D12DescriptorHeap> m_srvHeap;
-		ComPtr<ID3D12Resource> m_renderTargets[kNumBuffers];
-		D3D12_CPU_DESCRIPTOR_HANDLE m_renderTargetsHandles[kNumBuffers];
+		std::unique_ptr<DescriptorHeap> m_descriptorHeap;
+		std::unique_ptr<DescriptorHeap> m_transientRtvHeap;
+		ComPtr<ID3D12Resource> m_renderTargets[kMaxBuffers];
+		D3D12_CPU_DESCRIPTOR_HANDLE m_renderTargetsHandles[kMaxBuffers];
 		int m_currentFrame;
 		int m_currentBuffer;
 		HANDLE m_fenceEvent;
@@ -56,23 +137,88 @@ namespace Sigma
 		ComPtr<ID3D12Fence> m_haltFence;
 		UINT64 m_haltFenceValue;
 
-		ComPtr<ID3D12Resource> m_vertexBuffer;
-		ComPtr<ID3D12Resource> m_ConstantBuffer;
-		ComPtr<ID3D12Resource> m_textureRes;
+		ResourceHandle m_vertexBuffer;
+		ResourceHandle m_texture;
 
 		D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-		ComPtr<ID3D12PipelineState> m_pipelineState;
+		std::unique_ptr<PipelineStateCache> m_pipelineCache;
+		uint64_t m_pipelineKey;
+		uint64_t m_upscalePipelineKey;
 		ComPtr<ID3D12RootSignature> m_rootSignature;
 
+		// Client size, as last received by the render thread
 		int m_windowWidth;
 		int m_windowHeight;
 		int m_bufferWidth;
 		int m_bufferHeight;
+
+		// While an edge of the window is dragged, the swap chain is only resized once the size stops changing
+		bool m_inSizeMove;
+		std::chrono::steady_clock::time_point m_lastResizeEventTime;
+
+		// The scene is rendered at a fraction of the swap chain size, then upscaled to it
+		float m_renderScale;
+		int m_renderWidth;
+		int m_renderHeight;
+		DynamicResolution m_dynamicResolution;
+		bool m_dynamicResolutionEnabled;
+		float m_frameRenderScales[kMaxFrames];
+		double m_gpuFrameTimeMs;
+
+		std::unique_ptr<GpuProfiler> m_gpuProfiler;
+
+		// Timeline of the frame being built, then of the frames in flight until the GPU completes them
+		FramePacingSample m_framePacingSample;
+		FramePacingSample m_pendingFramePacing[kMaxFrames];
+		FramePacingStats m_framePacing;
+		std::chrono::steady_clock::time_point m_lastOverlayUpdate;
+
+		// Fewer frames in flight lower the latency, more of them absorb CPU and GPU spikes
+		uint32_t m_numFrames;
+		uint32_t m_numBuffers;
+		bool m_vsync;
+		bool m_tearingSupported;
+		LatencyBenchmark m_latencyBenchmark;
+		LatencyMode m_modeBeforeBenchmark;
+
+		FrameTimeTrace m_frameTimeTrace;
+
+		AssetArchive m_assetArchive;
+		std::unique_ptr<IoService> m_ioService;
 		
 		ComPtr<ID3D12Heap> m_uploadHeap;
-		std::unique_ptr<LinearHeapAllocator> m_uploadAllocator;
+		std::unique_ptr<UploadQueue> m_uploadQueue;
+		std::unique_ptr<ConstantAllocator> m_constantAllocator;
 		ComPtr<ID3D12Heap> m_heap;
 
+		// Heaps and resources of the local segment, evicted in LRU order when over the OS budget
+		std::unique_ptr<ResidencyManager> m_residencyManager;
+		uint32_t m_heapResidency;
+
+		// Default heap resources are placed in large heaps, buffers and textures can't share them on resource heap tier 1
+		std::unique_ptr<GpuHeapAllocator> m_bufferAllocator;
+		std::unique_ptr<GpuHeapAllocator> m_textureAllocator;
+		// Moves them out of fragmented heap blocks in the background
+		std::unique_ptr<GpuDefragmenter> m_defragmenter;
+		// Owns them, released before the allocators they come from
+		std::unique_ptr<ResourceRegistry> m_resourceRegistry;
+
+		std::unique_ptr<JobSystem> m_jobSystem;
+		std::unique_ptr<CommandListPool> m_commandListPool;
+
+		SpscQueue<WindowEvent, 1024> m_windowEvents;
+		// Window thread only : events that did not fit in the queue yet, in order
+		std::vector<WindowEvent> m_pendingWindowEvents;
+		// Formatted by the render thread, set by the window thread
+		std::mutex m_overlayTitleMutex;
+		std::string m_overlayTitle;
+		HANDLE m_renderThread;
+		std::vector<WindowEvent> m_inputEvents;
+		FrameState m_frameStates[2];
+
+		FrameGraph m_frameGraph;
+		std::vector<TransientTexture> m_transientTextures;
+
 	private:
 		void SetupWindow();
 		void SetupD3D();
@@ -80,15 +226,30 @@ namespace Sigma
 		void CleanWindow();
 
 		void ResizeSwapChainBuffers();
+		void SetLatencyMode(const LatencyMode& mode);
+		UINT GetSwapChainFlags() const;
+		void RetireFrameSlot(uint32_t slot);
 		void WaitForGPU();
 		void WaitForGPUCopy();
 
 		Frame GetNewFrame();
-		void GameLoop();
+		void GameLoop(const FrameState& state);
+		bool ProcessWindowEvents();
+		void Simulate(const FrameState& previous, FrameState& next);
+		void PushWindowEvent(WindowEventType type, int x, int y);
+		bool FlushWindowEvents();
+		void UpdateOverlay();
+		// Into a new descriptor, the previous one is freed
+		void CreateTextureView();
+		FrameGraphResource CreateTransientTexture(const char* name, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags);
+		const TransientTexture* GetTransientTexture(FrameGraphResource resource) const;
+		void ExecuteFrameGraph(Frame& frame);
+		void RecordPass(ID3D12GraphicsCommandList* commandList, ResourceStateTracker* stateTracker, uint32_t passIndex);
+		void SubmitFrame(Frame& frame);
 
 		LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 		static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
-		DWORD WINAPI GameLoop(HANDLE message);
-		static DWORD WINAPI StaticGameLoop(LPVOID StartParam);
+		DWORD RenderLoop();
+		static DWORD WINAPI StaticGameLoop(LPVOID startParam);
 	};
 }
\ No newline at end of file
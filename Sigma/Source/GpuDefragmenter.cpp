@@ -0,0 +1,229 @@
+#include "stdafx.h"
+#include "GpuDefragmenter.h"
+#include <algorithm>
+#include "Profile.h"
+
+namespace Sigma
+{
+	GpuDefragmenter::GpuDefragmenter(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> copyQueue, ResidencyManager* residencyManager, ResourceStateRegistry& resourceStates, UINT64 bytesPerFrame) :
+		m_device(device),
+		m_copyQueue(copyQueue),
+		m_fenceValue(0),
+		m_residencyManager(residencyManager),
+		m_resourceStates(resourceStates),
+		m_bytesPerFrame(bytesPerFrame),
+		m_submitted(false)
+	{
+		m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+		// A single batch of copies is in flight at a time, so a single allocator is enough
+		m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_commandAllocator));
+		m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList));
+		m_commandList->Close();
+	}
+
+	GpuDefragmenter::~GpuDefragmenter()
+	{
+		if (m_fence->GetCompletedValue() < m_fenceValue)
+		{
+			m_fence->SetEventOnCompletion(m_fenceValue, m_fenceEvent);
+			WaitForSingleObject(m_fenceEvent, INFINITE);
+		}
+		CloseHandle(m_fenceEvent);
+	}
+
+	uint32_t GpuDefragmenter::Register(GpuHeapAllocator* allocator, ID3D12Resource* resource, const GpuAllocation& allocation, ResourceMovedCallback onMoved)
+	{
+		// A write between the copy and the switch to the new resource would be lost
+		D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		const D3D12_RESOURCE_FLAGS writableFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		if ((desc.Flags & writableFlags) != 0)
+			return kInvalidMovableResource;
+
+		uint32_t handle;
+		if (!m_freeEntries.empty())
+		{
+			handle = m_freeEntries.back();
+			m_freeEntries.pop_back();
+		}
+		else
+		{
+			handle = (uint32_t)m_entries.size();
+			m_entries.emplace_back();
+		}
+
+		Entry& entry = m_entries[handle];
+		entry.m_allocator = allocator;
+		entry.m_resource = resource;
+		entry.m_allocation = allocation;
+		entry.m_alignment = (std::max)(m_device->GetResourceAllocationInfo(0, 1, &desc).Alignment, (UINT64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+		entry.m_onMoved = onMoved;
+		entry.m_moving = false;
+
+		if (std::find(m_allocators.begin(), m_allocators.end(), allocator) == m_allocators.end())
+			m_allocators.push_back(allocator);
+		return handle;
+	}
+
+	void GpuDefragmenter::Unregister(uint32_t handle)
+	{
+		if (handle == kInvalidMovableResource)
+			return;
+
+		// A resource being copied is kept until the copy completes, the move is then dropped
+		Entry& entry = m_entries[handle];
+		entry.m_allocator = nullptr;
+		entry.m_onMoved = nullptr;
+		if (!entry.m_moving)
+		{
+			entry.m_resource.Reset();
+			m_freeEntries.push_back(handle);
+		}
+	}
+
+	void GpuDefragmenter::Update(UINT64 completedFrameFenceValue, UINT64 frameFenceValue)
+	{
+		ProfileScopedEvent(PIX_COLOR_INDEX(5), "Defragmentation");
+
+		if (m_submitted && m_fence->GetCompletedValue() >= m_fenceValue)
+			CompleteMoves(frameFenceValue);
+
+		while (!m_retired.empty() && m_retired.front().m_frameFenceValue <= completedFrameFenceValue)
+		{
+			Retired& retired = m_retired.front();
+			m_resourceStates.Unregister(retired.m_resource.Get());
+			retired.m_resource.Reset();
+			retired.m_allocator->Free(retired.m_allocation);
+			m_retired.pop_front();
+		}
+
+		if (!m_moves.empty())
+			return;
+
+		UINT64 movedBytes = 0;
+		for (GpuHeapAllocator* allocator : m_allocators)
+		{
+			if (movedBytes >= m_bytesPerFrame)
+				break;
+			movedBytes += PlanMoves(allocator, m_bytesPerFrame - movedBytes, frameFenceValue);
+		}
+		if (!m_moves.empty())
+			m_commandList->Close();
+	}
+
+	void GpuDefragmenter::TransitionSources(ResourceStateTracker* stateTracker)
+	{
+		if (m_submitted)
+			return;
+
+		// The copy queue can only access resources in the COMMON state
+		for (const Move& move : m_moves)
+		{
+			stateTracker->Transition(m_entries[move.m_entry].m_resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+		}
+	}
+
+	UINT64 GpuDefragmenter::Submit(ID3D12Fence* frameFence, UINT64 frameFenceValue)
+	{
+		if (m_moves.empty() || m_submitted)
+			return 0;
+
+		// The sources are read by the frame, and only reach COMMON at its end
+		m_copyQueue->Wait(frameFence, frameFenceValue);
+		ID3D12CommandList* commandLists[] = { m_commandList.Get() };
+		m_copyQueue->ExecuteCommandLists(1, commandLists);
+		m_copyQueue->Signal(m_fence.Get(), ++m_fenceValue);
+		m_submitted = true;
+		return m_fenceValue;
+	}
+
+	void GpuDefragmenter::WaitOnGPU(ID3D12CommandQueue* queue, UINT64 ticket)
+	{
+		if (ticket != 0)
+			queue->Wait(m_fence.Get(), ticket);
+	}
+
+	void GpuDefragmenter::CompleteMoves(UINT64 frameFenceValue)
+	{
+		for (Move& move : m_moves)
+		{
+			Entry& entry = m_entries[move.m_entry];
+			entry.m_moving = false;
+			if (entry.m_allocator == nullptr)
+			{
+				// Unregistered while it was copied, no frame has used the copy
+				move.m_resource.Reset();
+				move.m_allocator->Free(move.m_allocation);
+				entry.m_resource.Reset();
+				m_freeEntries.push_back(move.m_entry);
+				continue;
+			}
+
+			// Frames submitted until now may still use the old placement, the copy queue left both in COMMON
+			Retired retired = { entry.m_allocator, entry.m_resource, entry.m_allocation, frameFenceValue - 1 };
+			m_retired.push_back(retired);
+			m_resourceStates.Register(move.m_resource.Get(), m_resourceStates.GetSubresourceCount(entry.m_resource.Get()), D3D12_RESOURCE_STATE_COMMON);
+
+			entry.m_resource = move.m_resource;
+			entry.m_allocation = move.m_allocation;
+			entry.m_onMoved(entry.m_resource.Get(), entry.m_allocation);
+		}
+		m_moves.clear();
+		m_submitted = false;
+	}
+
+	UINT64 GpuDefragmenter::PlanMoves(GpuHeapAllocator* allocator, UINT64 maxBytes, UINT64 frameFenceValue)
+	{
+		m_movable.clear();
+		for (uint32_t i = 0; i < m_entries.size(); i++)
+		{
+			const Entry& entry = m_entries[i];
+			if (entry.m_allocator != allocator)
+				continue;
+
+			MovableAllocation movable = { i, entry.m_allocation.m_heapBlock, { entry.m_allocation.m_offset, entry.m_allocation.m_size, entry.m_allocation.m_block }, entry.m_alignment };
+			m_movable.push_back(movable);
+		}
+		if (m_movable.empty())
+			return 0;
+
+		allocator->GetBlockAllocators(m_blocks);
+		UINT64 movedBytes = m_planner.Plan(m_blocks, m_movable, maxBytes, m_plannedMoves);
+
+		for (const DefragmentationMove& plannedMove : m_plannedMoves)
+		{
+			Entry& entry = m_entries[plannedMove.m_id];
+			Move move;
+			move.m_entry = plannedMove.m_id;
+			move.m_allocator = allocator;
+			move.m_allocation = allocator->GetAllocation(plannedMove.m_destinationBlock, plannedMove.m_destination);
+
+			D3D12_RESOURCE_DESC desc = entry.m_resource->GetDesc();
+			if (FAILED(m_device->CreatePlacedResource(move.m_allocation.m_heap, move.m_allocation.m_offset, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&move.m_resource))))
+			{
+				allocator->Free(move.m_allocation);
+				movedBytes -= move.m_allocation.m_size;
+				continue;
+			}
+
+			if (m_moves.empty())
+			{
+				m_commandAllocator->Reset();
+				m_commandList->Reset(m_commandAllocator.Get(), nullptr);
+			}
+			m_commandList->CopyResource(move.m_resource.Get(), entry.m_resource.Get());
+
+			// Both heaps are used by the copy, which runs before the next frame
+			if (m_residencyManager != nullptr)
+			{
+				m_residencyManager->MarkUsed(entry.m_allocation.m_residencyHandle, frameFenceValue + 1);
+				m_residencyManager->MarkUsed(move.m_allocation.m_residencyHandle, frameFenceValue + 1);
+			}
+
+			entry.m_moving = true;
+			m_moves.push_back(move);
+		}
+		return movedBytes;
+	}
+}
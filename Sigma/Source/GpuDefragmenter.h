@@ -0,0 +1,110 @@
+#pragma once
+
+#include "stdafx.h"
+#include <deque>
+#include <functional>
+#include <vector>
+#include "DefragmentationPlanner.h"
+#include "GpuHeapAllocator.h"
+#include "ResourceStateTracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	const uint32_t kInvalidMovableResource = 0xffffffff;
+
+	// Called once a resource has been copied to its new place : views and handles to the old resource have to be recreated
+	typedef std::function<void(ID3D12Resource* resource, const GpuAllocation& allocation)> ResourceMovedCallback;
+
+	/*
+	Moves registered resources out of fragmented heap blocks, a few megabytes per frame, so emptied blocks get released.
+
+	Each frame, Update completes the moves whose copy is done, then plans new ones (see DefragmentationPlanner) if none is
+	in flight : a resource is created at each destination and the copies are recorded for the copy queue. The frame
+	transitions the sources to COMMON (TransitionSources), and once it is submitted, the copy queue waits for it, copies,
+	and the next frame waits for the copies GPU side. Once the copies are done, the owners switch to the new resources
+	through their callback, and the old placements are freed when the frames that may still use them are complete.
+
+	Frames recorded between the copy and CompleteMoves keep using the old resource, so a GPU write in that window would
+	be lost : only resources the GPU never writes can be moved, Register rejects render targets, depth stencils and UAVs.
+
+	Render thread only, frames must signal consecutive fence values.
+	*/
+	class GpuDefragmenter
+	{
+	public:
+		GpuDefragmenter(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> copyQueue, ResidencyManager* residencyManager, ResourceStateRegistry& resourceStates, UINT64 bytesPerFrame);
+		~GpuDefragmenter();
+
+		// The resource must be registered in resourceStates. Its owner keeps freeing the allocation it has been given last.
+		// Returns kInvalidMovableResource for resources the GPU can write
+		uint32_t Register(GpuHeapAllocator* allocator, ID3D12Resource* resource, const GpuAllocation& allocation, ResourceMovedCallback onMoved);
+		void Unregister(uint32_t handle);
+
+		// Before the frame is recorded
+		void Update(UINT64 completedFrameFenceValue, UINT64 frameFenceValue);
+		// At the end of the frame recording
+		void TransitionSources(ResourceStateTracker* stateTracker);
+		// After the frame fence has been signaled, returns the ticket the next frame has to wait for, 0 if nothing was moved
+		UINT64 Submit(ID3D12Fence* frameFence, UINT64 frameFenceValue);
+		void WaitOnGPU(ID3D12CommandQueue* queue, UINT64 ticket);
+
+	private:
+		struct Entry
+		{
+			GpuHeapAllocator* m_allocator; // Null once unregistered
+			ComPtr<ID3D12Resource> m_resource;
+			GpuAllocation m_allocation;
+			UINT64 m_alignment;
+			ResourceMovedCallback m_onMoved;
+			bool m_moving;
+		};
+
+		struct Move
+		{
+			uint32_t m_entry;
+			GpuHeapAllocator* m_allocator;
+			ComPtr<ID3D12Resource> m_resource;
+			GpuAllocation m_allocation;
+		};
+
+		// Old placement, freed once the frames that may use it are complete
+		struct Retired
+		{
+			GpuHeapAllocator* m_allocator;
+			ComPtr<ID3D12Resource> m_resource;
+			GpuAllocation m_allocation;
+			UINT64 m_frameFenceValue;
+		};
+
+		void CompleteMoves(UINT64 frameFenceValue);
+		// Returns the number of bytes moved
+		UINT64 PlanMoves(GpuHeapAllocator* allocator, UINT64 maxBytes, UINT64 frameFenceValue);
+
+		ComPtr<ID3D12Device> m_device;
+		ComPtr<ID3D12CommandQueue> m_copyQueue;
+		ComPtr<ID3D12CommandAllocator> m_commandAllocator;
+		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		ComPtr<ID3D12Fence> m_fence;
+		UINT64 m_fenceValue;
+		HANDLE m_fenceEvent;
+		ResidencyManager* m_residencyManager;
+		ResourceStateRegistry& m_resourceStates;
+		UINT64 m_bytesPerFrame;
+
+		DefragmentationPlanner m_planner;
+		std::vector<Entry> m_entries;
+		std::vector<uint32_t> m_freeEntries;
+		std::vector<GpuHeapAllocator*> m_allocators;
+
+		// Recorded this frame, then in flight until m_fenceValue is reached
+		std::vector<Move> m_moves;
+		bool m_submitted;
+		std::deque<Retired> m_retired;
+
+		std::vector<TlsfAllocator*> m_blocks;
+		std::vector<MovableAllocation> m_movable;
+		std::vector<DefragmentationMove> m_plannedMoves;
+	};
+}
@@ -0,0 +1,187 @@
+#include "stdafx.h"
+#include "GpuHeapAllocator.h"
+
+namespace Sigma
+{
+	GpuHeapAllocator::GpuHeapAllocator(ComPtr<ID3D12Device> device, ResidencyManager* residencyManager, D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, UINT64 blockSize) :
+		m_device(device),
+		m_residencyManager(residencyManager),
+		m_type(type),
+		m_flags(flags),
+		m_blockSize(AlignUp(blockSize, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT))
+	{
+		// Only heaps that may hold textures need the MSAA alignment
+		bool buffersOnly = (flags & D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS) == D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		m_heapAlignment = buffersOnly ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	}
+
+	GpuHeapAllocator::~GpuHeapAllocator()
+	{
+		for (uint32_t i = 0; i < m_heapBlocks.size(); i++)
+		{
+			if (m_heapBlocks[i].m_heap != nullptr)
+				ReleaseHeapBlock(i);
+		}
+	}
+
+	GpuAllocation GpuHeapAllocator::Allocate(const D3D12_RESOURCE_ALLOCATION_INFO& info)
+	{
+		GpuAllocation allocation = {};
+		UINT64 alignment = (std::max)(info.Alignment, (UINT64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+		TlsfAllocation blockAllocation = { kInvalidOffset, 0, kInvalidTlsfBlock };
+		uint32_t heapBlock = 0;
+		for (; heapBlock < m_heapBlocks.size(); heapBlock++)
+		{
+			if (m_heapBlocks[heapBlock].m_heap == nullptr)
+				continue;
+
+			blockAllocation = m_heapBlocks[heapBlock].m_allocator->Allocate(info.SizeInBytes, alignment);
+			if (blockAllocation.m_offset != kInvalidOffset)
+				break;
+		}
+
+		if (blockAllocation.m_offset == kInvalidOffset)
+		{
+			heapBlock = CreateHeapBlock((std::max)(m_blockSize, AlignUp(info.SizeInBytes, m_heapAlignment)));
+			if (heapBlock == kInvalidTlsfBlock)
+				return allocation;
+
+			blockAllocation = m_heapBlocks[heapBlock].m_allocator->Allocate(info.SizeInBytes, alignment);
+			if (blockAllocation.m_offset == kInvalidOffset)
+				return allocation;
+		}
+
+		return GetAllocation(heapBlock, blockAllocation);
+	}
+
+	void GpuHeapAllocator::Free(const GpuAllocation& allocation)
+	{
+		if (allocation.m_heap == nullptr)
+			return;
+
+		HeapBlock& heapBlock = m_heapBlocks[allocation.m_heapBlock];
+		heapBlock.m_allocator->Free(allocation.m_block);
+		if (!heapBlock.m_allocator->IsEmpty())
+			return;
+
+		// Keep a single empty block around
+		for (uint32_t i = 0; i < m_heapBlocks.size(); i++)
+		{
+			if (i != allocation.m_heapBlock && m_heapBlocks[i].m_heap != nullptr && m_heapBlocks[i].m_allocator->IsEmpty())
+			{
+				ReleaseHeapBlock(allocation.m_heapBlock);
+				return;
+			}
+		}
+	}
+
+	ComPtr<ID3D12Resource> GpuHeapAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GpuAllocation& allocation)
+	{
+		ComPtr<ID3D12Resource> resource;
+		GpuAllocation newAllocation = Allocate(m_device->GetResourceAllocationInfo(0, 1, &desc));
+		if (newAllocation.m_heap == nullptr)
+			return resource;
+
+		if (FAILED(m_device->CreatePlacedResource(newAllocation.m_heap, newAllocation.m_offset, &desc, initialState, clearValue, IID_PPV_ARGS(&resource))))
+		{
+			Free(newAllocation);
+			return nullptr;
+		}
+
+		allocation = newAllocation;
+		return resource;
+	}
+
+	TlsfStats GpuHeapAllocator::GetStats() const
+	{
+		TlsfStats stats = {};
+		for (const HeapBlock& heapBlock : m_heapBlocks)
+		{
+			if (heapBlock.m_heap == nullptr)
+				continue;
+
+			TlsfStats blockStats = heapBlock.m_allocator->GetStats();
+			stats.m_size += blockStats.m_size;
+			stats.m_usedSize += blockStats.m_usedSize;
+			stats.m_freeSize += blockStats.m_freeSize;
+			stats.m_largestFreeBlock = (std::max)(stats.m_largestFreeBlock, blockStats.m_largestFreeBlock);
+			stats.m_allocationCount += blockStats.m_allocationCount;
+			stats.m_freeBlockCount += blockStats.m_freeBlockCount;
+		}
+		return stats;
+	}
+
+	uint32_t GpuHeapAllocator::GetHeapBlockCount() const
+	{
+		uint32_t count = 0;
+		for (const HeapBlock& heapBlock : m_heapBlocks)
+		{
+			if (heapBlock.m_heap != nullptr)
+				count++;
+		}
+		return count;
+	}
+
+	void GpuHeapAllocator::GetBlockAllocators(std::vector<TlsfAllocator*>& allocators) const
+	{
+		allocators.clear();
+		for (const HeapBlock& heapBlock : m_heapBlocks)
+		{
+			allocators.push_back(heapBlock.m_allocator.get());
+		}
+	}
+
+	GpuAllocation GpuHeapAllocator::GetAllocation(uint32_t heapBlock, const TlsfAllocation& blockAllocation) const
+	{
+		GpuAllocation allocation;
+		allocation.m_heap = m_heapBlocks[heapBlock].m_heap.Get();
+		allocation.m_offset = blockAllocation.m_offset;
+		allocation.m_size = blockAllocation.m_size;
+		allocation.m_heapBlock = heapBlock;
+		allocation.m_block = blockAllocation.m_block;
+		allocation.m_residencyHandle = m_heapBlocks[heapBlock].m_residencyHandle;
+		return allocation;
+	}
+
+	uint32_t GpuHeapAllocator::CreateHeapBlock(UINT64 size)
+	{
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.Alignment = m_heapAlignment;
+		heapDesc.SizeInBytes = size;
+		heapDesc.Properties.Type = m_type;
+		heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapDesc.Properties.VisibleNodeMask = 0;
+		heapDesc.Properties.CreationNodeMask = 0;
+		heapDesc.Flags = m_flags;
+
+		ComPtr<ID3D12Heap> heap;
+		if (FAILED(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap))))
+			return kInvalidTlsfBlock;
+
+		uint32_t heapBlock = 0;
+		while (heapBlock < m_heapBlocks.size() && m_heapBlocks[heapBlock].m_heap != nullptr)
+		{
+			heapBlock++;
+		}
+		if (heapBlock == m_heapBlocks.size())
+			m_heapBlocks.emplace_back();
+
+		HeapBlock& block = m_heapBlocks[heapBlock];
+		block.m_heap = heap;
+		block.m_allocator = std::make_unique<TlsfAllocator>(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+		block.m_residencyHandle = m_residencyManager != nullptr ? m_residencyManager->Register(heap.Get()) : kInvalidResidencyHandle;
+		return heapBlock;
+	}
+
+	void GpuHeapAllocator::ReleaseHeapBlock(uint32_t heapBlock)
+	{
+		HeapBlock& block = m_heapBlocks[heapBlock];
+		if (m_residencyManager != nullptr)
+			m_residencyManager->Unregister(block.m_residencyHandle);
+		block.m_heap.Reset();
+		block.m_allocator.reset();
+		block.m_residencyHandle = kInvalidResidencyHandle;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "stdafx.h"
+#include <memory>
+#include <vector>
+#include "ResidencyManager.h"
+#include "TlsfAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	// Where a placed resource lives
+	struct GpuAllocation
+	{
+		ID3D12Heap* m_heap; // Null if the allocation failed
+		UINT64 m_offset;
+		UINT64 m_size;
+		uint32_t m_heapBlock;
+		uint32_t m_block;
+		uint32_t m_residencyHandle; // Of the heap, to mark it used by the frames using the resource
+	};
+
+	/*
+	Places resources in large heaps instead of one committed resource (one OS allocation) each.
+
+	Each heap block is managed by a TLSF allocator with a 64 KiB granularity, resources needing the 4 MiB alignment of
+	MSAA textures get it from the same blocks. A new block is created when no block has room, resources larger than the
+	block size get a block of their own. A block left empty is released, unless it is the only empty one, so a resource
+	created and freed over and over does not create a heap every time.
+
+	Heap flags follow resource heap tier 1 : buffers, non render target textures and render target textures need
+	separate allocators. Blocks are registered with the residency manager, so like it this is render thread only. The
+	GPU must be done with a resource before its allocation is freed.
+	*/
+	class GpuHeapAllocator
+	{
+	public:
+		GpuHeapAllocator(ComPtr<ID3D12Device> device, ResidencyManager* residencyManager, D3D12_HEAP_TYPE type, D3D12_HEAP_FLAGS flags, UINT64 blockSize);
+		~GpuHeapAllocator();
+
+		GpuAllocation Allocate(const D3D12_RESOURCE_ALLOCATION_INFO& info);
+		void Free(const GpuAllocation& allocation);
+
+		// Returns null if there was no memory left, allocation is then left untouched
+		ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GpuAllocation& allocation);
+
+		// Over every heap block
+		TlsfStats GetStats() const;
+		uint32_t GetHeapBlockCount() const;
+
+		// For the defragmenter, which allocates in the blocks directly. Released blocks are null
+		void GetBlockAllocators(std::vector<TlsfAllocator*>& allocators) const;
+		GpuAllocation GetAllocation(uint32_t heapBlock, const TlsfAllocation& blockAllocation) const;
+
+	private:
+		struct HeapBlock
+		{
+			ComPtr<ID3D12Heap> m_heap; // Null once released, the slot is reused by the next block
+			std::unique_ptr<TlsfAllocator> m_allocator;
+			uint32_t m_residencyHandle;
+		};
+
+		uint32_t CreateHeapBlock(UINT64 size);
+		void ReleaseHeapBlock(uint32_t heapBlock);
+
+		ComPtr<ID3D12Device> m_device;
+		ResidencyManager* m_residencyManager;
+		D3D12_HEAP_TYPE m_type;
+		D3D12_HEAP_FLAGS m_flags;
+		UINT64 m_blockSize;
+		UINT64 m_heapAlignment;
+
+		std::vector<HeapBlock> m_heapBlocks;
+	};
+}
@@ -0,0 +1,135 @@
+#include "stdafx.h"
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Sigma
+{
+	// Innermost open scope of the calling thread, scopes opened with none are children of the frame root
+	thread_local uint32_t t_currentScope = kInvalidGpuScope;
+
+	GpuProfiler::GpuProfiler(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> queue, uint32_t numFrames, uint32_t maxScopes, uint32_t historySize) :
+		m_queue(queue),
+		m_maxScopes(maxScopes),
+		m_frames(numFrames),
+		m_currentFrame(0),
+		m_nextScope(0),
+		m_timingTree(historySize),
+		m_frameTimeMs(0.0),
+		m_frameEndAgeMs(0.0)
+	{
+		D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+		queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		queryHeapDesc.Count = numFrames * maxScopes * 2;
+		device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap));
+
+		D3D12_HEAP_PROPERTIES heapProps = {};
+		heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = queryHeapDesc.Count * sizeof(UINT64);
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback));
+
+		queue->GetTimestampFrequency(&m_frequency);
+
+		for (FrameSlot& frame : m_frames)
+		{
+			frame.m_scopes.resize(maxScopes);
+			frame.m_scopeCount = 0;
+		}
+	}
+
+	void GpuProfiler::BeginFrame(uint32_t frameIndex)
+	{
+		m_currentFrame = frameIndex;
+		FrameSlot& frame = m_frames[frameIndex];
+		if (frame.m_scopeCount > 0)
+		{
+			D3D12_RANGE readRange = { GetQueryIndex(0, false) * sizeof(UINT64), GetQueryIndex(frame.m_scopeCount, false) * sizeof(UINT64) };
+			D3D12_RANGE writeRange = { 0, 0 };
+			UINT64* timestamps;
+			m_readback->Map(0, &readRange, reinterpret_cast<void**>(&timestamps));
+
+			m_readbackScopes.resize(frame.m_scopeCount);
+			for (uint32_t i = 0; i < frame.m_scopeCount; i++)
+			{
+				GpuScope& scope = m_readbackScopes[i];
+				scope.m_name = frame.m_scopes[i].m_name;
+				scope.m_parent = frame.m_scopes[i].m_parent;
+				scope.m_begin = timestamps[GetQueryIndex(i, false)];
+				scope.m_end = timestamps[GetQueryIndex(i, true)];
+			}
+			m_readback->Unmap(0, &writeRange);
+
+			m_timingTree.AddFrame(m_readbackScopes.data(), m_readbackScopes.size(), m_frequency);
+			const GpuScope& root = m_readbackScopes[0];
+			m_frameTimeMs = root.m_end > root.m_begin ? (root.m_end - root.m_begin) * 1000.0 / m_frequency : 0.0;
+
+			// The GPU clock is only comparable to itself, the age of the frame end converts it to CPU time
+			UINT64 gpuTimestamp;
+			UINT64 cpuTimestamp;
+			m_queue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp);
+			m_frameEndAgeMs = gpuTimestamp > root.m_end ? (gpuTimestamp - root.m_end) * 1000.0 / m_frequency : 0.0;
+		}
+
+		frame.m_scopeCount = 0;
+		strcpy_s(frame.m_scopes[0].m_name, "Frame");
+		frame.m_scopes[0].m_parent = kInvalidGpuScope;
+		m_nextScope.store(1, std::memory_order_relaxed);
+	}
+
+	void GpuProfiler::WriteFrameBegin(ID3D12GraphicsCommandList* commandList)
+	{
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(0, false));
+	}
+
+	void GpuProfiler::EndFrame(ID3D12GraphicsCommandList* commandList)
+	{
+		FrameSlot& frame = m_frames[m_currentFrame];
+		frame.m_scopeCount = (std::min)(m_nextScope.load(std::memory_order_relaxed), m_maxScopes);
+
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(0, true));
+		commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(0, false), frame.m_scopeCount * 2,
+			m_readback.Get(), GetQueryIndex(0, false) * sizeof(UINT64));
+	}
+
+	uint32_t GpuProfiler::BeginScope(ID3D12GraphicsCommandList* commandList, const char* name)
+	{
+		uint32_t scope = m_nextScope.fetch_add(1, std::memory_order_relaxed);
+		if (scope >= m_maxScopes)
+			return kInvalidGpuScope;
+
+		ScopeRecord& record = m_frames[m_currentFrame].m_scopes[scope];
+		size_t length = (std::min)(strlen(name), (size_t)kMaxNameLength - 1);
+		memcpy(record.m_name, name, length);
+		record.m_name[length] = 0;
+		record.m_parent = t_currentScope != kInvalidGpuScope ? t_currentScope : 0;
+		t_currentScope = scope;
+
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(scope, false));
+		return scope;
+	}
+
+	void GpuProfiler::EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope)
+	{
+		if (scope == kInvalidGpuScope)
+			return;
+
+		uint32_t parent = m_frames[m_currentFrame].m_scopes[scope].m_parent;
+		t_currentScope = parent != 0 ? parent : kInvalidGpuScope;
+
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(scope, true));
+	}
+
+	uint32_t GpuProfiler::GetQueryIndex(uint32_t scope, bool end) const
+	{
+		return (m_currentFrame * m_maxScopes + scope) * 2 + (end ? 1 : 0);
+	}
+}
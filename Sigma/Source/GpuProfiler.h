@@ -0,0 +1,93 @@
+#pragma once
+
+#include "stdafx.h"
+#include <atomic>
+#include <vector>
+#include "GpuTimingTree.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	/*
+	Times regions of the GPU work with timestamp queries, without an external capture tool.
+
+	Every frame in flight has its own range of queries and of the readback buffer. BeginFrame reads back the scopes of the
+	previous frame that used the slot (its fence must have been reached) into the timing tree, and opens the "Frame" root
+	scope. Scopes can be recorded from several threads at once, each on its own command list : indices are allocated
+	atomically, and nesting is tracked per thread.
+	*/
+	class GpuProfiler
+	{
+	public:
+		GpuProfiler(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> queue, uint32_t numFrames, uint32_t maxScopes, uint32_t historySize);
+
+		void BeginFrame(uint32_t frameIndex);
+		// The root scope is written by the first and the last command lists of the frame
+		void WriteFrameBegin(ID3D12GraphicsCommandList* commandList);
+		void EndFrame(ID3D12GraphicsCommandList* commandList);
+
+		// Returns kInvalidGpuScope once the frame is out of scopes, EndScope ignores it
+		uint32_t BeginScope(ID3D12GraphicsCommandList* commandList, const char* name);
+		void EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope);
+
+		const GpuTimingTree& GetTimingTree() const { return m_timingTree; }
+		// Of the last frame read back, 0 if none
+		double GetFrameTimeMs() const { return m_frameTimeMs; }
+		// How long before the read back the GPU completed that frame
+		double GetFrameEndAgeMs() const { return m_frameEndAgeMs; }
+
+	private:
+		static const uint32_t kMaxNameLength = 48;
+
+		struct ScopeRecord
+		{
+			char m_name[kMaxNameLength];
+			uint32_t m_parent;
+		};
+
+		struct FrameSlot
+		{
+			std::vector<ScopeRecord> m_scopes;
+			uint32_t m_scopeCount;
+		};
+
+		uint32_t GetQueryIndex(uint32_t scope, bool end) const;
+
+		ComPtr<ID3D12CommandQueue> m_queue;
+		ComPtr<ID3D12QueryHeap> m_queryHeap;
+		ComPtr<ID3D12Resource> m_readback;
+		UINT64 m_frequency;
+		uint32_t m_maxScopes;
+
+		std::vector<FrameSlot> m_frames;
+		uint32_t m_currentFrame;
+		std::atomic<uint32_t> m_nextScope;
+
+		GpuTimingTree m_timingTree;
+		std::vector<GpuScope> m_readbackScopes;
+		double m_frameTimeMs;
+		double m_frameEndAgeMs;
+	};
+
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, const char* name) :
+			m_profiler(profiler),
+			m_commandList(commandList),
+			m_scope(profiler.BeginScope(commandList, name))
+		{
+		}
+
+		~GpuProfileScope()
+		{
+			m_profiler.EndScope(m_commandList, m_scope);
+		}
+
+	private:
+		GpuProfiler& m_profiler;
+		ID3D12GraphicsCommandList* m_commandList;
+		uint32_t m_scope;
+	};
+}
@@ -0,0 +1,169 @@
+#include "GpuTimingTree.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace Sigma
+{
+	GpuTimingTree::GpuTimingTree(uint32_t historySize) :
+		m_historySize(std::max(1u, historySize)),
+		m_frameCount(0)
+	{
+	}
+
+	void GpuTimingTree::AddFrame(const GpuScope* scopes, size_t count, uint64_t frequency)
+	{
+		if (frequency == 0)
+			return;
+
+		m_frameCount++;
+		m_frameMs.assign(m_nodes.size(), -1.0);
+		m_scopeNodes.assign(count, kInvalidGpuScope);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const GpuScope& scope = scopes[i];
+			if (scope.m_end <= scope.m_begin)
+				continue;
+
+			uint32_t parentNode = kInvalidGpuScope;
+			if (scope.m_parent != kInvalidGpuScope)
+			{
+				// Children of ignored scopes are ignored too
+				if (scope.m_parent >= i || m_scopeNodes[scope.m_parent] == kInvalidGpuScope)
+					continue;
+				parentNode = m_scopeNodes[scope.m_parent];
+			}
+
+			uint32_t node = FindOrAddNode(parentNode, scope.m_name);
+			if (node >= m_frameMs.size())
+				m_frameMs.resize(node + 1, -1.0);
+
+			double ms = (scope.m_end - scope.m_begin) * 1000.0 / frequency;
+			m_frameMs[node] = std::max(m_frameMs[node], 0.0) + ms;
+			m_scopeNodes[i] = node;
+		}
+
+		for (size_t i = 0; i < m_nodes.size(); i++)
+		{
+			if (m_frameMs[i] < 0.0)
+				continue;
+
+			GpuTimingNode& node = m_nodes[i];
+			node.m_lastMs = m_frameMs[i];
+			node.m_lastFrame = m_frameCount;
+			UpdateStatistics(node);
+		}
+	}
+
+	const GpuTimingNode* GpuTimingTree::Find(const char* path) const
+	{
+		uint32_t parent = kInvalidGpuScope;
+		const GpuTimingNode* found = nullptr;
+		while (*path != 0)
+		{
+			const char* separator = strchr(path, '/');
+			size_t length = separator != nullptr ? (size_t)(separator - path) : strlen(path);
+
+			found = nullptr;
+			for (uint32_t i = 0; i < m_nodes.size(); i++)
+			{
+				const GpuTimingNode& node = m_nodes[i];
+				if (node.m_parent == parent && node.m_name.size() == length && node.m_name.compare(0, length, path, length) == 0)
+				{
+					found = &node;
+					parent = i;
+					break;
+				}
+			}
+			if (found == nullptr)
+				return nullptr;
+
+			path += length;
+			if (*path == '/')
+				path++;
+		}
+		return found;
+	}
+
+	std::string GpuTimingTree::ToString() const
+	{
+		std::ostringstream stream;
+		stream.setf(std::ios::fixed);
+		stream.precision(3);
+
+		// Depth first, nodes are stored parents first but siblings of different depths are interleaved
+		std::vector<uint32_t> stack;
+		for (uint32_t i = (uint32_t)m_nodes.size(); i-- > 0;)
+		{
+			if (m_nodes[i].m_parent == kInvalidGpuScope)
+				stack.push_back(i);
+		}
+
+		while (!stack.empty())
+		{
+			uint32_t index = stack.back();
+			stack.pop_back();
+
+			const GpuTimingNode& node = m_nodes[index];
+			if (node.m_lastFrame != m_frameCount)
+				continue;
+
+			stream << std::string(node.m_depth * 2, ' ') << node.m_name << " : " << node.m_lastMs << " ms (avg " << node.m_averageMs
+				<< ", min " << node.m_minMs << ", max " << node.m_maxMs << ")\n";
+
+			for (uint32_t i = (uint32_t)m_nodes.size(); i-- > index + 1;)
+			{
+				if (m_nodes[i].m_parent == index)
+					stack.push_back(i);
+			}
+		}
+		return stream.str();
+	}
+
+	uint32_t GpuTimingTree::FindOrAddNode(uint32_t parent, const char* name)
+	{
+		for (uint32_t i = 0; i < m_nodes.size(); i++)
+		{
+			if (m_nodes[i].m_parent == parent && m_nodes[i].m_name == name)
+				return i;
+		}
+
+		GpuTimingNode node;
+		node.m_name = name;
+		node.m_parent = parent;
+		node.m_depth = parent != kInvalidGpuScope ? m_nodes[parent].m_depth + 1 : 0;
+		node.m_lastFrame = 0;
+		node.m_lastMs = 0.0;
+		node.m_averageMs = 0.0;
+		node.m_minMs = 0.0;
+		node.m_maxMs = 0.0;
+		node.m_historyHead = 0;
+		m_nodes.push_back(node);
+		return (uint32_t)m_nodes.size() - 1;
+	}
+
+	void GpuTimingTree::UpdateStatistics(GpuTimingNode& node)
+	{
+		if (node.m_history.size() < m_historySize)
+		{
+			node.m_history.push_back(node.m_lastMs);
+		}
+		else
+		{
+			node.m_history[node.m_historyHead] = node.m_lastMs;
+			node.m_historyHead = (node.m_historyHead + 1) % m_historySize;
+		}
+
+		double sum = 0.0;
+		node.m_minMs = node.m_history[0];
+		node.m_maxMs = node.m_history[0];
+		for (double ms : node.m_history)
+		{
+			sum += ms;
+			node.m_minMs = std::min(node.m_minMs, ms);
+			node.m_maxMs = std::max(node.m_maxMs, ms);
+		}
+		node.m_averageMs = sum / node.m_history.size();
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Sigma
+{
+	const uint32_t kInvalidGpuScope = 0xffffffff;
+
+	// A timed region of a frame, as read back from the timestamp queries
+	struct GpuScope
+	{
+		const char* m_name;
+		uint32_t m_parent;	// Index of the enclosing scope in the same frame, always lower than this one, or kInvalidGpuScope
+		uint64_t m_begin;	// Timestamps, in GPU ticks
+		uint64_t m_end;
+	};
+
+	struct GpuTimingNode
+	{
+		std::string m_name;
+		uint32_t m_parent;	// Node index, or kInvalidGpuScope for roots
+		uint32_t m_depth;
+		uint64_t m_lastFrame;	// Last frame the node was timed in
+
+		// Milliseconds, a scope seen several times under the same parent in a frame counts as the sum
+		double m_lastMs;
+		// Over the frames the node was timed in, in the history window
+		double m_averageMs;
+		double m_minMs;
+		double m_maxMs;
+
+		std::vector<double> m_history;
+		uint32_t m_historyHead;
+	};
+
+	/*
+	Aggregates the GPU scopes of each frame into a tree of named nodes (Frame > Triangle > ...), with rolling statistics.
+	Nodes are identified by their name and parent node, so the same pass keeps the same node from frame to frame.
+	Does not depend on any graphics API, the timestamps come from GpuProfiler.
+	*/
+	class GpuTimingTree
+	{
+	public:
+		explicit GpuTimingTree(uint32_t historySize);
+
+		// Scopes with no valid timestamps (end <= begin) are ignored, with their children
+		void AddFrame(const GpuScope* scopes, size_t count, uint64_t frequency);
+
+		// Nodes are only added, a parent is always before its children
+		const std::vector<GpuTimingNode>& GetNodes() const { return m_nodes; }
+		// Finds a node by path, like "Frame/Triangle", returns nullptr if it was never timed
+		const GpuTimingNode* Find(const char* path) const;
+		uint64_t GetFrameCount() const { return m_frameCount; }
+
+		// One indented line per node timed in the last frame
+		std::string ToString() const;
+
+	private:
+		uint32_t FindOrAddNode(uint32_t parent, const char* name);
+		void UpdateStatistics(GpuTimingNode& node);
+
+		uint32_t m_historySize;
+		uint64_t m_frameCount;
+		std::vector<GpuTimingNode> m_nodes;
+		std::vector<uint32_t> m_scopeNodes;
+		std::vector<double> m_frameMs;
+	};
+}
@@ -0,0 +1,55 @@
+#include "HandlePool.h"
+
+namespace Sigma
+{
+	Handle HandlePool::Allocate()
+	{
+		uint32_t index;
+		if (!m_freeIndices.empty())
+		{
+			index = m_freeIndices.back();
+			m_freeIndices.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)m_generations.size();
+			m_generations.push_back(1);
+			m_sparseToDense.push_back(kInvalidDenseIndex);
+		}
+
+		m_sparseToDense[index] = (uint32_t)m_denseToSparse.size();
+		m_denseToSparse.push_back(index);
+
+		Handle handle = { index, m_generations[index] };
+		return handle;
+	}
+
+	uint32_t HandlePool::Free(Handle handle)
+	{
+		uint32_t denseIndex = GetDenseIndex(handle);
+		if (denseIndex == kInvalidDenseIndex)
+			return kInvalidDenseIndex;
+
+		// Skips 0 when wrapping around
+		uint32_t& generation = m_generations[handle.m_index];
+		generation = generation + 1 != 0 ? generation + 1 : 1;
+		m_sparseToDense[handle.m_index] = kInvalidDenseIndex;
+		m_freeIndices.push_back(handle.m_index);
+
+		uint32_t last = m_denseToSparse.back();
+		m_denseToSparse.pop_back();
+		if (denseIndex < m_denseToSparse.size())
+		{
+			m_denseToSparse[denseIndex] = last;
+			m_sparseToDense[last] = denseIndex;
+		}
+		return denseIndex;
+	}
+
+	Handle HandlePool::GetHandle(uint32_t denseIndex) const
+	{
+		uint32_t index = m_denseToSparse[denseIndex];
+		Handle handle = { index, m_generations[index] };
+		return handle;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Sigma
+{
+	const uint32_t kInvalidDenseIndex = 0xffffffff;
+
+	// Generation 0 is never used, so a zero initialized handle is invalid
+	struct Handle
+	{
+		uint32_t m_index;
+		uint32_t m_generation;
+
+		bool IsValid() const { return m_generation != 0; }
+		bool operator==(const Handle& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+		bool operator!=(const Handle& other) const { return !(*this == other); }
+	};
+
+	/*
+	Maps generational handles to indices in densely packed arrays, only deals with indices so the data can be laid out by
+	the owner (one array per field).
+
+	A handle keeps its index for its whole life, its generation is bumped when it is freed, so stale handles are detected
+	instead of reaching whatever reused the slot. Live elements stay packed at the start of the owner arrays : Free moves
+	the last one into the hole, and the owner has to move its data the same way.
+	*/
+	class HandlePool
+	{
+	public:
+		// The new element is at dense index GetCount() - 1
+		Handle Allocate();
+		// Returns the dense index the last element has to be moved to, kInvalidDenseIndex if the handle is stale.
+		// Nothing has to be moved when the freed element was the last one (the returned index is then GetCount())
+		uint32_t Free(Handle handle);
+
+		// kInvalidDenseIndex if the handle is stale
+		uint32_t GetDenseIndex(Handle handle) const
+		{
+			return handle.m_index < m_generations.size() && m_generations[handle.m_index] == handle.m_generation ? m_sparseToDense[handle.m_index] : kInvalidDenseIndex;
+		}
+		Handle GetHandle(uint32_t denseIndex) const;
+		uint32_t GetCount() const { return (uint32_t)m_denseToSparse.size(); }
+
+	private:
+		std::vector<uint32_t> m_generations;
+		std::vector<uint32_t> m_sparseToDense;
+		std::vector<uint32_t> m_denseToSparse;
+		std::vector<uint32_t> m_freeIndices;
+	};
+}
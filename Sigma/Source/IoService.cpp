@@ -0,0 +1,471 @@
+#include "IoService.h"
+#include <algorithm>
+#include <cmath>
+#include "CpuProfiler.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Sigma
+{
+	const intptr_t kInvalidFileHandle = -1;
+
+	// Nearest rank, on sorted values
+	static double PercentileMs(const std::vector<uint64_t>& sorted, double percentile)
+	{
+		size_t rank = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+		rank = std::max<size_t>(1, std::min(rank, sorted.size()));
+		return sorted[rank - 1] / 1000000.0;
+	}
+
+	static intptr_t OpenReadFile(const char* path, uint64_t& size, void* completionPort)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return kInvalidFileHandle;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || CreateIoCompletionPort(file, completionPort, 0, 0) == nullptr)
+		{
+			CloseHandle(file);
+			return kInvalidFileHandle;
+		}
+		size = (uint64_t)fileSize.QuadPart;
+		return (intptr_t)file;
+#else
+		(void)completionPort;
+		int file = open(path, O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			return kInvalidFileHandle;
+
+		struct stat status;
+		if (fstat(file, &status) != 0)
+		{
+			close(file);
+			return kInvalidFileHandle;
+		}
+		size = (uint64_t)status.st_size;
+		return file;
+#endif
+	}
+
+	static void CloseReadFile(intptr_t file)
+	{
+#ifdef _WIN32
+		CloseHandle((HANDLE)file);
+#else
+		close((int)file);
+#endif
+	}
+
+#ifndef _WIN32
+	// pread can return less than asked
+	static bool ReadFully(int file, uint64_t offset, uint64_t size, uint8_t* destination)
+	{
+		while (size > 0)
+		{
+			ssize_t bytesRead = pread(file, destination, (size_t)size, (off_t)offset);
+			if (bytesRead < 0 && errno == EINTR)
+				continue;
+			if (bytesRead <= 0)
+				return false;
+
+			offset += bytesRead;
+			size -= bytesRead;
+			destination += bytesRead;
+		}
+		return true;
+	}
+#endif
+
+	IoService::IoService(uint32_t queueDepth, uint64_t maxInFlightBytes) :
+		m_queueDepth(std::max(queueDepth, 1u)),
+		m_maxInFlightBytes(maxInFlightBytes),
+		m_nextRequestId(1),
+		m_inFlightReads(0),
+		m_inFlightBytes(0),
+		m_running(true),
+		m_completionPort(nullptr)
+	{
+		ResetStats();
+
+#ifdef _WIN32
+		// Overlapped reads do not block, one thread issues and completes all of them
+		m_completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+		m_threads.emplace_back(&IoService::ThreadMain, this);
+#else
+		for (uint32_t i = 0; i < m_queueDepth; i++)
+		{
+			m_threads.emplace_back(&IoService::ThreadMain, this);
+		}
+#endif
+	}
+
+	IoService::~IoService()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_running = false;
+
+			std::vector<RequestId> requests;
+			for (const auto& request : m_requests)
+			{
+				requests.push_back(request.first);
+			}
+			for (RequestId id : requests)
+			{
+				auto request = m_requests.find(id);
+				if (request == m_requests.end() || request->second.m_issuedBytes == request->second.m_size)
+					continue;
+
+				request->second.m_cancelled = true;
+				if (request->second.m_readsInFlight == 0)
+					FinishRequest(id, lock);
+			}
+		}
+
+		WakeUp();
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+
+		for (const File& file : m_files)
+		{
+			if (file.m_open)
+				CloseReadFile(file.m_handle);
+		}
+#ifdef _WIN32
+		CloseHandle(m_completionPort);
+#endif
+	}
+
+	uint32_t IoService::OpenFile(const char* path)
+	{
+		uint64_t size = 0;
+		intptr_t handle = OpenReadFile(path, size, m_completionPort);
+		if (handle == kInvalidFileHandle)
+			return kInvalidIoFile;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		File file = { handle, size, true };
+		for (uint32_t i = 0; i < m_files.size(); i++)
+		{
+			if (!m_files[i].m_open)
+			{
+				m_files[i] = file;
+				return i;
+			}
+		}
+		m_files.push_back(file);
+		return (uint32_t)m_files.size() - 1;
+	}
+
+	void IoService::CloseFile(uint32_t file)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (file < m_files.size() && m_files[file].m_open)
+		{
+			CloseReadFile(m_files[file].m_handle);
+			m_files[file].m_open = false;
+		}
+	}
+
+	uint64_t IoService::GetFileSize(uint32_t file) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return file < m_files.size() && m_files[file].m_open ? m_files[file].m_size : 0;
+	}
+
+	IoService::RequestId IoService::Read(uint32_t file, uint64_t offset, uint64_t size, void* destination, IoPriority priority, IoBatch* batch, Callback callback)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_running || file >= m_files.size() || !m_files[file].m_open || offset > m_files[file].m_size || size > m_files[file].m_size - offset)
+			return 0;
+
+		RequestId id = m_nextRequestId++;
+		Request& request = m_requests[id];
+		request.m_file = file;
+		request.m_offset = offset;
+		request.m_size = size;
+		request.m_destination = static_cast<uint8_t*>(destination);
+		request.m_priority = priority;
+		request.m_batch = batch;
+		request.m_callback = std::move(callback);
+		request.m_submitTime = CpuProfiler::Now();
+		request.m_issuedBytes = 0;
+		request.m_readsInFlight = 0;
+		request.m_cancelled = false;
+		request.m_failed = false;
+
+		if (batch != nullptr)
+			batch->m_pending++;
+		if (m_requests.size() == 1)
+			m_busySince = request.m_submitTime;
+
+		if (size == 0)
+		{
+			FinishRequest(id, lock);
+			return id;
+		}
+
+		m_queues[(uint32_t)priority].push_back(id);
+		lock.unlock();
+		WakeUp();
+		return id;
+	}
+
+	bool IoService::Cancel(RequestId id)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto request = m_requests.find(id);
+		if (request == m_requests.end() || request->second.m_cancelled || request->second.m_failed || request->second.m_issuedBytes == request->second.m_size)
+			return false;
+
+		// Its queue entry is skipped when reached
+		request->second.m_cancelled = true;
+		if (request->second.m_readsInFlight == 0)
+			FinishRequest(id, lock);
+		return true;
+	}
+
+	void IoService::Wait(IoBatch& batch)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_batchDone.wait(lock, [&batch]() { return batch.m_pending == 0; });
+	}
+
+	IoStats IoService::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		IoStats stats = {};
+		for (const auto& request : m_requests)
+		{
+			if (!request.second.m_cancelled && !request.second.m_failed && request.second.m_issuedBytes < request.second.m_size)
+				stats.m_queuedRequests++;
+		}
+		stats.m_inFlightReads = m_inFlightReads;
+		stats.m_inFlightBytes = m_inFlightBytes;
+		stats.m_completedRequests = m_completedRequests;
+		stats.m_cancelledRequests = m_cancelledRequests;
+		stats.m_failedRequests = m_failedRequests;
+		stats.m_completedBytes = m_completedBytes;
+
+		if (!m_latencies.empty())
+		{
+			std::vector<uint64_t> sorted = m_latencies;
+			std::sort(sorted.begin(), sorted.end());
+			stats.m_p50LatencyMs = PercentileMs(sorted, 50.0);
+			stats.m_p99LatencyMs = PercentileMs(sorted, 99.0);
+			stats.m_maxLatencyMs = sorted.back() / 1000000.0;
+		}
+
+		uint64_t busyTime = m_busyTime + (m_requests.empty() ? 0 : CpuProfiler::Now() - m_busySince);
+		if (busyTime > 0)
+			stats.m_throughputMBs = m_completedBytes / (1024.0 * 1024.0) / (busyTime / 1000000000.0);
+		return stats;
+	}
+
+	void IoService::ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_completedRequests = 0;
+		m_cancelledRequests = 0;
+		m_failedRequests = 0;
+		m_completedBytes = 0;
+		m_latencies.clear();
+		m_latencyHead = 0;
+		m_busyTime = 0;
+		m_busySince = CpuProfiler::Now();
+	}
+
+	IoService::Request* IoService::FindNextRequest()
+	{
+		for (std::deque<RequestId>& queue : m_queues)
+		{
+			// Entries of finished, cancelled or fully issued requests are dropped here
+			while (!queue.empty())
+			{
+				auto request = m_requests.find(queue.front());
+				if (request != m_requests.end() && !request->second.m_cancelled && !request->second.m_failed && request->second.m_issuedBytes < request->second.m_size)
+					return &request->second;
+				queue.pop_front();
+			}
+		}
+		return nullptr;
+	}
+
+	bool IoService::TakeChunk(Chunk& chunk)
+	{
+		Request* request = m_running && m_inFlightReads < m_queueDepth ? FindNextRequest() : nullptr;
+		if (request == nullptr)
+			return false;
+
+		// Lower priorities wait as well, a request bigger than the budget is read alone
+		uint64_t size = std::min(request->m_size - request->m_issuedBytes, kIoChunkSize);
+		if (m_inFlightBytes != 0 && m_inFlightBytes + size > m_maxInFlightBytes)
+			return false;
+
+		chunk.m_request = m_queues[(uint32_t)request->m_priority].front();
+		chunk.m_file = m_files[request->m_file].m_handle;
+		chunk.m_offset = request->m_offset + request->m_issuedBytes;
+		chunk.m_size = size;
+		chunk.m_destination = request->m_destination + request->m_issuedBytes;
+
+		request->m_issuedBytes += size;
+		request->m_readsInFlight++;
+		m_inFlightReads++;
+		m_inFlightBytes += size;
+		return true;
+	}
+
+	void IoService::CompleteChunk(const Chunk& chunk, bool success, std::unique_lock<std::mutex>& lock)
+	{
+		m_inFlightReads--;
+		m_inFlightBytes -= chunk.m_size;
+
+		Request& request = m_requests[chunk.m_request];
+		request.m_readsInFlight--;
+		request.m_failed = request.m_failed || !success;
+		if (request.m_readsInFlight == 0 && (request.m_issuedBytes == request.m_size || request.m_cancelled || request.m_failed))
+			FinishRequest(chunk.m_request, lock);
+	}
+
+	void IoService::FinishRequest(RequestId id, std::unique_lock<std::mutex>& lock)
+	{
+		auto found = m_requests.find(id);
+		Request request = std::move(found->second);
+		m_requests.erase(found);
+
+		uint64_t now = CpuProfiler::Now();
+		IoStatus status = request.m_failed ? IoStatus::Failed : (request.m_cancelled ? IoStatus::Cancelled : IoStatus::Completed);
+		if (status == IoStatus::Completed)
+		{
+			m_completedRequests++;
+			m_completedBytes += request.m_size;
+			if (m_latencies.size() < kLatencyHistory)
+				m_latencies.push_back(now - request.m_submitTime);
+			else
+				m_latencies[m_latencyHead] = now - request.m_submitTime;
+			m_latencyHead = (m_latencyHead + 1) % kLatencyHistory;
+		}
+		else if (status == IoStatus::Cancelled)
+		{
+			m_cancelledRequests++;
+		}
+		else
+		{
+			m_failedRequests++;
+		}
+
+		if (m_requests.empty())
+			m_busyTime += now - m_busySince;
+
+		lock.unlock();
+		if (request.m_callback)
+			request.m_callback(id, status);
+		if (request.m_batch != nullptr)
+		{
+			if (status != IoStatus::Completed)
+				request.m_batch->m_failed++;
+			request.m_batch->m_pending--;
+		}
+		lock.lock();
+		m_batchDone.notify_all();
+	}
+
+	void IoService::WakeUp()
+	{
+#ifdef _WIN32
+		PostQueuedCompletionStatus(m_completionPort, 0, 0, nullptr);
+#else
+		m_wakeUp.notify_all();
+#endif
+	}
+
+	void IoService::ThreadMain()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+#ifdef _WIN32
+		// The OVERLAPPED comes first, completions are cast back to their read
+		struct PendingRead
+		{
+			OVERLAPPED m_overlapped;
+			Chunk m_chunk;
+		};
+		std::vector<PendingRead> reads(m_queueDepth);
+		std::vector<PendingRead*> freeReads;
+		for (PendingRead& read : reads)
+		{
+			freeReads.push_back(&read);
+		}
+
+		while (m_running || m_inFlightReads != 0)
+		{
+			Chunk chunk;
+			while (TakeChunk(chunk))
+			{
+				PendingRead* read = freeReads.back();
+				freeReads.pop_back();
+				read->m_overlapped = {};
+				read->m_overlapped.Offset = (DWORD)chunk.m_offset;
+				read->m_overlapped.OffsetHigh = (DWORD)(chunk.m_offset >> 32);
+				read->m_chunk = chunk;
+
+				lock.unlock();
+				bool issued = ReadFile((HANDLE)chunk.m_file, chunk.m_destination, (DWORD)chunk.m_size, nullptr, &read->m_overlapped) || GetLastError() == ERROR_IO_PENDING;
+				lock.lock();
+				if (!issued)
+				{
+					freeReads.push_back(read);
+					CompleteChunk(chunk, false, lock);
+				}
+			}
+
+			lock.unlock();
+			DWORD bytesRead = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+			BOOL success = GetQueuedCompletionStatus(m_completionPort, &bytesRead, &key, &overlapped, INFINITE);
+			lock.lock();
+
+			// Packets without OVERLAPPED only wake the thread up
+			if (overlapped != nullptr)
+			{
+				PendingRead* read = reinterpret_cast<PendingRead*>(overlapped);
+				freeReads.push_back(read);
+				CompleteChunk(read->m_chunk, success && bytesRead == read->m_chunk.m_size, lock);
+			}
+		}
+#else
+		while (true)
+		{
+			Chunk chunk;
+			m_wakeUp.wait(lock, [this, &chunk]() { return !m_running || TakeChunk(chunk); });
+			if (!m_running)
+				break;
+
+			lock.unlock();
+			bool success = ReadFully((int)chunk.m_file, chunk.m_offset, chunk.m_size, chunk.m_destination);
+			lock.lock();
+			CompleteChunk(chunk, success, lock);
+
+			// The budget freed can let other threads issue
+			m_wakeUp.notify_all();
+		}
+#endif
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Sigma
+{
+	const uint32_t kInvalidIoFile = 0xffffffff;
+	const uint64_t kIoChunkSize = 1024 * 1024; // Larger reads are split, so they are spread over the queue depth
+
+	// Served strictly in this order
+	enum class IoPriority
+	{
+		Critical,
+		High,
+		Normal,
+		Low,
+		Count,
+	};
+
+	enum class IoStatus
+	{
+		Completed,
+		Cancelled,
+		Failed, // Error or end of file before the requested size
+	};
+
+	// Number of reads still to be completed, used to wait for a group of reads
+	struct IoBatch
+	{
+		std::atomic<uint32_t> m_pending{ 0 };
+		std::atomic<uint32_t> m_failed{ 0 }; // Failed or cancelled
+	};
+
+	struct IoStats
+	{
+		uint32_t m_queuedRequests; // Not fully issued yet
+		uint32_t m_inFlightReads;
+		uint64_t m_inFlightBytes;
+		uint64_t m_completedRequests;
+		uint64_t m_cancelledRequests;
+		uint64_t m_failedRequests;
+		uint64_t m_completedBytes;
+		// From Read to completion, over the last kLatencyHistory requests
+		double m_p50LatencyMs;
+		double m_p99LatencyMs;
+		double m_maxLatencyMs;
+		// Completed bytes over the time requests were pending
+		double m_throughputMBs;
+	};
+
+	/*
+	Asynchronous file reads into caller owned memory (upload heap memory works, it is only written), with priorities,
+	cancellation and a bound on the bytes being read at once.
+
+	Requests are split in chunks of kIoChunkSize, the next chunk is always taken from the highest priority request queued
+	first, and only issued if it fits in the in-flight budget : a low priority stream can not delay critical reads by more
+	than the chunks already issued. Up to queueDepth chunks are read at the same time.
+	On Windows chunks are overlapped reads issued and completed by a single thread through a completion port, elsewhere
+	every thread of a pool does blocking preads.
+
+	Callbacks run on the I/O threads (or in Cancel), they should only hand the result over.
+	*/
+	class IoService
+	{
+	public:
+		typedef uint64_t RequestId; // 0 is never returned
+		typedef std::function<void(RequestId request, IoStatus status)> Callback;
+
+		static const uint32_t kLatencyHistory = 4096;
+
+		IoService(uint32_t queueDepth, uint64_t maxInFlightBytes);
+		// Cancels queued requests, waits for the reads in flight
+		~IoService();
+
+		// Returns kInvalidIoFile if the file can not be opened
+		uint32_t OpenFile(const char* path);
+		// No request can be pending on the file
+		void CloseFile(uint32_t file);
+		uint64_t GetFileSize(uint32_t file) const;
+
+		RequestId Read(uint32_t file, uint64_t offset, uint64_t size, void* destination, IoPriority priority, IoBatch* batch = nullptr, Callback callback = nullptr);
+		// Returns false if the request was already fully issued. Otherwise it completes as cancelled once its chunks in
+		// flight are done, the destination can not be reused before that
+		bool Cancel(RequestId request);
+
+		bool IsComplete(const IoBatch& batch) const { return batch.m_pending == 0; }
+		void Wait(IoBatch& batch);
+
+		IoStats GetStats() const;
+		void ResetStats();
+
+	private:
+		struct File
+		{
+			intptr_t m_handle;
+			uint64_t m_size;
+			bool m_open;
+		};
+
+		struct Request
+		{
+			uint32_t m_file;
+			uint64_t m_offset;
+			uint64_t m_size;
+			uint8_t* m_destination;
+			IoPriority m_priority;
+			IoBatch* m_batch;
+			Callback m_callback;
+			uint64_t m_submitTime;
+
+			uint64_t m_issuedBytes;
+			uint32_t m_readsInFlight;
+			bool m_cancelled;
+			bool m_failed;
+		};
+
+		struct Chunk
+		{
+			RequestId m_request;
+			intptr_t m_file;
+			uint64_t m_offset;
+			uint64_t m_size;
+			uint8_t* m_destination;
+		};
+
+		// All called with the mutex locked. Finishing a request unlocks it during the callback
+		Request* FindNextRequest();
+		bool TakeChunk(Chunk& chunk);
+		void CompleteChunk(const Chunk& chunk, bool success, std::unique_lock<std::mutex>& lock);
+		void FinishRequest(RequestId id, std::unique_lock<std::mutex>& lock);
+
+		void WakeUp();
+		void ThreadMain();
+
+		uint32_t m_queueDepth;
+		uint64_t m_maxInFlightBytes;
+		std::vector<File> m_files;
+
+		std::unordered_map<RequestId, Request> m_requests;
+		std::deque<RequestId> m_queues[(uint32_t)IoPriority::Count];
+		RequestId m_nextRequestId;
+		uint32_t m_inFlightReads;
+		uint64_t m_inFlightBytes;
+		bool m_running;
+
+		// Statistics
+		uint64_t m_completedRequests;
+		uint64_t m_cancelledRequests;
+		uint64_t m_failedRequests;
+		uint64_t m_completedBytes;
+		std::vector<uint64_t> m_latencies;
+		uint32_t m_latencyHead;
+		uint64_t m_busyTime;
+		uint64_t m_busySince;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wakeUp;
+		std::condition_variable m_batchDone;
+		std::vector<std::thread> m_threads;
+		void* m_completionPort; // Windows only
+	};
+}
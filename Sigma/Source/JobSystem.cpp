@@ -0,0 +1,178 @@
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <string>
+
+namespace Sigma
+{
+	static thread_local uint32_t t_threadIndex = JobSystem::kInvalidThreadIndex;
+
+	JobSystem::JobSystem(uint32_t numWorkers, uint32_t numExternalThreads) :
+		m_numExternalThreads(std::max(numExternalThreads, 1u)),
+		m_nextExternalThread(1),
+		m_pendingJobs(0),
+		m_running(true)
+	{
+		if (numWorkers == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		for (uint32_t i = 0; i < m_numExternalThreads + numWorkers; i++)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+
+		t_threadIndex = 0;
+		for (uint32_t i = m_numExternalThreads; i < m_queues.size(); i++)
+		{
+			m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_running = false;
+		}
+		m_wakeUp.notify_all();
+
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	uint32_t JobSystem::RegisterThread()
+	{
+		if (t_threadIndex < m_queues.size())
+			return t_threadIndex;
+
+		uint32_t index = m_nextExternalThread.fetch_add(1);
+		if (index >= m_numExternalThreads)
+			return kInvalidThreadIndex;
+
+		t_threadIndex = index;
+		return index;
+	}
+
+	uint32_t JobSystem::GetThreadIndex()
+	{
+		return t_threadIndex;
+	}
+
+	uint32_t JobSystem::GetQueueIndex() const
+	{
+		return t_threadIndex < m_queues.size() ? t_threadIndex : 0;
+	}
+
+	void JobSystem::Run(Job job, JobCounter* counter)
+	{
+		if (counter != nullptr)
+			counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+		Task task;
+		task.m_job = std::move(job);
+		task.m_counter = counter;
+
+		Queue& queue = *m_queues[GetQueueIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_tasks.push_back(std::move(task));
+		}
+
+		// Taking the lock makes sure a worker about to sleep sees the new job
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_pendingJobs.fetch_add(1);
+		}
+		m_wakeUp.notify_one();
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		while (counter.m_value.load(std::memory_order_acquire) > 0)
+		{
+			if (!TryRunOne(GetQueueIndex()))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t)>& func)
+	{
+		JobCounter counter;
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+		{
+			uint32_t end = std::min(begin + batchSize, count);
+			Run([&func, begin, end]()
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					func(i);
+				}
+			}, &counter);
+		}
+		Wait(counter);
+	}
+
+	bool JobSystem::TryRunOne(uint32_t threadIndex)
+	{
+		Task task;
+		bool found = false;
+
+		// Own queue first, newest job
+		{
+			Queue& queue = *m_queues[threadIndex];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (!queue.m_tasks.empty())
+			{
+				task = std::move(queue.m_tasks.back());
+				queue.m_tasks.pop_back();
+				found = true;
+			}
+		}
+
+		// Then steal the oldest job of another thread
+		for (uint32_t i = 1; !found && i < m_queues.size(); i++)
+		{
+			Queue& queue = *m_queues[(threadIndex + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (!queue.m_tasks.empty())
+			{
+				task = std::move(queue.m_tasks.front());
+				queue.m_tasks.pop_front();
+				found = true;
+			}
+		}
+
+		if (!found)
+			return false;
+
+		m_pendingJobs.fetch_sub(1);
+		task.m_job();
+
+		if (task.m_counter != nullptr)
+			task.m_counter->m_value.fetch_sub(1, std::memory_order_release);
+
+		return true;
+	}
+
+	void JobSystem::WorkerMain(uint32_t threadIndex)
+	{
+		t_threadIndex = threadIndex;
+		CpuProfiler::SetThreadName(("Worker " + std::to_string(threadIndex)).c_str());
+
+		while (m_running)
+		{
+			if (!TryRunOne(threadIndex))
+			{
+				std::unique_lock<std::mutex> lock(m_sleepMutex);
+				m_wakeUp.wait(lock, [this]() { return m_pendingJobs > 0 || !m_running; });
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Sigma
+{
+	// Number of jobs still to be completed, used to wait for a group of jobs
+	struct JobCounter
+	{
+		std::atomic<uint32_t> m_value{ 0 };
+	};
+
+	/*
+	Work-stealing job scheduler.
+
+	Every thread owns a job queue : a thread pushes and pops its own jobs from the back (most recent first, still hot in cache)
+	and idle threads steal from the front of the other queues. Waiting on a counter runs other jobs instead of blocking,
+	so jobs can spawn and wait on jobs.
+
+	Thread indices 0 to numExternalThreads - 1 are reserved for threads outside of the job system : 0 is the one that created it,
+	the others get theirs from RegisterThread. Workers come after them. Every index, and so every per-thread slot indexed by
+	GetThreadIndex (command lists...), is used by a single thread.
+	Threads that did not register can still run and wait on jobs through queue 0, but have no index of their own.
+	*/
+	class JobSystem
+	{
+	public:
+		typedef std::function<void()> Job;
+
+		static const uint32_t kInvalidThreadIndex = 0xffffffff;
+
+		// numWorkers = 0 picks one worker per hardware thread, minus the calling thread
+		JobSystem(uint32_t numWorkers = 0, uint32_t numExternalThreads = 1);
+		~JobSystem();
+
+		// Gives the calling thread one of the reserved external indices, kInvalidThreadIndex once they are all taken
+		uint32_t RegisterThread();
+
+		void Run(Job job, JobCounter* counter = nullptr);
+		void Wait(JobCounter& counter);
+
+		// Splits [0, count) in batches of batchSize and waits for all of them
+		void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t)>& func);
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_queues.size(); }
+		// kInvalidThreadIndex on a thread that is neither a worker nor registered
+		static uint32_t GetThreadIndex();
+
+	private:
+		struct Task
+		{
+			Job m_job;
+			JobCounter* m_counter;
+		};
+
+		struct Queue
+		{
+			std::mutex m_mutex;
+			std::deque<Task> m_tasks;
+		};
+
+		uint32_t GetQueueIndex() const;
+		bool TryRunOne(uint32_t threadIndex);
+		void WorkerMain(uint32_t threadIndex);
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_workers;
+		uint32_t m_numExternalThreads;
+		std::atomic<uint32_t> m_nextExternalThread;
+
+		std::atomic<int32_t> m_pendingJobs;
+		std::atomic<bool> m_running;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeUp;
+	};
+}
@@ -0,0 +1,70 @@
+#include "LatencyBenchmark.h"
+#include <fstream>
+
+namespace Sigma
+{
+	LatencyBenchmark::LatencyBenchmark(uint32_t warmupFrames, uint32_t measuredFrames) :
+		m_warmupFrames(warmupFrames),
+		m_measuredFrames(measuredFrames),
+		m_running(false),
+		m_modeIndex(0),
+		m_frame(0)
+	{
+	}
+
+	void LatencyBenchmark::Start(const std::vector<LatencyMode>& modes)
+	{
+		m_modes = modes;
+		m_modeIndex = 0;
+		m_frame = 0;
+		m_results.clear();
+		m_running = !m_modes.empty();
+	}
+
+	bool LatencyBenchmark::AdvanceFrame(FramePacingStats& stats)
+	{
+		if (!m_running)
+			return false;
+
+		m_frame++;
+		if (m_frame == m_warmupFrames)
+			stats.Clear();
+
+		if (m_frame < m_warmupFrames + m_measuredFrames)
+			return false;
+
+		LatencyBenchmarkResult result;
+		result.m_mode = m_modes[m_modeIndex];
+		result.m_summary = stats.ComputeSummary();
+		m_results.push_back(result);
+
+		m_frame = 0;
+		m_modeIndex++;
+		if (m_modeIndex == m_modes.size())
+		{
+			m_running = false;
+			m_modeIndex = 0;
+		}
+		return true;
+	}
+
+	bool LatencyBenchmark::WriteCsv(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		file << "frames_in_flight,vsync,frames,average_ms,fps,p50_ms,p99_ms,p99_9_ms,hitches,latency_ms,queued_frames\n";
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (const LatencyBenchmarkResult& result : m_results)
+		{
+			const FramePacingSummary& summary = result.m_summary;
+			double fps = summary.m_averageMs > 0.0 ? 1000.0 / summary.m_averageMs : 0.0;
+			file << result.m_mode.m_framesInFlight << "," << (result.m_mode.m_vsync ? 1 : 0) << "," << summary.m_frameCount << ","
+				<< summary.m_averageMs << "," << fps << "," << summary.m_p50Ms << "," << summary.m_p99Ms << "," << summary.m_p999Ms << ","
+				<< summary.m_hitchCount << "," << summary.m_latencyMs << "," << summary.m_queuedFrames << "\n";
+		}
+		return (bool)file;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "FramePacing.h"
+
+namespace Sigma
+{
+	struct LatencyMode
+	{
+		uint32_t m_framesInFlight;
+		bool m_vsync; // Without vsync, frames are presented immediately (with tearing when supported)
+	};
+
+	struct LatencyBenchmarkResult
+	{
+		LatencyMode m_mode;
+		FramePacingSummary m_summary;
+	};
+
+	/*
+	Runs the game in each latency mode in turn, to compare their throughput (frame time) and latency.
+	Every mode first runs warm up frames, so the queue settles, then the frame pacing statistics are cleared and
+	recorded once the measured frames are done.
+	*/
+	class LatencyBenchmark
+	{
+	public:
+		LatencyBenchmark(uint32_t warmupFrames, uint32_t measuredFrames);
+
+		void Start(const std::vector<LatencyMode>& modes);
+		bool IsRunning() const { return m_running; }
+		// The mode the frames should run in
+		const LatencyMode& GetMode() const { return m_modes[m_modeIndex]; }
+
+		// At the end of every frame while running, returns true when the mode changes : to GetMode(), or back to the
+		// mode used before the benchmark once it is no longer running
+		bool AdvanceFrame(FramePacingStats& stats);
+
+		const std::vector<LatencyBenchmarkResult>& GetResults() const { return m_results; }
+		// Returns false if the file could not be written
+		bool WriteCsv(const char* path) const;
+
+	private:
+		uint32_t m_warmupFrames;
+		uint32_t m_measuredFrames;
+
+		bool m_running;
+		std::vector<LatencyMode> m_modes;
+		uint32_t m_modeIndex;
+		uint32_t m_frame; // In the current mode
+		std::vector<LatencyBenchmarkResult> m_results;
+	};
+}
@@ -0,0 +1,37 @@
+#include "LinearAllocator.h"
+#include <algorithm>
+
+namespace Sigma
+{
+	LinearAllocator::LinearAllocator(uint64_t size, uint64_t alignment) :
+		m_size(size),
+		m_alignment(alignment),
+		m_head(0),
+		m_allocationCount(0)
+	{
+	}
+
+	uint64_t LinearAllocator::Allocate(uint64_t size)
+	{
+		uint64_t alignedSize = AlignUp(size, m_alignment);
+		uint64_t offset = m_head.fetch_add(alignedSize, std::memory_order_relaxed);
+
+		// The head keeps moving past the end once full, which is fine until Reset
+		if (offset + alignedSize > m_size)
+			return kInvalidOffset;
+
+		m_allocationCount.fetch_add(1, std::memory_order_relaxed);
+		return offset;
+	}
+
+	void LinearAllocator::Reset()
+	{
+		m_head.store(0, std::memory_order_relaxed);
+		m_allocationCount.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t LinearAllocator::GetUsedSize() const
+	{
+		return std::min(m_head.load(std::memory_order_relaxed), m_size);
+	}
+}
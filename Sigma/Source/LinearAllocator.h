@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "RingAllocator.h"
+
+namespace Sigma
+{
+	/*
+	Lock-free bump allocator, only deals with offsets so it can be used on any kind of memory.
+	Every allocation is rounded up to the same alignment, so a single fetch_add is enough and any number of threads
+	can allocate at the same time. Memory is only ever reclaimed all at once, by Reset.
+	*/
+	class LinearAllocator
+	{
+	public:
+		LinearAllocator(uint64_t size, uint64_t alignment);
+
+		// Returns kInvalidOffset if there is not enough space left
+		uint64_t Allocate(uint64_t size);
+
+		// Not thread safe, nothing may allocate during a reset
+		void Reset();
+
+		uint64_t GetSize() const { return m_size; }
+		uint64_t GetUsedSize() const;
+		uint64_t GetAllocationCount() const { return m_allocationCount.load(std::memory_order_relaxed); }
+
+	private:
+		uint64_t m_size;
+		uint64_t m_alignment;
+		std::atomic<uint64_t> m_head;
+		std::atomic<uint64_t> m_allocationCount;
+	};
+}
@@ -0,0 +1,501 @@
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include "JobSystem.h"
+
+namespace Sigma
+{
+	const uint32_t kFloatsPerJob = 64 * 1024;
+	const float kKaiserAlpha = 4.0f;
+	const float kKaiserRadius = 3.0f; // In source texels
+	const float kPi = 3.14159265358979f;
+
+	// sRGB encoding is a lookup indexed by the top bits of the float, 10 mantissa bits per octave :
+	// half a bucket is at most 0.03 of an 8 bit step. Below the first bucket everything encodes to 0
+	const float kSrgbEncodeMin = 1.0f / 8192.0f;
+	const uint32_t kSrgbEncodeShift = 13;
+
+	static uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	static float BitsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	static float SrgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float LinearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	struct SrgbTables
+	{
+		float m_toLinear[256];
+		std::vector<uint8_t> m_fromLinear;
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				m_toLinear[i] = SrgbToLinear(i / 255.0f);
+			}
+
+			// Each entry encodes the middle of its bucket, the last one is 1.0
+			uint32_t minBits = FloatBits(kSrgbEncodeMin);
+			uint32_t count = ((FloatBits(1.0f) - minBits) >> kSrgbEncodeShift) + 1;
+			m_fromLinear.resize(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				float value = std::min(BitsFloat(minBits + (i << kSrgbEncodeShift) + (1 << (kSrgbEncodeShift - 1))), 1.0f);
+				m_fromLinear[i] = (uint8_t)(LinearToSrgb(value) * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	static const SrgbTables& GetSrgbTables()
+	{
+		static SrgbTables tables;
+		return tables;
+	}
+
+	// Halves in the low 16 bits of each lane, denormals, infinities and NaNs are kept
+	static inline __m128 HalfToFloat(__m128i halves)
+	{
+		const __m128i noSign = _mm_set1_epi32(0x7fff);
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+		const __m128i wasInfNan = _mm_set1_epi32(0x7bff);
+		const __m128i infNanExponent = _mm_set1_epi32(255 << 23);
+
+		__m128i exponentMantissa = _mm_and_si128(noSign, halves);
+		__m128i sign = _mm_slli_epi32(_mm_xor_si128(halves, exponentMantissa), 16);
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), magic);
+		__m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(exponentMantissa, wasInfNan), infNanExponent);
+		return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan)));
+	}
+
+	// Rounds to nearest even, overflows to infinity. Halves are returned in the low 16 bits of each lane
+	static inline __m128i FloatToHalf(__m128 values)
+	{
+		const __m128i signMask = _mm_set1_epi32((int)0x80000000);
+		const __m128i halfOverflow = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i nanBit = _mm_set1_epi32(0x200);
+		const __m128i infinity = _mm_set1_epi32(0x7c00);
+		const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+		const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+		__m128i bits = _mm_castps_si128(values);
+		__m128i sign = _mm_and_si128(bits, signMask);
+		__m128i absolute = _mm_xor_si128(bits, sign);
+		__m128 absoluteFloat = _mm_castsi128_ps(absolute);
+
+		__m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absoluteFloat, absoluteFloat));
+		__m128i isRegular = _mm_cmpgt_epi32(halfOverflow, absolute);
+		__m128i infOrNan = _mm_or_si128(_mm_and_si128(isNan, nanBit), infinity);
+
+		// The float addition rounds the mantissa of subnormals
+		__m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absolute);
+		__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absoluteFloat, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+		// Rebias the exponent and round, ties go to the even mantissa
+		__m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absolute, 31 - 13), 31);
+		__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absolute, normalBias), mantissaOdd), 13);
+
+		__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+		__m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNan));
+		return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+	}
+
+	// Packs the low 16 bits of each lane, packs_epi32 saturates so they are sign extended first
+	static inline __m128i PackHalves(__m128i a, __m128i b)
+	{
+		return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+	}
+
+	static void DecodeUnorm8(const uint8_t* src, float* dst, uint32_t count)
+	{
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		const __m128i zero = _mm_setzero_si128();
+
+		uint32_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+			_mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+			_mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+		}
+
+		for (; i < count; i++)
+		{
+			dst[i] = src[i] * (1.0f / 255.0f);
+		}
+	}
+
+	static void DecodeSrgb(const uint8_t* src, float* dst, uint32_t numTexels)
+	{
+		const float* toLinear = GetSrgbTables().m_toLinear;
+		for (uint32_t i = 0; i < numTexels * 4; i += 4)
+		{
+			dst[i] = toLinear[src[i]];
+			dst[i + 1] = toLinear[src[i + 1]];
+			dst[i + 2] = toLinear[src[i + 2]];
+			dst[i + 3] = src[i + 3] * (1.0f / 255.0f);
+		}
+	}
+
+	static void DecodeHalf(const uint8_t* src, float* dst, uint32_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(uint16_t)));
+			_mm_storeu_ps(dst + i, HalfToFloat(_mm_unpacklo_epi16(halves, zero)));
+			_mm_storeu_ps(dst + i + 4, HalfToFloat(_mm_unpackhi_epi16(halves, zero)));
+		}
+
+		// The rest goes through the same path, padded
+		if (i < count)
+		{
+			uint16_t halves[8] = {};
+			float values[8];
+			memcpy(halves, src + i * sizeof(uint16_t), (count - i) * sizeof(uint16_t));
+			DecodeHalf(reinterpret_cast<const uint8_t*>(halves), values, 8);
+			memcpy(dst + i, values, (count - i) * sizeof(float));
+		}
+	}
+
+	static void EncodeUnorm8(const float* src, uint8_t* dst, uint32_t count)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		uint32_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i values[4];
+			for (uint32_t j = 0; j < 4; j++)
+			{
+				__m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + j * 4), zero), one);
+				values[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half));
+			}
+			__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+		}
+
+		for (; i < count; i++)
+		{
+			dst[i] = (uint8_t)(std::min(std::max(src[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	static void EncodeSrgb(const float* src, uint8_t* dst, uint32_t numTexels)
+	{
+		const uint8_t* fromLinear = GetSrgbTables().m_fromLinear.data();
+		const __m128 minimum = _mm_set1_ps(kSrgbEncodeMin);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128i minBits = _mm_set1_epi32(FloatBits(kSrgbEncodeMin));
+
+		for (uint32_t i = 0; i < numTexels; i++)
+		{
+			__m128 texel = _mm_loadu_ps(src + i * 4);
+			__m128 clamped = _mm_min_ps(_mm_max_ps(texel, minimum), one);
+			uint32_t indices[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(clamped), minBits), kSrgbEncodeShift));
+
+			dst[i * 4] = fromLinear[indices[0]];
+			dst[i * 4 + 1] = fromLinear[indices[1]];
+			dst[i * 4 + 2] = fromLinear[indices[2]];
+			dst[i * 4 + 3] = (uint8_t)(std::min(std::max(src[i * 4 + 3], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	static void EncodeHalf(const float* src, uint8_t* dst, uint32_t count)
+	{
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i halves = PackHalves(FloatToHalf(_mm_loadu_ps(src + i)), FloatToHalf(_mm_loadu_ps(src + i + 4)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * sizeof(uint16_t)), halves);
+		}
+
+		if (i < count)
+		{
+			float values[8] = {};
+			uint16_t halves[8];
+			memcpy(values, src + i, (count - i) * sizeof(float));
+			EncodeHalf(values, reinterpret_cast<uint8_t*>(halves), 8);
+			memcpy(dst + i * sizeof(uint16_t), halves, (count - i) * sizeof(uint16_t));
+		}
+	}
+
+	static uint32_t GetChannelCount(MipFormat format)
+	{
+		return format == MipFormat::R8 ? 1 : 4;
+	}
+
+	static float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			float factor = x / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	MipGenerator::MipGenerator(JobSystem* jobSystem) :
+		m_jobSystem(jobSystem),
+		m_format(MipFormat::RGBA8),
+		m_source(nullptr),
+		m_sourceRowPitch(0)
+	{
+		m_box.m_numTaps = 2;
+		m_box.m_offsets[0] = 0;
+		m_box.m_offsets[1] = 1;
+		m_box.m_weights[0] = 0.5f;
+		m_box.m_weights[1] = 0.5f;
+
+		// Half band sinc, destination texels are centered between two source texels
+		m_kaiser.m_numTaps = kMaxTaps;
+		float sum = 0.0f;
+		for (uint32_t i = 0; i < kMaxTaps; i++)
+		{
+			int32_t offset = (int32_t)i - (int32_t)kMaxTaps / 2 + 1;
+			float distance = offset - 0.5f;
+			float x = distance * 0.5f * kPi;
+			float sinc = sinf(x) / x;
+			float t = distance / kKaiserRadius;
+			float window = BesselI0(kKaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(kKaiserAlpha);
+
+			m_kaiser.m_offsets[i] = offset;
+			m_kaiser.m_weights[i] = sinc * window;
+			sum += m_kaiser.m_weights[i];
+		}
+		for (uint32_t i = 0; i < kMaxTaps; i++)
+		{
+			m_kaiser.m_weights[i] /= sum;
+		}
+	}
+
+	void MipGenerator::Generate(MipFormat format, MipFilter filter, const void* source, uint64_t sourceRowPitch, uint32_t width, uint32_t height, uint32_t numLevels)
+	{
+		m_format = format;
+		m_source = reinterpret_cast<const uint8_t*>(source);
+		m_sourceRowPitch = sourceRowPitch;
+		m_levels.resize(std::min(std::max(numLevels, 1u), GetFullChainLevelCount(width, height)));
+
+		uint32_t channels = GetChannelCount(format);
+		Level& first = m_levels[0];
+		first.m_width = width;
+		first.m_height = height;
+		first.m_texels.resize((size_t)width * height * channels);
+		ForEachRows(height, width * channels, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t y = firstRow; y < endRow; y++)
+			{
+				const uint8_t* src = m_source + y * m_sourceRowPitch;
+				float* dst = first.m_texels.data() + (size_t)y * width * channels;
+				if (format == MipFormat::RGBA8Srgb)
+					DecodeSrgb(src, dst, width);
+				else if (format == MipFormat::RGBA16F)
+					DecodeHalf(src, dst, width * channels);
+				else
+					DecodeUnorm8(src, dst, width * channels);
+			}
+		});
+
+		const Filter& levelFilter = filter == MipFilter::Kaiser ? m_kaiser : m_box;
+		for (uint32_t level = 1; level < m_levels.size(); level++)
+		{
+			Downsample(m_levels[level - 1], m_levels[level], levelFilter, channels);
+		}
+	}
+
+	void MipGenerator::Write(uint32_t level, const TextureRows& rows) const
+	{
+		// Level 0 is exactly the source
+		if (level == 0)
+		{
+			CopyTextureRows(rows, m_source, m_sourceRowPitch, 0, TexelConversion::None);
+			return;
+		}
+
+		const Level& source = m_levels[level];
+		uint32_t channels = GetChannelCount(m_format);
+		ForEachRows(source.m_height, source.m_width * channels, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t y = firstRow; y < endRow; y++)
+			{
+				const float* src = source.m_texels.data() + (size_t)y * source.m_width * channels;
+				uint8_t* dst = rows.m_data + y * rows.m_rowPitch;
+				if (m_format == MipFormat::RGBA8Srgb)
+					EncodeSrgb(src, dst, source.m_width);
+				else if (m_format == MipFormat::RGBA16F)
+					EncodeHalf(src, dst, source.m_width * channels);
+				else
+					EncodeUnorm8(src, dst, source.m_width * channels);
+			}
+		});
+	}
+
+	uint32_t MipGenerator::GetFullChainLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t count = 1;
+		while (width > 1 || height > 1)
+		{
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			count++;
+		}
+		return count;
+	}
+
+	uint32_t MipGenerator::GetTexelSize(MipFormat format)
+	{
+		switch (format)
+		{
+		case MipFormat::RGBA16F:
+			return 8;
+		case MipFormat::R8:
+			return 1;
+		default:
+			return 4;
+		}
+	}
+
+	void MipGenerator::Downsample(const Level& source, Level& destination, const Filter& filter, uint32_t channels)
+	{
+		destination.m_width = std::max(source.m_width / 2, 1u);
+		destination.m_height = std::max(source.m_height / 2, 1u);
+		destination.m_texels.resize((size_t)destination.m_width * destination.m_height * channels);
+
+		int32_t lastColumn = (int32_t)source.m_width - 1;
+		int32_t lastRow = (int32_t)source.m_height - 1;
+		uint32_t sourceRowSize = source.m_width * channels;
+		ForEachRows(destination.m_height, sourceRowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			std::vector<float> filtered(sourceRowSize);
+			for (uint32_t y = firstRow; y < endRow; y++)
+			{
+				// Vertical pass, the same for any number of channels
+				const float* rows[kMaxTaps];
+				for (uint32_t k = 0; k < filter.m_numTaps; k++)
+				{
+					int32_t row = std::min(std::max(2 * (int32_t)y + filter.m_offsets[k], 0), lastRow);
+					rows[k] = source.m_texels.data() + (size_t)row * sourceRowSize;
+				}
+
+				uint32_t i = 0;
+				for (; i + 4 <= sourceRowSize; i += 4)
+				{
+					__m128 sum = _mm_mul_ps(_mm_loadu_ps(rows[0] + i), _mm_set1_ps(filter.m_weights[0]));
+					for (uint32_t k = 1; k < filter.m_numTaps; k++)
+					{
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(filter.m_weights[k])));
+					}
+					_mm_storeu_ps(filtered.data() + i, sum);
+				}
+				for (; i < sourceRowSize; i++)
+				{
+					float sum = rows[0][i] * filter.m_weights[0];
+					for (uint32_t k = 1; k < filter.m_numTaps; k++)
+					{
+						sum += rows[k][i] * filter.m_weights[k];
+					}
+					filtered[i] = sum;
+				}
+
+				// Horizontal pass
+				float* dst = destination.m_texels.data() + (size_t)y * destination.m_width * channels;
+				if (channels == 4)
+				{
+					for (uint32_t x = 0; x < destination.m_width; x++)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (uint32_t k = 0; k < filter.m_numTaps; k++)
+						{
+							int32_t column = std::min(std::max(2 * (int32_t)x + filter.m_offsets[k], 0), lastColumn);
+							__m128 tap = _mm_mul_ps(_mm_loadu_ps(filtered.data() + column * 4), _mm_set1_ps(filter.m_weights[k]));
+							sum = k == 0 ? tap : _mm_add_ps(sum, tap);
+						}
+						_mm_storeu_ps(dst + x * 4, sum);
+					}
+					continue;
+				}
+
+				// Single channel : 4 destination texels at a time away from the edges, even and odd source texels are split
+				int32_t firstOffset = filter.m_offsets[0];
+				int32_t lastOffset = filter.m_offsets[filter.m_numTaps - 1];
+				uint32_t x = 0;
+				while (x < destination.m_width)
+				{
+					bool inside = 2 * (int32_t)x + firstOffset >= 0 && 2 * (int32_t)x + lastOffset + 7 <= lastColumn && x + 4 <= destination.m_width;
+					if (inside)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (uint32_t k = 0; k < filter.m_numTaps; k++)
+						{
+							const float* src = filtered.data() + 2 * (int32_t)x + filter.m_offsets[k];
+							__m128 even = _mm_shuffle_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _MM_SHUFFLE(2, 0, 2, 0));
+							__m128 tap = _mm_mul_ps(even, _mm_set1_ps(filter.m_weights[k]));
+							sum = k == 0 ? tap : _mm_add_ps(sum, tap);
+						}
+						_mm_storeu_ps(dst + x, sum);
+						x += 4;
+						continue;
+					}
+
+					float sum = 0.0f;
+					for (uint32_t k = 0; k < filter.m_numTaps; k++)
+					{
+						int32_t column = std::min(std::max(2 * (int32_t)x + filter.m_offsets[k], 0), lastColumn);
+						float tap = filtered[column] * filter.m_weights[k];
+						sum = k == 0 ? tap : sum + tap;
+					}
+					dst[x] = sum;
+					x++;
+				}
+			}
+		});
+	}
+
+	void MipGenerator::ForEachRows(uint32_t numRows, uint32_t rowSize, const std::function<void(uint32_t, uint32_t)>& func) const
+	{
+		uint32_t rowsPerJob = std::max(kFloatsPerJob / std::max(rowSize, 1u), 1u);
+		if (m_jobSystem == nullptr || numRows <= rowsPerJob)
+		{
+			func(0, numRows);
+			return;
+		}
+
+		uint32_t numJobs = (numRows + rowsPerJob - 1) / rowsPerJob;
+		m_jobSystem->ParallelFor(numJobs, 1, [&](uint32_t job)
+		{
+			func(job * rowsPerJob, std::min((job + 1) * rowsPerJob, numRows));
+		});
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "TextureCopy.h"
+
+namespace Sigma
+{
+	class JobSystem;
+
+	enum class MipFormat
+	{
+		RGBA8,
+		RGBA8Srgb,
+		RGBA16F,
+		R8,
+	};
+
+	enum class MipFilter
+	{
+		Box,	// 2x2 average
+		Kaiser,	// 6x6 Kaiser windowed sinc, sharper
+	};
+
+	/*
+	Builds mip chains on the CPU, for textures uploaded without them.
+
+	Level 0 is decoded once to floats in linear space (sRGB colors are linearized, alpha stays linear), each level is
+	then filtered from the previous one with a separable filter : rows of the previous level are combined vertically,
+	then texels of that row horizontally, with SSE2. Edges are clamped, odd sizes round down. Rows are split in jobs
+	when a job system is given.
+
+	Generate filters the whole chain, Write encodes one level straight into its upload footprint, so it can be called
+	from an UploadQueue texture writer.
+	*/
+	class MipGenerator
+	{
+	public:
+		// Without job system, everything runs on the calling thread
+		MipGenerator(JobSystem* jobSystem = nullptr);
+
+		// The source must stay valid until level 0 has been written
+		void Generate(MipFormat format, MipFilter filter, const void* source, uint64_t sourceRowPitch, uint32_t width, uint32_t height, uint32_t numLevels);
+		void Write(uint32_t level, const TextureRows& rows) const;
+
+		uint32_t GetLevelCount() const { return (uint32_t)m_levels.size(); }
+		uint32_t GetWidth(uint32_t level) const { return m_levels[level].m_width; }
+		uint32_t GetHeight(uint32_t level) const { return m_levels[level].m_height; }
+
+		// Down to 1x1
+		static uint32_t GetFullChainLevelCount(uint32_t width, uint32_t height);
+		static uint32_t GetTexelSize(MipFormat format);
+
+	private:
+		static const uint32_t kMaxTaps = 6;
+
+		struct Filter
+		{
+			// Relative to twice the destination coordinate
+			int32_t m_offsets[kMaxTaps];
+			float m_weights[kMaxTaps];
+			uint32_t m_numTaps;
+		};
+
+		struct Level
+		{
+			uint32_t m_width;
+			uint32_t m_height;
+			std::vector<float> m_texels;
+		};
+
+		void Downsample(const Level& source, Level& destination, const Filter& filter, uint32_t channels);
+		// Calls func(firstRow, endRow) for batches of rows, in jobs if possible
+		void ForEachRows(uint32_t numRows, uint32_t rowSize, const std::function<void(uint32_t, uint32_t)>& func) const;
+
+		JobSystem* m_jobSystem;
+		Filter m_box;
+		Filter m_kaiser;
+
+		MipFormat m_format;
+		const uint8_t* m_source;
+		uint64_t m_sourceRowPitch;
+		std::vector<Level> m_levels;
+	};
+}
@@ -0,0 +1,240 @@
+#include "PipelineCache.h"
+#include <cstring>
+#include <fstream>
+
+namespace Sigma
+{
+	const uint32_t kPipelineCacheMagic = 0x46435053; // "SPCF"
+	const uint32_t kPipelineCacheVersion = 2;
+
+	struct PipelineCacheHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		uint64_t m_compatibilityKey;
+		uint64_t m_entryCount;
+		uint64_t m_checksum; // Of everything after the header
+	};
+
+	struct PipelineCacheEntryHeader
+	{
+		uint64_t m_key;
+		uint64_t m_blobSize;
+	};
+
+	PipelineHasher::PipelineHasher() :
+		m_hash(0xcbf29ce484222325ull)
+	{
+	}
+
+	void PipelineHasher::Add(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			m_hash ^= bytes[i];
+			m_hash *= 0x100000001b3ull;
+		}
+	}
+
+	void PipelineHasher::AddString(const char* string)
+	{
+		// Length first, so that consecutive strings can not be confused
+		uint64_t length = string != nullptr ? strlen(string) : 0;
+		AddValue(length);
+		Add(string, (size_t)length);
+	}
+
+	PipelineCache::PipelineCache(uint32_t numThreads, ReleaseFunction release) :
+		m_release(release),
+		m_compilingCount(0),
+		m_running(true)
+	{
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			m_workers.emplace_back(&PipelineCache::WorkerMain, this);
+		}
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running = false;
+			m_queue.clear();
+		}
+		m_wakeUp.notify_all();
+
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+
+		for (auto& entry : m_entries)
+		{
+			if (entry.second.m_pipeline != nullptr)
+				m_release(entry.second.m_pipeline);
+		}
+	}
+
+	void PipelineCache::Request(uint64_t key, CompileFunction compile)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			// Entries loaded from disk only have a blob, they still have to be compiled once
+			Entry& entry = m_entries[key];
+			if (entry.m_requested)
+				return;
+
+			entry.m_requested = true;
+			Compilation compilation = { key, compile };
+			m_queue.push_back(compilation);
+		}
+		m_wakeUp.notify_one();
+	}
+
+	void* PipelineCache::Get(uint64_t key) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		if (it == m_entries.end() || !it->second.m_ready)
+			return nullptr;
+		return it->second.m_pipeline;
+	}
+
+	void PipelineCache::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]() { return m_queue.empty() && m_compilingCount == 0; });
+	}
+
+	uint32_t PipelineCache::GetPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return (uint32_t)m_queue.size() + m_compilingCount;
+	}
+
+	void PipelineCache::WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_wakeUp.wait(lock, [this]() { return !m_queue.empty() || !m_running; });
+			if (!m_running)
+				return;
+
+			Compilation compilation = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_compilingCount++;
+
+			// Compilation can take a long time, don't hold the lock
+			std::vector<uint8_t> cachedBlob = m_entries[compilation.m_key].m_blob;
+			lock.unlock();
+
+			std::vector<uint8_t> blob;
+			void* pipeline = compilation.m_compile(cachedBlob, blob);
+
+			lock.lock();
+			Entry& entry = m_entries[compilation.m_key];
+			entry.m_pipeline = pipeline;
+			entry.m_ready = true;
+			if (!blob.empty())
+				entry.m_blob = std::move(blob);
+
+			m_compilingCount--;
+			if (m_queue.empty() && m_compilingCount == 0)
+				m_idle.notify_all();
+		}
+	}
+
+	bool PipelineCache::Load(const char* path, uint64_t compatibilityKey)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+
+		uint64_t remaining = (uint64_t)file.tellg();
+		file.seekg(0);
+
+		PipelineCacheHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			header.m_magic != kPipelineCacheMagic ||
+			header.m_version != kPipelineCacheVersion ||
+			header.m_compatibilityKey != compatibilityKey)
+		{
+			return false;
+		}
+		remaining -= sizeof(header);
+
+		// Read everything before touching the entries, a truncated or corrupt file is ignored as a whole
+		PipelineHasher checksum;
+		std::vector<std::pair<uint64_t, std::vector<uint8_t>>> blobs;
+		for (uint64_t i = 0; i < header.m_entryCount; i++)
+		{
+			PipelineCacheEntryHeader entryHeader;
+			if (remaining < sizeof(entryHeader) || !file.read(reinterpret_cast<char*>(&entryHeader), sizeof(entryHeader)))
+				return false;
+			remaining -= sizeof(entryHeader);
+			checksum.AddValue(entryHeader);
+
+			if (remaining < entryHeader.m_blobSize)
+				return false;
+			remaining -= entryHeader.m_blobSize;
+
+			std::vector<uint8_t> blob((size_t)entryHeader.m_blobSize);
+			if (!file.read(reinterpret_cast<char*>(blob.data()), blob.size()))
+				return false;
+			checksum.Add(blob.data(), blob.size());
+
+			blobs.emplace_back(entryHeader.m_key, std::move(blob));
+		}
+		if (remaining != 0 || checksum.Get() != header.m_checksum)
+			return false;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& blob : blobs)
+		{
+			Entry& entry = m_entries[blob.first];
+			if (entry.m_blob.empty())
+				entry.m_blob = std::move(blob.second);
+		}
+		return true;
+	}
+
+	bool PipelineCache::Save(const char* path, uint64_t compatibilityKey) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Blobs loaded but not requested this run are kept
+		PipelineCacheHeader header = { kPipelineCacheMagic, kPipelineCacheVersion, compatibilityKey, 0, 0 };
+		PipelineHasher checksum;
+		for (const auto& entry : m_entries)
+		{
+			if (entry.second.m_blob.empty())
+				continue;
+
+			PipelineCacheEntryHeader entryHeader = { entry.first, entry.second.m_blob.size() };
+			checksum.AddValue(entryHeader);
+			checksum.Add(entry.second.m_blob.data(), entry.second.m_blob.size());
+			header.m_entryCount++;
+		}
+		header.m_checksum = checksum.Get();
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const auto& entry : m_entries)
+		{
+			if (entry.second.m_blob.empty())
+				continue;
+
+			PipelineCacheEntryHeader entryHeader = { entry.first, entry.second.m_blob.size() };
+			file.write(reinterpret_cast<const char*>(&entryHeader), sizeof(entryHeader));
+			file.write(reinterpret_cast<const char*>(entry.second.m_blob.data()), entry.second.m_blob.size());
+		}
+		return (bool)file;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Sigma
+{
+	// 64 bits FNV-1a. Pipeline descs hold pointers, so they are hashed field by field, following the pointers
+	class PipelineHasher
+	{
+	public:
+		PipelineHasher();
+
+		void Add(const void* data, size_t size);
+		void AddString(const char* string);
+
+		template<typename T>
+		void AddValue(const T& value)
+		{
+			Add(&value, sizeof(T));
+		}
+
+		uint64_t Get() const { return m_hash; }
+
+	private:
+		uint64_t m_hash;
+	};
+
+	/*
+	Pipelines keyed by the hash of their desc, compiled on background threads.
+
+	Pipelines are opaque here : the compile function creates one from the blob a previous run cached (possibly empty, or
+	rejected by the driver) and returns the blob to cache, the release function destroys one.
+	Get returns nullptr until a requested pipeline is ready, the caller decides what to use in the meantime.
+
+	Cache file : header with a checksum of the rest, then for every entry its key, blob size and blob bytes. A file written
+	for another compatibility key (adapter, driver version...), truncated or corrupt is ignored.
+	*/
+	class PipelineCache
+	{
+	public:
+		typedef std::function<void*(const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& blob)> CompileFunction;
+		typedef std::function<void(void*)> ReleaseFunction;
+
+		PipelineCache(uint32_t numThreads, ReleaseFunction release);
+		~PipelineCache();
+
+		// Queues a compilation, unless the key was already requested
+		void Request(uint64_t key, CompileFunction compile);
+		void* Get(uint64_t key) const;
+		void WaitIdle();
+
+		bool Load(const char* path, uint64_t compatibilityKey);
+		bool Save(const char* path, uint64_t compatibilityKey) const;
+
+		uint32_t GetPendingCount() const;
+
+	private:
+		struct Entry
+		{
+			void* m_pipeline;
+			std::vector<uint8_t> m_blob;
+			bool m_requested;
+			bool m_ready;
+		};
+
+		struct Compilation
+		{
+			uint64_t m_key;
+			CompileFunction m_compile;
+		};
+
+		void WorkerMain();
+
+		ReleaseFunction m_release;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		std::deque<Compilation> m_queue;
+		uint32_t m_compilingCount;
+		bool m_running;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wakeUp;
+		std::condition_variable m_idle;
+		std::vector<std::thread> m_workers;
+	};
+}
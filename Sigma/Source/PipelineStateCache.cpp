@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "PipelineStateCache.h"
+#include <algorithm>
+
+namespace Sigma
+{
+	// Copy of a desc and everything it points to, alive until its background compilation is done
+	struct GraphicsPipelineDesc
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC m_desc;
+		std::vector<uint8_t> m_shaders[5];
+		std::vector<D3D12_INPUT_ELEMENT_DESC> m_inputElements;
+		std::vector<std::string> m_semanticNames;
+	};
+
+	D3D12_SHADER_BYTECODE* GetShaders(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint32_t index)
+	{
+		D3D12_SHADER_BYTECODE* shaders[] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+		return shaders[index];
+	}
+
+	std::shared_ptr<GraphicsPipelineDesc> CopyDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		std::shared_ptr<GraphicsPipelineDesc> copy = std::make_shared<GraphicsPipelineDesc>();
+		copy->m_desc = desc;
+
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			D3D12_SHADER_BYTECODE* shader = GetShaders(copy->m_desc, i);
+			const uint8_t* bytecode = static_cast<const uint8_t*>(shader->pShaderBytecode);
+			copy->m_shaders[i].assign(bytecode, bytecode + shader->BytecodeLength);
+			shader->pShaderBytecode = shader->BytecodeLength != 0 ? copy->m_shaders[i].data() : nullptr;
+		}
+
+		copy->m_inputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + desc.InputLayout.NumElements);
+		for (const D3D12_INPUT_ELEMENT_DESC& element : copy->m_inputElements)
+		{
+			copy->m_semanticNames.push_back(element.SemanticName);
+		}
+		for (size_t i = 0; i < copy->m_inputElements.size(); i++)
+		{
+			copy->m_inputElements[i].SemanticName = copy->m_semanticNames[i].c_str();
+		}
+		copy->m_desc.InputLayout.pInputElementDescs = copy->m_inputElements.data();
+
+		// Stream output is not used yet
+		copy->m_desc.StreamOutput = {};
+		copy->m_desc.CachedPSO = {};
+
+		return copy;
+	}
+
+	PipelineStateCache::PipelineStateCache(ComPtr<ID3D12Device> device, const std::string& path, uint64_t compatibilityKey) :
+		m_device(device),
+		m_path(path),
+		m_compatibilityKey(compatibilityKey),
+		m_cache((std::max)(1u, std::thread::hardware_concurrency() / 4), [](void* pipeline) { static_cast<ID3D12PipelineState*>(pipeline)->Release(); })
+	{
+		m_cache.Load(m_path.c_str(), m_compatibilityKey);
+	}
+
+	void PipelineStateCache::AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serializedRootSignature)
+	{
+		PipelineHasher hasher;
+		hasher.Add(serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize());
+		m_rootSignatureHashes[rootSignature] = hasher.Get();
+	}
+
+	uint64_t PipelineStateCache::Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const
+	{
+		PipelineHasher hasher;
+
+		auto rootSignature = m_rootSignatureHashes.find(desc.pRootSignature);
+		if (rootSignature != m_rootSignatureHashes.end())
+			hasher.AddValue(rootSignature->second);
+		else
+			hasher.AddValue(desc.pRootSignature);
+
+		const D3D12_SHADER_BYTECODE* shaders[] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+		for (const D3D12_SHADER_BYTECODE* shader : shaders)
+		{
+			hasher.AddValue((uint64_t)shader->BytecodeLength);
+			hasher.Add(shader->pShaderBytecode, shader->BytecodeLength);
+		}
+
+		// Field by field, the blend and depth stencil descs have padding after their UINT8 masks
+		hasher.AddValue(desc.BlendState.AlphaToCoverageEnable);
+		hasher.AddValue(desc.BlendState.IndependentBlendEnable);
+		for (const D3D12_RENDER_TARGET_BLEND_DESC& blend : desc.BlendState.RenderTarget)
+		{
+			hasher.AddValue(blend.BlendEnable);
+			hasher.AddValue(blend.LogicOpEnable);
+			hasher.AddValue(blend.SrcBlend);
+			hasher.AddValue(blend.DestBlend);
+			hasher.AddValue(blend.BlendOp);
+			hasher.AddValue(blend.SrcBlendAlpha);
+			hasher.AddValue(blend.DestBlendAlpha);
+			hasher.AddValue(blend.BlendOpAlpha);
+			hasher.AddValue(blend.LogicOp);
+			hasher.AddValue(blend.RenderTargetWriteMask);
+		}
+		hasher.AddValue(desc.SampleMask);
+		hasher.AddValue(desc.RasterizerState);
+
+		const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+		hasher.AddValue(depthStencil.DepthEnable);
+		hasher.AddValue(depthStencil.DepthWriteMask);
+		hasher.AddValue(depthStencil.DepthFunc);
+		hasher.AddValue(depthStencil.StencilEnable);
+		hasher.AddValue(depthStencil.StencilReadMask);
+		hasher.AddValue(depthStencil.StencilWriteMask);
+		const D3D12_DEPTH_STENCILOP_DESC* faces[] = { &depthStencil.FrontFace, &depthStencil.BackFace };
+		for (const D3D12_DEPTH_STENCILOP_DESC* face : faces)
+		{
+			hasher.AddValue(face->StencilFailOp);
+			hasher.AddValue(face->StencilDepthFailOp);
+			hasher.AddValue(face->StencilPassOp);
+			hasher.AddValue(face->StencilFunc);
+		}
+
+		hasher.AddValue(desc.InputLayout.NumElements);
+		for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+			hasher.AddString(element.SemanticName);
+			hasher.AddValue(element.SemanticIndex);
+			hasher.AddValue(element.Format);
+			hasher.AddValue(element.InputSlot);
+			hasher.AddValue(element.AlignedByteOffset);
+			hasher.AddValue(element.InputSlotClass);
+			hasher.AddValue(element.InstanceDataStepRate);
+		}
+
+		hasher.AddValue(desc.IBStripCutValue);
+		hasher.AddValue(desc.PrimitiveTopologyType);
+		hasher.AddValue(desc.NumRenderTargets);
+		hasher.Add(desc.RTVFormats, sizeof(DXGI_FORMAT) * desc.NumRenderTargets);
+		hasher.AddValue(desc.DSVFormat);
+		hasher.AddValue(desc.SampleDesc);
+		hasher.AddValue(desc.NodeMask);
+		hasher.AddValue(desc.Flags);
+
+		return hasher.Get();
+	}
+
+	uint64_t PipelineStateCache::RequestGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		uint64_t key = Hash(desc);
+
+		ComPtr<ID3D12Device> device = m_device;
+		std::shared_ptr<GraphicsPipelineDesc> copy = CopyDesc(desc);
+		ComPtr<ID3D12RootSignature> rootSignature = desc.pRootSignature;
+
+		m_cache.Request(key, [device, copy, rootSignature](const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& blob) -> void*
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = copy->m_desc;
+			ID3D12PipelineState* pipeline = nullptr;
+			HRESULT result = E_FAIL;
+
+			if (!cachedBlob.empty())
+			{
+				desc.CachedPSO.pCachedBlob = cachedBlob.data();
+				desc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+				result = device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline));
+			}
+
+			// No blob, or one from another driver version
+			if (FAILED(result))
+			{
+				desc.CachedPSO = {};
+				result = device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline));
+			}
+
+			if (FAILED(result))
+			{
+				OutputDebugString("Pipeline state compilation failed\n");
+				return nullptr;
+			}
+
+			ComPtr<ID3DBlob> compiledBlob;
+			if (SUCCEEDED(pipeline->GetCachedBlob(&compiledBlob)))
+			{
+				const uint8_t* data = static_cast<const uint8_t*>(compiledBlob->GetBufferPointer());
+				blob.assign(data, data + compiledBlob->GetBufferSize());
+			}
+
+			return pipeline;
+		});
+
+		return key;
+	}
+
+	ID3D12PipelineState* PipelineStateCache::Get(uint64_t key, ID3D12PipelineState* placeholder) const
+	{
+		ID3D12PipelineState* pipeline = static_cast<ID3D12PipelineState*>(m_cache.Get(key));
+		return pipeline != nullptr ? pipeline : placeholder;
+	}
+
+	void PipelineStateCache::Save()
+	{
+		m_cache.WaitIdle();
+		m_cache.Save(m_path.c_str(), m_compatibilityKey);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "stdafx.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PipelineCache.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	/*
+	D3D12 pipeline states on top of PipelineCache.
+	Descs are keyed by everything they describe : shader bytecode, input layout, render target formats, raster/blend/depth states...
+	Root signatures are keyed by their serialized blob, they have to be added before being used in a desc.
+	Compiled pipelines are cached to disk with GetCachedBlob, a blob the driver rejects is simply compiled again.
+	*/
+	class PipelineStateCache
+	{
+	public:
+		PipelineStateCache(ComPtr<ID3D12Device> device, const std::string& path, uint64_t compatibilityKey);
+
+		void AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serializedRootSignature);
+
+		// Starts the compilation in the background if needed and returns the key to fetch the pipeline with
+		uint64_t RequestGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+		// placeholder is returned while the pipeline is compiling
+		ID3D12PipelineState* Get(uint64_t key, ID3D12PipelineState* placeholder = nullptr) const;
+
+		void Save();
+
+	private:
+		uint64_t Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const;
+
+		ComPtr<ID3D12Device> m_device;
+		std::string m_path;
+		uint64_t m_compatibilityKey;
+		std::unordered_map<ID3D12RootSignature*, uint64_t> m_rootSignatureHashes;
+		PipelineCache m_cache;
+	};
+}
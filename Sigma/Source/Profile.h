@@ -0,0 +1,22 @@
+#pragma once
+
+#include "stdafx.h"
+#include "CpuProfiler.h"
+
+namespace Sigma
+{
+	// The CPU profiler only keeps the format string of an event
+	template<typename... Args>
+	inline const char* ProfileEventName(const char* format, Args...)
+	{
+		return format;
+	}
+}
+
+#define PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_IMPL(a, b)
+
+// PIXScopedEvent that is also recorded by the CPU profiler
+#define ProfileScopedEvent(color, ...) \
+	PIXScopedEvent(color, __VA_ARGS__); \
+	Sigma::CpuProfileScope PROFILE_CONCATENATE(cpuProfileScope, __LINE__)(Sigma::ProfileEventName(__VA_ARGS__))
@@ -0,0 +1,79 @@
+#include "stdafx.h"
+#include "ResidencyManager.h"
+#include "Defines.h"
+#include "Profile.h"
+
+namespace Sigma
+{
+	ResidencyManager::ResidencyManager(ComPtr<ID3D12Device> device, ComPtr<IDXGIAdapter3> adapter) :
+		m_device(device),
+		m_adapter(adapter),
+		m_memoryInfo()
+	{
+		m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &m_memoryInfo);
+	}
+
+	uint32_t ResidencyManager::Register(ID3D12Heap* heap)
+	{
+		return Register(heap, heap->GetDesc().SizeInBytes);
+	}
+
+	uint32_t ResidencyManager::Register(ID3D12Resource* resource)
+	{
+		D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		return Register(resource, m_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes);
+	}
+
+	uint32_t ResidencyManager::Register(ID3D12Pageable* object, UINT64 size)
+	{
+		uint32_t handle = m_set.Add(size);
+		if (handle >= m_objects.size())
+			m_objects.resize(handle + 1, nullptr);
+		m_objects[handle] = object;
+		return handle;
+	}
+
+	void ResidencyManager::Unregister(uint32_t handle)
+	{
+		if (handle == kInvalidResidencyHandle)
+			return;
+
+		m_set.Remove(handle);
+		m_objects[handle] = nullptr;
+	}
+
+	void ResidencyManager::Update(UINT64 completedFenceValue)
+	{
+		ProfileScopedEvent(PIX_COLOR_INDEX(5), "Residency");
+
+		// The budget changes with what the other applications use, CurrentUsage includes our resident objects
+		m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &m_memoryInfo);
+		UINT64 residentSize = m_set.GetResidentSize();
+		UINT64 untrackedUsage = m_memoryInfo.CurrentUsage > residentSize ? m_memoryInfo.CurrentUsage - residentSize : 0;
+		UINT64 budget = m_memoryInfo.Budget > untrackedUsage ? m_memoryInfo.Budget - untrackedUsage : 0;
+
+		m_set.Update(budget, completedFenceValue, m_makeResident, m_evict);
+
+		// Evicting first leaves room for the objects coming back
+		if (!m_evict.empty())
+		{
+			GatherObjects(m_evict);
+			DXSafeCall(m_device->Evict((UINT)m_batch.size(), m_batch.data()));
+		}
+		if (!m_makeResident.empty())
+		{
+			// Blocks until the objects are resident, they are needed by the frame about to be submitted
+			GatherObjects(m_makeResident);
+			DXSafeCall(m_device->MakeResident((UINT)m_batch.size(), m_batch.data()));
+		}
+	}
+
+	void ResidencyManager::GatherObjects(const std::vector<uint32_t>& handles)
+	{
+		m_batch.clear();
+		for (uint32_t handle : handles)
+		{
+			m_batch.push_back(m_objects[handle]);
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "stdafx.h"
+#include <vector>
+#include "ResidencySet.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	/*
+	Keeps the registered heaps and committed resources of the local memory segment under the OS budget.
+
+	Every frame, the objects it uses are marked with its fence value and Update is called right before the frame is
+	submitted : it polls the budget, makes the used objects resident again and evicts the least recently used ones the
+	GPU is done with (see ResidencySet). Only the budget left by the memory this manager does not track (swap chain,
+	other applications...) is used for the registered objects.
+	Not thread safe, everything is expected to be called from the render thread.
+	*/
+	class ResidencyManager
+	{
+	public:
+		ResidencyManager(ComPtr<ID3D12Device> device, ComPtr<IDXGIAdapter3> adapter);
+
+		uint32_t Register(ID3D12Heap* heap);
+		uint32_t Register(ID3D12Resource* resource);
+		void Unregister(uint32_t handle);
+
+		void MarkUsed(uint32_t handle, UINT64 fenceValue) { m_set.MarkUsed(handle, fenceValue); }
+		void Update(UINT64 completedFenceValue);
+
+		const ResidencyStats& GetStats() const { return m_set.GetStats(); }
+		const DXGI_QUERY_VIDEO_MEMORY_INFO& GetMemoryInfo() const { return m_memoryInfo; }
+
+	private:
+		uint32_t Register(ID3D12Pageable* object, UINT64 size);
+		void GatherObjects(const std::vector<uint32_t>& handles);
+
+		ComPtr<ID3D12Device> m_device;
+		ComPtr<IDXGIAdapter3> m_adapter;
+		DXGI_QUERY_VIDEO_MEMORY_INFO m_memoryInfo;
+
+		ResidencySet m_set;
+		std::vector<ID3D12Pageable*> m_objects; // Indexed by handle, not referenced
+		std::vector<uint32_t> m_makeResident;
+		std::vector<uint32_t> m_evict;
+		std::vector<ID3D12Pageable*> m_batch;
+	};
+}
@@ -0,0 +1,153 @@
+#include "ResidencySet.h"
+
+namespace Sigma
+{
+	uint32_t ResidencySet::Add(uint64_t size)
+	{
+		uint32_t handle;
+		if (!m_freeHandles.empty())
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+		else
+		{
+			handle = (uint32_t)m_entries.size();
+			m_entries.emplace_back();
+		}
+
+		Entry& entry = m_entries[handle];
+		entry.m_size = size;
+		entry.m_lastUsedFenceValue = 0;
+		entry.m_allocated = true;
+		entry.m_resident = true;
+		entry.m_pendingResident = false;
+		Link(handle);
+		m_residentSize += size;
+
+		m_stats.m_objectCount++;
+		m_stats.m_residentCount++;
+		m_stats.m_totalSize += size;
+		m_stats.m_residentSize = m_residentSize;
+		return handle;
+	}
+
+	void ResidencySet::Remove(uint32_t handle)
+	{
+		if (handle == kInvalidResidencyHandle || !m_entries[handle].m_allocated)
+			return;
+
+		Entry& entry = m_entries[handle];
+		if (entry.m_resident)
+		{
+			Unlink(handle);
+			m_residentSize -= entry.m_size;
+			m_stats.m_residentCount--;
+		}
+		if (entry.m_pendingResident)
+		{
+			for (uint32_t& pending : m_pendingResident)
+			{
+				if (pending == handle)
+				{
+					pending = m_pendingResident.back();
+					m_pendingResident.pop_back();
+					break;
+				}
+			}
+		}
+
+		m_stats.m_objectCount--;
+		m_stats.m_totalSize -= entry.m_size;
+		m_stats.m_residentSize = m_residentSize;
+		entry.m_allocated = false;
+		m_freeHandles.push_back(handle);
+	}
+
+	void ResidencySet::MarkUsed(uint32_t handle, uint64_t fenceValue)
+	{
+		Entry& entry = m_entries[handle];
+		if (fenceValue > entry.m_lastUsedFenceValue)
+			entry.m_lastUsedFenceValue = fenceValue;
+
+		if (entry.m_resident)
+		{
+			// Most recently used
+			Unlink(handle);
+			Link(handle);
+		}
+		else if (!entry.m_pendingResident)
+		{
+			entry.m_pendingResident = true;
+			m_pendingResident.push_back(handle);
+		}
+	}
+
+	bool ResidencySet::Update(uint64_t budget, uint64_t completedFenceValue, std::vector<uint32_t>& makeResident, std::vector<uint32_t>& evict)
+	{
+		makeResident.clear();
+		evict.clear();
+		m_stats.m_budget = budget;
+		m_stats.m_evictedSize = 0;
+		m_stats.m_madeResidentSize = 0;
+
+		// Objects needed by the frame about to be submitted come back first, they are the most recently used
+		for (uint32_t handle : m_pendingResident)
+		{
+			Entry& entry = m_entries[handle];
+			entry.m_pendingResident = false;
+			entry.m_resident = true;
+			Link(handle);
+			m_residentSize += entry.m_size;
+			m_stats.m_residentCount++;
+			m_stats.m_madeResidentSize += entry.m_size;
+			makeResident.push_back(handle);
+		}
+		m_pendingResident.clear();
+
+		// The list is in use order, objects after the first one still in use are at least as recent
+		while (m_residentSize > budget && m_head != kInvalidResidencyHandle)
+		{
+			uint32_t handle = m_head;
+			Entry& entry = m_entries[handle];
+			if (entry.m_lastUsedFenceValue > completedFenceValue)
+				break;
+
+			Unlink(handle);
+			entry.m_resident = false;
+			m_residentSize -= entry.m_size;
+			m_stats.m_residentCount--;
+			m_stats.m_evictedSize += entry.m_size;
+			evict.push_back(handle);
+		}
+
+		m_stats.m_residentSize = m_residentSize;
+		return m_residentSize <= budget;
+	}
+
+	void ResidencySet::Link(uint32_t handle)
+	{
+		Entry& entry = m_entries[handle];
+		entry.m_previous = m_tail;
+		entry.m_next = kInvalidResidencyHandle;
+		if (m_tail != kInvalidResidencyHandle)
+			m_entries[m_tail].m_next = handle;
+		else
+			m_head = handle;
+		m_tail = handle;
+	}
+
+	void ResidencySet::Unlink(uint32_t handle)
+	{
+		Entry& entry = m_entries[handle];
+		if (entry.m_previous != kInvalidResidencyHandle)
+			m_entries[entry.m_previous].m_next = entry.m_next;
+		else
+			m_head = entry.m_next;
+
+		if (entry.m_next != kInvalidResidencyHandle)
+			m_entries[entry.m_next].m_previous = entry.m_previous;
+		else
+			m_tail = entry.m_previous;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Sigma
+{
+	const uint32_t kInvalidResidencyHandle = 0xffffffff;
+
+	struct ResidencyStats
+	{
+		uint32_t m_objectCount;
+		uint32_t m_residentCount;
+		uint64_t m_totalSize;
+		uint64_t m_residentSize;
+		uint64_t m_budget;		// Given to the last Update
+		uint64_t m_evictedSize;	// By the last Update
+		uint64_t m_madeResidentSize;
+	};
+
+	/*
+	Residency policy of GPU memory objects (heaps, committed resources), only deals with handles and sizes so it does not
+	depend on any graphics API.
+
+	Resident objects are kept in least recently used order. Objects are used by the frame that will signal a fence value :
+	an evicted object that is used again has to be made resident before that frame is submitted, and an object can only be
+	evicted once the fence of its last use has been reached. Update evicts the least recently used objects until the resident
+	size fits the budget. When the objects of the frames in flight alone do not fit, it stays over budget rather than evicting
+	what the next frame will need again.
+	*/
+	class ResidencySet
+	{
+	public:
+		// Created objects are resident
+		uint32_t Add(uint64_t size);
+		void Remove(uint32_t handle);
+
+		void MarkUsed(uint32_t handle, uint64_t fenceValue);
+
+		// Fills the objects to make resident (used since they were evicted) and to evict, returns false if still over budget
+		bool Update(uint64_t budget, uint64_t completedFenceValue, std::vector<uint32_t>& makeResident, std::vector<uint32_t>& evict);
+
+		bool IsResident(uint32_t handle) const { return m_entries[handle].m_resident; }
+		uint64_t GetResidentSize() const { return m_residentSize; }
+		const ResidencyStats& GetStats() const { return m_stats; }
+
+	private:
+		struct Entry
+		{
+			uint64_t m_size;
+			uint64_t m_lastUsedFenceValue;
+			// Neighbours in the LRU list, while resident
+			uint32_t m_previous;
+			uint32_t m_next;
+			bool m_allocated;
+			bool m_resident;
+			bool m_pendingResident;
+		};
+
+		void Link(uint32_t handle);
+		void Unlink(uint32_t handle);
+
+		std::vector<Entry> m_entries;
+		std::vector<uint32_t> m_freeHandles;
+		std::vector<uint32_t> m_pendingResident;
+
+		// Least recently used first
+		uint32_t m_head = kInvalidResidencyHandle;
+		uint32_t m_tail = kInvalidResidencyHandle;
+		uint64_t m_residentSize = 0;
+		ResidencyStats m_stats = {};
+	};
+}
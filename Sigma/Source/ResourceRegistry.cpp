@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "ResourceRegistry.h"
+
+namespace Sigma
+{
+	ResourceRegistry::ResourceRegistry(ComPtr<ID3D12Device> device, ResourceStateRegistry& resourceStates, DescriptorHeap& descriptorHeap) :
+		m_device(device),
+		m_resourceStates(resourceStates),
+		m_descriptorHeap(descriptorHeap)
+	{
+	}
+
+	ResourceRegistry::~ResourceRegistry()
+	{
+		for (const PendingRelease& release : m_openReleases)
+		{
+			Release(release);
+		}
+		for (const PendingRelease& release : m_pendingReleases)
+		{
+			Release(release);
+		}
+
+		for (uint32_t i = 0; i < m_handles.GetCount(); i++)
+		{
+			PendingRelease release = { m_resources[i], m_allocators[i], m_allocations[i], 0 };
+			Release(release);
+			if (m_srvIndices[i] != kInvalidDescriptorIndex)
+				m_descriptorHeap.Free(m_srvIndices[i]);
+		}
+	}
+
+	ResourceHandle ResourceRegistry::Create(GpuHeapAllocator& allocator, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+	{
+		GpuAllocation allocation;
+		ComPtr<ID3D12Resource> resource = allocator.CreateResource(desc, initialState, clearValue, allocation);
+		if (resource == nullptr)
+			return ResourceHandle();
+
+		D3D12_RESOURCE_DESC resourceDesc = resource->GetDesc();
+		UINT numSubresources = resourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? resourceDesc.MipLevels : resourceDesc.MipLevels * resourceDesc.DepthOrArraySize;
+		m_resourceStates.Register(resource.Get(), numSubresources, initialState);
+
+		ResourceHandle handle = m_handles.Allocate();
+		m_resources.push_back(resource.Detach());
+		m_descs.push_back(resourceDesc);
+		m_allocators.push_back(&allocator);
+		m_allocations.push_back(allocation);
+		m_residencyHandles.push_back(allocation.m_residencyHandle);
+		m_srvIndices.push_back(kInvalidDescriptorIndex);
+		return handle;
+	}
+
+	void ResourceRegistry::Destroy(ResourceHandle handle)
+	{
+		uint32_t denseIndex = m_handles.Free(handle);
+		if (denseIndex == kInvalidDenseIndex)
+			return;
+
+		PendingRelease release = { m_resources[denseIndex], m_allocators[denseIndex], m_allocations[denseIndex], 0 };
+		m_openReleases.push_back(release);
+		if (m_srvIndices[denseIndex] != kInvalidDescriptorIndex)
+			m_descriptorHeap.Free(m_srvIndices[denseIndex]);
+
+		// The last element fills the hole
+		m_resources[denseIndex] = m_resources.back();
+		m_descs[denseIndex] = m_descs.back();
+		m_allocators[denseIndex] = m_allocators.back();
+		m_allocations[denseIndex] = m_allocations.back();
+		m_residencyHandles[denseIndex] = m_residencyHandles.back();
+		m_srvIndices[denseIndex] = m_srvIndices.back();
+
+		m_resources.pop_back();
+		m_descs.pop_back();
+		m_allocators.pop_back();
+		m_allocations.pop_back();
+		m_residencyHandles.pop_back();
+		m_srvIndices.pop_back();
+	}
+
+	uint32_t ResourceRegistry::CreateShaderResourceView(ResourceHandle handle, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+	{
+		uint32_t denseIndex = m_handles.GetDenseIndex(handle);
+		uint32_t srvIndex = m_descriptorHeap.Allocate();
+		m_device->CreateShaderResourceView(m_resources[denseIndex], desc, m_descriptorHeap.GetCPUHandle(srvIndex));
+		if (m_srvIndices[denseIndex] != kInvalidDescriptorIndex)
+			m_descriptorHeap.Free(m_srvIndices[denseIndex]);
+		m_srvIndices[denseIndex] = srvIndex;
+		return srvIndex;
+	}
+
+	void ResourceRegistry::Replace(ResourceHandle handle, ID3D12Resource* resource, const GpuAllocation& allocation)
+	{
+		uint32_t denseIndex = m_handles.GetDenseIndex(handle);
+		resource->AddRef();
+		m_resources[denseIndex]->Release();
+		m_resources[denseIndex] = resource;
+		m_allocations[denseIndex] = allocation;
+		m_residencyHandles[denseIndex] = allocation.m_residencyHandle;
+	}
+
+	void ResourceRegistry::MarkUsed(ResidencyManager* residencyManager, UINT64 fenceValue) const
+	{
+		for (uint32_t residencyHandle : m_residencyHandles)
+		{
+			residencyManager->MarkUsed(residencyHandle, fenceValue);
+		}
+	}
+
+	void ResourceRegistry::Submit(UINT64 fenceValue)
+	{
+		for (PendingRelease& release : m_openReleases)
+		{
+			release.m_fenceValue = fenceValue;
+			m_pendingReleases.push_back(release);
+		}
+		m_openReleases.clear();
+	}
+
+	void ResourceRegistry::Retire(UINT64 completedFenceValue)
+	{
+		while (!m_pendingReleases.empty() && m_pendingReleases.front().m_fenceValue <= completedFenceValue)
+		{
+			Release(m_pendingReleases.front());
+			m_pendingReleases.pop_front();
+		}
+	}
+
+	ID3D12Resource* ResourceRegistry::GetResource(ResourceHandle handle) const
+	{
+		uint32_t denseIndex = m_handles.GetDenseIndex(handle);
+		return denseIndex != kInvalidDenseIndex ? m_resources[denseIndex] : nullptr;
+	}
+
+	void ResourceRegistry::Release(const PendingRelease& release)
+	{
+		m_resourceStates.Unregister(release.m_resource);
+		release.m_resource->Release();
+		release.m_allocator->Free(release.m_allocation);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "stdafx.h"
+#include <deque>
+#include <vector>
+#include "DescriptorHeap.h"
+#include "GpuHeapAllocator.h"
+#include "HandlePool.h"
+#include "ResourceStateTracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	typedef Handle ResourceHandle;
+
+	/*
+	Owns placed resources, referenced by generational handles instead of ComPtr.
+
+	Metadata is stored one array per field, kept packed by a HandlePool, so loops over every resource only touch the
+	fields they need (MarkUsed only reads the residency handles). The registry holds a single reference to each
+	resource, lookups return raw pointers and never touch the reference count.
+
+	Destroy invalidates the handle right away, the resource and its allocation are released once the frames that may
+	still use them are complete : releases since the last Submit are tagged with its fence value, and Retire performs
+	them once that fence has been reached (like DescriptorHeap). Resources are registered in the ResourceStateRegistry,
+	which keeps tracking their current state. Render thread only.
+	*/
+	class ResourceRegistry
+	{
+	public:
+		ResourceRegistry(ComPtr<ID3D12Device> device, ResourceStateRegistry& resourceStates, DescriptorHeap& descriptorHeap);
+		// Releases everything, the GPU must be idle
+		~ResourceRegistry();
+
+		// Returns an invalid handle if there was no memory left
+		ResourceHandle Create(GpuHeapAllocator& allocator, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue);
+		void Destroy(ResourceHandle handle);
+
+		// Into a new descriptor, the previous one is freed (frames in flight may still read it). Returns its index
+		uint32_t CreateShaderResourceView(ResourceHandle handle, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+		// For resources moved by the defragmenter, which keeps the previous one until the frames using it are complete.
+		// Views have to be recreated
+		void Replace(ResourceHandle handle, ID3D12Resource* resource, const GpuAllocation& allocation);
+
+		// Marks the heaps of every resource used by the frame
+		void MarkUsed(ResidencyManager* residencyManager, UINT64 fenceValue) const;
+
+		void Submit(UINT64 fenceValue);
+		void Retire(UINT64 completedFenceValue);
+
+		bool IsValid(ResourceHandle handle) const { return m_handles.GetDenseIndex(handle) != kInvalidDenseIndex; }
+		uint32_t GetCount() const { return m_handles.GetCount(); }
+
+		// Null if the handle is stale
+		ID3D12Resource* GetResource(ResourceHandle handle) const;
+		// The handle must be valid
+		const D3D12_RESOURCE_DESC& GetDesc(ResourceHandle handle) const { return m_descs[m_handles.GetDenseIndex(handle)]; }
+		const GpuAllocation& GetAllocation(ResourceHandle handle) const { return m_allocations[m_handles.GetDenseIndex(handle)]; }
+		GpuHeapAllocator* GetAllocator(ResourceHandle handle) const { return m_allocators[m_handles.GetDenseIndex(handle)]; }
+		uint32_t GetSrvIndex(ResourceHandle handle) const { return m_srvIndices[m_handles.GetDenseIndex(handle)]; }
+
+	private:
+		struct PendingRelease
+		{
+			ID3D12Resource* m_resource;
+			GpuHeapAllocator* m_allocator;
+			GpuAllocation m_allocation;
+			UINT64 m_fenceValue;
+		};
+
+		void Release(const PendingRelease& release);
+
+		ComPtr<ID3D12Device> m_device;
+		ResourceStateRegistry& m_resourceStates;
+		DescriptorHeap& m_descriptorHeap;
+
+		HandlePool m_handles;
+		std::vector<ID3D12Resource*> m_resources; // One reference each
+		std::vector<D3D12_RESOURCE_DESC> m_descs;
+		std::vector<GpuHeapAllocator*> m_allocators;
+		std::vector<GpuAllocation> m_allocations;
+		std::vector<uint32_t> m_residencyHandles; // Copied from the allocations, read every frame
+		std::vector<uint32_t> m_srvIndices;
+
+		std::vector<PendingRelease> m_openReleases;
+		std::deque<PendingRelease> m_pendingReleases;
+	};
+}
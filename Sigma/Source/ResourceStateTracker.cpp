@@ -0,0 +1,187 @@
+#include "ResourceStateTracker.h"
+
+namespace Sigma
+{
+	uint32_t SubresourceStates::Get(uint32_t subresource) const
+	{
+		if (IsUniform() || subresource >= m_subresourceStates.size())
+			return m_state;
+		return m_subresourceStates[subresource];
+	}
+
+	void SubresourceStates::Set(uint32_t subresource, uint32_t state, uint32_t numSubresources)
+	{
+		if (subresource == kAllSubresources || numSubresources <= 1)
+		{
+			m_state = state;
+			m_subresourceStates.clear();
+			return;
+		}
+
+		if (IsUniform())
+		{
+			if (m_state == state)
+				return;
+			m_subresourceStates.assign(numSubresources, m_state);
+		}
+		m_subresourceStates[subresource] = state;
+
+		// Go back to a single state when possible
+		for (uint32_t s : m_subresourceStates)
+		{
+			if (s != state)
+				return;
+		}
+		m_state = state;
+		m_subresourceStates.clear();
+	}
+
+	void ResourceStateRegistry::Register(void* resource, uint32_t numSubresources, uint32_t state)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Entry& entry = m_entries[resource];
+		entry.m_numSubresources = numSubresources;
+		entry.m_states.Set(kAllSubresources, state, numSubresources);
+	}
+
+	void ResourceStateRegistry::Unregister(void* resource)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.erase(resource);
+	}
+
+	uint32_t ResourceStateRegistry::GetSubresourceCount(void* resource) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(resource);
+		return it != m_entries.end() ? it->second.m_numSubresources : 1;
+	}
+
+	void ResourceStateTracker::Transition(void* resource, uint32_t stateAfter, uint32_t subresource)
+	{
+		SubresourceStates& local = m_localStates[resource];
+
+		auto transitionFrom = [&](uint32_t sub, uint32_t stateBefore)
+		{
+			if (stateBefore == kUnknownState)
+			{
+				StateTransition pending = { resource, sub, kUnknownState, stateAfter };
+				m_pendingTransitions.push_back(pending);
+			}
+			else if (stateBefore != stateAfter)
+			{
+				AddBarrier(resource, sub, stateBefore, stateAfter);
+			}
+		};
+
+		if (subresource == kAllSubresources)
+		{
+			if (local.IsUniform())
+			{
+				transitionFrom(kAllSubresources, local.m_state);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < local.m_subresourceStates.size(); i++)
+				{
+					transitionFrom(i, local.m_subresourceStates[i]);
+				}
+			}
+			local.Set(kAllSubresources, stateAfter, 0);
+		}
+		else
+		{
+			transitionFrom(subresource, local.Get(subresource));
+			local.Set(subresource, stateAfter, m_registry.GetSubresourceCount(resource));
+		}
+	}
+
+	void ResourceStateTracker::AddBarrier(void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter)
+	{
+		// Merge with the previous barrier on the same resource if it targets the same subresources
+		for (size_t i = m_barriers.size(); i-- > 0;)
+		{
+			StateTransition& previous = m_barriers[i];
+			if (previous.m_resource != resource)
+				continue;
+
+			if (previous.m_subresource == subresource)
+			{
+				previous.m_stateAfter = stateAfter;
+				if (previous.m_stateBefore == previous.m_stateAfter)
+				{
+					m_barriers.erase(m_barriers.begin() + i);
+				}
+				return;
+			}
+			break;
+		}
+
+		StateTransition barrier = { resource, subresource, stateBefore, stateAfter };
+		m_barriers.push_back(barrier);
+	}
+
+	void ResourceStateTracker::ResolvePendingTransitions(ResourceStateRegistry& registry, std::vector<StateTransition>& transitions)
+	{
+		std::lock_guard<std::mutex> lock(registry.m_mutex);
+
+		for (const StateTransition& pending : m_pendingTransitions)
+		{
+			auto it = registry.m_entries.find(pending.m_resource);
+			if (it == registry.m_entries.end())
+				continue;
+
+			const SubresourceStates& global = it->second.m_states;
+			if (pending.m_subresource == kAllSubresources && !global.IsUniform())
+			{
+				for (uint32_t i = 0; i < global.m_subresourceStates.size(); i++)
+				{
+					if (global.m_subresourceStates[i] != pending.m_stateAfter)
+					{
+						StateTransition transition = { pending.m_resource, i, global.m_subresourceStates[i], pending.m_stateAfter };
+						transitions.push_back(transition);
+					}
+				}
+			}
+			else
+			{
+				uint32_t stateBefore = global.Get(pending.m_subresource);
+				if (stateBefore != pending.m_stateAfter)
+				{
+					StateTransition transition = { pending.m_resource, pending.m_subresource, stateBefore, pending.m_stateAfter };
+					transitions.push_back(transition);
+				}
+			}
+		}
+
+		// Resources are left in the last state this command list put them in
+		for (auto& local : m_localStates)
+		{
+			auto it = registry.m_entries.find(local.first);
+			if (it == registry.m_entries.end())
+				continue;
+
+			ResourceStateRegistry::Entry& entry = it->second;
+			if (local.second.IsUniform())
+			{
+				if (local.second.m_state != kUnknownState)
+					entry.m_states.Set(kAllSubresources, local.second.m_state, entry.m_numSubresources);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < local.second.m_subresourceStates.size(); i++)
+				{
+					if (local.second.m_subresourceStates[i] != kUnknownState)
+						entry.m_states.Set(i, local.second.m_subresourceStates[i], entry.m_numSubresources);
+				}
+			}
+		}
+	}
+
+	void ResourceStateTracker::Reset()
+	{
+		m_localStates.clear();
+		m_pendingTransitions.clear();
+		m_barriers.clear();
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Sigma
+{
+	// Same values as D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, states are D3D12_RESOURCE_STATES bits
+	const uint32_t kAllSubresources = 0xffffffff;
+	const uint32_t kUnknownState = 0xffffffff;
+
+	struct StateTransition
+	{
+		void* m_resource;
+		uint32_t m_subresource;
+		uint32_t m_stateBefore;
+		uint32_t m_stateAfter;
+	};
+
+	// State of every subresource of a resource, stored as a single value as long as they all share it
+	struct SubresourceStates
+	{
+		uint32_t m_state = kUnknownState;
+		std::vector<uint32_t> m_subresourceStates;
+
+		bool IsUniform() const { return m_subresourceStates.empty(); }
+		uint32_t Get(uint32_t subresource) const;
+		void Set(uint32_t subresource, uint32_t state, uint32_t numSubresources);
+	};
+
+	// Known state of resources on the queue timeline, i.e. at the end of everything submitted so far
+	class ResourceStateRegistry
+	{
+	public:
+		void Register(void* resource, uint32_t numSubresources, uint32_t state);
+		void Unregister(void* resource);
+
+		uint32_t GetSubresourceCount(void* resource) const;
+
+	private:
+		friend class ResourceStateTracker;
+
+		struct Entry
+		{
+			uint32_t m_numSubresources;
+			SubresourceStates m_states;
+		};
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<void*, Entry> m_entries;
+	};
+
+	/*
+	Per command list state tracking.
+
+	Transition records the state a resource needs to be in for the next commands, and queues a barrier only if
+	the state known by this command list is different. Queued barriers are merged and should be flushed in a single
+	ResourceBarrier call right before the draw/copy that needs them.
+
+	The first time a command list uses a resource, its state before the command list runs is not known yet (other
+	command lists may be submitted before it). Those transitions are kept pending and resolved against the registry
+	at submission time, to be recorded in a small command list executed right before this one.
+	*/
+	class ResourceStateTracker
+	{
+	public:
+		ResourceStateTracker(const ResourceStateRegistry& registry) : m_registry(registry) {}
+
+		void Transition(void* resource, uint32_t stateAfter, uint32_t subresource = kAllSubresources);
+
+		const std::vector<StateTransition>& GetBarriers() const { return m_barriers; }
+
+		// Hands all queued barriers to record at once (to go in a single ResourceBarrier call), then clears them
+		template<typename RecordFunction>
+		void FlushBarriers(RecordFunction record)
+		{
+			if (!m_barriers.empty())
+				record(m_barriers);
+			m_barriers.clear();
+		}
+
+		// Must be called in submission order. Fills transitions with the barriers needed before this command list
+		// and updates the registry with the state resources are left in
+		void ResolvePendingTransitions(ResourceStateRegistry& registry, std::vector<StateTransition>& transitions);
+
+		void Reset();
+
+	private:
+		void AddBarrier(void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter);
+
+		const ResourceStateRegistry& m_registry;
+		std::unordered_map<void*, SubresourceStates> m_localStates;
+		std::vector<StateTransition> m_pendingTransitions;
+		std::vector<StateTransition> m_barriers;
+	};
+}
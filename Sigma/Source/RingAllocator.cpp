@@ -0,0 +1,96 @@
+#include "RingAllocator.h"
+
+namespace Sigma
+{
+	RingAllocator::RingAllocator(uint64_t size) :
+		m_size(size),
+		m_head(0),
+		m_tail(0),
+		m_used(0),
+		m_openRegionSize(0)
+	{
+	}
+
+	uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		if (size == 0 || size > m_size)
+			return kInvalidOffset;
+
+		// Everything has been retired, restart from the beginning to get the biggest contiguous block
+		if (m_used == 0)
+		{
+			m_head = 0;
+			m_tail = 0;
+		}
+		else if (m_head == m_tail)
+		{
+			// Full
+			return kInvalidOffset;
+		}
+
+		uint64_t offset = kInvalidOffset;
+		uint64_t consumed = 0;
+
+		if (m_head >= m_tail)
+		{
+			// Free space is [head, size) and [0, tail)
+			uint64_t alignedHead = AlignUp(m_head, alignment);
+			if (alignedHead + size <= m_size)
+			{
+				offset = alignedHead;
+				consumed = alignedHead + size - m_head;
+			}
+			else if (size <= m_tail)
+			{
+				// Wrap around, the end of the ring is wasted until this region is retired
+				offset = 0;
+				consumed = m_size - m_head + size;
+			}
+		}
+		else
+		{
+			// Free space is [head, tail)
+			uint64_t alignedHead = AlignUp(m_head, alignment);
+			if (alignedHead + size <= m_tail)
+			{
+				offset = alignedHead;
+				consumed = alignedHead + size - m_head;
+			}
+		}
+
+		if (offset == kInvalidOffset)
+			return kInvalidOffset;
+
+		m_head = offset + size;
+		if (m_head == m_size)
+			m_head = 0;
+
+		m_used += consumed;
+		m_openRegionSize += consumed;
+		return offset;
+	}
+
+	void RingAllocator::Submit(uint64_t fenceValue)
+	{
+		if (m_openRegionSize == 0)
+			return;
+
+		Region region;
+		region.m_end = m_head;
+		region.m_size = m_openRegionSize;
+		region.m_fenceValue = fenceValue;
+		m_regions.push_back(region);
+
+		m_openRegionSize = 0;
+	}
+
+	void RingAllocator::Retire(uint64_t completedFenceValue)
+	{
+		while (!m_regions.empty() && m_regions.front().m_fenceValue <= completedFenceValue)
+		{
+			m_tail = m_regions.front().m_end;
+			m_used -= m_regions.front().m_size;
+			m_regions.pop_front();
+		}
+	}
+}
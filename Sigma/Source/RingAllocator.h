@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Align.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace Sigma
+{
+	const uint64_t kInvalidOffset = ~0ull;
+
+	/*
+	Fence-tracked ring allocator, only deals with offsets so it can be used on any kind of memory.
+
+	Allocations are grouped in regions : every allocation made since the last Submit belongs to the same region,
+	and Submit tags that region with the fence value the GPU will signal once it is done with it.
+	Retire frees every region whose fence value has been reached, in submission order.
+
+	|   free   |  region A (fence 4)  |  region B (fence 5)  |  open region  |   free   |
+	           ^ tail                                                       ^ head
+	*/
+	class RingAllocator
+	{
+	public:
+		RingAllocator(uint64_t size);
+
+		// Returns kInvalidOffset if there is not enough free contiguous space left
+		uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+		// Closes the open region, it will be freed once the fence reaches fenceValue
+		void Submit(uint64_t fenceValue);
+
+		// Frees all regions whose fence value is lower or equal to completedFenceValue
+		void Retire(uint64_t completedFenceValue);
+
+		uint64_t GetSize() const { return m_size; }
+		uint64_t GetUsedSize() const { return m_used; }
+		size_t GetPendingRegionCount() const { return m_regions.size(); }
+
+	private:
+		struct Region
+		{
+			uint64_t m_end;
+			uint64_t m_size;
+			uint64_t m_fenceValue;
+		};
+
+		std::deque<Region> m_regions;
+		uint64_t m_size;
+		uint64_t m_head;
+		uint64_t m_tail;
+		uint64_t m_used;
+		uint64_t m_openRegionSize;
+	};
+}
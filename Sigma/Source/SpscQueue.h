@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Sigma
+{
+	/*
+	Lock-free bounded queue for exactly one producer thread and one consumer thread.
+
+	Head and tail only ever increase and wrap naturally, the slot is the index masked by the capacity.
+	Each side keeps a cached copy of the other side index, and only reloads it (acquire) when the cache says the queue
+	looks full or empty, so in the common case Push and Pop touch a single shared cache line.
+	*/
+	template<typename T, uint32_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	public:
+		SpscQueue() :
+			m_head(0),
+			m_cachedTail(0),
+			m_tail(0),
+			m_cachedHead(0)
+		{
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer side, returns false if the queue is full
+		bool Push(const T& value)
+		{
+			uint32_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_cachedHead == Capacity)
+			{
+				m_cachedHead = m_head.load(std::memory_order_acquire);
+				if (tail - m_cachedHead == Capacity)
+					return false;
+			}
+
+			m_items[tail & (Capacity - 1)] = value;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side, returns false if the queue is empty
+		bool Pop(T& value)
+		{
+			uint32_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_cachedTail)
+			{
+				m_cachedTail = m_tail.load(std::memory_order_acquire);
+				if (head == m_cachedTail)
+					return false;
+			}
+
+			value = m_items[head & (Capacity - 1)];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// Consumer owned
+		alignas(64) std::atomic<uint32_t> m_head;
+		uint32_t m_cachedTail;
+
+		// Producer owned
+		alignas(64) std::atomic<uint32_t> m_tail;
+		uint32_t m_cachedHead;
+
+		alignas(64) T m_items[Capacity];
+	};
+}
@@ -0,0 +1,106 @@
+#include "TextureCopy.h"
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace Sigma
+{
+	static inline uint32_t ConvertTexel(uint32_t texel, TexelConversion conversion)
+	{
+		return conversion == TexelConversion::SwapRedBlue ? (texel & 0xff00ff00) | ((texel >> 16) & 0xff) | ((texel & 0xff) << 16) : texel;
+	}
+
+	static inline __m128i ConvertTexels(__m128i texels, TexelConversion conversion)
+	{
+		if (conversion != TexelConversion::SwapRedBlue)
+			return texels;
+
+		const __m128i greenAlpha = _mm_set1_epi32((int)0xff00ff00);
+		__m128i redBlue = _mm_andnot_si128(greenAlpha, texels);
+		return _mm_or_si128(_mm_and_si128(texels, greenAlpha), _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16)));
+	}
+
+	template <TexelConversion Conversion>
+	static void CopyScalar(uint8_t* dst, const uint8_t* src, uint64_t size)
+	{
+		if (Conversion == TexelConversion::None)
+		{
+			memcpy(dst, src, size);
+			return;
+		}
+
+		for (uint64_t i = 0; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t))
+		{
+			uint32_t texel;
+			memcpy(&texel, src + i, sizeof(texel));
+			texel = ConvertTexel(texel, Conversion);
+			memcpy(dst + i, &texel, sizeof(texel));
+		}
+	}
+
+	template <TexelConversion Conversion>
+	static void CopyRow(uint8_t* dst, const uint8_t* src, uint64_t size)
+	{
+		// Streaming stores need 16 byte alignment, reaching it must not split a texel
+		uint64_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+		if (Conversion != TexelConversion::None && (head & 3) != 0)
+		{
+			CopyScalar<Conversion>(dst, src, size);
+			return;
+		}
+
+		head = std::min(head, size);
+		CopyScalar<Conversion>(dst, src, head);
+		dst += head;
+		src += head;
+		size -= head;
+
+		for (; size >= 64; size -= 64, dst += 64, src += 64)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst), ConvertTexels(a, Conversion));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), ConvertTexels(b, Conversion));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), ConvertTexels(c, Conversion));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), ConvertTexels(d, Conversion));
+		}
+
+		for (; size >= 16; size -= 16, dst += 16, src += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst), ConvertTexels(a, Conversion));
+		}
+
+		CopyScalar<Conversion>(dst, src, size);
+	}
+
+	template <TexelConversion Conversion>
+	static void CopyRows(const TextureRows& destination, const uint8_t* source, uint64_t sourceRowPitch, uint64_t sourceSlicePitch)
+	{
+		for (uint32_t slice = 0; slice < destination.m_numSlices; slice++)
+		{
+			uint8_t* dst = destination.m_data + slice * destination.m_slicePitch;
+			const uint8_t* src = source + slice * sourceSlicePitch;
+			for (uint32_t row = 0; row < destination.m_numRows; row++)
+			{
+				CopyRow<Conversion>(dst, src, destination.m_rowSize);
+				dst += destination.m_rowPitch;
+				src += sourceRowPitch;
+			}
+		}
+	}
+
+	void CopyTextureRows(const TextureRows& destination, const void* source, uint64_t sourceRowPitch, uint64_t sourceSlicePitch, TexelConversion conversion)
+	{
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(source);
+		if (conversion == TexelConversion::SwapRedBlue)
+			CopyRows<TexelConversion::SwapRedBlue>(destination, src, sourceRowPitch, sourceSlicePitch);
+		else
+			CopyRows<TexelConversion::None>(destination, src, sourceRowPitch, sourceSlicePitch);
+
+		// Streaming stores are weakly ordered, they must be visible before the copy is submitted
+		_mm_sfence();
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Sigma
+{
+	enum class TexelConversion
+	{
+		None,
+		SwapRedBlue, // RGBA8 <-> BGRA8
+	};
+
+	// Rows of one subresource, slices follow each other
+	struct TextureRows
+	{
+		uint8_t* m_data;
+		uint64_t m_rowPitch;
+		uint64_t m_slicePitch;
+		uint64_t m_rowSize; // Bytes used in each row, the end of the pitch is padding
+		uint32_t m_numRows;
+		uint32_t m_numSlices;
+	};
+
+	/*
+	Copies a subresource into its footprint in an upload buffer, converting texels on the way.
+
+	The destination is written with non-temporal SSE2 stores, 64 bytes (a full write combining buffer) at a time :
+	upload heaps are write-combined memory, which the CPU should never read and only fill in full lines. Padding at
+	the end of the rows is left untouched. The source can have any alignment and pitch.
+	*/
+	void CopyTextureRows(const TextureRows& destination, const void* source, uint64_t sourceRowPitch, uint64_t sourceSlicePitch, TexelConversion conversion);
+}
@@ -0,0 +1,288 @@
+#include "TlsfAllocator.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Sigma
+{
+	// Index of the lowest/highest set bit, value must not be 0
+	static uint32_t FindLowestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return (uint32_t)__builtin_ctzll(value);
+#endif
+	}
+
+	static uint32_t FindHighestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+	}
+
+	TlsfAllocator::TlsfAllocator(uint64_t size, uint64_t granularity) :
+		m_size(size / granularity),
+		m_granularityLog2(FindHighestBit(granularity)),
+		m_usedSize(0),
+		m_allocationCount(0),
+		m_firstLevelBitmap(0)
+	{
+		std::fill(std::begin(m_secondLevelBitmaps), std::end(m_secondLevelBitmaps), 0);
+		for (uint32_t i = 0; i < kFirstLevelCount; i++)
+		{
+			std::fill(std::begin(m_freeLists[i]), std::end(m_freeLists[i]), kInvalidTlsfBlock);
+		}
+
+		if (m_size == 0)
+			return;
+
+		uint32_t block = CreateBlock();
+		m_blocks[block].m_offset = 0;
+		m_blocks[block].m_size = m_size;
+		InsertFreeBlock(block);
+	}
+
+	TlsfAllocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		TlsfAllocation allocation = { kInvalidOffset, 0, kInvalidTlsfBlock };
+		uint64_t units = std::max<uint64_t>(1, (size + (1ull << m_granularityLog2) - 1) >> m_granularityLog2);
+		uint64_t alignmentUnits = std::max<uint64_t>(1, alignment >> m_granularityLog2);
+		if (units > m_size)
+			return allocation;
+
+		// Room for the worst alignment gap, so any block found fits
+		uint32_t block = FindFreeBlock(units + alignmentUnits - 1);
+		if (block == kInvalidTlsfBlock)
+			return allocation;
+
+		RemoveFreeBlock(block);
+		m_blocks[block].m_free = false;
+
+		// The free block was merged with its neighbours, so the gap and the tail have none to merge with
+		uint64_t gap = AlignUp(m_blocks[block].m_offset, alignmentUnits) - m_blocks[block].m_offset;
+		if (gap > 0)
+		{
+			SplitFreeTail(block, gap);
+			uint32_t alignedBlock = m_blocks[block].m_nextPhysical;
+			RemoveFreeBlock(alignedBlock);
+			m_blocks[alignedBlock].m_free = false;
+
+			// The gap stays free, in front of the allocation
+			m_blocks[block].m_free = true;
+			InsertFreeBlock(block);
+			block = alignedBlock;
+		}
+		if (m_blocks[block].m_size > units)
+		{
+			SplitFreeTail(block, units);
+		}
+
+		m_usedSize += units;
+		m_allocationCount++;
+
+		allocation.m_offset = m_blocks[block].m_offset << m_granularityLog2;
+		allocation.m_size = units << m_granularityLog2;
+		allocation.m_block = block;
+		return allocation;
+	}
+
+	void TlsfAllocator::Free(uint32_t block)
+	{
+		if (block == kInvalidTlsfBlock || m_blocks[block].m_free)
+			return;
+
+		m_usedSize -= m_blocks[block].m_size;
+		m_allocationCount--;
+		m_blocks[block].m_free = true;
+
+		uint32_t next = m_blocks[block].m_nextPhysical;
+		if (next != kInvalidTlsfBlock && m_blocks[next].m_free)
+		{
+			RemoveFreeBlock(next);
+			m_blocks[block].m_size += m_blocks[next].m_size;
+			m_blocks[block].m_nextPhysical = m_blocks[next].m_nextPhysical;
+			if (m_blocks[next].m_nextPhysical != kInvalidTlsfBlock)
+				m_blocks[m_blocks[next].m_nextPhysical].m_previousPhysical = block;
+			DestroyBlock(next);
+		}
+
+		uint32_t previous = m_blocks[block].m_previousPhysical;
+		if (previous != kInvalidTlsfBlock && m_blocks[previous].m_free)
+		{
+			RemoveFreeBlock(previous);
+			m_blocks[previous].m_size += m_blocks[block].m_size;
+			m_blocks[previous].m_nextPhysical = m_blocks[block].m_nextPhysical;
+			if (m_blocks[block].m_nextPhysical != kInvalidTlsfBlock)
+				m_blocks[m_blocks[block].m_nextPhysical].m_previousPhysical = previous;
+			DestroyBlock(block);
+			block = previous;
+		}
+
+		InsertFreeBlock(block);
+	}
+
+	TlsfStats TlsfAllocator::GetStats() const
+	{
+		TlsfStats stats = {};
+		stats.m_size = m_size << m_granularityLog2;
+		stats.m_usedSize = m_usedSize << m_granularityLog2;
+		stats.m_freeSize = (m_size - m_usedSize) << m_granularityLog2;
+		stats.m_allocationCount = m_allocationCount;
+		stats.m_freeBlockCount = (uint32_t)(m_blocks.size() - m_unusedBlocks.size()) - m_allocationCount;
+
+		// The largest free block is in the highest non empty class
+		if (m_firstLevelBitmap != 0)
+		{
+			uint32_t firstLevel = FindHighestBit(m_firstLevelBitmap);
+			uint32_t secondLevel = FindHighestBit(m_secondLevelBitmaps[firstLevel]);
+			uint64_t largest = 0;
+			for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != kInvalidTlsfBlock; block = m_blocks[block].m_nextFree)
+			{
+				largest = std::max(largest, m_blocks[block].m_size);
+			}
+			stats.m_largestFreeBlock = largest << m_granularityLog2;
+		}
+		return stats;
+	}
+
+	void TlsfAllocator::GetClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+	{
+		if (size < kSecondLevelCount)
+		{
+			firstLevel = 0;
+			secondLevel = (uint32_t)size;
+			return;
+		}
+
+		uint32_t log2 = FindHighestBit(size);
+		firstLevel = log2 - kSecondLevelLog2 + 1;
+		secondLevel = (uint32_t)(size >> (log2 - kSecondLevelLog2)) ^ kSecondLevelCount;
+	}
+
+	uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const
+	{
+		// Rounded up to the next class, every block of the class found is then large enough
+		uint64_t roundedSize = size;
+		if (size >= kSecondLevelCount)
+			roundedSize += (1ull << (FindHighestBit(size) - kSecondLevelLog2)) - 1;
+
+		uint32_t firstLevel;
+		uint32_t secondLevel;
+		GetClass(roundedSize, firstLevel, secondLevel);
+
+		uint32_t secondLevelBitmap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		if (secondLevelBitmap == 0)
+		{
+			uint64_t firstLevelBitmap = firstLevel + 1 < kFirstLevelCount ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+			if (firstLevelBitmap != 0)
+			{
+				firstLevel = FindLowestBit(firstLevelBitmap);
+				secondLevelBitmap = m_secondLevelBitmaps[firstLevel];
+			}
+		}
+		if (secondLevelBitmap != 0)
+			return m_freeLists[firstLevel][FindLowestBit(secondLevelBitmap)];
+
+		// Blocks of the class of the size itself may still fit (a whole heap for instance), only the first one is
+		// checked to stay O(1)
+		GetClass(size, firstLevel, secondLevel);
+		uint32_t block = m_freeLists[firstLevel][secondLevel];
+		return block != kInvalidTlsfBlock && m_blocks[block].m_size >= size ? block : kInvalidTlsfBlock;
+	}
+
+	void TlsfAllocator::InsertFreeBlock(uint32_t block)
+	{
+		uint32_t firstLevel;
+		uint32_t secondLevel;
+		GetClass(m_blocks[block].m_size, firstLevel, secondLevel);
+
+		uint32_t head = m_freeLists[firstLevel][secondLevel];
+		m_blocks[block].m_previousFree = kInvalidTlsfBlock;
+		m_blocks[block].m_nextFree = head;
+		if (head != kInvalidTlsfBlock)
+			m_blocks[head].m_previousFree = block;
+		m_freeLists[firstLevel][secondLevel] = block;
+
+		m_firstLevelBitmap |= 1ull << firstLevel;
+		m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	}
+
+	void TlsfAllocator::RemoveFreeBlock(uint32_t block)
+	{
+		uint32_t firstLevel;
+		uint32_t secondLevel;
+		GetClass(m_blocks[block].m_size, firstLevel, secondLevel);
+
+		uint32_t previous = m_blocks[block].m_previousFree;
+		uint32_t next = m_blocks[block].m_nextFree;
+		if (next != kInvalidTlsfBlock)
+			m_blocks[next].m_previousFree = previous;
+		if (previous != kInvalidTlsfBlock)
+		{
+			m_blocks[previous].m_nextFree = next;
+			return;
+		}
+
+		m_freeLists[firstLevel][secondLevel] = next;
+		if (next == kInvalidTlsfBlock)
+		{
+			m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (m_secondLevelBitmaps[firstLevel] == 0)
+				m_firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+
+	void TlsfAllocator::SplitFreeTail(uint32_t block, uint64_t size)
+	{
+		uint32_t tail = CreateBlock();
+		Block& head = m_blocks[block];
+		m_blocks[tail].m_offset = head.m_offset + size;
+		m_blocks[tail].m_size = head.m_size - size;
+		m_blocks[tail].m_previousPhysical = block;
+		m_blocks[tail].m_nextPhysical = head.m_nextPhysical;
+		if (head.m_nextPhysical != kInvalidTlsfBlock)
+			m_blocks[head.m_nextPhysical].m_previousPhysical = tail;
+		head.m_nextPhysical = tail;
+		head.m_size = size;
+		InsertFreeBlock(tail);
+	}
+
+	uint32_t TlsfAllocator::CreateBlock()
+	{
+		uint32_t block;
+		if (!m_unusedBlocks.empty())
+		{
+			block = m_unusedBlocks.back();
+			m_unusedBlocks.pop_back();
+		}
+		else
+		{
+			block = (uint32_t)m_blocks.size();
+			m_blocks.emplace_back();
+		}
+
+		Block& entry = m_blocks[block];
+		entry.m_offset = 0;
+		entry.m_size = 0;
+		entry.m_previousPhysical = kInvalidTlsfBlock;
+		entry.m_nextPhysical = kInvalidTlsfBlock;
+		entry.m_previousFree = kInvalidTlsfBlock;
+		entry.m_nextFree = kInvalidTlsfBlock;
+		entry.m_free = true;
+		return block;
+	}
+
+	void TlsfAllocator::DestroyBlock(uint32_t block)
+	{
+		m_unusedBlocks.push_back(block);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "RingAllocator.h"
+
+namespace Sigma
+{
+	const uint32_t kInvalidTlsfBlock = 0xffffffff;
+
+	struct TlsfAllocation
+	{
+		uint64_t m_offset;	// kInvalidOffset if there was no free block large enough
+		uint64_t m_size;	// Rounded up to the granularity
+		uint32_t m_block;	// To give back to Free
+	};
+
+	struct TlsfStats
+	{
+		uint64_t m_size;
+		uint64_t m_usedSize;
+		uint64_t m_freeSize;
+		uint64_t m_largestFreeBlock;
+		uint32_t m_allocationCount;
+		uint32_t m_freeBlockCount;
+
+		// 0 when all the free space is a single block, close to 1 when it is scattered in small ones
+		double GetFragmentation() const { return m_freeSize > 0 ? 1.0 - (double)m_largestFreeBlock / m_freeSize : 0.0; }
+	};
+
+	/*
+	Two level segregated fit allocator, only deals with offsets so it can manage any kind of memory (GPU heaps have no room
+	for block headers, blocks are kept on the side).
+
+	Free blocks are sorted in size classes : the first level is the power of two of the size, the second level splits it
+	in kSecondLevelCount linear steps. A bitmap per level gives the first non empty class large enough with a bit scan,
+	so Allocate and Free are O(1). Requests are rounded up to the next class, so any block found fits (good fit rather
+	than best fit). Freed blocks are merged with their free neighbours right away.
+
+	Sizes and offsets are multiples of the granularity, which must be a power of two (64 KiB for placed resources).
+	*/
+	class TlsfAllocator
+	{
+	public:
+		TlsfAllocator(uint64_t size, uint64_t granularity);
+
+		// alignment must be a power of two
+		TlsfAllocation Allocate(uint64_t size, uint64_t alignment);
+		void Free(uint32_t block);
+
+		uint64_t GetSize() const { return m_size << m_granularityLog2; }
+		bool IsEmpty() const { return m_allocationCount == 0; }
+		TlsfStats GetStats() const;
+
+	private:
+		static const uint32_t kSecondLevelLog2 = 4;
+		static const uint32_t kSecondLevelCount = 1 << kSecondLevelLog2;
+		// Sizes below kSecondLevelCount units are all in the first class, then one class per power of two up to 2^63
+		static const uint32_t kFirstLevelCount = 64 - kSecondLevelLog2 + 1;
+
+		struct Block
+		{
+			uint64_t m_offset; // In units of the granularity, as the size
+			uint64_t m_size;
+			uint32_t m_previousPhysical;
+			uint32_t m_nextPhysical;
+			uint32_t m_previousFree;
+			uint32_t m_nextFree;
+			bool m_free;
+		};
+
+		static void GetClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+		uint32_t FindFreeBlock(uint64_t size) const;
+		void InsertFreeBlock(uint32_t block);
+		void RemoveFreeBlock(uint32_t block);
+		// Carves the end of a block into a new free one
+		void SplitFreeTail(uint32_t block, uint64_t size);
+
+		uint32_t CreateBlock();
+		void DestroyBlock(uint32_t block);
+
+		uint64_t m_size;
+		uint32_t m_granularityLog2;
+		uint64_t m_usedSize;
+		uint32_t m_allocationCount;
+
+		std::vector<Block> m_blocks;
+		std::vector<uint32_t> m_unusedBlocks;
+
+		uint64_t m_firstLevelBitmap;
+		uint32_t m_secondLevelBitmaps[kFirstLevelCount];
+		uint32_t m_freeLists[kFirstLevelCount][kSecondLevelCount];
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Sigma
+{
+	/*
+	Thread-safe bookkeeping for batched uploads, independent of the graphics API.
+
+	Any thread can add commands to the open batch, every command of a batch is tagged with the same ticket :
+	the fence value that will be signaled once the whole batch has been executed.
+	Writing an upload is split in two steps so the source memory can be filled outside of the lock :
+	- BeginWrite reserves space for the open batch (the reserve function runs under the lock)
+	- EndWrite adds the command, or CancelWrite gives up
+	Flush waits for all writers of the open batch to be done before handing its commands over.
+	*/
+	template<typename Command>
+	class UploadBatcher
+	{
+	public:
+		UploadBatcher(uint64_t firstTicket = 1) : m_openTicket(firstTicket), m_lastFlushedTicket(firstTicket - 1), m_activeWriters(0)
+		{
+		}
+
+		// Returns the ticket of the open batch, or 0 if reserve failed
+		template<typename ReserveFunc>
+		uint64_t BeginWrite(ReserveFunc reserve)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!reserve(m_openTicket))
+				return 0;
+
+			++m_activeWriters;
+			return m_openTicket;
+		}
+
+		void EndWrite(const Command& command)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_commands.push_back(command);
+			--m_activeWriters;
+			m_writersDone.notify_all();
+		}
+
+		void CancelWrite()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_activeWriters;
+			m_writersDone.notify_all();
+		}
+
+		// Moves the open batch commands into commands and returns its ticket, or 0 if the batch is empty.
+		// submit runs under the lock once the batch is closed, so nothing can be added to it anymore
+		template<typename SubmitFunc>
+		uint64_t Flush(std::vector<Command>& commands, SubmitFunc submit)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_writersDone.wait(lock, [this]() { return m_activeWriters == 0; });
+
+			if (m_commands.empty())
+				return 0;
+
+			commands.swap(m_commands);
+			m_commands.clear();
+
+			uint64_t ticket = m_openTicket++;
+			m_lastFlushedTicket = ticket;
+			submit(ticket);
+			return ticket;
+		}
+
+		uint64_t GetLastFlushedTicket() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_lastFlushedTicket;
+		}
+
+	private:
+		mutable std::mutex m_mutex;
+		std::condition_variable m_writersDone;
+		std::vector<Command> m_commands;
+		uint64_t m_openTicket;
+		uint64_t m_lastFlushedTicket;
+		uint32_t m_activeWriters;
+	};
+}
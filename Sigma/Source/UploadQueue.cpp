@@ -0,0 +1,295 @@
+#include "stdafx.h"
+#include "UploadQueue.h"
+#include "Profile.h"
+
+namespace Sigma
+{
+	UploadQueue::UploadQueue(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> copyQueue, ComPtr<ID3D12Heap> uploadHeap) :
+		m_device(device),
+		m_copyQueue(copyQueue),
+		m_batcher(1)
+	{
+		m_allocator = std::make_unique<UploadAllocator>(m_device, uploadHeap);
+
+		m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+		// The command list is reset with a different allocator on each flush
+		ComPtr<ID3D12CommandAllocator> commandAllocator;
+		m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator));
+		m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList));
+		m_commandList->Close();
+
+		BusyCommandAllocator busy;
+		busy.m_ticket = 0;
+		busy.m_allocator = commandAllocator;
+		m_busyCommandAllocators.push_back(busy);
+	}
+
+	UploadQueue::~UploadQueue()
+	{
+		WaitOnCPU(m_batcher.GetLastFlushedTicket());
+		CloseHandle(m_fenceEvent);
+	}
+
+	UINT64 UploadQueue::UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size)
+	{
+		UploadCommand command;
+		command.m_destination = destination;
+		command.m_destinationOffset = destinationOffset;
+		command.m_size = size;
+		command.m_firstSubresource = 0;
+
+		UINT64 ticket = m_batcher.BeginWrite([&](uint64_t)
+		{
+			std::lock_guard<std::mutex> lock(m_allocatorMutex);
+			command.m_source = m_allocator->Allocate(size, sizeof(float));
+			return command.m_source.m_resource != nullptr;
+		});
+
+		if (ticket == 0)
+			return 0;
+
+		memcpy(command.m_source.m_cpuAddress, data, size);
+
+		m_batcher.EndWrite(command);
+		return ticket;
+	}
+
+	// Formats differing only by sRGB or typeless-ness hold the same bits
+	static DXGI_FORMAT GetTexelLayout(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			return DXGI_FORMAT_B8G8R8A8_UNORM;
+		default:
+			return format;
+		}
+	}
+
+	static bool GetTexelConversion(DXGI_FORMAT sourceFormat, DXGI_FORMAT destinationFormat, TexelConversion& conversion)
+	{
+		DXGI_FORMAT source = GetTexelLayout(sourceFormat);
+		DXGI_FORMAT destination = GetTexelLayout(destinationFormat);
+		conversion = TexelConversion::None;
+		if (sourceFormat == DXGI_FORMAT_UNKNOWN || source == destination)
+			return true;
+
+		if ((source == DXGI_FORMAT_R8G8B8A8_UNORM && destination == DXGI_FORMAT_B8G8R8A8_UNORM) || (source == DXGI_FORMAT_B8G8R8A8_UNORM && destination == DXGI_FORMAT_R8G8B8A8_UNORM))
+		{
+			conversion = TexelConversion::SwapRedBlue;
+			return true;
+		}
+		return false;
+	}
+
+	UINT64 UploadQueue::UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data, DXGI_FORMAT sourceFormat)
+	{
+		TexelConversion conversion;
+		if (!GetTexelConversion(sourceFormat, destination->GetDesc().Format, conversion))
+			return 0;
+
+		return UploadTexture(destination, firstSubresource, numSubresources, [&](UINT subresource, const TextureRows& rows)
+		{
+			const D3D12_SUBRESOURCE_DATA& source = data[subresource - firstSubresource];
+			CopyTextureRows(rows, source.pData, source.RowPitch, source.SlicePitch, conversion);
+		});
+	}
+
+	UINT64 UploadQueue::UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const TextureWriter& writer)
+	{
+		return WriteTexture(destination, firstSubresource, numSubresources, [&](UINT8* bufferStart, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprints, const UINT* numRows, const UINT64* rowSizes)
+		{
+			for (UINT i = 0; i < numSubresources; i++)
+			{
+				TextureRows rows;
+				rows.m_data = bufferStart + footprints[i].Offset;
+				rows.m_rowPitch = footprints[i].Footprint.RowPitch;
+				rows.m_slicePitch = (UINT64)footprints[i].Footprint.RowPitch * numRows[i];
+				rows.m_rowSize = rowSizes[i];
+				rows.m_numRows = numRows[i];
+				rows.m_numSlices = footprints[i].Footprint.Depth;
+				writer(firstSubresource + i, rows);
+			}
+		});
+	}
+
+	UINT64 UploadQueue::UploadTexture(ID3D12Resource* destination, const CookedTexture& texture)
+	{
+		const CookedTextureHeader& header = *texture.m_header;
+		D3D12_RESOURCE_DESC desc = destination->GetDesc();
+		if (desc.Width != header.m_width || desc.Height != header.m_height || desc.MipLevels != header.m_mipLevels || desc.DepthOrArraySize != 1)
+			return 0;
+
+		return WriteTexture(destination, 0, header.m_mipLevels, [&](UINT8* bufferStart, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprints, const UINT* numRows, const UINT64* rowSizes)
+		{
+			UINT8* dataStart = bufferStart + footprints[0].Offset;
+			bool sameLayout = true;
+			for (UINT i = 0; i < header.m_mipLevels; i++)
+			{
+				const CookedSubresource& subresource = texture.m_subresources[i];
+				sameLayout = sameLayout && footprints[i].Offset - footprints[0].Offset == subresource.m_offset && footprints[i].Footprint.RowPitch == subresource.m_rowPitch
+					&& numRows[i] == subresource.m_numRows && rowSizes[i] == subresource.m_rowSize;
+			}
+
+			TextureRows rows;
+			rows.m_numSlices = 1;
+			if (sameLayout)
+			{
+				// Padding included, as one row
+				rows.m_data = dataStart;
+				rows.m_rowPitch = header.m_dataSize;
+				rows.m_slicePitch = header.m_dataSize;
+				rows.m_rowSize = header.m_dataSize;
+				rows.m_numRows = 1;
+				CopyTextureRows(rows, texture.m_data, header.m_dataSize, header.m_dataSize, TexelConversion::None);
+				return;
+			}
+
+			for (UINT i = 0; i < header.m_mipLevels; i++)
+			{
+				const CookedSubresource& subresource = texture.m_subresources[i];
+				rows.m_data = bufferStart + footprints[i].Offset;
+				rows.m_rowPitch = footprints[i].Footprint.RowPitch;
+				rows.m_slicePitch = (UINT64)footprints[i].Footprint.RowPitch * numRows[i];
+				rows.m_rowSize = (std::min)(rowSizes[i], (UINT64)subresource.m_rowSize);
+				rows.m_numRows = (std::min)(numRows[i], subresource.m_numRows);
+				CopyTextureRows(rows, texture.m_data + subresource.m_offset, subresource.m_rowPitch, 0, TexelConversion::None);
+			}
+		});
+	}
+
+	UINT64 UploadQueue::WriteTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const FootprintWriter& writer)
+	{
+		UploadCommand command;
+		command.m_destination = destination;
+		command.m_destinationOffset = 0;
+		command.m_size = 0;
+		command.m_firstSubresource = firstSubresource;
+		command.m_footprints.resize(numSubresources);
+
+		std::vector<UINT> numRows(numSubresources);
+		std::vector<UINT64> rowSizesInBytes(numSubresources);
+		D3D12_RESOURCE_DESC desc = destination->GetDesc();
+
+		UINT64 ticket = m_batcher.BeginWrite([&](uint64_t)
+		{
+			std::lock_guard<std::mutex> lock(m_allocatorMutex);
+			command.m_source = m_allocator->AllocateTexture(&desc, firstSubresource, numSubresources, command.m_footprints.data(), numRows.data(), rowSizesInBytes.data());
+			return command.m_source.m_resource != nullptr;
+		});
+
+		if (ticket == 0)
+			return 0;
+
+		// Footprints offsets are relative to the start of the upload buffer
+		UINT8* bufferStart = reinterpret_cast<UINT8*>(command.m_source.m_cpuAddress) - command.m_source.m_offset;
+		writer(bufferStart, command.m_footprints.data(), numRows.data(), rowSizesInBytes.data());
+
+		m_batcher.EndWrite(command);
+		return ticket;
+	}
+
+	UINT64 UploadQueue::Flush()
+	{
+		// Batches have to be executed in ticket order for the fence to stay monotonic
+		std::lock_guard<std::mutex> flushLock(m_flushMutex);
+
+		std::vector<UploadCommand> commands;
+		UINT64 ticket = m_batcher.Flush(commands, [this](uint64_t flushedTicket)
+		{
+			std::lock_guard<std::mutex> lock(m_allocatorMutex);
+			m_allocator->Submit(flushedTicket);
+		});
+
+		if (ticket == 0)
+			return 0;
+
+		ProfileScopedEvent(PIX_COLOR_INDEX(3), "Flush uploads %llu", ticket);
+
+		ComPtr<ID3D12CommandAllocator> commandAllocator;
+		if (m_busyCommandAllocators.front().m_ticket <= m_fence->GetCompletedValue())
+		{
+			commandAllocator = m_busyCommandAllocators.front().m_allocator;
+			m_busyCommandAllocators.pop_front();
+			commandAllocator->Reset();
+		}
+		else
+		{
+			m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator));
+		}
+
+		m_commandList->Reset(commandAllocator.Get(), nullptr);
+		for (const UploadCommand& command : commands)
+		{
+			if (command.m_footprints.empty())
+			{
+				m_commandList->CopyBufferRegion(command.m_destination.Get(), command.m_destinationOffset, command.m_source.m_resource, command.m_source.m_offset, command.m_size);
+			}
+			else
+			{
+				for (UINT i = 0; i < command.m_footprints.size(); i++)
+				{
+					D3D12_TEXTURE_COPY_LOCATION Dst = {};
+					Dst.pResource = command.m_destination.Get();
+					Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+					Dst.SubresourceIndex = command.m_firstSubresource + i;
+
+					D3D12_TEXTURE_COPY_LOCATION Src = {};
+					Src.pResource = command.m_source.m_resource;
+					Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+					Src.PlacedFootprint = command.m_footprints[i];
+
+					m_commandList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+				}
+			}
+		}
+		m_commandList->Close();
+
+		ID3D12CommandList* commandLists[] = { m_commandList.Get() };
+		m_copyQueue->ExecuteCommandLists(1, commandLists);
+		m_copyQueue->Signal(m_fence.Get(), ticket);
+
+		BusyCommandAllocator busy;
+		busy.m_ticket = ticket;
+		busy.m_allocator = commandAllocator;
+		m_busyCommandAllocators.push_back(busy);
+
+		return ticket;
+	}
+
+	void UploadQueue::WaitOnGPU(ID3D12CommandQueue* queue, UINT64 ticket)
+	{
+		if (ticket != 0)
+		{
+			queue->Wait(m_fence.Get(), ticket);
+		}
+	}
+
+	void UploadQueue::WaitOnCPU(UINT64 ticket)
+	{
+		if (!IsComplete(ticket))
+		{
+			ProfileScopedEvent(PIX_COLOR_INDEX(2), "Waiting for uploads");
+			m_fence->SetEventOnCompletion(ticket, m_fenceEvent);
+			WaitForSingleObject(m_fenceEvent, INFINITE);
+			PIXNotifyWakeFromFenceSignal(m_fenceEvent);
+		}
+	}
+
+	bool UploadQueue::IsComplete(UINT64 ticket)
+	{
+		return m_fence->GetCompletedValue() >= ticket;
+	}
+
+	void UploadQueue::Retire()
+	{
+		std::lock_guard<std::mutex> lock(m_allocatorMutex);
+		m_allocator->Retire(m_fence->GetCompletedValue());
+	}
+}
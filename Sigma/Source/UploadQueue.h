@@ -0,0 +1,92 @@
+#pragma once
+
+#include "stdafx.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Allocator.h"
+#include "CookedTexture.h"
+#include "TextureCopy.h"
+#include "UploadBatcher.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace Sigma
+{
+	struct UploadCommand
+	{
+		ComPtr<ID3D12Resource> m_destination;
+		UINT64 m_destinationOffset;
+		UploadAllocation m_source;
+		UINT64 m_size;
+
+		// Empty for buffer copies
+		UINT m_firstSubresource;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> m_footprints;
+	};
+
+	// Fills a subresource directly in upload memory (write-combined : write every byte once, never read)
+	typedef std::function<void(UINT subresource, const TextureRows& rows)> TextureWriter;
+
+	/*
+	Batches buffer and texture uploads from any thread and submits them on the copy queue with a single ExecuteCommandLists.
+	Each upload returns a ticket : the copy fence value that will be signaled once its batch is done.
+	Other queues should wait on tickets GPU side (WaitOnGPU) rather than blocking the CPU.
+	Resources must be in the COPY_DEST state (or decay-able to it) when the batch is executed.
+	*/
+	class UploadQueue
+	{
+	public:
+		UploadQueue(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> copyQueue, ComPtr<ID3D12Heap> uploadHeap);
+		~UploadQueue();
+
+		// Return the upload ticket, or 0 if the upload heap is full (Flush and Retire before trying again)
+		UINT64 UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size);
+		// The data is converted from sourceFormat (UNKNOWN for the format of the destination), swapping RGBA8 and BGRA8
+		// or ignoring sRGB. 0 is also returned for other conversions
+		UINT64 UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data, DXGI_FORMAT sourceFormat = DXGI_FORMAT_UNKNOWN);
+		// Without intermediate copy, the writer is called once per subresource before this returns
+		UINT64 UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const TextureWriter& writer);
+		// Every mip of the destination, which must have the size and mip count of the texture. A single copy when the
+		// device footprints match the cooked layout
+		UINT64 UploadTexture(ID3D12Resource* destination, const CookedTexture& texture);
+
+		// Submits everything queued so far, returns its ticket or 0 if there was nothing to submit
+		UINT64 Flush();
+
+		// Makes queue wait for the ticket without blocking the CPU
+		void WaitOnGPU(ID3D12CommandQueue* queue, UINT64 ticket);
+		void WaitOnCPU(UINT64 ticket);
+		bool IsComplete(UINT64 ticket);
+
+		// Reclaims upload memory of completed batches
+		void Retire();
+
+	private:
+		// Called once with the footprints of all subresources, their offsets are relative to bufferStart
+		typedef std::function<void(UINT8* bufferStart, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprints, const UINT* numRows, const UINT64* rowSizes)> FootprintWriter;
+		UINT64 WriteTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const FootprintWriter& writer);
+
+		ComPtr<ID3D12Device> m_device;
+		ComPtr<ID3D12CommandQueue> m_copyQueue;
+		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		ComPtr<ID3D12Fence> m_fence;
+		HANDLE m_fenceEvent;
+
+		std::unique_ptr<UploadAllocator> m_allocator;
+		std::mutex m_allocatorMutex;
+
+		UploadBatcher<UploadCommand> m_batcher;
+
+		// Command allocators are recycled once the batch that used them is done
+		struct BusyCommandAllocator
+		{
+			UINT64 m_ticket;
+			ComPtr<ID3D12CommandAllocator> m_allocator;
+		};
+		std::deque<BusyCommandAllocator> m_busyCommandAllocators;
+		std::mutex m_flushMutex;
+	};
+}
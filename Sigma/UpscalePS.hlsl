@@ -0,0 +1,17 @@
+Texture2D Texture2DTable[] : register(t0, space0);
+SamplerState TextureSampler;
+
+struct UpscaleConstants
+{
+	float2 UVScale;		// Rendered part of the source texture
+	float2 UVMin;		// First texel center, so filtering never wraps around to the unrendered far edge
+	float2 UVClamp;		// Last texel center of the rendered part, so filtering never reads outside of it
+	uint TextureIndex;
+};
+ConstantBuffer<UpscaleConstants> upscaleConstants : register(b0, space0);
+
+float4 main(float4 pos : SV_POSITION, float2 texCoord : TEXCOORD) : SV_TARGET
+{
+	float2 uv = clamp(texCoord * upscaleConstants.UVScale, upscaleConstants.UVMin, upscaleConstants.UVClamp);
+	return Texture2DTable[upscaleConstants.TextureIndex].Sample(TextureSampler, uv);
+}
\ No newline at end of file
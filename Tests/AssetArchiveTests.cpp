@@ -0,0 +1,171 @@
+#include "Test.h"
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Sigma;
+
+const char* kArchivePath = "AssetArchiveTests.pak";
+const char* kCorruptPath = "AssetArchiveTests.corrupt.pak";
+
+struct TestAsset
+{
+	std::string m_name;
+	std::vector<uint8_t> m_data;
+	bool m_compress;
+};
+
+// Half compressible text, half random bytes, some empty and some spanning many blocks
+static std::vector<TestAsset> MakeAssets(std::mt19937& random)
+{
+	static const char* words[] = { "float4 ", "return ", "texture", "sampler", "cbuffer ", "struct ", "\n\t" };
+	std::vector<TestAsset> assets;
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		TestAsset asset;
+		asset.m_name = "Assets/" + std::to_string(i) + ".bin";
+		asset.m_compress = random() % 2 == 0;
+		uint32_t size = i % 25 == 0 ? 0 : random() % (i % 10 == 0 ? 600000 : 20000);
+		while (asset.m_data.size() < size)
+		{
+			if (i % 2 == 0)
+			{
+				for (const char* c = words[random() % 7]; *c != 0; c++)
+				{
+					asset.m_data.push_back((uint8_t)*c);
+				}
+			}
+			else
+			{
+				asset.m_data.push_back((uint8_t)random());
+			}
+		}
+		asset.m_data.resize(size);
+		assets.push_back(asset);
+	}
+	return assets;
+}
+
+static std::vector<uint8_t> ReadFile(const char* path)
+{
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+		return data;
+	fseek(file, 0, SEEK_END);
+	data.resize((size_t)ftell(file));
+	fseek(file, 0, SEEK_SET);
+	size_t read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+	data.resize(read);
+	return data;
+}
+
+static void WriteFile(const char* path, const std::vector<uint8_t>& data, size_t size)
+{
+	FILE* file = fopen(path, "wb");
+	fwrite(data.data(), 1, size, file);
+	fclose(file);
+}
+
+static void TestRoundTrip(const std::vector<TestAsset>& assets, JobSystem& jobSystem)
+{
+	AssetArchiveWriter writer;
+	for (const TestAsset& asset : assets)
+	{
+		CHECK(writer.Add(asset.m_name.c_str(), asset.m_data.data(), asset.m_data.size(), asset.m_compress));
+	}
+	CHECK(!writer.Add(assets[3].m_name.c_str(), assets[3].m_data.data(), assets[3].m_data.size(), false));
+	CHECK(writer.Write(kArchivePath));
+
+	AssetArchive archive;
+	CHECK(archive.Open(kArchivePath));
+	CHECK(archive.GetEntryCount() == assets.size());
+	uint32_t compressed = 0;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const AssetArchiveEntry* entry = archive.Find(assets[i].m_name.c_str());
+		CHECK(entry != nullptr);
+		if (entry == nullptr)
+			continue;
+		CHECK(entry == archive.Find(HashAssetName(assets[i].m_name.c_str())));
+		CHECK(entry->m_size == assets[i].m_data.size());
+		CHECK(entry->m_offset % kAssetArchiveAlignment == 0);
+		compressed += entry->m_numBlocks != 0;
+
+		// Uncompressed entries are used in place, compressed ones only through Read
+		AssetSpan span = archive.GetSpan(*entry);
+		if (entry->m_numBlocks == 0)
+			CHECK(span.m_size == entry->m_size && (span.m_size == 0 || memcmp(span.m_data, assets[i].m_data.data(), span.m_size) == 0));
+		else
+			CHECK(span.m_size == 0);
+
+		std::vector<uint8_t> data(assets[i].m_data.size() + 1, 0xa5);
+		CHECK(archive.Read(*entry, data.data(), i % 2 ? &jobSystem : nullptr));
+		CHECK((assets[i].m_data.empty() || memcmp(data.data(), assets[i].m_data.data(), assets[i].m_data.size()) == 0) && data.back() == 0xa5);
+	}
+	// Random data stays stored even when asked to compress, text does not
+	CHECK(compressed > 0 && compressed < assets.size());
+	CHECK(archive.Find("Assets/missing.bin") == nullptr);
+	archive.Close();
+	CHECK(!archive.IsOpen());
+}
+
+// Truncated archives and corrupt tables of contents are rejected by Open or by Read, corrupt compressed data by Read,
+// nothing reads outside the mapping (checked by the sanitizers)
+static void TestCorruptArchives(const std::vector<TestAsset>& assets, JobSystem& jobSystem)
+{
+	std::vector<uint8_t> file = ReadFile(kArchivePath);
+	CHECK(!file.empty());
+	AssetArchive archive;
+
+	WriteFile(kCorruptPath, file, file.size() - 8);
+	CHECK(!archive.Open(kCorruptPath));
+	WriteFile(kCorruptPath, file, sizeof(AssetArchiveHeader) - 1);
+	CHECK(!archive.Open(kCorruptPath));
+	CHECK(!archive.Open("AssetArchiveTests.missing.pak"));
+
+	std::mt19937 random(7);
+	AssetArchiveHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	size_t tocEnd = (size_t)header.m_tocOffset + header.m_entryCount * sizeof(AssetArchiveEntry);
+	CHECK(tocEnd < file.size());
+	uint32_t failedReads = 0;
+	for (uint32_t i = 0; i < 200; i++)
+	{
+		// Alternately the header and table of contents, or the asset data
+		std::vector<uint8_t> corrupt = file;
+		size_t position = i % 2 == 0 ? random() % tocEnd : tocEnd + random() % (file.size() - tocEnd);
+		corrupt[position] ^= (uint8_t)(1 << (random() % 8));
+		WriteFile(kCorruptPath, corrupt, corrupt.size());
+
+		if (!archive.Open(kCorruptPath))
+			continue;
+		for (const TestAsset& asset : assets)
+		{
+			const AssetArchiveEntry* entry = archive.Find(asset.m_name.c_str());
+			if (entry == nullptr)
+				continue;
+			std::vector<uint8_t> data((size_t)entry->m_size);
+			failedReads += !archive.Read(*entry, data.data(), &jobSystem);
+		}
+		archive.Close();
+	}
+	CHECK(failedReads > 0);
+	remove(kCorruptPath);
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	std::vector<TestAsset> assets = MakeAssets(random);
+	JobSystem jobSystem(2);
+	TestRoundTrip(assets, jobSystem);
+	TestCorruptArchives(assets, jobSystem);
+	remove(kArchivePath);
+	return ReportTestResults("AssetArchiveTests");
+}
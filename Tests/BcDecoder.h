@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Reference block decoders, written from the BC format specifications, independently of the encoder. Decoded blocks are
+// 16 RGBA8 texels in row order
+namespace BcDecoder
+{
+	inline void Expand565(uint16_t color, int32_t* rgb)
+	{
+		int32_t r = color >> 11;
+		int32_t g = (color >> 5) & 63;
+		int32_t b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC3 color blocks always use the 4 color mode, BC1 blocks only when color0 > color1
+	inline void DecodeBc1(const uint8_t* block, uint8_t texels[16][4], bool alwaysFourColors)
+	{
+		uint16_t color0, color1;
+		uint32_t indices;
+		memcpy(&color0, block, 2);
+		memcpy(&color1, block + 2, 2);
+		memcpy(&indices, block + 4, 4);
+
+		int32_t palette[4][4];
+		Expand565(color0, palette[0]);
+		Expand565(color1, palette[1]);
+		bool fourColors = alwaysFourColors || color0 > color1;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			palette[2][c] = fourColors ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = fourColors ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t index = (indices >> (2 * i)) & 3;
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				texels[i][c] = (uint8_t)palette[index][c];
+			}
+		}
+	}
+
+	// Into one channel of the texels
+	inline void DecodeBc4(const uint8_t* block, uint8_t texels[16][4], uint32_t channel)
+	{
+		int32_t palette[8];
+		palette[0] = block[0];
+		palette[1] = block[1];
+		if (palette[0] > palette[1])
+		{
+			for (int32_t i = 1; i < 7; i++)
+			{
+				palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+			}
+		}
+		else
+		{
+			for (int32_t i = 1; i < 5; i++)
+			{
+				palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		memcpy(&indices, block + 2, 6);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			texels[i][channel] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	inline uint32_t ReadBits(const uint8_t* block, uint32_t& position, uint32_t count)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < count; i++, position++)
+		{
+			value |= ((block[position >> 3] >> (position & 7)) & 1) << i;
+		}
+		return value;
+	}
+
+	// Mode 6 only, returns false for any other mode
+	inline bool DecodeBc7(const uint8_t* block, uint8_t texels[16][4])
+	{
+		if ((block[0] & 0x7f) != 0x40)
+			return false;
+
+		uint32_t position = 7;
+		int32_t endpoints[2][4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = (int32_t)ReadBits(block, position, 7);
+			endpoints[1][c] = (int32_t)ReadBits(block, position, 7);
+		}
+		int32_t pBits[2];
+		pBits[0] = (int32_t)ReadBits(block, position, 1);
+		pBits[1] = (int32_t)ReadBits(block, position, 1);
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = (endpoints[0][c] << 1) | pBits[0];
+			endpoints[1][c] = (endpoints[1][c] << 1) | pBits[1];
+		}
+
+		static const int32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			// The anchor index has its top bit implied
+			int32_t weight = weights[ReadBits(block, position, i == 0 ? 3 : 4)];
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				texels[i][c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+			}
+		}
+		return true;
+	}
+}
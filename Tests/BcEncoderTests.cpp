@@ -0,0 +1,241 @@
+#include "Test.h"
+#include "BcDecoder.h"
+#include "BcEncoder.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+struct Image
+{
+	uint32_t m_width;
+	uint32_t m_height;
+	std::vector<uint8_t> m_texels; // RGBA8, tightly packed
+};
+
+// Smooth color and alpha ramps over the whole image
+static Image MakeGradient(uint32_t width, uint32_t height)
+{
+	Image image = { width, height, std::vector<uint8_t>((size_t)width * height * 4) };
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint8_t* texel = &image.m_texels[((size_t)y * width + x) * 4];
+			texel[0] = (uint8_t)(255 * x / (width - 1));
+			texel[1] = (uint8_t)(255 * y / (height - 1));
+			texel[2] = (uint8_t)(255 * (x + y) / (width + height - 2));
+			texel[3] = (uint8_t)(255 - 255 * y / (height - 1));
+		}
+	}
+	return image;
+}
+
+struct EncodedImage
+{
+	uint32_t m_blocksX;
+	uint32_t m_blocksY;
+	uint64_t m_rowPitch;
+	std::vector<uint8_t> m_blocks;
+};
+
+// With padding at the end of each row of blocks, which must be left untouched
+static EncodedImage Encode(BcFormat format, const Image& image, uint32_t quality, JobSystem* jobSystem)
+{
+	EncodedImage encoded;
+	encoded.m_blocksX = (image.m_width + 3) / 4;
+	encoded.m_blocksY = (image.m_height + 3) / 4;
+	encoded.m_rowPitch = encoded.m_blocksX * GetBcBlockSize(format) + 32;
+	encoded.m_blocks.assign(encoded.m_rowPitch * encoded.m_blocksY, 0xee);
+	EncodeBc(format, image.m_texels.data(), image.m_width * 4, image.m_width, image.m_height, encoded.m_blocks.data(), encoded.m_rowPitch, quality, jobSystem);
+	for (uint32_t y = 0; y < encoded.m_blocksY; y++)
+	{
+		CHECK(encoded.m_blocks[y * encoded.m_rowPitch + encoded.m_blocksX * GetBcBlockSize(format)] == 0xee);
+		CHECK(encoded.m_blocks[(y + 1) * encoded.m_rowPitch - 1] == 0xee);
+	}
+	return encoded;
+}
+
+static Image Decode(BcFormat format, const EncodedImage& encoded, uint32_t width, uint32_t height)
+{
+	Image image = { width, height, std::vector<uint8_t>((size_t)width * height * 4) };
+	for (uint32_t blockY = 0; blockY < encoded.m_blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < encoded.m_blocksX; blockX++)
+		{
+			const uint8_t* block = &encoded.m_blocks[blockY * encoded.m_rowPitch + blockX * GetBcBlockSize(format)];
+			uint8_t texels[16][4] = {};
+			switch (format)
+			{
+			case BcFormat::BC1:
+				BcDecoder::DecodeBc1(block, texels, false);
+				break;
+			case BcFormat::BC3:
+				BcDecoder::DecodeBc1(block + 8, texels, true);
+				BcDecoder::DecodeBc4(block, texels, 3);
+				break;
+			case BcFormat::BC4:
+				BcDecoder::DecodeBc4(block, texels, 0);
+				break;
+			case BcFormat::BC5:
+				BcDecoder::DecodeBc4(block, texels, 0);
+				BcDecoder::DecodeBc4(block + 8, texels, 1);
+				break;
+			case BcFormat::BC7:
+				CHECK(BcDecoder::DecodeBc7(block, texels));
+				break;
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = blockX * 4 + i % 4;
+				uint32_t y = blockY * 4 + i / 4;
+				if (x < width && y < height)
+					memcpy(&image.m_texels[((size_t)y * width + x) * 4], texels[i], 4);
+			}
+		}
+	}
+	return image;
+}
+
+static double GetPsnr(const Image& a, const Image& b, uint32_t firstChannel, uint32_t numChannels)
+{
+	double squaredError = 0.0;
+	for (size_t i = 0; i < a.m_texels.size(); i += 4)
+	{
+		for (uint32_t c = firstChannel; c < firstChannel + numChannels; c++)
+		{
+			double difference = (double)a.m_texels[i + c] - b.m_texels[i + c];
+			squaredError += difference * difference;
+		}
+	}
+	double meanSquaredError = squaredError / (a.m_texels.size() / 4 * numChannels);
+	return meanSquaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+// Every format decodes back close to a gradient : red and green vary along different axes, so even BC7 mode 6 cannot
+// fit a block on a single line. More quality never makes it worse, and jobs give the same blocks
+static void TestGradient(JobSystem& jobSystem)
+{
+	Image gradient = MakeGradient(256, 256);
+	// Opaque for BC1, its transparent texels are checked separately
+	Image opaque = gradient;
+	for (size_t i = 3; i < opaque.m_texels.size(); i += 4)
+	{
+		opaque.m_texels[i] = 255;
+	}
+
+	double previous = 0.0;
+	for (uint32_t quality = 0; quality <= kMaxBcQuality; quality++)
+	{
+		EncodedImage encoded = Encode(BcFormat::BC1, opaque, quality, nullptr);
+		double psnr = GetPsnr(opaque, Decode(BcFormat::BC1, encoded, 256, 256), 0, 3);
+		CHECK(psnr >= 44.5);
+		CHECK(psnr >= previous - 0.05);
+		previous = psnr;
+		CHECK(Encode(BcFormat::BC1, opaque, quality, &jobSystem).m_blocks == encoded.m_blocks);
+	}
+
+	previous = 0.0;
+	for (uint32_t quality = 0; quality <= kMaxBcQuality; quality++)
+	{
+		EncodedImage encoded = Encode(BcFormat::BC7, gradient, quality, nullptr);
+		Image decoded = Decode(BcFormat::BC7, encoded, 256, 256);
+		double psnr = GetPsnr(gradient, decoded, 0, 3);
+		CHECK(psnr >= 50.5);
+		CHECK(GetPsnr(gradient, decoded, 3, 1) >= 54.5);
+		CHECK(psnr >= previous - 0.05);
+		previous = psnr;
+		CHECK(Encode(BcFormat::BC7, gradient, quality, &jobSystem).m_blocks == encoded.m_blocks);
+	}
+
+	Image bc3 = Decode(BcFormat::BC3, Encode(BcFormat::BC3, gradient, 1, nullptr), 256, 256);
+	CHECK(GetPsnr(gradient, bc3, 0, 3) >= 44.5);
+	CHECK(GetPsnr(gradient, bc3, 3, 1) >= 53.5);
+	CHECK(GetPsnr(gradient, Decode(BcFormat::BC4, Encode(BcFormat::BC4, gradient, 0, nullptr), 256, 256), 0, 1) >= 53.5);
+	CHECK(GetPsnr(gradient, Decode(BcFormat::BC5, Encode(BcFormat::BC5, gradient, 0, nullptr), 256, 256), 0, 2) >= 53.5);
+}
+
+// Colors along a single axis, the case mode 6 and the BC1 principal axis fit best
+static void TestRamp()
+{
+	Image ramp = { 256, 256, std::vector<uint8_t>(256 * 256 * 4) };
+	for (uint32_t y = 0; y < 256; y++)
+	{
+		for (uint32_t x = 0; x < 256; x++)
+		{
+			uint8_t* texel = &ramp.m_texels[(y * 256 + x) * 4];
+			texel[0] = (uint8_t)x;
+			texel[1] = (uint8_t)(255 - x);
+			texel[2] = (uint8_t)(x / 2 + 64);
+			texel[3] = 255;
+		}
+	}
+	CHECK(GetPsnr(ramp, Decode(BcFormat::BC1, Encode(BcFormat::BC1, ramp, 1, nullptr), 256, 256), 0, 3) >= 44.0);
+	CHECK(GetPsnr(ramp, Decode(BcFormat::BC7, Encode(BcFormat::BC7, ramp, 1, nullptr), 256, 256), 0, 3) >= 52.0);
+}
+
+// BC1 texels under alpha 128 decode transparent, the others opaque
+static void TestBc1Alpha()
+{
+	Image image = MakeGradient(64, 64);
+	EncodedImage encoded = Encode(BcFormat::BC1, image, 1, nullptr);
+	Image decoded = Decode(BcFormat::BC1, encoded, 64, 64);
+	for (size_t i = 3; i < image.m_texels.size(); i += 4)
+	{
+		CHECK(decoded.m_texels[i] == (image.m_texels[i] < 128 ? 0 : 255));
+	}
+}
+
+// Sizes that are not multiples of 4 clamp the partial blocks, which stay within the footprint. Noise only has to
+// encode, solid colors have to come back
+static void TestPartialBlocks()
+{
+	std::mt19937 random(3);
+	const BcFormat formats[] = { BcFormat::BC1, BcFormat::BC3, BcFormat::BC4, BcFormat::BC5, BcFormat::BC7 };
+	for (uint32_t i = 0; i < 40; i++)
+	{
+		uint32_t width = 1 + random() % 13;
+		uint32_t height = 1 + random() % 13;
+		Image image = { width, height, std::vector<uint8_t>((size_t)width * height * 4) };
+		for (uint8_t& value : image.m_texels)
+		{
+			value = (uint8_t)(random() % 256);
+		}
+		Image solid = image;
+		for (size_t texel = 0; texel < solid.m_texels.size(); texel += 4)
+		{
+			memcpy(&solid.m_texels[texel], &image.m_texels[0], 3);
+			solid.m_texels[texel + 3] = 255;
+		}
+
+		for (BcFormat format : formats)
+		{
+			Decode(format, Encode(format, image, 1, nullptr), width, height);
+			Image decoded = Decode(format, Encode(format, solid, 1, nullptr), width, height);
+			uint32_t numChannels = format == BcFormat::BC4 ? 1 : format == BcFormat::BC5 ? 2 : 3;
+			for (size_t texel = 0; texel < solid.m_texels.size(); texel += 4)
+			{
+				for (uint32_t c = 0; c < numChannels; c++)
+				{
+					// 565 endpoints and their interpolation are off by up to 8 for BC1 and BC3, exact enough elsewhere
+					int32_t tolerance = format == BcFormat::BC1 || format == BcFormat::BC3 ? 8 : 2;
+					CHECK(std::abs((int32_t)decoded.m_texels[texel + c] - solid.m_texels[texel + c]) <= tolerance);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	JobSystem jobSystem(3);
+	TestGradient(jobSystem);
+	TestRamp();
+	TestBc1Alpha();
+	TestPartialBlocks();
+	return ReportTestResults("BcEncoderTests");
+}
@@ -0,0 +1,193 @@
+#include "Test.h"
+#include "BlockCompression.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint8_t kGuard = 0xa5;
+const uint32_t kGuardSize = 64;
+
+enum class Content
+{
+	Random,
+	Text,
+	Zeros,
+	Runs,
+	NoisyRamp,
+	Count,
+};
+
+static std::vector<uint8_t> MakeData(Content content, uint32_t size, std::mt19937& random)
+{
+	static const char* words[] = { "float4 ", "return ", "texture", "sampler", "cbuffer ", "struct ", "\n\t", "SV_Position", "0.0f, ", "matrix " };
+	std::vector<uint8_t> data(size, 0);
+	for (uint32_t i = 0; i < size;)
+	{
+		switch (content)
+		{
+		case Content::Random:
+			data[i++] = (uint8_t)random();
+			break;
+		case Content::Text:
+			for (const char* c = words[random() % 10]; *c != 0 && i < size; c++)
+			{
+				data[i++] = (uint8_t)*c;
+			}
+			break;
+		case Content::Runs:
+			data[i] = i % 7 == 0 ? (uint8_t)random() : data[i > 0 ? i - 1 : 0];
+			i++;
+			break;
+		case Content::NoisyRamp:
+			data[i] = (uint8_t)((i / 4) ^ (random() % 3));
+			i++;
+			break;
+		default:
+			i = size;
+			break;
+		}
+	}
+	return data;
+}
+
+// Decompresses into a buffer of exactly size bytes followed by a guard, which must never be written
+static bool Decompress(const std::vector<uint8_t>& compressed, uint32_t compressedSize, std::vector<uint8_t>& output, uint32_t size)
+{
+	output.assign(size + kGuardSize, kGuard);
+	bool result = DecompressBlock(compressed.data(), compressedSize, output.data(), size);
+	for (uint32_t i = 0; i < kGuardSize; i++)
+	{
+		CHECK(output[size + i] == kGuard);
+	}
+	output.resize(size);
+	return result;
+}
+
+static void TestRoundTrip()
+{
+	std::mt19937 random(1);
+	const uint32_t sizes[] = { 0, 1, 4, 5, 11, 12, 13, 16, 17, 64, 255, 256, 1000, 4096, 65535, 65536 };
+	for (uint32_t content = 0; content < (uint32_t)Content::Count; content++)
+	{
+		for (uint32_t size : sizes)
+		{
+			std::vector<uint8_t> data = MakeData((Content)content, size, random);
+			std::vector<uint8_t> compressed(GetCompressBound(size));
+			uint32_t compressedSize = CompressBlock(data.data(), size, compressed.data(), (uint32_t)compressed.size());
+			CHECK(compressedSize > 0 || size == 0);
+			CHECK(compressedSize <= GetCompressBound(size));
+
+			std::vector<uint8_t> output;
+			CHECK(Decompress(compressed, compressedSize, output, size) && output == data);
+			// The size has to match exactly
+			if (size > 0)
+				CHECK(!Decompress(compressed, compressedSize, output, size - 1));
+			CHECK(!Decompress(compressed, compressedSize, output, size + 1));
+
+			// Too little room for the compressed data fails instead of truncating
+			if (compressedSize > 1)
+				CHECK(CompressBlock(data.data(), size, compressed.data(), compressedSize - 1) == 0);
+		}
+	}
+
+	// Compressible data actually shrinks
+	std::vector<uint8_t> text = MakeData(Content::Text, 65536, random);
+	std::vector<uint8_t> compressed(GetCompressBound(65536));
+	CHECK(CompressBlock(text.data(), 65536, compressed.data(), (uint32_t)compressed.size()) < 65536 / 2);
+	std::vector<uint8_t> zeros(65536, 0);
+	CHECK(CompressBlock(zeros.data(), 65536, compressed.data(), (uint32_t)compressed.size()) < 512);
+}
+
+// A block written by the reference lz4 tool (lz4 -9, taken out of its frame), and blocks built by hand from the format
+// description : an overlapping match and a literal run longer than 15
+static void TestReferenceBlocks()
+{
+	const char text[] = "float4 main(float4 position : SV_Position) : SV_Target\n{\n\treturn texture.Sample(sampler, position.xy) * float4(0.5f, 0.5f, 0.5f, 1.0f);\n}\n";
+	const std::vector<uint8_t> reference = {
+		0xc3, 0x66, 0x6c, 0x6f, 0x61, 0x74, 0x34, 0x20, 0x6d, 0x61, 0x69, 0x6e, 0x28, 0x0c, 0x00, 0xf3, 0x00, 0x70, 0x6f, 0x73,
+		0x69, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x3a, 0x20, 0x53, 0x56, 0x5f, 0x50, 0x0e, 0x00, 0x12, 0x29, 0x0f, 0x00, 0xf1, 0x12,
+		0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x0a, 0x7b, 0x0a, 0x09, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x74, 0x65, 0x78,
+		0x74, 0x75, 0x72, 0x65, 0x2e, 0x53, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x28, 0x73, 0x07, 0x00, 0x25, 0x72, 0x2c, 0x46, 0x00,
+		0x72, 0x2e, 0x78, 0x79, 0x29, 0x20, 0x2a, 0x20, 0x5c, 0x00, 0x78, 0x28, 0x30, 0x2e, 0x35, 0x66, 0x2c, 0x20, 0x06, 0x00,
+		0x90, 0x31, 0x2e, 0x30, 0x66, 0x29, 0x3b, 0x0a, 0x7d, 0x0a,
+	};
+	uint32_t size = (uint32_t)strlen(text);
+	std::vector<uint8_t> output;
+	CHECK(Decompress(reference, (uint32_t)reference.size(), output, size) && memcmp(output.data(), text, size) == 0);
+
+	// "abc", a 12 bytes match at offset 3 reading what it writes, then the last 5 literals
+	const std::vector<uint8_t> overlapping = { 0x38, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'v', 'w', 'x', 'y', 'z' };
+	CHECK(Decompress(overlapping, (uint32_t)overlapping.size(), output, 20));
+	CHECK(memcmp(output.data(), "abcabcabcabcabcvwxyz", 20) == 0);
+
+	// 300 literals : 15 in the token, then 255 and 30
+	std::vector<uint8_t> literals = { 0xf0, 0xff, 0x1e };
+	for (uint32_t i = 0; i < 300; i++)
+	{
+		literals.push_back((uint8_t)i);
+	}
+	CHECK(Decompress(literals, (uint32_t)literals.size(), output, 300));
+	for (uint32_t i = 0; i < 300; i++)
+	{
+		CHECK(output[i] == (uint8_t)i);
+	}
+}
+
+// Hand made invalid blocks, each has to fail
+static void TestInvalidBlocks()
+{
+	std::vector<uint8_t> output;
+	// Offset 0
+	CHECK(!Decompress({ 0x10, 'a', 0x00, 0x00, 0x50, 'v', 'w', 'x', 'y', 'z' }, 10, output, 10));
+	// Offset before the start of the output
+	CHECK(!Decompress({ 0x10, 'a', 0x02, 0x00, 0x50, 'v', 'w', 'x', 'y', 'z' }, 10, output, 10));
+	// Literals past the end of the input
+	CHECK(!Decompress({ 0x50, 'a', 'b' }, 3, output, 5));
+	// Literal length continuing past the end of the input
+	CHECK(!Decompress({ 0xf0, 0xff }, 2, output, 300));
+	// Match past the end of the output
+	CHECK(!Decompress({ 0x3f, 'a', 'b', 'c', 0x03, 0x00, 0x10, 0x50, 'v', 'w', 'x', 'y', 'z' }, 13, output, 20));
+	// Match offset cut off
+	CHECK(!Decompress({ 0x38, 'a', 'b', 'c', 0x03 }, 5, output, 20));
+	// Empty input for a non empty block
+	CHECK(!Decompress({ 0x00 }, 0, output, 1));
+}
+
+// Random bit flips and truncations of valid blocks : the decoder may fail or succeed, it must never write past the
+// destination (checked by the guard) or read past the input (checked by the sanitizers)
+static void TestCorruptInput()
+{
+	std::mt19937 random(2);
+	uint32_t failures = 0;
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		uint32_t size = 1 + random() % 2000;
+		std::vector<uint8_t> data = MakeData((Content)(random() % (uint32_t)Content::Count), size, random);
+		std::vector<uint8_t> compressed(GetCompressBound(size));
+		uint32_t compressedSize = CompressBlock(data.data(), size, compressed.data(), (uint32_t)compressed.size());
+
+		uint32_t flips = 1 + random() % 4;
+		for (uint32_t flip = 0; flip < flips; flip++)
+		{
+			compressed[random() % compressedSize] ^= (uint8_t)(1 << (random() % 8));
+		}
+		uint32_t truncated = random() % 4 == 0 ? random() % (compressedSize + 1) : compressedSize;
+		compressed.resize(truncated);
+
+		std::vector<uint8_t> output;
+		failures += !Decompress(compressed, truncated, output, size);
+	}
+	// Most corruptions are caught, the size check alone catches many
+	CHECK(failures > 10000);
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestReferenceBlocks();
+	TestInvalidBlocks();
+	TestCorruptInput();
+	return ReportTestResults("BlockCompressionTests");
+}
@@ -0,0 +1,88 @@
+#include "Test.h"
+#include "CpuProfiler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace Sigma;
+
+// Now read between two tick reads, the closest pair of a few, so a preemption in between does not fail the checks
+static void Sample(uint64_t& ticks, uint64_t& now)
+{
+	uint64_t closest = UINT64_MAX;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		uint64_t before = CpuProfiler::GetTicks();
+		uint64_t sample = CpuProfiler::Now();
+		uint64_t after = CpuProfiler::GetTicks();
+		if (after - before < closest)
+		{
+			closest = after - before;
+			ticks = before + (after - before) / 2;
+			now = sample;
+		}
+	}
+}
+
+// Ticks converted to nanoseconds follow the steady clock, wherever the ticks come from
+static void TestTickConversion()
+{
+	uint64_t beginTicks, begin;
+	Sample(beginTicks, begin);
+	CHECK(std::abs((double)CpuProfiler::TicksToNanoseconds(beginTicks) - (double)begin) < 100000.0);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	uint64_t endTicks, end;
+	Sample(endTicks, end);
+	CHECK(endTicks > beginTicks);
+
+	// Within 1% over 50 ms, and 100 us of the clock itself
+	double elapsed = (double)(end - begin);
+	double converted = (double)(CpuProfiler::TicksToNanoseconds(endTicks) - CpuProfiler::TicksToNanoseconds(beginTicks));
+	CHECK(converted > elapsed * 0.99 && converted < elapsed * 1.01);
+	CHECK(std::abs((double)CpuProfiler::TicksToNanoseconds(endTicks) - (double)end) < 100000.0);
+	CHECK(CpuProfiler::TicksToNanoseconds(0) == 0);
+}
+
+static void TestChromeTrace()
+{
+	CpuProfiler::SetThreadName("Test \"thread\"");
+	CpuProfiler::BeginFrame();
+	{
+		CpuProfileScope scope("Sleep");
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	const char* path = "CpuProfilerTests.json";
+	CHECK(CpuProfiler::WriteChromeTrace(path, 1));
+	std::ifstream file(path);
+	std::stringstream stream;
+	stream << file.rdbuf();
+	std::string trace = stream.str();
+
+	CHECK(trace.find("\"Test \\\"thread\\\"\"") != std::string::npos);
+	CHECK(trace.find("\"Frame 0\"") != std::string::npos);
+
+	// The scope lasted at least the 20 ms it slept, in microseconds
+	size_t scope = trace.find("{\"name\":\"Sleep\"");
+	CHECK(scope != std::string::npos);
+	if (scope != std::string::npos)
+	{
+		size_t duration = trace.find("\"dur\":", scope);
+		double durationUs = atof(trace.c_str() + duration + 6);
+		CHECK(durationUs >= 20000.0 && durationUs < 200000.0);
+	}
+	file.close();
+	remove(path);
+}
+
+int main()
+{
+	TestTickConversion();
+	TestChromeTrace();
+	return ReportTestResults("CpuProfilerTests");
+}
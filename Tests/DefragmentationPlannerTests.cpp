@@ -0,0 +1,302 @@
+#include "Test.h"
+#include "DefragmentationPlanner.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint64_t kGranularity = 64 * 1024;
+const uint64_t kBlockSize = 64 * 1024 * 1024;
+
+// Heap blocks with their live allocations, the way GpuDefragmenter hands them to the planner
+struct SimulatedHeap
+{
+	std::vector<std::unique_ptr<TlsfAllocator>> m_blocks;
+	std::vector<MovableAllocation> m_allocations;
+	uint32_t m_nextId = 0;
+
+	explicit SimulatedHeap(uint32_t numBlocks)
+	{
+		for (uint32_t i = 0; i < numBlocks; i++)
+		{
+			m_blocks.push_back(std::unique_ptr<TlsfAllocator>(new TlsfAllocator(kBlockSize, kGranularity)));
+		}
+	}
+
+	std::vector<TlsfAllocator*> GetBlocks() const
+	{
+		std::vector<TlsfAllocator*> blocks;
+		for (const std::unique_ptr<TlsfAllocator>& block : m_blocks)
+		{
+			blocks.push_back(block.get());
+		}
+		return blocks;
+	}
+
+	bool AllocateIn(uint32_t block, uint64_t size, uint64_t alignment)
+	{
+		TlsfAllocation allocation = m_blocks[block]->Allocate(size, alignment);
+		if (allocation.m_offset == kInvalidOffset)
+			return false;
+		MovableAllocation movable = { m_nextId++, block, allocation, alignment };
+		m_allocations.push_back(movable);
+		return true;
+	}
+
+	// In the first block it fits in, like GpuHeapAllocator
+	bool Allocate(uint64_t size, uint64_t alignment)
+	{
+		for (uint32_t i = 0; i < m_blocks.size(); i++)
+		{
+			if (AllocateIn(i, size, alignment))
+				return true;
+		}
+		return false;
+	}
+
+	void Free(size_t index)
+	{
+		m_blocks[m_allocations[index].m_block]->Free(m_allocations[index].m_allocation.m_block);
+		m_allocations[index] = m_allocations.back();
+		m_allocations.pop_back();
+	}
+
+	// What the caller does once the copies are done : the sources are freed, the allocations now live at the destinations
+	void Apply(const std::vector<DefragmentationMove>& moves)
+	{
+		for (const DefragmentationMove& move : moves)
+		{
+			for (MovableAllocation& allocation : m_allocations)
+			{
+				if (allocation.m_id != move.m_id)
+					continue;
+				m_blocks[allocation.m_block]->Free(allocation.m_allocation.m_block);
+				allocation.m_block = move.m_destinationBlock;
+				allocation.m_allocation = move.m_destination;
+			}
+		}
+	}
+
+	const MovableAllocation* Find(uint32_t id) const
+	{
+		for (const MovableAllocation& allocation : m_allocations)
+		{
+			if (allocation.m_id == id)
+				return &allocation;
+		}
+		return nullptr;
+	}
+};
+
+// Random allocations and frees, textures and buffers of 64 KiB to 4 MiB, some 4 MiB aligned, then every other allocation
+// of the last blocks freed so they end up sparse
+static void SimulateHistory(SimulatedHeap& heap, std::mt19937& random)
+{
+	for (uint32_t step = 0; step < 3000; step++)
+	{
+		if (!heap.m_allocations.empty() && random() % 100 < 40)
+		{
+			heap.Free(random() % heap.m_allocations.size());
+			continue;
+		}
+		uint64_t size = kGranularity * (1 + random() % 64);
+		heap.Allocate(size, random() % 8 == 0 ? 4 * 1024 * 1024 : kGranularity);
+	}
+	for (size_t i = heap.m_allocations.size(); i-- > 0;)
+	{
+		if (heap.m_allocations[i].m_block >= heap.m_blocks.size() / 2 && random() % 3 != 0)
+			heap.Free(i);
+	}
+}
+
+// Live allocations, including the sources which stay allocated until the copies are done, and planned destinations
+// never overlap, destinations are aligned, and moves within a block only go down
+static void CheckMoves(const SimulatedHeap& heap, const std::vector<DefragmentationMove>& moves)
+{
+	std::vector<std::vector<std::pair<uint64_t, uint64_t>>> ranges(heap.m_blocks.size());
+	for (const MovableAllocation& allocation : heap.m_allocations)
+	{
+		ranges[allocation.m_block].push_back(std::make_pair(allocation.m_allocation.m_offset, allocation.m_allocation.m_size));
+	}
+	for (const DefragmentationMove& move : moves)
+	{
+		const MovableAllocation* source = heap.Find(move.m_id);
+		CHECK(source != nullptr);
+		if (source == nullptr)
+			continue;
+		CHECK(move.m_destination.m_offset != kInvalidOffset);
+		CHECK(move.m_destination.m_size == source->m_allocation.m_size);
+		CHECK(move.m_destination.m_offset % source->m_alignment == 0);
+		if (move.m_destinationBlock == source->m_block)
+			CHECK(move.m_destination.m_offset < source->m_allocation.m_offset);
+		ranges[move.m_destinationBlock].push_back(std::make_pair(move.m_destination.m_offset, move.m_destination.m_size));
+	}
+
+	for (std::vector<std::pair<uint64_t, uint64_t>>& blockRanges : ranges)
+	{
+		std::sort(blockRanges.begin(), blockRanges.end());
+		for (size_t i = 1; i < blockRanges.size(); i++)
+		{
+			CHECK(blockRanges[i - 1].first + blockRanges[i - 1].second <= blockRanges[i].first);
+		}
+		CHECK(blockRanges.empty() || blockRanges.back().first + blockRanges.back().second <= kBlockSize);
+	}
+}
+
+static uint64_t GetMovedBytes(const SimulatedHeap& heap, const std::vector<DefragmentationMove>& moves)
+{
+	uint64_t bytes = 0;
+	for (const DefragmentationMove& move : moves)
+	{
+		bytes += heap.Find(move.m_id)->m_allocation.m_size;
+	}
+	return bytes;
+}
+
+// Several frames of moves under a budget : each plan stays under it, except a single allocation larger than the budget
+// which moves alone, and the heap ends up with fewer used blocks
+static void TestSimulatedHistory(uint32_t seed)
+{
+	std::mt19937 random(seed);
+	SimulatedHeap heap(6);
+	SimulateHistory(heap, random);
+	uint64_t usedBytes = 0;
+	uint32_t usedBlocks = 0;
+	for (const std::unique_ptr<TlsfAllocator>& block : heap.m_blocks)
+	{
+		usedBytes += block->GetStats().m_usedSize;
+		usedBlocks += !block->IsEmpty();
+	}
+
+	DefragmentationPlanner planner;
+	std::vector<DefragmentationMove> moves;
+	const uint64_t maxBytes = 3 * 1024 * 1024;
+	uint32_t frames = 0;
+	for (; frames < 1000; frames++)
+	{
+		uint64_t movedBytes = planner.Plan(heap.GetBlocks(), heap.m_allocations, maxBytes, moves);
+		if (moves.empty())
+			break;
+		CHECK(movedBytes == GetMovedBytes(heap, moves));
+		CHECK(movedBytes <= maxBytes || moves.size() == 1);
+		CheckMoves(heap, moves);
+		heap.Apply(moves);
+	}
+	// Converges, and nothing is lost on the way
+	CHECK(frames < 1000);
+	uint64_t finalUsedBytes = 0;
+	uint32_t finalUsedBlocks = 0;
+	for (const std::unique_ptr<TlsfAllocator>& block : heap.m_blocks)
+	{
+		finalUsedBytes += block->GetStats().m_usedSize;
+		finalUsedBlocks += !block->IsEmpty();
+	}
+	CHECK(finalUsedBytes == usedBytes);
+	CHECK(finalUsedBlocks < usedBlocks);
+}
+
+// The emptiest block is the first source, it is emptied before any other block is touched
+static void TestEmptiestBlockFirst()
+{
+	const uint64_t mebibyte = 1024 * 1024;
+	SimulatedHeap heap(3);
+	// Block 0 at 75% with a single hole, block 1 at 40% and block 2 at 10% with holes everywhere
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		if (i < 48)
+			heap.AllocateIn(0, mebibyte, kGranularity);
+		heap.AllocateIn(1, mebibyte, kGranularity);
+		heap.AllocateIn(2, mebibyte, kGranularity);
+	}
+	for (size_t i = heap.m_allocations.size(); i-- > 0;)
+	{
+		uint32_t block = heap.m_allocations[i].m_block;
+		uint64_t index = heap.m_allocations[i].m_allocation.m_offset / mebibyte;
+		if ((block == 1 && index % 5 >= 2) || (block == 2 && index % 10 != 0))
+			heap.Free(i);
+	}
+	CHECK(heap.m_blocks[1]->GetStats().m_usedSize == 26 * mebibyte);
+	CHECK(heap.m_blocks[2]->GetStats().m_usedSize == 7 * mebibyte);
+
+	// The budget only covers part of the emptiest block, all of it goes to the fullest block
+	DefragmentationPlanner planner;
+	std::vector<DefragmentationMove> moves;
+	CHECK(planner.Plan(heap.GetBlocks(), heap.m_allocations, 4 * mebibyte, moves) == 4 * mebibyte);
+	CHECK(moves.size() == 4);
+	for (const DefragmentationMove& move : moves)
+	{
+		CHECK(heap.Find(move.m_id)->m_block == 2 && move.m_destinationBlock == 0);
+	}
+	CheckMoves(heap, moves);
+	heap.Apply(moves);
+
+	planner.Plan(heap.GetBlocks(), heap.m_allocations, 64 * mebibyte, moves);
+	CheckMoves(heap, moves);
+	CHECK(moves.size() > 3);
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		CHECK((heap.Find(moves[i].m_id)->m_block == 2) == (i < 3));
+	}
+	heap.Apply(moves);
+	CHECK(heap.m_blocks[2]->IsEmpty());
+}
+
+// An allocation larger than the budget still moves, alone
+static void TestOversizeAllocation()
+{
+	const uint64_t mebibyte = 1024 * 1024;
+	SimulatedHeap heap(2);
+	for (uint32_t i = 0; i < 40; i++)
+	{
+		heap.AllocateIn(0, mebibyte, kGranularity);
+	}
+	// Block 1 : a hole, then 1 MiB and 8 MiB at the end, moved first
+	TlsfAllocation hole = heap.m_blocks[1]->Allocate(4 * mebibyte, kGranularity);
+	heap.AllocateIn(1, mebibyte, kGranularity);
+	heap.AllocateIn(1, 8 * mebibyte, kGranularity);
+	heap.m_blocks[1]->Free(hole.m_block);
+
+	DefragmentationPlanner planner;
+	std::vector<DefragmentationMove> moves;
+	CHECK(planner.Plan(heap.GetBlocks(), heap.m_allocations, mebibyte, moves) == 8 * mebibyte);
+	CHECK(moves.size() == 1 && heap.Find(moves[0].m_id)->m_allocation.m_size == 8 * mebibyte);
+	CheckMoves(heap, moves);
+}
+
+// A compact heap, full blocks and a last block filled from the start, has nothing to move
+static void TestCompactHeap()
+{
+	SimulatedHeap heap(3);
+	std::mt19937 random(3);
+	while (heap.m_blocks[2]->GetStats().m_usedSize < kBlockSize * 3 / 4)
+	{
+		if (!heap.Allocate(kGranularity * (1 + random() % 16), kGranularity))
+			break;
+	}
+	CHECK(heap.m_blocks[0]->GetStats().m_freeBlockCount <= 1 && heap.m_blocks[1]->GetStats().m_freeBlockCount <= 1);
+
+	DefragmentationPlanner planner;
+	std::vector<DefragmentationMove> moves;
+	CHECK(planner.Plan(heap.GetBlocks(), heap.m_allocations, kBlockSize, moves) == 0);
+	CHECK(moves.empty());
+
+	// Nor does an empty heap or missing blocks
+	SimulatedHeap empty(2);
+	std::vector<TlsfAllocator*> blocks = empty.GetBlocks();
+	blocks.insert(blocks.begin(), nullptr);
+	CHECK(planner.Plan(blocks, empty.m_allocations, kBlockSize, moves) == 0 && moves.empty());
+}
+
+int main()
+{
+	for (uint32_t seed = 1; seed <= 20; seed++)
+	{
+		TestSimulatedHistory(seed);
+	}
+	TestEmptiestBlockFirst();
+	TestOversizeAllocation();
+	TestCompactHeap();
+	return ReportTestResults("DefragmentationPlannerTests");
+}
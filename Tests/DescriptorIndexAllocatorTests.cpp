@@ -0,0 +1,76 @@
+#include "Test.h"
+#include "DescriptorIndexAllocator.h"
+#include <algorithm>
+#include <vector>
+
+using namespace Sigma;
+
+static void TestSingles()
+{
+	DescriptorIndexAllocator allocator(8, 4);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		CHECK(allocator.Allocate() == i);
+	}
+	CHECK(allocator.Allocate() == kInvalidDescriptorIndex);
+	CHECK(allocator.GetAllocatedCount() == 4);
+
+	// Not reusable before the fence of the frame freeing it is reached
+	allocator.Free(2);
+	allocator.Submit(1);
+	CHECK(allocator.Allocate() == kInvalidDescriptorIndex);
+	allocator.Retire(1);
+	CHECK(allocator.GetAllocatedCount() == 3);
+	CHECK(allocator.Allocate() == 2);
+}
+
+// Freeing several single descriptors at once gives every one of them back
+static void TestSingleRangeFree()
+{
+	DescriptorIndexAllocator allocator(8, 4);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		allocator.Allocate();
+	}
+	allocator.FreeRange(1, 3);
+	allocator.Submit(1);
+	allocator.Retire(1);
+	CHECK(allocator.GetAllocatedCount() == 1);
+
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		indices.push_back(allocator.Allocate());
+	}
+	std::sort(indices.begin(), indices.end());
+	CHECK(indices[0] == 1 && indices[1] == 2 && indices[2] == 3);
+	CHECK(allocator.Allocate() == kInvalidDescriptorIndex);
+	CHECK(allocator.GetAllocatedCount() == 4);
+}
+
+static void TestRanges()
+{
+	DescriptorIndexAllocator allocator(16, 12);
+	uint32_t a = allocator.AllocateRange(4);
+	uint32_t b = allocator.AllocateRange(4);
+	uint32_t c = allocator.AllocateRange(4);
+	CHECK(a == 4 && b == 8 && c == 12);
+	CHECK(allocator.AllocateRange(1) == kInvalidDescriptorIndex);
+
+	// Freed ranges merge with their neighbours
+	allocator.FreeRange(a, 4);
+	allocator.FreeRange(c, 4);
+	allocator.FreeRange(b, 4);
+	allocator.Submit(1);
+	allocator.Retire(1);
+	CHECK(allocator.GetAllocatedCount() == 0);
+	CHECK(allocator.AllocateRange(12) == 4);
+}
+
+int main()
+{
+	TestSingles();
+	TestSingleRangeFree();
+	TestRanges();
+	return ReportTestResults("DescriptorIndexAllocatorTests");
+}
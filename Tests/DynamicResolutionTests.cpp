@@ -0,0 +1,168 @@
+#include "Test.h"
+#include "DynamicResolution.h"
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint32_t kFramesInFlight = 2;
+
+struct SimulatedFrame
+{
+	double m_gpuTimeMs;
+	float m_renderScale;
+	float m_nextScale;
+};
+
+// GPU time is cost * scale^2 with some noise, and is measured kFramesInFlight frames after the scale was picked
+static std::vector<SimulatedFrame> Replay(DynamicResolution& resolution, const std::vector<double>& costTrace, double noise, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> jitter(1.0 - noise, 1.0 + noise);
+	std::deque<float> inFlight(kFramesInFlight, resolution.GetScale());
+	std::vector<SimulatedFrame> frames;
+
+	for (double cost : costTrace)
+	{
+		float renderScale = inFlight.front();
+		inFlight.pop_front();
+
+		SimulatedFrame frame;
+		frame.m_gpuTimeMs = cost * renderScale * renderScale * jitter(random);
+		frame.m_renderScale = renderScale;
+		frame.m_nextScale = resolution.Update(frame.m_gpuTimeMs, renderScale);
+		frames.push_back(frame);
+		inFlight.push_back(frame.m_nextScale);
+	}
+	return frames;
+}
+
+static void TestConvergence()
+{
+	DynamicResolution resolution;
+	const DynamicResolutionSettings& settings = resolution.GetSettings();
+	double budget = settings.m_targetFrameTimeMs * settings.m_headroom;
+
+	// 25 ms at full resolution, the scale fitting the budget is sqrt(15 / 25)
+	std::vector<SimulatedFrame> frames = Replay(resolution, std::vector<double>(300, 25.0), 0.0, 1);
+	float expected = (float)std::sqrt(budget / 25.0);
+	CHECK(std::abs(frames.back().m_nextScale - expected) <= settings.m_hysteresis);
+
+	// Settled within a few frames, and under budget from then on
+	for (size_t i = 10; i < frames.size(); i++)
+	{
+		CHECK(frames[i].m_gpuTimeMs <= settings.m_targetFrameTimeMs);
+		CHECK(frames[i].m_nextScale == frames.back().m_nextScale);
+	}
+
+	// Noisy frames do not make the resolution flicker
+	resolution.Reset();
+	frames = Replay(resolution, std::vector<double>(1000, 25.0), 0.02, 2);
+	uint32_t changes = 0;
+	uint32_t overTarget = 0;
+	for (size_t i = 100; i < frames.size(); i++)
+	{
+		changes += frames[i].m_nextScale != frames[i - 1].m_nextScale;
+		overTarget += frames[i].m_gpuTimeMs > settings.m_targetFrameTimeMs;
+	}
+	CHECK(changes < 20);
+	CHECK(overTarget == 0);
+}
+
+static void TestLimits()
+{
+	DynamicResolutionSettings settings;
+	settings.m_minScale = 0.5f;
+	settings.m_maxScale = 0.9f;
+	DynamicResolution resolution(settings);
+
+	// Too expensive even at the lowest scale
+	std::vector<SimulatedFrame> frames = Replay(resolution, std::vector<double>(100, 200.0), 0.0, 3);
+	for (const SimulatedFrame& frame : frames)
+	{
+		CHECK(frame.m_nextScale >= settings.m_minScale && frame.m_nextScale <= settings.m_maxScale);
+	}
+	CHECK(frames.back().m_nextScale == settings.m_minScale);
+
+	// Then cheap : climbs back at most m_maxScaleIncrease per frame, and reaches the upper limit exactly
+	frames = Replay(resolution, std::vector<double>(200, 2.0), 0.0, 4);
+	float previous = settings.m_minScale;
+	for (const SimulatedFrame& frame : frames)
+	{
+		CHECK(frame.m_nextScale <= previous + settings.m_maxScaleIncrease + 1e-6f);
+		CHECK(frame.m_nextScale <= settings.m_maxScale);
+		previous = frame.m_nextScale;
+	}
+	CHECK(frames.back().m_nextScale == settings.m_maxScale);
+
+	// Invalid measurements are ignored
+	float scale = resolution.GetScale();
+	CHECK(resolution.Update(0.0, 1.0f) == scale);
+	CHECK(resolution.Update(10.0, 0.0f) == scale);
+}
+
+// A single slow frame drops the scale right away, then it recovers over several frames
+static void TestSpike()
+{
+	DynamicResolution resolution;
+	const DynamicResolutionSettings& settings = resolution.GetSettings();
+	std::vector<double> trace(200, 20.0);
+	trace[100] = 60.0;
+	std::vector<SimulatedFrame> frames = Replay(resolution, trace, 0.0, 5);
+
+	float settled = frames[99].m_nextScale;
+	CHECK(frames[100].m_nextScale < settled - settings.m_hysteresis);
+
+	// Measured as soon as its time is known, so the frames rendered right after are not above budget for long
+	uint32_t recoveryFrames = 0;
+	for (size_t i = 101; i < frames.size() && frames[i].m_nextScale < settled - settings.m_hysteresis; i++)
+	{
+		CHECK(frames[i].m_nextScale <= frames[i - 1].m_nextScale + settings.m_maxScaleIncrease + 1e-6f);
+		recoveryFrames++;
+	}
+	CHECK(recoveryFrames > 1);
+	CHECK(recoveryFrames < 60);
+	CHECK(std::abs(frames.back().m_nextScale - settled) <= settings.m_hysteresis);
+
+	uint32_t overTarget = 0;
+	for (size_t i = 101; i < frames.size(); i++)
+	{
+		overTarget += frames[i].m_gpuTimeMs > settings.m_targetFrameTimeMs;
+	}
+	CHECK(overTarget == 0);
+}
+
+// Load rising then falling over a few seconds, as when the camera turns toward a heavy scene and away again
+static void TestRamp()
+{
+	DynamicResolution resolution;
+	const DynamicResolutionSettings& settings = resolution.GetSettings();
+	std::vector<double> trace;
+	for (uint32_t i = 0; i < 600; i++)
+	{
+		trace.push_back(10.0 + 30.0 * std::sin(3.14159265 * i / 600.0));
+	}
+	std::vector<SimulatedFrame> frames = Replay(resolution, trace, 0.03, 6);
+
+	uint32_t overTarget = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		overTarget += frames[i].m_gpuTimeMs > settings.m_targetFrameTimeMs;
+		// Follows the load : full resolution when cheap, lowest around the peak
+		if (trace[i] * settings.m_minScale * settings.m_minScale > settings.m_targetFrameTimeMs)
+			CHECK(frames[i].m_nextScale == settings.m_minScale);
+	}
+	CHECK(overTarget < frames.size() / 50);
+	CHECK(frames.back().m_nextScale > 0.95f);
+}
+
+int main()
+{
+	TestConvergence();
+	TestLimits();
+	TestSpike();
+	TestRamp();
+	return ReportTestResults("DynamicResolutionTests");
+}
@@ -0,0 +1,165 @@
+#include "Test.h"
+#include "FrameGraph.h"
+#include <random>
+
+using namespace Sigma;
+
+static TransientResourceDesc GetDesc(uint64_t size, uint64_t alignment = 65536)
+{
+	TransientResourceDesc desc = {};
+	desc.m_size = size;
+	desc.m_alignment = alignment;
+	return desc;
+}
+
+static void TestCulling()
+{
+	FrameGraph graph;
+	int backBuffer = 0;
+	FrameGraphResource target = graph.Import("Back buffer", &backBuffer);
+	FrameGraphResource color = graph.CreateTransient("Color", GetDesc(65536));
+	FrameGraphResource unused = graph.CreateTransient("Unused", GetDesc(65536));
+
+	uint32_t scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, color, 0);
+	uint32_t debug = graph.AddPass("Debug", nullptr);
+	graph.Write(debug, unused, 0);
+	uint32_t readback = graph.AddPass("Readback", nullptr, true);
+	graph.Read(readback, unused, 0);
+	uint32_t dead = graph.AddPass("Dead", nullptr);
+	graph.Read(dead, color, 0);
+	graph.Write(dead, unused, 0);
+	uint32_t present = graph.AddPass("Present", nullptr);
+	graph.Read(present, color, 0);
+	graph.Write(present, target, 0);
+	graph.Compile();
+
+	const std::vector<FrameGraphPass>& passes = graph.GetPasses();
+	CHECK(!passes[scene].m_culled);
+	// Kept by the pass with side effects reading its result
+	CHECK(!passes[debug].m_culled);
+	CHECK(!passes[readback].m_culled);
+	// Its write is never read
+	CHECK(passes[dead].m_culled);
+	CHECK(!passes[present].m_culled);
+	CHECK(graph.GetCulledPassCount() == 1);
+
+	const std::vector<FrameGraphResourceNode>& resources = graph.GetResources();
+	CHECK(resources[color].m_firstPass == scene);
+	CHECK(resources[color].m_lastPass == present);
+	CHECK(resources[unused].m_firstPass == debug);
+	CHECK(resources[unused].m_lastPass == readback);
+	CHECK(passes[scene].m_firstUses.size() == 1 && passes[scene].m_firstUses[0] == color);
+
+	// Alive at the same time, so they can not share memory
+	CHECK(graph.GetHeapSize() == 2 * 65536);
+	CHECK(!resources[color].m_aliased);
+}
+
+static void TestAliasing()
+{
+	FrameGraph graph;
+	int backBuffer = 0;
+	FrameGraphResource target = graph.Import("Back buffer", &backBuffer);
+	FrameGraphResource a = graph.CreateTransient("A", GetDesc(4 * 65536));
+	FrameGraphResource b = graph.CreateTransient("B", GetDesc(2 * 65536));
+	FrameGraphResource c = graph.CreateTransient("C", GetDesc(2 * 65536));
+	FrameGraphResource d = graph.CreateTransient("D", GetDesc(3 * 65536));
+
+	// A -> B -> C -> D -> back buffer, each resource is only alive with its neighbours
+	FrameGraphResource chain[] = { a, b, c, d, target };
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		uint32_t pass = graph.AddPass("Pass", nullptr);
+		if (i > 0)
+			graph.Read(pass, chain[i - 1], 0);
+		graph.Write(pass, chain[i], 0);
+	}
+	uint32_t last = graph.AddPass("Last", nullptr);
+	graph.Read(last, d, 0);
+	graph.Write(last, target, 0);
+	graph.Compile();
+
+	const std::vector<FrameGraphResourceNode>& resources = graph.GetResources();
+	CHECK(graph.GetTransientSize() == 11 * 65536);
+	// C reuses the start of A, D the rest of A and the start of B
+	CHECK(resources[a].m_heapOffset == 0);
+	CHECK(resources[b].m_heapOffset == 4 * 65536);
+	CHECK(resources[c].m_heapOffset == 0);
+	CHECK(resources[d].m_heapOffset == 2 * 65536);
+	CHECK(graph.GetHeapSize() == 6 * 65536);
+	CHECK(resources[a].m_aliased && resources[b].m_aliased && resources[c].m_aliased && resources[d].m_aliased);
+}
+
+// Random graphs, checked against all pairs of transients
+static void TestRandomGraphs()
+{
+	std::mt19937 random(5);
+	for (uint32_t iteration = 0; iteration < 200; iteration++)
+	{
+		FrameGraph graph;
+		int backBuffer = 0;
+		FrameGraphResource target = graph.Import("Back buffer", &backBuffer);
+
+		uint32_t numResources = 1 + random() % 60;
+		for (uint32_t i = 0; i < numResources; i++)
+		{
+			graph.CreateTransient("Transient", GetDesc(1 + random() % (1 << 22), 1ull << (8 + random() % 9)));
+		}
+
+		uint32_t numPasses = 1 + random() % 80;
+		for (uint32_t i = 0; i < numPasses; i++)
+		{
+			uint32_t pass = graph.AddPass("Pass", nullptr, random() % 16 == 0);
+			for (uint32_t access = random() % 4; access > 0; access--)
+			{
+				FrameGraphResource resource = 1 + random() % numResources;
+				if (random() % 2 == 0)
+					graph.Read(pass, resource, 0);
+				else
+					graph.Write(pass, resource, 0);
+			}
+			if (random() % 8 == 0)
+				graph.Write(pass, target, 0);
+		}
+		graph.Compile();
+
+		const std::vector<FrameGraphResourceNode>& resources = graph.GetResources();
+		uint64_t transientSize = 0;
+		for (FrameGraphResource i = 1; i < resources.size(); i++)
+		{
+			const FrameGraphResourceNode& resource = resources[i];
+			if (resource.m_firstPass == 0xffffffff)
+				continue;
+
+			transientSize += resource.m_desc.m_size;
+			CHECK(resource.m_heapOffset % resource.m_desc.m_alignment == 0);
+			CHECK(resource.m_heapOffset + resource.m_desc.m_size <= graph.GetHeapSize());
+
+			bool aliased = false;
+			for (FrameGraphResource j = 1; j < resources.size(); j++)
+			{
+				const FrameGraphResourceNode& other = resources[j];
+				if (j == i || other.m_firstPass == 0xffffffff)
+					continue;
+
+				bool sharesMemory = other.m_heapOffset < resource.m_heapOffset + resource.m_desc.m_size &&
+					resource.m_heapOffset < other.m_heapOffset + other.m_desc.m_size;
+				bool aliveTogether = other.m_firstPass <= resource.m_lastPass && resource.m_firstPass <= other.m_lastPass;
+				CHECK(!(sharesMemory && aliveTogether));
+				aliased |= sharesMemory;
+			}
+			CHECK(resource.m_aliased == aliased);
+		}
+		CHECK(graph.GetTransientSize() == transientSize);
+		CHECK(graph.GetHeapSize() <= transientSize + numResources * 65536);
+	}
+}
+
+int main()
+{
+	TestCulling();
+	TestAliasing();
+	TestRandomGraphs();
+	return ReportTestResults("FrameGraphTests");
+}
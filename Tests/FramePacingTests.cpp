@@ -0,0 +1,171 @@
+#include "Test.h"
+#include "FramePacing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Sigma;
+
+// Same capacity as the game
+const uint32_t kFramePacingFrames = 1000;
+const uint64_t kNanosecondsPerMs = 1000000;
+
+static bool Near(double a, double b)
+{
+	return std::fabs(a - b) < 1e-9;
+}
+
+// Frames with the given frame times in milliseconds, the first frame starts at 1 s
+static void AddFrames(FramePacingStats& stats, const std::vector<uint64_t>& frameMs, uint64_t& frameIndex, uint64_t& start)
+{
+	if (start == 0)
+		start = 1000 * kNanosecondsPerMs;
+	for (uint64_t ms : frameMs)
+	{
+		FramePacingSample sample = {};
+		sample.m_frameIndex = frameIndex++;
+		sample.m_cpuStart = start;
+		stats.Add(sample);
+		start += ms * kNanosecondsPerMs;
+	}
+}
+
+// Nearest rank : the smallest frame time with at least p% of the frames at or below it
+static void TestPercentiles()
+{
+	FramePacingStats stats(2000);
+	std::vector<uint64_t> frameMs;
+	for (uint64_t ms = 1; ms <= 1000; ms++)
+	{
+		frameMs.push_back(ms);
+	}
+	std::mt19937 random(1);
+	std::shuffle(frameMs.begin(), frameMs.end(), random);
+	// 1001 frames for 1000 frame times, the last frame time is never known
+	frameMs.push_back(1);
+	uint64_t frameIndex = 0;
+	uint64_t start = 0;
+	AddFrames(stats, frameMs, frameIndex, start);
+
+	FramePacingSummary summary = stats.ComputeSummary();
+	CHECK(summary.m_frameCount == 1001);
+	CHECK(Near(summary.m_averageMs, 500.5));
+	CHECK(Near(summary.m_p50Ms, 500.0));
+	CHECK(Near(summary.m_p99Ms, 990.0));
+	CHECK(Near(summary.m_p999Ms, 999.0));
+	CHECK(Near(summary.m_maxMs, 1000.0));
+
+	// 10 frame times : ranks 5, 10 and 10
+	stats.Clear();
+	AddFrames(stats, { 12, 10, 10, 10, 11, 10, 10, 10, 25, 10, 0 }, frameIndex, start);
+	summary = stats.ComputeSummary();
+	CHECK(Near(summary.m_p50Ms, 10.0) && Near(summary.m_p99Ms, 25.0) && Near(summary.m_p999Ms, 25.0));
+	CHECK(Near(summary.m_averageMs, 11.8));
+}
+
+// A hitch takes strictly more than kHitchRatio times the median
+static void TestHitches()
+{
+	FramePacingStats stats(100);
+	uint64_t frameIndex = 0;
+	uint64_t start = 0;
+	AddFrames(stats, { 10, 10, 10, 20, 10, 21, 10, 10, 40, 10, 0 }, frameIndex, start);
+	FramePacingSummary summary = stats.ComputeSummary();
+	CHECK(Near(summary.m_p50Ms, 10.0));
+	CHECK(summary.m_hitchCount == 2);
+
+	// Steady frames have none
+	stats.Clear();
+	AddFrames(stats, std::vector<uint64_t>(50, 16), frameIndex, start);
+	CHECK(stats.ComputeSummary().m_hitchCount == 0);
+}
+
+// Once full, the oldest frames are dropped and frame times are still taken between consecutive frames
+static void TestWraparound()
+{
+	FramePacingStats stats(kFramePacingFrames);
+	uint64_t frameIndex = 0;
+	uint64_t start = 0;
+	AddFrames(stats, std::vector<uint64_t>(500, 100), frameIndex, start);
+	AddFrames(stats, std::vector<uint64_t>(1100, 16), frameIndex, start);
+	CHECK(stats.GetSampleCount() == kFramePacingFrames);
+
+	FramePacingSummary summary = stats.ComputeSummary();
+	CHECK(summary.m_frameCount == kFramePacingFrames);
+	CHECK(Near(summary.m_averageMs, 16.0) && Near(summary.m_maxMs, 16.0) && summary.m_hitchCount == 0);
+
+	// Oldest first, the first frame kept is frame 600
+	const char* path = "FramePacingTests.csv";
+	CHECK(stats.WriteCsv(path));
+	std::ifstream file(path);
+	std::string header;
+	std::string first;
+	std::getline(file, header);
+	std::getline(file, first);
+	file.close();
+	CHECK(first.compare(0, 4, "600,") == 0);
+	remove(path);
+
+	// Cleared, the ring starts over
+	stats.Clear();
+	CHECK(stats.GetSampleCount() == 0);
+	summary = stats.ComputeSummary();
+	CHECK(summary.m_frameCount == 0 && summary.m_maxMs == 0.0 && summary.m_latencyMs == 0.0);
+	AddFrames(stats, { 5, 7, 0 }, frameIndex, start);
+	summary = stats.ComputeSummary();
+	CHECK(summary.m_frameCount == 3 && Near(summary.m_maxMs, 7.0) && Near(summary.m_averageMs, 6.0));
+}
+
+// Waits and latency are averaged over every frame, including the last one, which has no frame time
+static void TestLatency()
+{
+	FramePacingStats stats(16);
+	uint64_t start = 1000 * kNanosecondsPerMs;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		FramePacingSample sample = {};
+		sample.m_frameIndex = i;
+		sample.m_cpuStart = start;
+		sample.m_waitableWake = start + (1 + i) * kNanosecondsPerMs;
+		sample.m_fenceWaitEnd = sample.m_waitableWake + 2 * kNanosecondsPerMs;
+		sample.m_submit = sample.m_fenceWaitEnd + 5 * kNanosecondsPerMs;
+		sample.m_present = sample.m_submit + kNanosecondsPerMs;
+		sample.m_gpuComplete = start + (30 + 10 * i) * kNanosecondsPerMs;
+		sample.m_queuedFrames = 1 + i % 2;
+		stats.Add(sample);
+		start += 16 * kNanosecondsPerMs;
+	}
+
+	FramePacingSummary summary = stats.ComputeSummary();
+	CHECK(Near(summary.m_waitableWaitMs, 2.5));
+	CHECK(Near(summary.m_fenceWaitMs, 2.0));
+	CHECK(Near(summary.m_latencyMs, 45.0));
+	CHECK(Near(summary.m_queuedFrames, 1.5));
+	CHECK(Near(summary.m_p50Ms, 16.0));
+
+	// A single frame has waits and latency, but no frame time
+	stats.Clear();
+	FramePacingSample sample = {};
+	sample.m_cpuStart = start;
+	sample.m_waitableWake = start + 3 * kNanosecondsPerMs;
+	sample.m_fenceWaitEnd = sample.m_waitableWake;
+	sample.m_gpuComplete = start + 20 * kNanosecondsPerMs;
+	sample.m_queuedFrames = 2;
+	stats.Add(sample);
+	summary = stats.ComputeSummary();
+	CHECK(summary.m_frameCount == 1 && summary.m_p50Ms == 0.0 && summary.m_hitchCount == 0);
+	CHECK(Near(summary.m_waitableWaitMs, 3.0) && Near(summary.m_fenceWaitMs, 0.0) && Near(summary.m_latencyMs, 20.0) && Near(summary.m_queuedFrames, 2.0));
+}
+
+int main()
+{
+	TestPercentiles();
+	TestHitches();
+	TestWraparound();
+	TestLatency();
+	return ReportTestResults("FramePacingTests");
+}
@@ -0,0 +1,128 @@
+#include "Test.h"
+#include "GpuTimingTree.h"
+#include <cmath>
+#include <vector>
+
+using namespace Sigma;
+
+// One tick per millisecond, so timestamps read as milliseconds
+const uint64_t kFrequency = 1000;
+
+static bool Near(double a, double b)
+{
+	return std::fabs(a - b) < 1e-9;
+}
+
+static GpuScope Scope(const char* name, uint32_t parent, uint64_t begin, uint64_t end)
+{
+	GpuScope scope = { name, parent, begin, end };
+	return scope;
+}
+
+// Scopes nest into named nodes, a scope repeated under the same parent is summed, the same name under another parent
+// is another node
+static void TestHierarchy()
+{
+	GpuTimingTree tree(8);
+	std::vector<GpuScope> scopes;
+	scopes.push_back(Scope("Frame", kInvalidGpuScope, 0, 100));
+	scopes.push_back(Scope("Shadows", 0, 0, 20));
+	scopes.push_back(Scope("Draw", 1, 5, 15));
+	scopes.push_back(Scope("Main", 0, 20, 80));
+	scopes.push_back(Scope("Draw", 3, 20, 30));
+	scopes.push_back(Scope("Draw", 3, 40, 55));
+	tree.AddFrame(scopes.data(), scopes.size(), kFrequency);
+
+	CHECK(tree.GetFrameCount() == 1);
+	CHECK(tree.GetNodes().size() == 5);
+	const GpuTimingNode* frame = tree.Find("Frame");
+	const GpuTimingNode* shadowDraw = tree.Find("Frame/Shadows/Draw");
+	const GpuTimingNode* mainDraw = tree.Find("Frame/Main/Draw");
+	CHECK(frame != nullptr && shadowDraw != nullptr && mainDraw != nullptr && shadowDraw != mainDraw);
+	if (frame == nullptr || shadowDraw == nullptr || mainDraw == nullptr)
+		return;
+	CHECK(Near(frame->m_lastMs, 100.0) && frame->m_depth == 0 && frame->m_parent == kInvalidGpuScope);
+	CHECK(Near(shadowDraw->m_lastMs, 10.0) && shadowDraw->m_depth == 2);
+	CHECK(Near(mainDraw->m_lastMs, 25.0) && mainDraw->m_depth == 2);
+	CHECK(Near(tree.Find("Frame/Main")->m_lastMs, 60.0));
+	CHECK(&tree.GetNodes()[mainDraw->m_parent] == tree.Find("Frame/Main"));
+	CHECK(tree.Find("Frame/Draw") == nullptr && tree.Find("Main") == nullptr);
+
+	// Parents are always stored before their children
+	for (uint32_t i = 0; i < tree.GetNodes().size(); i++)
+	{
+		CHECK(tree.GetNodes()[i].m_parent == kInvalidGpuScope || tree.GetNodes()[i].m_parent < i);
+	}
+
+	// Depth first, children indented under their parent
+	CHECK(tree.ToString() ==
+		"Frame : 100.000 ms (avg 100.000, min 100.000, max 100.000)\n"
+		"  Shadows : 20.000 ms (avg 20.000, min 20.000, max 20.000)\n"
+		"    Draw : 10.000 ms (avg 10.000, min 10.000, max 10.000)\n"
+		"  Main : 60.000 ms (avg 60.000, min 60.000, max 60.000)\n"
+		"    Draw : 25.000 ms (avg 25.000, min 25.000, max 25.000)\n");
+}
+
+// Scopes with no valid timestamps, or unbalanced ones pointing to a parent that does not enclose them, are ignored with
+// their children, the rest of the frame still counts
+static void TestInvalidScopes()
+{
+	GpuTimingTree tree(8);
+	std::vector<GpuScope> scopes;
+	scopes.push_back(Scope("Frame", kInvalidGpuScope, 0, 50));
+	scopes.push_back(Scope("Empty", 0, 10, 10));
+	scopes.push_back(Scope("Child", 1, 10, 12));
+	scopes.push_back(Scope("Reversed", 0, 30, 20));
+	scopes.push_back(Scope("Forward", 5, 0, 5));
+	scopes.push_back(Scope("Self", 5, 0, 5));
+	scopes.push_back(Scope("Valid", 0, 20, 30));
+	tree.AddFrame(scopes.data(), scopes.size(), kFrequency);
+
+	CHECK(tree.GetNodes().size() == 2);
+	CHECK(tree.Find("Frame/Valid") != nullptr && Near(tree.Find("Frame/Valid")->m_lastMs, 10.0));
+	CHECK(tree.Find("Frame/Empty") == nullptr && tree.Find("Frame/Empty/Child") == nullptr);
+	CHECK(tree.Find("Frame/Reversed") == nullptr && tree.Find("Forward") == nullptr && tree.Find("Self") == nullptr);
+
+	// Without a frequency nothing can be converted, the frame is dropped
+	tree.AddFrame(scopes.data(), scopes.size(), 0);
+	CHECK(tree.GetFrameCount() == 1);
+}
+
+// Min, average and max over the last frames of the window, per node, only over the frames it was timed in
+static void TestRollingStatistics()
+{
+	GpuTimingTree tree(4);
+	const uint64_t frameMs[] = { 10, 20, 30, 40, 50, 5 };
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		std::vector<GpuScope> scopes;
+		scopes.push_back(Scope("Frame", kInvalidGpuScope, 1000, 1000 + frameMs[i]));
+		// Only timed every other frame
+		if (i % 2 == 0)
+			scopes.push_back(Scope("Sometimes", 0, 1000, 1000 + i + 1));
+		tree.AddFrame(scopes.data(), scopes.size(), kFrequency);
+
+		const GpuTimingNode* frame = tree.Find("Frame");
+		CHECK(frame != nullptr && frame->m_lastFrame == i + 1);
+		if (i == 2)
+			CHECK(Near(frame->m_averageMs, 20.0) && Near(frame->m_minMs, 10.0) && Near(frame->m_maxMs, 30.0));
+		if (i == 4)
+			CHECK(Near(frame->m_averageMs, 35.0) && Near(frame->m_minMs, 20.0) && Near(frame->m_maxMs, 50.0));
+		if (i == 5)
+			CHECK(Near(frame->m_averageMs, 31.25) && Near(frame->m_minMs, 5.0) && Near(frame->m_maxMs, 50.0) && Near(frame->m_lastMs, 5.0));
+	}
+
+	// 1, 3 and 5 ms, the frames it was missing from do not count, and it is not listed for the last frame
+	const GpuTimingNode* sometimes = tree.Find("Frame/Sometimes");
+	CHECK(sometimes != nullptr && sometimes->m_lastFrame == 5);
+	CHECK(Near(sometimes->m_averageMs, 3.0) && Near(sometimes->m_minMs, 1.0) && Near(sometimes->m_maxMs, 5.0));
+	CHECK(tree.ToString() == "Frame : 5.000 ms (avg 31.250, min 5.000, max 50.000)\n");
+}
+
+int main()
+{
+	TestHierarchy();
+	TestInvalidScopes();
+	TestRollingStatistics();
+	return ReportTestResults("GpuTimingTreeTests");
+}
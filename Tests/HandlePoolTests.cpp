@@ -0,0 +1,105 @@
+#include "Test.h"
+#include "HandlePool.h"
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+static void TestBasics()
+{
+	HandlePool pool;
+	CHECK(pool.GetDenseIndex(Handle{ 0, 0 }) == kInvalidDenseIndex);
+
+	Handle a = pool.Allocate();
+	Handle b = pool.Allocate();
+	Handle c = pool.Allocate();
+	CHECK(a.IsValid() && b.IsValid() && c.IsValid());
+	CHECK(pool.GetDenseIndex(a) == 0 && pool.GetDenseIndex(b) == 1 && pool.GetDenseIndex(c) == 2);
+
+	// c fills the hole left by a
+	CHECK(pool.Free(a) == 0);
+	CHECK(pool.GetDenseIndex(c) == 0 && pool.GetHandle(0) == c);
+	CHECK(pool.GetDenseIndex(a) == kInvalidDenseIndex);
+	CHECK(pool.Free(a) == kInvalidDenseIndex);
+
+	// Freeing the last element moves nothing
+	CHECK(pool.Free(b) == pool.GetCount());
+
+	// The slot freed last is reused first, with a new generation
+	Handle d = pool.Allocate();
+	CHECK(d.m_index == b.m_index && d != b);
+	CHECK(pool.GetDenseIndex(b) == kInvalidDenseIndex);
+	CHECK(pool.GetCount() == 2);
+}
+
+// Random allocations and frees with a value per element moved like an owner would, checked against the live handles
+static void TestFuzz(uint32_t seed)
+{
+	HandlePool pool;
+	std::vector<uint32_t> values;
+	std::mt19937 random(seed);
+
+	struct Live
+	{
+		Handle m_handle;
+		uint32_t m_value;
+	};
+	std::vector<Live> live;
+	std::vector<Handle> freed;
+
+	for (uint32_t step = 0; step < 200000; step++)
+	{
+		uint32_t operation = random() % 3;
+		if (operation == 0 || live.empty())
+		{
+			Live element = { pool.Allocate(), (uint32_t)random() };
+			CHECK(pool.GetDenseIndex(element.m_handle) == pool.GetCount() - 1);
+			values.push_back(element.m_value);
+			live.push_back(element);
+		}
+		else if (operation == 1)
+		{
+			size_t victim = random() % live.size();
+			uint32_t denseIndex = pool.Free(live[victim].m_handle);
+			CHECK(denseIndex != kInvalidDenseIndex);
+			values[denseIndex] = values.back();
+			values.pop_back();
+
+			freed.push_back(live[victim].m_handle);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+		else
+		{
+			const Live& element = live[random() % live.size()];
+			uint32_t denseIndex = pool.GetDenseIndex(element.m_handle);
+			CHECK(denseIndex != kInvalidDenseIndex && values[denseIndex] == element.m_value);
+			CHECK(pool.GetHandle(denseIndex) == element.m_handle);
+
+			// Stale handles never resolve, even once their slot is in use again
+			if (!freed.empty())
+			{
+				Handle stale = freed[random() % freed.size()];
+				CHECK(pool.GetDenseIndex(stale) == kInvalidDenseIndex);
+				CHECK(pool.Free(stale) == kInvalidDenseIndex);
+			}
+		}
+		CHECK(pool.GetCount() == live.size());
+	}
+
+	for (const Live& element : live)
+	{
+		uint32_t denseIndex = pool.Free(element.m_handle);
+		values[denseIndex] = values.back();
+		values.pop_back();
+	}
+	CHECK(pool.GetCount() == 0 && values.empty());
+}
+
+int main()
+{
+	TestBasics();
+	TestFuzz(1);
+	TestFuzz(2);
+	return ReportTestResults("HandlePoolTests");
+}
@@ -0,0 +1,206 @@
+#include "Test.h"
+#include "IoService.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const char* kDataPath = "IoServiceTests.bin";
+const uint64_t kMiB = 1024 * 1024;
+
+static void WriteData(const std::vector<uint8_t>& data, size_t size)
+{
+	FILE* file = fopen(kDataPath, "wb");
+	fwrite(data.data(), 1, size, file);
+	fclose(file);
+}
+
+// Random ranges at every priority, all read back correctly without going over the queue depth or the in-flight budget
+static void TestRandomReads(const std::vector<uint8_t>& data)
+{
+	std::mt19937 random(7);
+	IoService io(4, 8 * kMiB);
+	uint32_t file = io.OpenFile(kDataPath);
+	CHECK(file != kInvalidIoFile);
+	CHECK(io.GetFileSize(file) == data.size());
+	CHECK(io.OpenFile("IoServiceTests.missing.bin") == kInvalidIoFile);
+	// Past the end of the file
+	CHECK(io.Read(file, data.size() - 10, 11, nullptr, IoPriority::Normal) == 0);
+
+	struct Range
+	{
+		uint64_t m_offset;
+		std::vector<uint8_t> m_data;
+	};
+	std::vector<Range> ranges(300);
+	IoBatch batch;
+	for (Range& range : ranges)
+	{
+		uint64_t size = random() % (3 * kMiB);
+		range.m_offset = random() % (data.size() - size);
+		range.m_data.resize((size_t)size);
+		CHECK(io.Read(file, range.m_offset, size, range.m_data.data(), (IoPriority)(random() % (uint32_t)IoPriority::Count), &batch) != 0);
+	}
+
+	uint64_t maxInFlightBytes = 0;
+	while (!io.IsComplete(batch))
+	{
+		IoStats stats = io.GetStats();
+		maxInFlightBytes = std::max(maxInFlightBytes, stats.m_inFlightBytes);
+		CHECK(stats.m_inFlightReads <= 4);
+	}
+	io.Wait(batch);
+	CHECK(batch.m_failed == 0);
+	CHECK(maxInFlightBytes <= 8 * kMiB);
+	for (const Range& range : ranges)
+	{
+		CHECK(range.m_data.empty() || memcmp(range.m_data.data(), &data[(size_t)range.m_offset], range.m_data.size()) == 0);
+	}
+
+	IoStats stats = io.GetStats();
+	CHECK(stats.m_completedRequests == ranges.size());
+	CHECK(stats.m_queuedRequests == 0 && stats.m_inFlightReads == 0 && stats.m_inFlightBytes == 0);
+	CHECK(stats.m_p50LatencyMs <= stats.m_p99LatencyMs && stats.m_p99LatencyMs <= stats.m_maxLatencyMs);
+
+	// Empty reads complete right away
+	IoBatch empty;
+	CHECK(io.Read(file, 5, 0, nullptr, IoPriority::Normal, &empty) != 0);
+	CHECK(io.IsComplete(empty));
+
+	// Indices of closed files are reused
+	io.CloseFile(file);
+	CHECK(io.OpenFile(kDataPath) == file);
+}
+
+// With a single read at a time, a critical read queued behind a low priority stream goes right after the chunk in
+// flight, and chunks of a partly issued request still go first within the same priority
+static void TestPriorities(std::vector<uint8_t>& buffer)
+{
+	IoService io(1, kMiB);
+	uint32_t file = io.OpenFile(kDataPath);
+	std::mutex mutex;
+	std::vector<uint32_t> order;
+	IoBatch batch;
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		io.Read(file, i * kMiB, kMiB, &buffer[i * kMiB], IoPriority::Low, &batch, [&, i](IoService::RequestId, IoStatus)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			order.push_back(i);
+		});
+	}
+	io.Read(file, 0, 4096, &buffer[30 * kMiB], IoPriority::Critical, &batch, [&](IoService::RequestId, IoStatus status)
+	{
+		CHECK(status == IoStatus::Completed);
+		std::lock_guard<std::mutex> lock(mutex);
+		order.push_back(100);
+	});
+	io.Wait(batch);
+
+	CHECK(order.size() == 21);
+	size_t position = std::find(order.begin(), order.end(), 100u) - order.begin();
+	CHECK(position <= 2);
+	// The low priority reads keep their order
+	order.erase(order.begin() + position);
+	CHECK(std::is_sorted(order.begin(), order.end()));
+}
+
+// Requests not fully issued are cancelled, callbacks and batches see them as such, fully issued ones can not be
+static void TestCancellation(std::vector<uint8_t>& buffer)
+{
+	IoService io(1, kMiB);
+	uint32_t file = io.OpenFile(kDataPath);
+	IoBatch batch;
+	std::vector<IoService::RequestId> requests;
+	std::atomic<uint32_t> cancelledCallbacks(0);
+	std::atomic<uint32_t> completedCallbacks(0);
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		requests.push_back(io.Read(file, i * kMiB, 2 * kMiB, buffer.data(), IoPriority::Normal, &batch, [&](IoService::RequestId, IoStatus status)
+		{
+			(status == IoStatus::Cancelled ? cancelledCallbacks : completedCallbacks)++;
+		}));
+	}
+
+	uint32_t cancelled = 0;
+	for (IoService::RequestId request : requests)
+	{
+		cancelled += io.Cancel(request);
+	}
+	CHECK(!io.Cancel(requests[5]));
+	io.Wait(batch);
+
+	CHECK(cancelled >= 18);
+	CHECK(cancelledCallbacks == cancelled && completedCallbacks == 20 - cancelled);
+	CHECK(batch.m_failed == cancelled);
+	IoStats stats = io.GetStats();
+	CHECK(stats.m_cancelledRequests == cancelled);
+	CHECK(stats.m_inFlightReads == 0 && stats.m_queuedRequests == 0);
+
+	// Cancelling after completion, or an unknown request
+	CHECK(!io.Cancel(requests[0]));
+	CHECK(!io.Cancel(0));
+}
+
+// A file that shrinks after being opened fails the reads past its new end, the service keeps working
+static void TestFailure(const std::vector<uint8_t>& data, std::vector<uint8_t>& buffer)
+{
+	IoService io(2, kMiB);
+	uint32_t file = io.OpenFile(kDataPath);
+	WriteData(data, kMiB);
+
+	IoBatch batch;
+	io.Read(file, 2 * kMiB, kMiB, buffer.data(), IoPriority::High, &batch, [](IoService::RequestId, IoStatus status)
+	{
+		CHECK(status == IoStatus::Failed);
+	});
+	io.Wait(batch);
+	CHECK(batch.m_failed == 1);
+	CHECK(io.GetStats().m_failedRequests == 1);
+
+	IoBatch valid;
+	io.Read(file, 0, 4096, buffer.data(), IoPriority::High, &valid);
+	io.Wait(valid);
+	CHECK(valid.m_failed == 0 && memcmp(buffer.data(), data.data(), 4096) == 0);
+
+	WriteData(data, data.size());
+}
+
+// Destroying the service with queued work cancels it and waits for the reads in flight
+static void TestDestruction(std::vector<uint8_t>& buffer)
+{
+	IoBatch batch;
+	{
+		IoService io(2, 2 * kMiB);
+		uint32_t file = io.OpenFile(kDataPath);
+		for (uint32_t i = 0; i < 30; i++)
+		{
+			io.Read(file, 0, kMiB, &buffer[i * kMiB], IoPriority::Low, &batch);
+		}
+	}
+	CHECK(batch.m_pending == 0);
+	CHECK(batch.m_failed >= 26);
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	std::vector<uint8_t> data(40 * kMiB);
+	for (uint8_t& byte : data)
+	{
+		byte = (uint8_t)random();
+	}
+	WriteData(data, data.size());
+	std::vector<uint8_t> buffer(40 * kMiB);
+
+	TestRandomReads(data);
+	TestPriorities(buffer);
+	TestCancellation(buffer);
+	TestFailure(data, buffer);
+	TestDestruction(buffer);
+	remove(kDataPath);
+	return ReportTestResults("IoServiceTests");
+}
@@ -0,0 +1,82 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <vector>
+
+using namespace Sigma;
+
+static void TestThreadIndices()
+{
+	JobSystem jobSystem(3, 3);
+	CHECK(jobSystem.GetThreadCount() == 6);
+	CHECK(JobSystem::GetThreadIndex() == 0);
+	CHECK(jobSystem.RegisterThread() == 0);
+
+	// External threads get the reserved indices, one each, until there are none left
+	uint32_t registered[3] = {};
+	uint32_t unregistered = 0;
+	std::thread first([&]() { registered[0] = jobSystem.RegisterThread(); });
+	first.join();
+	std::thread second([&]() { registered[1] = jobSystem.RegisterThread(); registered[2] = JobSystem::GetThreadIndex(); });
+	second.join();
+	std::thread third([&]() { unregistered = jobSystem.RegisterThread(); });
+	third.join();
+	CHECK(registered[0] == 1 || registered[0] == 2);
+	CHECK(registered[1] == 3 - registered[0]);
+	CHECK(registered[2] == registered[1]);
+	CHECK(unregistered == JobSystem::kInvalidThreadIndex);
+
+	// Workers come after the external threads, the caller may run jobs while waiting
+	std::vector<uint32_t> indices(1000);
+	jobSystem.ParallelFor((uint32_t)indices.size(), 10, [&](uint32_t i) { indices[i] = JobSystem::GetThreadIndex(); });
+	for (uint32_t index : indices)
+	{
+		CHECK(index == 0 || (index >= 3 && index < 6));
+	}
+
+	// Without an index, jobs can still be run and waited on
+	bool done = false;
+	std::thread other([&]()
+	{
+		CHECK(JobSystem::GetThreadIndex() == JobSystem::kInvalidThreadIndex);
+		JobCounter counter;
+		jobSystem.Run([&done]() { done = true; }, &counter);
+		jobSystem.Wait(counter);
+	});
+	other.join();
+	CHECK(done);
+}
+
+// Jobs spawning jobs and waiting on them
+static void TestNestedJobs()
+{
+	JobSystem jobSystem(2);
+	std::atomic<uint32_t> leaves(0);
+	std::vector<uint32_t> visited(64 * 64, 0);
+
+	JobCounter counter;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		jobSystem.Run([&, i]()
+		{
+			JobCounter children;
+			for (uint32_t j = 0; j < 64; j++)
+			{
+				jobSystem.Run([&, i, j]() { visited[i * 64 + j]++; leaves++; }, &children);
+			}
+			jobSystem.Wait(children);
+		}, &counter);
+	}
+	jobSystem.Wait(counter);
+
+	CHECK(leaves == 64 * 64);
+	CHECK(std::count(visited.begin(), visited.end(), 1u) == 64 * 64);
+	CHECK(counter.m_value == 0);
+}
+
+int main()
+{
+	TestThreadIndices();
+	TestNestedJobs();
+	return ReportTestResults("JobSystemTests");
+}
@@ -0,0 +1,247 @@
+#include "Test.h"
+#include "MipGenerator.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const double kPi = 3.14159265358979323846;
+
+static double SrgbToLinear(double value)
+{
+	return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+static double LinearToSrgb(double value)
+{
+	return value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+}
+
+static double HalfToDouble(uint16_t half)
+{
+	int32_t exponent = (half >> 10) & 0x1f;
+	double mantissa = half & 0x3ff;
+	double value = exponent == 0 ? std::ldexp(mantissa, -24) : std::ldexp(mantissa + 1024.0, exponent - 25);
+	return half & 0x8000 ? -value : value;
+}
+
+static uint32_t GetChannelCount(MipFormat format)
+{
+	return format == MipFormat::R8 ? 1 : 4;
+}
+
+// The filters MipGenerator documents, in double precision
+struct ReferenceFilter
+{
+	std::vector<int32_t> m_offsets;
+	std::vector<double> m_weights;
+};
+
+static double BesselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (uint32_t k = 1; k < 30; k++)
+	{
+		double factor = x / (2.0 * k);
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+static ReferenceFilter MakeReferenceFilter(MipFilter filter)
+{
+	ReferenceFilter reference;
+	if (filter == MipFilter::Box)
+	{
+		reference.m_offsets = { 0, 1 };
+		reference.m_weights = { 0.5, 0.5 };
+		return reference;
+	}
+
+	// 6 taps Kaiser windowed half band sinc, alpha 4, radius 3
+	double sum = 0.0;
+	for (int32_t offset = -2; offset <= 3; offset++)
+	{
+		double distance = offset - 0.5;
+		double x = distance * 0.5 * kPi;
+		double t = distance / 3.0;
+		double weight = std::sin(x) / x * BesselI0(4.0 * std::sqrt(1.0 - t * t)) / BesselI0(4.0);
+		reference.m_offsets.push_back(offset);
+		reference.m_weights.push_back(weight);
+		sum += weight;
+	}
+	for (double& weight : reference.m_weights)
+	{
+		weight /= sum;
+	}
+	return reference;
+}
+
+struct ReferenceLevel
+{
+	uint32_t m_width;
+	uint32_t m_height;
+	std::vector<double> m_values; // Linear
+};
+
+// Both directions at once, edges clamped, odd sizes rounded down
+static ReferenceLevel Downsample(const ReferenceLevel& source, const ReferenceFilter& filter, uint32_t channels)
+{
+	ReferenceLevel level;
+	level.m_width = std::max(source.m_width / 2, 1u);
+	level.m_height = std::max(source.m_height / 2, 1u);
+	level.m_values.resize((size_t)level.m_width * level.m_height * channels);
+	for (uint32_t y = 0; y < level.m_height; y++)
+	{
+		for (uint32_t x = 0; x < level.m_width; x++)
+		{
+			for (uint32_t channel = 0; channel < channels; channel++)
+			{
+				double sum = 0.0;
+				for (size_t i = 0; i < filter.m_offsets.size(); i++)
+				{
+					int32_t row = std::min(std::max(2 * (int32_t)y + filter.m_offsets[i], 0), (int32_t)source.m_height - 1);
+					for (size_t j = 0; j < filter.m_offsets.size(); j++)
+					{
+						int32_t column = std::min(std::max(2 * (int32_t)x + filter.m_offsets[j], 0), (int32_t)source.m_width - 1);
+						sum += filter.m_weights[i] * filter.m_weights[j] * source.m_values[((size_t)row * source.m_width + column) * channels + channel];
+					}
+				}
+				level.m_values[((size_t)y * level.m_width + x) * channels + channel] = sum;
+			}
+		}
+	}
+	return level;
+}
+
+// Random images of every format and filter, every level checked against the double precision reference : within 1 LSB
+// for the 8 bit formats, 1/1024 for half floats. The padding of the destination rows is left untouched
+static void TestAgainstReference(JobSystem* jobSystem, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	const MipFormat formats[] = { MipFormat::RGBA8, MipFormat::RGBA8Srgb, MipFormat::RGBA16F, MipFormat::R8 };
+	MipGenerator generator(jobSystem);
+
+	for (uint32_t i = 0; i < 80; i++)
+	{
+		MipFormat format = formats[i % 4];
+		MipFilter filter = (i / 4) % 2 ? MipFilter::Kaiser : MipFilter::Box;
+		uint32_t channels = GetChannelCount(format);
+		uint32_t texelSize = MipGenerator::GetTexelSize(format);
+
+		// Some wide and flat ones, where a single row stays for several levels
+		uint32_t width = 1 + random() % 70;
+		uint32_t height = 1 + random() % 70;
+		if (i % 7 == 0)
+		{
+			width = 256;
+			height = 1 + random() % 3;
+		}
+
+		uint64_t sourcePitch = (width + random() % 8) * texelSize;
+		std::vector<uint8_t> source(sourcePitch * height);
+		ReferenceLevel level = { width, height, std::vector<double>((size_t)width * height * channels) };
+		for (uint32_t y = 0; y < height; y++)
+		{
+			uint8_t* row = &source[y * sourcePitch];
+			for (uint32_t x = 0; x < width * channels; x++)
+			{
+				double& value = level.m_values[(size_t)y * width * channels + x];
+				if (format == MipFormat::RGBA16F)
+				{
+					// Finite halves between -8 and 8
+					uint16_t half = (uint16_t)(((random() % 2) << 15) | ((1 + random() % 17) << 10) | (random() & 0x3ff));
+					memcpy(row + 2 * x, &half, sizeof(half));
+					value = HalfToDouble(half);
+				}
+				else
+				{
+					row[x] = (uint8_t)random();
+					bool srgb = format == MipFormat::RGBA8Srgb && x % 4 != 3;
+					value = srgb ? SrgbToLinear(row[x] / 255.0) : row[x] / 255.0;
+				}
+			}
+		}
+
+		uint32_t numLevels = MipGenerator::GetFullChainLevelCount(width, height);
+		generator.Generate(format, filter, source.data(), sourcePitch, width, height, numLevels);
+		CHECK(generator.GetLevelCount() == numLevels);
+
+		ReferenceFilter referenceFilter = MakeReferenceFilter(filter);
+		for (uint32_t levelIndex = 0; levelIndex < numLevels; levelIndex++)
+		{
+			if (levelIndex > 0)
+				level = Downsample(level, referenceFilter, channels);
+			CHECK(generator.GetWidth(levelIndex) == level.m_width && generator.GetHeight(levelIndex) == level.m_height);
+
+			uint64_t rowSize = (uint64_t)level.m_width * texelSize;
+			uint64_t rowPitch = rowSize + 16;
+			std::vector<uint8_t> destination(rowPitch * level.m_height, 0xee);
+			TextureRows rows = { destination.data(), rowPitch, rowPitch * level.m_height, rowSize, level.m_height, 1 };
+			generator.Write(levelIndex, rows);
+
+			for (uint32_t y = 0; y < level.m_height; y++)
+			{
+				const uint8_t* row = &destination[y * rowPitch];
+				CHECK(row[rowSize] == 0xee && row[rowPitch - 1] == 0xee);
+				for (uint32_t x = 0; x < level.m_width * channels; x++)
+				{
+					double expected = level.m_values[(size_t)y * level.m_width * channels + x];
+					if (format == MipFormat::RGBA16F)
+					{
+						uint16_t half;
+						memcpy(&half, row + 2 * x, sizeof(half));
+						CHECK(std::abs(HalfToDouble(half) - expected) <= std::abs(expected) / 1024.0 + 1e-5);
+					}
+					else
+					{
+						bool srgb = format == MipFormat::RGBA8Srgb && x % 4 != 3;
+						double clamped = std::min(std::max(expected, 0.0), 1.0);
+						int32_t encoded = (int32_t)((srgb ? LinearToSrgb(clamped) : clamped) * 255.0 + 0.5);
+						CHECK(std::abs((int32_t)row[x] - encoded) <= 1);
+					}
+				}
+			}
+		}
+	}
+}
+
+// A constant image stays the same at every level, the filters are normalized and sRGB round trips
+static void TestConstant()
+{
+	const uint32_t width = 37;
+	const uint32_t height = 20;
+	std::vector<uint32_t> source(width * height, 0x80c04020);
+	MipGenerator generator;
+	generator.Generate(MipFormat::RGBA8Srgb, MipFilter::Kaiser, source.data(), width * sizeof(uint32_t), width, height, MipGenerator::GetFullChainLevelCount(width, height));
+	CHECK(generator.GetLevelCount() == 6);
+	CHECK(generator.GetWidth(5) == 1 && generator.GetHeight(5) == 1);
+
+	for (uint32_t level = 0; level < generator.GetLevelCount(); level++)
+	{
+		uint32_t levelWidth = generator.GetWidth(level);
+		uint32_t levelHeight = generator.GetHeight(level);
+		std::vector<uint32_t> texels(levelWidth * levelHeight);
+		TextureRows rows = { reinterpret_cast<uint8_t*>(texels.data()), levelWidth * sizeof(uint32_t), levelWidth * levelHeight * sizeof(uint32_t), levelWidth * sizeof(uint32_t), levelHeight, 1 };
+		generator.Write(level, rows);
+		for (uint32_t texel : texels)
+		{
+			CHECK(texel == 0x80c04020);
+		}
+	}
+}
+
+int main()
+{
+	TestConstant();
+	TestAgainstReference(nullptr, 1);
+	JobSystem jobSystem(3);
+	TestAgainstReference(&jobSystem, 2);
+	return ReportTestResults("MipGeneratorTests");
+}
@@ -0,0 +1,275 @@
+#include "Test.h"
+#include "PipelineCache.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace Sigma;
+
+const char* kCachePath = "PipelineCacheTests.bin";
+const char* kCorruptPath = "PipelineCacheTests.corrupt.bin";
+const uint64_t kCompatibilityKey = 0x1234;
+
+// Pipelines are ints holding their key, the blob the fake compiler returns is derived from the key
+static std::vector<uint8_t> MakeBlob(uint64_t key)
+{
+	std::vector<uint8_t> blob((size_t)(key % 50 + 1));
+	for (size_t i = 0; i < blob.size(); i++)
+	{
+		blob[i] = (uint8_t)(key * 31 + i);
+	}
+	return blob;
+}
+
+static std::atomic<uint32_t> s_liveCount(0);
+
+static void ReleasePipeline(void* pipeline)
+{
+	delete static_cast<uint64_t*>(pipeline);
+	s_liveCount--;
+}
+
+// Counts compilations, and remembers whether each one got the expected blob from the disk cache
+struct FakeCompiler
+{
+	std::atomic<uint32_t> m_compileCount{ 0 };
+	std::atomic<uint32_t> m_cachedBlobCount{ 0 };
+	std::atomic<uint32_t> m_wrongBlobCount{ 0 };
+
+	PipelineCache::CompileFunction Get(uint64_t key)
+	{
+		return [this, key](const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& blob) -> void*
+		{
+			m_compileCount++;
+			if (!cachedBlob.empty())
+			{
+				m_cachedBlobCount++;
+				if (cachedBlob != MakeBlob(key))
+					m_wrongBlobCount++;
+			}
+			blob = MakeBlob(key);
+			s_liveCount++;
+			return new uint64_t(key);
+		};
+	}
+};
+
+static std::vector<uint8_t> ReadFile(const char* path)
+{
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+		return data;
+	fseek(file, 0, SEEK_END);
+	data.resize((size_t)ftell(file));
+	fseek(file, 0, SEEK_SET);
+	size_t read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+	data.resize(read);
+	return data;
+}
+
+static void WriteFile(const char* path, const std::vector<uint8_t>& data, size_t size)
+{
+	FILE* file = fopen(path, "wb");
+	fwrite(data.data(), 1, size, file);
+	fclose(file);
+}
+
+// Strings are hashed with their length, so they can not run into each other
+static void TestHasher()
+{
+	PipelineHasher a;
+	a.AddString("ab");
+	a.AddString("c");
+	PipelineHasher b;
+	b.AddString("a");
+	b.AddString("bc");
+	CHECK(a.Get() != b.Get());
+
+	PipelineHasher c;
+	c.AddString("ab");
+	c.AddString("c");
+	CHECK(a.Get() == c.Get());
+}
+
+// Many threads requesting the same pipelines : each key is compiled once, then shared
+static void TestConcurrentRequests()
+{
+	FakeCompiler compiler;
+	{
+		PipelineCache cache(4, ReleasePipeline);
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < 8; t++)
+		{
+			threads.emplace_back([&]()
+			{
+				for (uint64_t key = 0; key < 100; key++)
+				{
+					cache.Request(key, compiler.Get(key));
+					cache.Get(key);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		cache.WaitIdle();
+
+		CHECK(compiler.m_compileCount == 100);
+		CHECK(cache.GetPendingCount() == 0);
+		for (uint64_t key = 0; key < 100; key++)
+		{
+			uint64_t* pipeline = static_cast<uint64_t*>(cache.Get(key));
+			CHECK(pipeline != nullptr && *pipeline == key);
+		}
+		CHECK(cache.Get(100) == nullptr);
+	}
+	// Every pipeline is released with the cache
+	CHECK(s_liveCount == 0);
+}
+
+// Get returns nothing while the pipeline compiles, the caller uses its placeholder until then
+static void TestNotReadyWhileCompiling()
+{
+	std::atomic<bool> started(false);
+	std::atomic<bool> release(false);
+	PipelineCache cache(1, ReleasePipeline);
+	cache.Request(7, [&](const std::vector<uint8_t>&, std::vector<uint8_t>&) -> void*
+	{
+		started = true;
+		while (!release)
+		{
+			std::this_thread::yield();
+		}
+		s_liveCount++;
+		return new uint64_t(7);
+	});
+	while (!started)
+	{
+		std::this_thread::yield();
+	}
+
+	CHECK(cache.Get(7) == nullptr);
+	CHECK(cache.GetPendingCount() == 1);
+	// Requesting it again while it compiles does not queue a second compilation
+	FakeCompiler compiler;
+	cache.Request(7, compiler.Get(7));
+
+	release = true;
+	cache.WaitIdle();
+	CHECK(cache.Get(7) != nullptr && *static_cast<uint64_t*>(cache.Get(7)) == 7);
+	CHECK(compiler.m_compileCount == 0);
+}
+
+// Blobs saved by one run are handed to the compiler by the next one, and blobs loaded but not requested are kept
+static void TestRoundTrip()
+{
+	{
+		FakeCompiler compiler;
+		PipelineCache cache(2, ReleasePipeline);
+		for (uint64_t key = 0; key < 40; key++)
+		{
+			cache.Request(key * 1000, compiler.Get(key * 1000));
+		}
+		cache.WaitIdle();
+		CHECK(cache.Save(kCachePath, kCompatibilityKey));
+	}
+	{
+		FakeCompiler compiler;
+		PipelineCache cache(2, ReleasePipeline);
+		CHECK(cache.Load(kCachePath, kCompatibilityKey));
+		for (uint64_t key = 0; key < 20; key++)
+		{
+			cache.Request(key * 1000, compiler.Get(key * 1000));
+		}
+		cache.Request(12345, compiler.Get(12345));
+		cache.WaitIdle();
+		CHECK(compiler.m_compileCount == 21);
+		CHECK(compiler.m_cachedBlobCount == 20 && compiler.m_wrongBlobCount == 0);
+		CHECK(cache.Save(kCachePath, kCompatibilityKey));
+	}
+	{
+		FakeCompiler compiler;
+		PipelineCache cache(2, ReleasePipeline);
+		CHECK(cache.Load(kCachePath, kCompatibilityKey));
+		for (uint64_t key = 0; key < 40; key++)
+		{
+			cache.Request(key * 1000, compiler.Get(key * 1000));
+		}
+		cache.Request(12345, compiler.Get(12345));
+		cache.WaitIdle();
+		CHECK(compiler.m_cachedBlobCount == 41 && compiler.m_wrongBlobCount == 0);
+	}
+	CHECK(s_liveCount == 0);
+}
+
+// Loading the file must fail and leave the cache without any blob
+static void CheckRejected(const char* path, uint64_t compatibilityKey)
+{
+	FakeCompiler compiler;
+	PipelineCache cache(1, ReleasePipeline);
+	CHECK(!cache.Load(path, compatibilityKey));
+	for (uint64_t key = 0; key < 40; key++)
+	{
+		cache.Request(key * 1000, compiler.Get(key * 1000));
+	}
+	cache.WaitIdle();
+	CHECK(compiler.m_cachedBlobCount == 0);
+}
+
+// Files from another driver or format version, truncated anywhere, or with any byte changed are ignored as a whole
+static void TestRejectedFiles()
+{
+	std::vector<uint8_t> file = ReadFile(kCachePath);
+	CHECK(file.size() > 32);
+
+	CheckRejected(kCachePath, kCompatibilityKey + 1);
+	CheckRejected("PipelineCacheTests.missing.bin", kCompatibilityKey);
+
+	// The version follows the magic
+	std::vector<uint8_t> corrupt = file;
+	corrupt[4]--;
+	WriteFile(kCorruptPath, corrupt, corrupt.size());
+	CheckRejected(kCorruptPath, kCompatibilityKey);
+
+	for (size_t size = 0; size < file.size(); size += 1 + size / 4)
+	{
+		WriteFile(kCorruptPath, file, size);
+		CheckRejected(kCorruptPath, kCompatibilityKey);
+	}
+	WriteFile(kCorruptPath, file, file.size() - 1);
+	CheckRejected(kCorruptPath, kCompatibilityKey);
+
+	// Trailing bytes
+	corrupt = file;
+	corrupt.push_back(0);
+	WriteFile(kCorruptPath, corrupt, corrupt.size());
+	CheckRejected(kCorruptPath, kCompatibilityKey);
+
+	for (size_t position = 0; position < file.size(); position += 1 + position / 8)
+	{
+		corrupt = file;
+		corrupt[position] ^= 0x10;
+		WriteFile(kCorruptPath, corrupt, corrupt.size());
+		CheckRejected(kCorruptPath, kCompatibilityKey);
+	}
+
+	// The original still loads
+	PipelineCache cache(1, ReleasePipeline);
+	CHECK(cache.Load(kCachePath, kCompatibilityKey));
+	remove(kCorruptPath);
+}
+
+int main()
+{
+	TestHasher();
+	TestConcurrentRequests();
+	TestNotReadyWhileCompiling();
+	TestRoundTrip();
+	TestRejectedFiles();
+	remove(kCachePath);
+	return ReportTestResults("PipelineCacheTests");
+}
@@ -0,0 +1,179 @@
+#include "Test.h"
+#include "ResidencySet.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint64_t kFramesInFlight = 2;
+
+// Least recently used objects go first, objects used again come back in the order they were used
+static void TestOrder()
+{
+	ResidencySet set;
+	uint32_t a = set.Add(100);
+	uint32_t b = set.Add(100);
+	uint32_t c = set.Add(100);
+	uint32_t d = set.Add(100);
+	std::vector<uint32_t> makeResident;
+	std::vector<uint32_t> evict;
+
+	// a is the most recently used, b the least
+	set.MarkUsed(c, 1);
+	set.MarkUsed(d, 1);
+	set.MarkUsed(a, 1);
+	CHECK(set.Update(200, 1, makeResident, evict));
+	CHECK(makeResident.empty());
+	CHECK(evict.size() == 2 && evict[0] == b && evict[1] == c);
+	CHECK(!set.IsResident(b) && !set.IsResident(c) && set.IsResident(d) && set.IsResident(a));
+
+	// c then b are needed again : made resident in that order, and now more recent than d and a
+	set.MarkUsed(c, 2);
+	set.MarkUsed(b, 2);
+	set.MarkUsed(c, 2);
+	CHECK(set.Update(200, 2, makeResident, evict));
+	CHECK(makeResident.size() == 2 && makeResident[0] == c && makeResident[1] == b);
+	CHECK(evict.size() == 2 && evict[0] == d && evict[1] == a);
+
+	const ResidencyStats& stats = set.GetStats();
+	CHECK(stats.m_objectCount == 4 && stats.m_residentCount == 2);
+	CHECK(stats.m_madeResidentSize == 200 && stats.m_evictedSize == 200);
+	CHECK(stats.m_residentSize == 200 && stats.m_totalSize == 400);
+
+	// Removing an object waiting to be made resident drops it
+	set.MarkUsed(a, 3);
+	set.Remove(a);
+	CHECK(set.Update(200, 3, makeResident, evict));
+	CHECK(makeResident.empty() && evict.empty());
+	CHECK(set.GetStats().m_objectCount == 3);
+}
+
+// Objects used by frames in flight stay resident, even over budget
+static void TestInFlight()
+{
+	ResidencySet set;
+	std::vector<uint32_t> handles;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		handles.push_back(set.Add(100));
+		set.MarkUsed(handles.back(), 5 + i);
+	}
+	std::vector<uint32_t> makeResident;
+	std::vector<uint32_t> evict;
+
+	// Fence 5 reached : only the first one can go
+	CHECK(!set.Update(100, 5, makeResident, evict));
+	CHECK(evict.size() == 1 && evict[0] == handles[0]);
+	CHECK(set.GetResidentSize() == 300);
+
+	CHECK(!set.Update(100, 6, makeResident, evict));
+	CHECK(evict.size() == 1 && evict[0] == handles[1]);
+	CHECK(set.Update(100, 7, makeResident, evict));
+	CHECK(evict.size() == 1 && evict[0] == handles[2]);
+	CHECK(set.GetResidentSize() == 100 && set.IsResident(handles[3]));
+}
+
+// Frames using random working sets, checked against a copy of what the device would have resident
+static void TestSimulation()
+{
+	std::mt19937 random(11);
+	ResidencySet set;
+	std::vector<uint64_t> sizes;
+	std::vector<uint64_t> lastUsed;
+	std::vector<bool> resident;
+	for (uint32_t i = 0; i < 500; i++)
+	{
+		uint64_t size = (1 + random() % 16) << 20;
+		CHECK(set.Add(size) == i);
+		sizes.push_back(size);
+		lastUsed.push_back(0);
+		resident.push_back(true);
+	}
+
+	std::vector<uint32_t> makeResident;
+	std::vector<uint32_t> evict;
+	uint64_t workingSetMax = 0;
+	uint32_t overBudgetFrames = 0;
+	for (uint64_t fence = 1; fence <= 3000; fence++)
+	{
+		// The budget drops in the middle of the run, as when another application takes video memory
+		uint64_t budget = (fence < 1500 ? 3000ull : 1500ull) << 20;
+
+		// A working set drifting over the objects, with a few random ones
+		uint32_t start = (uint32_t)(fence / 10) % 500;
+		std::vector<uint32_t> used;
+		for (uint32_t i = 0; i < 32; i++)
+		{
+			used.push_back((start + i) % 500);
+		}
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			used.push_back(random() % 500);
+		}
+
+		uint64_t workingSet = 0;
+		for (uint32_t handle : used)
+		{
+			set.MarkUsed(handle, fence);
+			if (lastUsed[handle] != fence)
+				workingSet += sizes[handle];
+			lastUsed[handle] = fence;
+		}
+		workingSetMax = std::max(workingSetMax, workingSet);
+
+		uint64_t completed = fence > kFramesInFlight ? fence - kFramesInFlight : 0;
+		bool underBudget = set.Update(budget, completed, makeResident, evict);
+
+		for (uint32_t handle : makeResident)
+		{
+			CHECK(!resident[handle]);
+			resident[handle] = true;
+		}
+		for (uint32_t handle : evict)
+		{
+			CHECK(resident[handle]);
+			// Never while the GPU may still use it
+			CHECK(lastUsed[handle] <= completed);
+			resident[handle] = false;
+		}
+
+		// Everything the frame uses is resident before it is submitted
+		for (uint32_t handle : used)
+		{
+			CHECK(resident[handle] && set.IsResident(handle));
+		}
+
+		uint64_t residentSize = 0;
+		for (uint32_t i = 0; i < 500; i++)
+		{
+			residentSize += resident[i] ? sizes[i] : 0;
+			CHECK(resident[i] == set.IsResident(i));
+		}
+		CHECK(residentSize == set.GetResidentSize());
+		CHECK(underBudget == (residentSize <= budget));
+		overBudgetFrames += !underBudget;
+
+		// Over budget only if the frames in flight need more than the budget
+		if (!underBudget)
+		{
+			for (uint32_t i = 0; i < 500; i++)
+			{
+				CHECK(!resident[i] || lastUsed[i] > completed);
+			}
+		}
+	}
+
+	// The working sets of the frames in flight fit, the budget is always met
+	CHECK(workingSetMax * kFramesInFlight < (1500ull << 20));
+	CHECK(overBudgetFrames == 0);
+	CHECK(set.GetStats().m_totalSize > (3000ull << 20));
+}
+
+int main()
+{
+	TestOrder();
+	TestInFlight();
+	TestSimulation();
+	return ReportTestResults("ResidencySetTests");
+}
@@ -0,0 +1,202 @@
+#include "Test.h"
+#include "ResourceStateTracker.h"
+#include <vector>
+
+using namespace Sigma;
+
+// D3D12_RESOURCE_STATES values
+const uint32_t kCommon = 0x0;
+const uint32_t kRenderTarget = 0x4;
+const uint32_t kShaderResource = 0x80 | 0x40;
+const uint32_t kCopyDest = 0x400;
+const uint32_t kCopySource = 0x800;
+
+// Stands in for the command list : keeps every ResourceBarrier call with its barriers
+struct RecordingCommandList
+{
+	std::vector<std::vector<StateTransition>> m_calls;
+
+	void ResourceBarrier(const std::vector<StateTransition>& barriers)
+	{
+		m_calls.push_back(barriers);
+	}
+
+	void Flush(ResourceStateTracker& tracker)
+	{
+		tracker.FlushBarriers([this](const std::vector<StateTransition>& barriers)
+		{
+			ResourceBarrier(barriers);
+		});
+	}
+};
+
+static bool Matches(const StateTransition& transition, void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter)
+{
+	return transition.m_resource == resource && transition.m_subresource == subresource && transition.m_stateBefore == stateBefore && transition.m_stateAfter == stateAfter;
+}
+
+// Transitions to the state a resource is already in, or back to the state before a queued barrier, record nothing
+static void TestRedundantTransitions()
+{
+	int a = 0;
+	ResourceStateRegistry registry;
+	registry.Register(&a, 1, kCopyDest);
+	ResourceStateTracker tracker(registry);
+	RecordingCommandList commandList;
+
+	// First use : pending until submission, no barrier in the command list
+	tracker.Transition(&a, kRenderTarget);
+	tracker.Transition(&a, kRenderTarget);
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.empty());
+
+	tracker.Transition(&a, kShaderResource);
+	tracker.Transition(&a, kShaderResource);
+	CHECK(tracker.GetBarriers().size() == 1 && Matches(tracker.GetBarriers()[0], &a, kAllSubresources, kRenderTarget, kShaderResource));
+
+	// Back to the state before the queued barrier cancels it
+	tracker.Transition(&a, kRenderTarget);
+	CHECK(tracker.GetBarriers().empty());
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.empty());
+
+	// A barrier already flushed is not merged with later ones
+	tracker.Transition(&a, kShaderResource);
+	commandList.Flush(tracker);
+	tracker.Transition(&a, kRenderTarget);
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.size() == 2);
+	CHECK(Matches(commandList.m_calls[1][0], &a, kAllSubresources, kShaderResource, kRenderTarget));
+}
+
+// Everything queued between two draws goes in one ResourceBarrier call, changes of the same resource collapse
+static void TestMergedBarriers()
+{
+	int resources[3] = {};
+	ResourceStateRegistry registry;
+	ResourceStateTracker tracker(registry);
+	RecordingCommandList commandList;
+	for (int& resource : resources)
+	{
+		registry.Register(&resource, 1, kCommon);
+		tracker.Transition(&resource, kCopyDest);
+	}
+
+	for (int& resource : resources)
+	{
+		tracker.Transition(&resource, kCopySource);
+		tracker.Transition(&resource, kShaderResource);
+	}
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.size() == 1);
+	CHECK(commandList.m_calls[0].size() == 3);
+	for (uint32_t i = 0; i < 3 && i < commandList.m_calls[0].size(); i++)
+	{
+		CHECK(Matches(commandList.m_calls[0][i], &resources[i], kAllSubresources, kCopyDest, kShaderResource));
+	}
+	CHECK(tracker.GetBarriers().empty());
+}
+
+// A subresource transition splits the resource state, a whole resource transition then needs one barrier per
+// subresource that is in another state, and states merge back once they are all the same
+static void TestSubresources()
+{
+	int texture = 0;
+	ResourceStateRegistry registry;
+	registry.Register(&texture, 4, kShaderResource);
+	ResourceStateTracker tracker(registry);
+	RecordingCommandList commandList;
+
+	tracker.Transition(&texture, kShaderResource);
+	tracker.Transition(&texture, kRenderTarget, 1);
+	tracker.Transition(&texture, kCopyDest, 3);
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.size() == 1 && commandList.m_calls[0].size() == 2);
+	CHECK(Matches(commandList.m_calls[0][0], &texture, 1, kShaderResource, kRenderTarget));
+	CHECK(Matches(commandList.m_calls[0][1], &texture, 3, kShaderResource, kCopyDest));
+
+	// Going back on a single subresource merges the states again
+	tracker.Transition(&texture, kShaderResource, 3);
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.size() == 2 && commandList.m_calls[1].size() == 1);
+
+	tracker.Transition(&texture, kCopySource);
+	commandList.Flush(tracker);
+	CHECK(commandList.m_calls.size() == 3 && commandList.m_calls[2].size() == 4);
+	for (uint32_t i = 0; i < 4 && i < commandList.m_calls[2].size(); i++)
+	{
+		CHECK(Matches(commandList.m_calls[2][i], &texture, i, i == 1 ? kRenderTarget : kShaderResource, kCopySource));
+	}
+
+	// Uniform again : a whole resource transition is a single barrier
+	tracker.Transition(&texture, kShaderResource);
+	CHECK(tracker.GetBarriers().size() == 1 && Matches(tracker.GetBarriers()[0], &texture, kAllSubresources, kCopySource, kShaderResource));
+
+	// Setting every subresource one by one also ends with a single state
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		tracker.Transition(&texture, kRenderTarget, i);
+	}
+	commandList.Flush(tracker);
+	tracker.Transition(&texture, kCopyDest);
+	CHECK(tracker.GetBarriers().size() == 1 && Matches(tracker.GetBarriers()[0], &texture, kAllSubresources, kRenderTarget, kCopyDest));
+}
+
+// Command lists recorded in any order, resolved in submission order, each against the state the previous ones left
+static void TestResolveInSubmissionOrder()
+{
+	int buffer = 0;
+	int texture = 0;
+	int unregistered = 0;
+	ResourceStateRegistry registry;
+	registry.Register(&buffer, 1, kCommon);
+	registry.Register(&texture, 4, kShaderResource);
+	ResourceStateTracker first(registry);
+	ResourceStateTracker second(registry);
+	ResourceStateTracker third(registry);
+
+	third.Transition(&buffer, kShaderResource);
+	third.Transition(&texture, kShaderResource);
+	second.Transition(&buffer, kShaderResource);
+	second.Transition(&texture, kShaderResource);
+	second.Transition(&texture, kRenderTarget, 2);
+	second.Transition(&unregistered, kCopyDest);
+	first.Transition(&buffer, kCopyDest);
+	first.Transition(&buffer, kCopySource);
+
+	// The first command list only knows its own barrier, the pending one comes from the registry
+	std::vector<StateTransition> transitions;
+	first.ResolvePendingTransitions(registry, transitions);
+	CHECK(transitions.size() == 1 && Matches(transitions[0], &buffer, kAllSubresources, kCommon, kCopyDest));
+	CHECK(first.GetBarriers().size() == 1 && Matches(first.GetBarriers()[0], &buffer, kAllSubresources, kCopyDest, kCopySource));
+
+	// The texture is already in the state the second one needs, unregistered resources are skipped
+	transitions.clear();
+	second.ResolvePendingTransitions(registry, transitions);
+	CHECK(transitions.size() == 1 && Matches(transitions[0], &buffer, kAllSubresources, kCopySource, kShaderResource));
+
+	// Subresource 2 was left as a render target, only it needs a barrier
+	transitions.clear();
+	third.ResolvePendingTransitions(registry, transitions);
+	CHECK(transitions.size() == 1 && Matches(transitions[0], &texture, 2, kRenderTarget, kShaderResource));
+
+	// A reset command list starts over from the registry
+	first.Reset();
+	CHECK(first.GetBarriers().empty());
+	first.Transition(&buffer, kCopyDest);
+	transitions.clear();
+	first.ResolvePendingTransitions(registry, transitions);
+	CHECK(transitions.size() == 1 && Matches(transitions[0], &buffer, kAllSubresources, kShaderResource, kCopyDest));
+
+	registry.Unregister(&texture);
+	CHECK(registry.GetSubresourceCount(&texture) == 1);
+}
+
+int main()
+{
+	TestRedundantTransitions();
+	TestMergedBarriers();
+	TestSubresources();
+	TestResolveInSubmissionOrder();
+	return ReportTestResults("ResourceStateTrackerTests");
+}
@@ -0,0 +1,178 @@
+#include "Test.h"
+#include "RingAllocator.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+static void TestAlignment()
+{
+	RingAllocator ring(4096);
+	uint64_t first = ring.Allocate(10, 1);
+	uint64_t second = ring.Allocate(10, 256);
+	uint64_t third = ring.Allocate(1, 512);
+	CHECK(first == 0);
+	CHECK(second == 256);
+	CHECK(third == 512);
+	// Padding counts as used until the region is retired
+	CHECK(ring.GetUsedSize() == 513);
+
+	CHECK(ring.Allocate(0, 1) == kInvalidOffset);
+	CHECK(ring.Allocate(4097, 1) == kInvalidOffset);
+}
+
+static void TestFullRing()
+{
+	RingAllocator ring(1024);
+	for (uint64_t i = 0; i < 4; i++)
+	{
+		CHECK(ring.Allocate(256, 256) == i * 256);
+	}
+	CHECK(ring.GetUsedSize() == 1024);
+	CHECK(ring.Allocate(1, 1) == kInvalidOffset);
+
+	// Nothing is freed before the fence of the region is reached
+	ring.Submit(1);
+	ring.Retire(0);
+	CHECK(ring.Allocate(1, 1) == kInvalidOffset);
+	ring.Retire(1);
+	CHECK(ring.GetUsedSize() == 0);
+	CHECK(ring.GetPendingRegionCount() == 0);
+
+	// Once empty, allocation restarts from the beginning
+	CHECK(ring.Allocate(1024, 1) == 0);
+}
+
+static void TestWraparound()
+{
+	RingAllocator ring(1024);
+	CHECK(ring.Allocate(768, 1) == 0);
+	ring.Submit(1);
+	CHECK(ring.Allocate(128, 1) == 768);
+	ring.Submit(2);
+	ring.Retire(1);
+	CHECK(ring.GetUsedSize() == 128);
+
+	// Does not fit in [896, 1024), wraps to the start and wastes the end of the ring
+	CHECK(ring.Allocate(512, 1) == 0);
+	CHECK(ring.GetUsedSize() == 128 + 128 + 512);
+	ring.Submit(3);
+
+	// Free space is now [512, 768)
+	CHECK(ring.Allocate(512, 1) == kInvalidOffset);
+	CHECK(ring.Allocate(256, 1) == 512);
+	CHECK(ring.Allocate(1, 1) == kInvalidOffset);
+	ring.Submit(4);
+
+	ring.Retire(2);
+	CHECK(ring.GetUsedSize() == 640 + 256);
+	// [768, 896) is free again, the wasted end is only reclaimed with the region that wrapped
+	CHECK(ring.Allocate(128, 1) == 768);
+	CHECK(ring.Allocate(1, 1) == kInvalidOffset);
+	ring.Submit(5);
+	ring.Retire(3);
+	CHECK(ring.Allocate(512, 1) == 0);
+	ring.Retire(5);
+	CHECK(ring.GetUsedSize() == 128 + 512);
+}
+
+static void TestRetireOrder()
+{
+	RingAllocator ring(1024);
+	for (uint64_t fence = 1; fence <= 4; fence++)
+	{
+		CHECK(ring.Allocate(100, 1) != kInvalidOffset);
+		ring.Submit(fence);
+	}
+	// An empty open region is not submitted
+	ring.Submit(5);
+	CHECK(ring.GetPendingRegionCount() == 4);
+
+	ring.Retire(2);
+	CHECK(ring.GetPendingRegionCount() == 2);
+	CHECK(ring.GetUsedSize() == 200);
+	ring.Retire(2);
+	CHECK(ring.GetPendingRegionCount() == 2);
+	ring.Retire(10);
+	CHECK(ring.GetPendingRegionCount() == 0);
+	CHECK(ring.GetUsedSize() == 0);
+}
+
+// Random frames checked against the live allocations : inside the ring, aligned, never overlapping
+static void TestRandomFrames()
+{
+	const uint64_t size = 256 * 1024;
+	const uint64_t framesInFlight = 3;
+	RingAllocator ring(size);
+	std::mt19937 random(42);
+
+	struct Allocation
+	{
+		uint64_t m_offset;
+		uint64_t m_size;
+	};
+	std::deque<std::vector<Allocation>> frames;
+	std::vector<Allocation> open;
+	uint64_t failures = 0;
+
+	for (uint64_t fence = 1; fence <= 20000; fence++)
+	{
+		uint32_t count = random() % 16;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint64_t allocationSize = 1 + random() % 4096;
+			uint64_t alignment = 1ull << (random() % 10);
+			uint64_t offset = ring.Allocate(allocationSize, alignment);
+			if (offset == kInvalidOffset)
+			{
+				failures++;
+				continue;
+			}
+
+			CHECK(offset % alignment == 0);
+			CHECK(offset + allocationSize <= size);
+			for (const std::vector<Allocation>& frame : frames)
+			{
+				for (const Allocation& live : frame)
+				{
+					CHECK(offset + allocationSize <= live.m_offset || live.m_offset + live.m_size <= offset);
+				}
+			}
+			for (const Allocation& live : open)
+			{
+				CHECK(offset + allocationSize <= live.m_offset || live.m_offset + live.m_size <= offset);
+			}
+			open.push_back({ offset, allocationSize });
+		}
+
+		ring.Submit(fence);
+		if (!open.empty())
+			frames.push_back(open);
+		open.clear();
+
+		if (fence > framesInFlight)
+		{
+			ring.Retire(fence - framesInFlight);
+			while (frames.size() > ring.GetPendingRegionCount())
+			{
+				frames.pop_front();
+			}
+		}
+	}
+
+	// Frames average 17 KiB, far from filling the ring even with its end wasted when wrapping
+	CHECK(failures == 0);
+	ring.Retire(~0ull);
+	CHECK(ring.GetUsedSize() == 0);
+}
+
+int main()
+{
+	TestAlignment();
+	TestFullRing();
+	TestWraparound();
+	TestRetireOrder();
+	TestRandomFrames();
+	return ReportTestResults("RingAllocatorTests");
+}
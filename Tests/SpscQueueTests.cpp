@@ -0,0 +1,93 @@
+#include "Test.h"
+#include "SpscQueue.h"
+#include <thread>
+
+using namespace Sigma;
+
+struct Item
+{
+	uint32_t m_sequence;
+	uint32_t m_check;
+};
+
+static uint32_t GetCheck(uint32_t sequence)
+{
+	return sequence * 2654435761u;
+}
+
+static void TestFullAndEmpty()
+{
+	SpscQueue<uint32_t, 4> queue;
+	uint32_t value = 0;
+	CHECK(!queue.Pop(value));
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		CHECK(queue.Push(i));
+	}
+	CHECK(!queue.Push(4));
+
+	// Head and tail keep going past the capacity, values come back in order
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		CHECK(queue.Pop(value) && value == i);
+		CHECK(queue.Push(i + 4));
+		CHECK(!queue.Push(0));
+	}
+	for (uint32_t i = 100; i < 104; i++)
+	{
+		CHECK(queue.Pop(value) && value == i);
+	}
+	CHECK(!queue.Pop(value));
+}
+
+// A producer and a consumer thread on a small queue, so it is full or empty most of the time.
+// Every item must come out once, in order, and with both fields written
+template<uint32_t Capacity>
+static void TestStress(uint32_t numItems)
+{
+	SpscQueue<Item, Capacity> queue;
+
+	std::thread producer([&]()
+	{
+		for (uint32_t i = 0; i < numItems; i++)
+		{
+			Item item = { i, GetCheck(i) };
+			while (!queue.Push(item))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint32_t expected = 0;
+	uint32_t outOfOrder = 0;
+	uint32_t torn = 0;
+	while (expected < numItems)
+	{
+		Item item;
+		if (!queue.Pop(item))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		outOfOrder += item.m_sequence != expected;
+		torn += item.m_check != GetCheck(item.m_sequence);
+		expected = item.m_sequence + 1;
+	}
+	producer.join();
+
+	CHECK(outOfOrder == 0);
+	CHECK(torn == 0);
+	Item item;
+	CHECK(!queue.Pop(item));
+}
+
+int main()
+{
+	TestFullAndEmpty();
+	TestStress<2>(200000);
+	TestStress<64>(1000000);
+	TestStress<1024>(1000000);
+	return ReportTestResults("SpscQueueTests");
+}
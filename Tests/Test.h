@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+
+namespace Sigma
+{
+	// A failed check is reported and the test keeps going, main returns ReportTestResults()
+	inline int& GetFailedCheckCount()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline int ReportTestResults(const char* name)
+	{
+		if (GetFailedCheckCount() == 0)
+		{
+			printf("%s : all checks passed\n", name);
+			return 0;
+		}
+		printf("%s : %d checks failed\n", name, GetFailedCheckCount());
+		return 1;
+	}
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d) : CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			Sigma::GetFailedCheckCount()++; \
+		} \
+	} while (0)
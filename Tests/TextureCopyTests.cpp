@@ -0,0 +1,87 @@
+#include "Test.h"
+#include "TextureCopy.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+static uint32_t SwapRedBlue(uint32_t texel)
+{
+	return (texel & 0xff00ff00) | ((texel >> 16) & 0xff) | ((texel & 0xff) << 16);
+}
+
+// Random sizes, pitches, alignments and conversions, checked against a texel by texel copy. The padding at the end of
+// the destination rows and the bytes around the footprint must be left untouched
+static void TestRandomCopies(uint32_t seed)
+{
+	std::mt19937 random(seed);
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		uint32_t numTexels = 1 + random() % 300;
+		uint32_t numRows = 1 + random() % 5;
+		uint32_t numSlices = 1 + random() % 3;
+		uint64_t rowSize = numTexels * sizeof(uint32_t);
+		uint64_t destinationPitch = rowSize + (random() % 3) * 16 + (random() % 2 ? 0 : 4 * (random() % 4));
+		uint64_t sourcePitch = rowSize + random() % 9;
+		TexelConversion conversion = random() % 2 ? TexelConversion::None : TexelConversion::SwapRedBlue;
+
+		// Any source alignment, destination aligned on a texel or not at all
+		uint32_t sourceOffset = random() % 16;
+		uint32_t destinationOffset = random() % 2 ? 0 : random() % 16;
+		if (random() % 2)
+			destinationOffset &= ~3u;
+
+		std::vector<uint8_t> source(sourceOffset + sourcePitch * numRows * numSlices + 16);
+		for (uint8_t& byte : source)
+		{
+			byte = (uint8_t)random();
+		}
+		std::vector<uint8_t> destination(destinationOffset + destinationPitch * numRows * numSlices + 16, 0xcd);
+		std::vector<uint8_t> expected = destination;
+
+		for (uint32_t row = 0; row < numRows * numSlices; row++)
+		{
+			uint8_t* dst = &expected[destinationOffset + row * destinationPitch];
+			const uint8_t* src = &source[sourceOffset + row * sourcePitch];
+			for (uint32_t texel = 0; texel < numTexels; texel++)
+			{
+				uint32_t value;
+				memcpy(&value, src + texel * sizeof(uint32_t), sizeof(value));
+				if (conversion == TexelConversion::SwapRedBlue)
+					value = SwapRedBlue(value);
+				memcpy(dst + texel * sizeof(uint32_t), &value, sizeof(value));
+			}
+		}
+
+		TextureRows rows = { &destination[destinationOffset], destinationPitch, destinationPitch * numRows, rowSize, numRows, numSlices };
+		CopyTextureRows(rows, &source[sourceOffset], sourcePitch, sourcePitch * numRows, conversion);
+		CHECK(destination == expected);
+	}
+}
+
+// Rows that are not a whole number of texels are copied as is without conversion
+static void TestUnalignedRowSize()
+{
+	std::vector<uint8_t> source(64 * 3);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		source[i] = (uint8_t)i;
+	}
+	std::vector<uint8_t> destination(80 * 3, 0);
+	TextureRows rows = { destination.data(), 80, 80 * 3, 63, 3, 1 };
+	CopyTextureRows(rows, source.data(), 64, 64 * 3, TexelConversion::None);
+	for (uint32_t row = 0; row < 3; row++)
+	{
+		CHECK(memcmp(&destination[row * 80], &source[row * 64], 63) == 0);
+		CHECK(destination[row * 80 + 63] == 0);
+	}
+}
+
+int main()
+{
+	TestRandomCopies(1);
+	TestRandomCopies(2);
+	TestUnalignedRowSize();
+	return ReportTestResults("TextureCopyTests");
+}
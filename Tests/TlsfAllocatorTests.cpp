@@ -0,0 +1,118 @@
+#include "Test.h"
+#include "TlsfAllocator.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace Sigma;
+
+const uint64_t kGranularity = 65536;
+
+static void TestBasics()
+{
+	TlsfAllocator allocator(16 * kGranularity, kGranularity);
+	TlsfAllocation a = allocator.Allocate(1, 1);
+	CHECK(a.m_offset == 0 && a.m_size == kGranularity);
+	TlsfAllocation b = allocator.Allocate(3 * kGranularity, 4 * kGranularity);
+	CHECK(b.m_offset == 4 * kGranularity && b.m_size == 3 * kGranularity);
+
+	TlsfStats stats = allocator.GetStats();
+	CHECK(stats.m_usedSize == 4 * kGranularity);
+	CHECK(stats.m_allocationCount == 2);
+	// The alignment gap stays free in front of b
+	CHECK(stats.m_freeBlockCount == 2);
+
+	CHECK(allocator.Allocate(17 * kGranularity, 1).m_offset == kInvalidOffset);
+
+	allocator.Free(a.m_block);
+	allocator.Free(b.m_block);
+	// Freeing twice does nothing
+	allocator.Free(b.m_block);
+	stats = allocator.GetStats();
+	CHECK(allocator.IsEmpty());
+	CHECK(stats.m_freeBlockCount == 1 && stats.m_largestFreeBlock == 16 * kGranularity);
+
+	// The whole heap in one allocation
+	TlsfAllocation all = allocator.Allocate(16 * kGranularity, kGranularity);
+	CHECK(all.m_offset == 0);
+	CHECK(allocator.Allocate(1, 1).m_offset == kInvalidOffset);
+}
+
+// Random allocations and frees, checked against the live allocations after every operation
+static void TestFuzz(uint64_t numUnits, uint32_t seed)
+{
+	TlsfAllocator allocator(numUnits * kGranularity, kGranularity);
+	std::mt19937 random(seed);
+
+	// Offset -> allocation
+	std::map<uint64_t, TlsfAllocation> live;
+	uint64_t usedSize = 0;
+	uint32_t failures = 0;
+
+	for (uint32_t step = 0; step < 50000; step++)
+	{
+		// Mostly allocating while the heap is emptier, mostly freeing once it fills
+		bool allocate = live.empty() || random() % 100 < (usedSize * 100 < numUnits * kGranularity * 70 ? 70u : 30u);
+		if (allocate)
+		{
+			uint64_t size = 1 + random() % ((random() % 8 == 0 ? 64 : 4) * kGranularity);
+			uint64_t alignment = kGranularity << (random() % 4 == 0 ? random() % 5 : 0);
+			TlsfAllocation allocation = allocator.Allocate(size, alignment);
+			if (allocation.m_offset == kInvalidOffset)
+			{
+				failures++;
+				continue;
+			}
+
+			CHECK(allocation.m_offset % alignment == 0);
+			CHECK(allocation.m_size >= size && allocation.m_size < size + kGranularity);
+			CHECK(allocation.m_offset + allocation.m_size <= allocator.GetSize());
+
+			// No overlap with the allocations right before and after
+			auto next = live.lower_bound(allocation.m_offset);
+			CHECK(next == live.end() || allocation.m_offset + allocation.m_size <= next->first);
+			if (next != live.begin())
+			{
+				auto previous = std::prev(next);
+				CHECK(previous->first + previous->second.m_size <= allocation.m_offset);
+			}
+			live[allocation.m_offset] = allocation;
+			usedSize += allocation.m_size;
+		}
+		else
+		{
+			auto victim = live.begin();
+			std::advance(victim, random() % live.size());
+			allocator.Free(victim->second.m_block);
+			usedSize -= victim->second.m_size;
+			live.erase(victim);
+		}
+
+		// Free neighbours are always merged : at most one free block around each allocation
+		TlsfStats stats = allocator.GetStats();
+		CHECK(stats.m_usedSize == usedSize);
+		CHECK(stats.m_allocationCount == live.size());
+		CHECK(stats.m_freeBlockCount <= live.size() + 1);
+	}
+	CHECK(failures > 0);
+
+	for (const auto& allocation : live)
+	{
+		allocator.Free(allocation.second.m_block);
+	}
+	TlsfStats stats = allocator.GetStats();
+	CHECK(allocator.IsEmpty());
+	CHECK(stats.m_freeBlockCount == 1);
+	CHECK(stats.m_largestFreeBlock == numUnits * kGranularity);
+	CHECK(stats.GetFragmentation() == 0.0);
+}
+
+int main()
+{
+	TestBasics();
+	TestFuzz(1024, 1);
+	TestFuzz(4096, 2);
+	TestFuzz(1000, 3);
+	return ReportTestResults("TlsfAllocatorTests");
+}
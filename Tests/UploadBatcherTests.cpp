@@ -0,0 +1,185 @@
+#include "Test.h"
+#include "UploadBatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace Sigma;
+
+struct TestCommand
+{
+	uint32_t m_id;
+	uint64_t m_ticket; // Given by BeginWrite
+};
+
+typedef UploadBatcher<TestCommand> TestBatcher;
+
+static uint64_t FlushAll(TestBatcher& batcher, std::vector<TestCommand>& commands)
+{
+	return batcher.Flush(commands, [](uint64_t) {});
+}
+
+static void TestTickets()
+{
+	TestBatcher batcher(5);
+	std::vector<TestCommand> commands;
+	uint32_t submits = 0;
+	CHECK(batcher.Flush(commands, [&](uint64_t) { submits++; }) == 0);
+	CHECK(submits == 0 && batcher.GetLastFlushedTicket() == 4);
+
+	// A failed reservation returns 0 and leaves no writer behind, Flush would hang otherwise
+	uint64_t reservedTicket = 0;
+	CHECK(batcher.BeginWrite([&](uint64_t ticket) { reservedTicket = ticket; return false; }) == 0);
+	CHECK(reservedTicket == 5);
+	CHECK(FlushAll(batcher, commands) == 0);
+
+	// A cancelled write adds nothing, the ticket stays open
+	CHECK(batcher.BeginWrite([](uint64_t) { return true; }) == 5);
+	batcher.CancelWrite();
+	CHECK(FlushAll(batcher, commands) == 0);
+
+	for (uint32_t batch = 0; batch < 3; batch++)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			uint64_t ticket = batcher.BeginWrite([](uint64_t) { return true; });
+			CHECK(ticket == 5 + batch);
+			TestCommand command = { i, ticket };
+			batcher.EndWrite(command);
+		}
+		uint64_t submitted = 0;
+		CHECK(batcher.Flush(commands, [&](uint64_t ticket) { submitted = ticket; }) == 5 + batch);
+		CHECK(submitted == 5 + batch && batcher.GetLastFlushedTicket() == 5 + batch);
+		CHECK(commands.size() == 4 && commands[3].m_id == 3);
+		commands.clear();
+	}
+}
+
+// Flush does not close the batch while a write is between BeginWrite and EndWrite, the command makes it in
+static void TestFlushWaitsForWriters()
+{
+	TestBatcher batcher;
+	uint64_t ticket = batcher.BeginWrite([](uint64_t) { return true; });
+	CHECK(ticket == 1);
+
+	std::atomic<bool> flushed(false);
+	std::vector<TestCommand> commands;
+	uint64_t flushedTicket = 0;
+	std::thread flusher([&]()
+	{
+		flushedTicket = FlushAll(batcher, commands);
+		flushed = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(!flushed);
+	TestCommand command = { 7, ticket };
+	batcher.EndWrite(command);
+	flusher.join();
+	CHECK(flushedTicket == 1 && commands.size() == 1 && commands[0].m_id == 7);
+}
+
+// Writers racing a flushing thread : tickets increase one by one, every command lands in the batch of the ticket it was
+// given, nothing is lost or duplicated
+static void TestConcurrentWriters()
+{
+	const uint32_t numWriters = 4;
+	const uint32_t writesPerThread = 5000;
+	TestBatcher batcher;
+	std::atomic<uint32_t> writersDone(0);
+	std::atomic<uint32_t> failedReservations(0);
+	std::vector<uint32_t> cancelled(numWriters, 0);
+
+	std::vector<std::thread> writers;
+	for (uint32_t w = 0; w < numWriters; w++)
+	{
+		writers.emplace_back([&, w]()
+		{
+			std::mt19937 random(w);
+			uint64_t lastWritten = 0;
+			for (uint32_t i = 0; i < writesPerThread; i++)
+			{
+				// Some reservations fail, as when the upload buffer is full
+				bool fail = random() % 16 == 0;
+				uint64_t ticket = batcher.BeginWrite([fail](uint64_t) { return !fail; });
+				if (ticket == 0)
+				{
+					failedReservations++;
+					continue;
+				}
+				if (random() % 8 == 0)
+				{
+					batcher.CancelWrite();
+					cancelled[w]++;
+					continue;
+				}
+				TestCommand command = { w * writesPerThread + i, ticket };
+				batcher.EndWrite(command);
+				lastWritten = ticket;
+
+				// Now and then wait for a flush, so writes span several batches even when the writers are never preempted
+				if (i % 1000 == 999)
+				{
+					while (batcher.GetLastFlushedTicket() < lastWritten)
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+			writersDone++;
+		});
+	}
+
+	std::vector<uint32_t> seen(numWriters * writesPerThread, 0);
+	uint64_t lastTicket = 0;
+	uint32_t batches = 0;
+	uint32_t commandCount = 0;
+	uint32_t wrongTickets = 0;
+	while (true)
+	{
+		bool done = writersDone == numWriters;
+		std::vector<TestCommand> commands;
+		uint64_t submitted = 0;
+		uint64_t ticket = batcher.Flush(commands, [&](uint64_t t) { submitted = t; });
+		if (ticket != 0)
+		{
+			CHECK(ticket == lastTicket + 1 && submitted == ticket);
+			lastTicket = ticket;
+			batches++;
+		}
+		for (const TestCommand& command : commands)
+		{
+			wrongTickets += command.m_ticket != ticket;
+			seen[command.m_id]++;
+			commandCount++;
+		}
+		if (done && ticket == 0)
+			break;
+	}
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+
+	uint32_t totalCancelled = 0;
+	for (uint32_t count : cancelled)
+	{
+		totalCancelled += count;
+	}
+	CHECK(wrongTickets == 0);
+	CHECK(batches > 1 && batcher.GetLastFlushedTicket() == lastTicket);
+	CHECK(failedReservations > 0 && totalCancelled > 0);
+	CHECK(commandCount == numWriters * writesPerThread - failedReservations - totalCancelled);
+	CHECK(std::count_if(seen.begin(), seen.end(), [](uint32_t count) { return count > 1; }) == 0);
+}
+
+int main()
+{
+	TestTickets();
+	TestFlushWaitsForWriters();
+	TestConcurrentWriters();
+	return ReportTestResults("UploadBatcherTests");
+}